@@ -95,6 +95,7 @@ LOCAL_SRC_FILES += \
     base/time.cc \
     base/time_posix.cc \
     base/timer.cc \
+    base/timer_wheel.cc \
     base/tracked.cc \
     base/tracked_objects.cc \
     base/utf_offset_string_conversions.cc \
@@ -106,11 +107,13 @@ LOCAL_SRC_FILES += \
     base/debug/debugger_posix.cc \
     base/debug/stack_trace.cc \
     base/debug/stack_trace_posix.cc \
+    base/debug/trace_event.cc \
     \
     base/i18n/file_util_icu.cc \
     base/i18n/icu_string_conversions.cc \
     base/i18n/time_formatting.cc \
     \
+    base/json/json_parser.cc \
     base/json/json_reader.cc \
     base/json/json_writer.cc \
     base/json/string_escape.cc \
@@ -215,19 +218,26 @@ LOCAL_SRC_FILES += \
     net/disk_cache/bitmap.cc \
     net/disk_cache/block_files.cc \
     net/disk_cache/cache_util_posix.cc \
+    net/disk_cache/compression.cc \
+    net/disk_cache/content_store.cc \
     net/disk_cache/disk_format.cc \
     net/disk_cache/entry_impl.cc \
     net/disk_cache/eviction.cc \
     net/disk_cache/file.cc \
     net/disk_cache/file_lock.cc \
     net/disk_cache/file_posix.cc \
+    net/disk_cache/frequency_sketch.cc \
     net/disk_cache/hash.cc \
     net/disk_cache/in_flight_backend_io.cc \
     net/disk_cache/in_flight_io.cc \
+    net/disk_cache/index_checker.cc \
+    net/disk_cache/index_filter.cc \
+    net/disk_cache/mapped_file.cc \
     net/disk_cache/mapped_file_posix.cc \
     net/disk_cache/mem_backend_impl.cc \
     net/disk_cache/mem_entry_impl.cc \
     net/disk_cache/mem_rankings.cc \
+    net/disk_cache/mem_slab_allocator.cc \
     net/disk_cache/net_log_parameters.cc \
     net/disk_cache/rankings.cc \
     net/disk_cache/stats.cc \
@@ -260,6 +270,9 @@ LOCAL_SRC_FILES += \
     net/http/http_network_layer.cc \
     net/http/http_network_session.cc \
     net/http/http_network_transaction.cc \
+    net/http/http_pipelined_connection.cc \
+    net/http/http_pipelined_host_pool.cc \
+    net/http/http_pipelined_stream.cc \
     net/http/http_proxy_client_socket.cc \
     net/http/http_proxy_client_socket_pool.cc \
     net/http/http_proxy_utils.cc \
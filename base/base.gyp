@@ -114,6 +114,7 @@
         'cpu_unittest.cc',
         'debug/leak_tracker_unittest.cc',
         'debug/stack_trace_unittest.cc',
+        'debug/trace_event_unittest.cc',
         'debug/trace_event_win_unittest.cc',
         'dir_reader_posix_unittest.cc',
         'environment_unittest.cc',
@@ -128,6 +129,7 @@
         'i18n/file_util_icu_unittest.cc',
         'i18n/icu_string_conversions_unittest.cc',
         'i18n/rtl_unittest.cc',
+        'json/json_parser_unittest.cc',
         'json/json_reader_unittest.cc',
         'json/json_writer_unittest.cc',
         'json/string_escape_unittest.cc',
@@ -194,6 +196,7 @@
         'time_unittest.cc',
         'time_win_unittest.cc',
         'timer_unittest.cc',
+        'timer_wheel_unittest.cc',
         'tools_sanity_unittest.cc',
         'tracked_objects_unittest.cc',
         'tuple_unittest.cc',
@@ -256,6 +259,7 @@
             '../third_party/icu/icu.gyp:icudata',
           ],
           'sources!': [
+            'debug/trace_event_unittest.cc',
             'dir_reader_posix_unittest.cc',
             'file_descriptor_shuffle_unittest.cc',
             'threading/worker_pool_posix_unittest.cc',
@@ -273,6 +277,32 @@
         }],
       ],
     },
+    {
+      'target_name': 'base_perftests',
+      'type': 'executable',
+      'dependencies': [
+        'base',
+        'test_support_base',
+        'test_support_perf',
+        '../testing/gtest.gyp:gtest',
+      ],
+      'sources': [
+        'debug/trace_event_perftest.cc',
+        'message_loop_perftest.cc',
+        'metrics/histogram_perftest.cc',
+        'threading/worker_pool_perftest.cc',
+        'timer_perftest.cc',
+        'utf_string_conversions_perftest.cc',
+      ],
+      'conditions': [
+        ['OS == "win"', {
+          'sources!': [
+            'debug/trace_event_perftest.cc',
+            'threading/worker_pool_perftest.cc',
+          ],
+        }],
+      ],
+    },
     {
       'target_name': 'test_support_base',
       'type': '<(library)',
@@ -341,6 +371,21 @@
     },
   ],
   'conditions': [
+    [ 'OS != "win"', {
+      'targets': [
+        {
+          # Prints the metrics of a live StatsTable for Prometheus.
+          'target_name': 'stats_table_scraper',
+          'type': 'executable',
+          'include_dirs': [
+            '..',
+          ],
+          'sources': [
+            'metrics/stats_table_scraper.cc',
+          ],
+        },
+      ],
+    }],
     [ 'OS == "win"', {
       'targets': [
         {
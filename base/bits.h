@@ -10,6 +10,7 @@
 
 #include "base/basictypes.h"
 #include "base/logging.h"
+#include "build/build_config.h"
 
 namespace base {
 namespace bits {
@@ -18,6 +19,9 @@ namespace bits {
 inline int Log2Floor(uint32 n) {
   if (n == 0)
     return -1;
+#if defined(COMPILER_GCC)
+  return 31 - __builtin_clz(n);
+#else
   int log = 0;
   uint32 value = n;
   for (int i = 4; i >= 0; --i) {
@@ -30,6 +34,7 @@ inline int Log2Floor(uint32 n) {
   }
   DCHECK_EQ(value, 1u);
   return log;
+#endif
 }
 
 // Returns the integer i such as 2^(i-1) < n <= 2^i
@@ -1,167 +1,313 @@
-// Copyright (c) 2010 The Chromium Authors. All rights reserved.
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
 #include "base/debug/trace_event.h"
 
+#include <algorithm>
+
 #include "base/format_macros.h"
-#include "base/file_path.h"
-#include "base/file_util.h"
-#include "base/path_service.h"
-#include "base/platform_thread.h"
+#include "base/json/string_escape.h"
+#include "base/logging.h"
 #include "base/process_util.h"
+#include "base/string_util.h"
 #include "base/stringprintf.h"
+#include "base/threading/platform_thread.h"
 #include "base/utf_string_conversions.h"
-#include "base/time.h"
-
-#define USE_UNRELIABLE_NOW
 
 namespace base {
 namespace debug {
 
-static const char* kEventTypeNames[] = {
-  "BEGIN",
-  "END",
-  "INSTANT"
+namespace {
+
+const char* const kEventTypePhases[] = {
+  "B",  // EVENT_BEGIN
+  "E",  // EVENT_END
+  "I"   // EVENT_INSTANT
+};
+
+// Returns the name of |category| in the JSON output.
+const char* GetCategoryName(int category) {
+  switch (category) {
+    case TRACE_CATEGORY_DEFAULT:
+      return "default";
+    case TRACE_CATEGORY_TASK:
+      return "task";
+    case TRACE_CATEGORY_NET:
+      return "net";
+    case TRACE_CATEGORY_DISK_CACHE:
+      return "disk_cache";
+    default:
+      NOTREACHED();
+      return "unknown";
+  }
+}
+
+}  // namespace
+
+// An event, as stored in the buffers.  It takes 64 bytes on 64-bit
+// platforms, and 56 bytes on 32-bit ones.
+struct TraceLog::Record {
+  int64 timestamp;  // The internal value of a TimeTicks.
+  const char* name;
+  const void* id;
+  int16 category;
+  int16 type;
+  int32 thread_id;
+  char extra[32];  // Truncated, and null terminated.
 };
 
-static const FilePath::CharType* kLogFileName =
-    FILE_PATH_LITERAL("trace_%d.log");
+// The ring buffer of the events recorded by a thread.  Only the thread adds
+// records, while any thread may copy them.  When its owner exits, the buffer
+// may be adopted by another thread.
+class TraceLog::ThreadBuffer {
+ public:
+  // The buffer is owned by the current thread.
+  ThreadBuffer()
+      : thread_id_(PlatformThread::CurrentId()),
+        in_use_(1),
+        num_records_(0),
+        full_(0),
+        start_index_(0) {
+  }
+
+  // Makes the current thread the owner of the buffer, if it has none.  The
+  // records of the previous owner are kept.
+  bool TryAcquire() {
+    if (base::subtle::Acquire_CompareAndSwap(&in_use_, 0, 1) != 0)
+      return false;
+    thread_id_ = PlatformThread::CurrentId();
+    return true;
+  }
+
+  // Called by the owner when it exits.
+  void Release() {
+    base::subtle::Release_Store(&in_use_, 0);
+  }
+
+  // Forgets the records added so far.  Called under TraceLog::lock_.
+  void Restart() {
+    start_index_ = static_cast<uint32>(
+        base::subtle::Acquire_Load(&num_records_));
+  }
+
+  // Only called on the thread that owns this buffer.
+  void Add(TraceCategory category, const char* name, EventType type,
+           const void* id, const char* extra) {
+    uint32 index = static_cast<uint32>(
+        base::subtle::NoBarrier_Load(&num_records_));
+    Record& record = records_[index & (kEventsPerThread - 1)];
+    record.timestamp = TimeTicks::HighResNow().ToInternalValue();
+    record.name = name;
+    record.id = id;
+    record.category = static_cast<int16>(category);
+    record.type = static_cast<int16>(type);
+    record.thread_id = static_cast<int32>(thread_id_);
+    if (extra)
+      base::strlcpy(record.extra, extra, sizeof(record.extra));
+    else
+      record.extra[0] = '\0';
+
+    // Publish the record.
+    if (index + 1 == kEventsPerThread)
+      base::subtle::Release_Store(&full_, 1);
+    base::subtle::Release_Store(&num_records_,
+                                static_cast<base::subtle::Atomic32>(index + 1));
+  }
+
+  // Appends the records added since the last Restart() that are still in
+  // the buffer to |records|, oldest first.  Called under TraceLog::lock_.
+  void CopyRecords(std::vector<Record>* records) const {
+    uint32 end = static_cast<uint32>(
+        base::subtle::Acquire_Load(&num_records_));
+    uint32 count = base::subtle::Acquire_Load(&full_) ?
+        static_cast<uint32>(kEventsPerThread) : end;
+    count = std::min(count, end - start_index_);
+    size_t first = records->size();
+    for (uint32 i = end - count; i != end; i++)
+      records->push_back(records_[i & (kEventsPerThread - 1)]);
+
+    // The owning thread may have overwritten the oldest records while we
+    // were copying them, including the one it may be writing right now.
+    base::subtle::MemoryBarrier();
+    uint32 new_end = static_cast<uint32>(
+        base::subtle::Acquire_Load(&num_records_));
+    size_t num_overwritten = 0;
+    for (uint32 i = end - count;
+         i != end && new_end - i >= static_cast<uint32>(kEventsPerThread);
+         i++) {
+      num_overwritten++;
+    }
+    records->erase(records->begin() + first,
+                   records->begin() + first + num_overwritten);
+  }
+
+ private:
+  // Only used by the owner.
+  PlatformThreadId thread_id_;
+
+  // 1 while a thread owns the buffer.
+  base::subtle::Atomic32 in_use_;
+
+  // The number of records ever added, modulo 2^32.  The next record goes
+  // at this index, modulo kEventsPerThread.
+  base::subtle::Atomic32 num_records_;
+
+  // Set once the buffer has wrapped around.
+  base::subtle::Atomic32 full_;
+
+  // The index of the first record to report.
+  uint32 start_index_;
+
+  Record records_[kEventsPerThread];
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadBuffer);
+};
+
+// static
+base::subtle::Atomic32 TraceLog::enabled_categories_ = 0;
 
 // static
 TraceLog* TraceLog::GetInstance() {
-  return Singleton<TraceLog, DefaultSingletonTraits<TraceLog> >::get();
+  // Leaky, since threads may trace until the very end.
+  return Singleton<TraceLog, LeakySingletonTraits<TraceLog> >::get();
 }
 
 // static
 bool TraceLog::IsTracing() {
-  return TraceLog::GetInstance()->enabled_;
+  return base::subtle::NoBarrier_Load(&enabled_categories_) != 0;
 }
 
 // static
 bool TraceLog::StartTracing() {
-  return TraceLog::GetInstance()->Start();
+  StartTracingCategories(TRACE_CATEGORY_ALL);
+  return true;
+}
+
+// static
+void TraceLog::StartTracingCategories(int categories) {
+  TraceLog* trace_log = GetInstance();
+  AutoLock lock(trace_log->lock_);
+  trace_log->trace_start_time_ = TimeTicks::HighResNow();
+  for (size_t i = 0; i < trace_log->thread_buffers_.size(); i++)
+    trace_log->thread_buffers_[i]->Restart();
+  base::subtle::Release_Store(&enabled_categories_, categories);
 }
 
 // static
 void TraceLog::StopTracing() {
-  return TraceLog::GetInstance()->Stop();
+  base::subtle::Release_Store(&enabled_categories_, 0);
+}
+
+// static
+void TraceLog::AddEvent(TraceCategory category,
+                        const char* name,
+                        EventType type,
+                        const void* id,
+                        const char* extra) {
+  GetInstance()->GetThreadBuffer()->Add(category, name, type, id, extra);
+}
+
+// static
+void TraceLog::GetTraceJSON(std::string* json) {
+  GetInstance()->GetJSON(json);
+}
+
+// static
+size_t TraceLog::GetNumThreadBuffersForTest() {
+  TraceLog* trace_log = GetInstance();
+  AutoLock lock(trace_log->lock_);
+  return trace_log->thread_buffers_.size();
 }
 
-void TraceLog::Trace(const std::string& name,
+void TraceLog::Trace(const char* name,
                      EventType type,
                      const void* id,
                      const std::wstring& extra,
                      const char* file,
                      int line) {
-  if (!enabled_)
+  if (!IsCategoryEnabled(TRACE_CATEGORY_DEFAULT))
     return;
   Trace(name, type, id, WideToUTF8(extra), file, line);
 }
 
-void TraceLog::Trace(const std::string& name,
+void TraceLog::Trace(const char* name,
                      EventType type,
                      const void* id,
                      const std::string& extra,
                      const char* file,
                      int line) {
-  if (!enabled_)
+  if (!IsCategoryEnabled(TRACE_CATEGORY_DEFAULT))
     return;
+  AddEvent(TRACE_CATEGORY_DEFAULT, name, type, id, extra.c_str());
+}
 
-#ifdef USE_UNRELIABLE_NOW
-  TimeTicks tick = TimeTicks::HighResNow();
-#else
-  TimeTicks tick = TimeTicks::Now();
-#endif
-  TimeDelta delta = tick - trace_start_time_;
-  int64 usec = delta.InMicroseconds();
-  std::string msg =
-    StringPrintf("{'pid':'0x%lx', 'tid':'0x%lx', 'type':'%s', "
-                 "'name':'%s', 'id':'%p', 'extra':'%s', 'file':'%s', "
-                 "'line_number':'%d', 'usec_begin': %" PRId64 "},\n",
-                 static_cast<unsigned long>(base::GetCurrentProcId()),
-                 static_cast<unsigned long>(PlatformThread::CurrentId()),
-                 kEventTypeNames[type],
-                 name.c_str(),
-                 id,
-                 extra.c_str(),
-                 file,
-                 line,
-                 usec);
-
-  Log(msg);
-}
-
-TraceLog::TraceLog() : enabled_(false), log_file_(NULL) {
-  base::ProcessHandle proc = base::GetCurrentProcessHandle();
-#if !defined(OS_MACOSX)
-  process_metrics_.reset(base::ProcessMetrics::CreateProcessMetrics(proc));
-#else
-  // The default port provider is sufficient to get data for the current
-  // process.
-  process_metrics_.reset(base::ProcessMetrics::CreateProcessMetrics(proc,
-                                                                    NULL));
-#endif
+TraceLog::TraceLog() : thread_buffer_(&TraceLog::OnThreadExit) {
 }
 
 TraceLog::~TraceLog() {
-  Stop();
-}
-
-bool TraceLog::OpenLogFile() {
-  FilePath::StringType pid_filename =
-      StringPrintf(kLogFileName, base::GetCurrentProcId());
-  FilePath log_file_path;
-  if (!PathService::Get(base::DIR_EXE, &log_file_path))
-    return false;
-  log_file_path = log_file_path.Append(pid_filename);
-  log_file_ = file_util::OpenFile(log_file_path, "a");
-  if (!log_file_) {
-    // try the current directory
-    log_file_ = file_util::OpenFile(FilePath(pid_filename), "a");
-    if (!log_file_) {
-      return false;
-    }
-  }
-  return true;
+  // The buffers are leaked on purpose: threads may still be adding to them.
 }
 
-void TraceLog::CloseLogFile() {
-  if (log_file_) {
-    file_util::CloseFile(log_file_);
-  }
-}
+TraceLog::ThreadBuffer* TraceLog::GetThreadBuffer() {
+  ThreadBuffer* buffer = static_cast<ThreadBuffer*>(thread_buffer_.Get());
+  if (buffer)
+    return buffer;
 
-bool TraceLog::Start() {
-  if (enabled_)
-    return true;
-  enabled_ = OpenLogFile();
-  if (enabled_) {
-    Log("var raw_trace_events = [\n");
-    trace_start_time_ = TimeTicks::Now();
-    timer_.Start(TimeDelta::FromMilliseconds(250), this, &TraceLog::Heartbeat);
+  AutoLock lock(lock_);
+  // Adopt the buffer of a thread that exited, if any.
+  for (size_t i = 0; i < thread_buffers_.size() && !buffer; i++) {
+    if (thread_buffers_[i]->TryAcquire())
+      buffer = thread_buffers_[i];
   }
-  return enabled_;
-}
-
-void TraceLog::Stop() {
-  if (enabled_) {
-    enabled_ = false;
-    Log("];\n");
-    CloseLogFile();
-    timer_.Stop();
+  if (!buffer) {
+    buffer = new ThreadBuffer;
+    thread_buffers_.push_back(buffer);
   }
+  thread_buffer_.Set(buffer);
+  return buffer;
 }
 
-void TraceLog::Heartbeat() {
-  std::string cpu = StringPrintf("%.0f", process_metrics_->GetCPUUsage());
-  TRACE_EVENT_INSTANT("heartbeat.cpu", 0, cpu);
+// static
+void TraceLog::OnThreadExit(void* buffer) {
+  static_cast<ThreadBuffer*>(buffer)->Release();
 }
 
-void TraceLog::Log(const std::string& msg) {
-  AutoLock lock(file_lock_);
+void TraceLog::GetJSON(std::string* json) {
+  AutoLock lock(lock_);
+  int64 start_time = trace_start_time_.ToInternalValue();
+  unsigned long pid = static_cast<unsigned long>(base::GetCurrentProcId());
+  json->append("{\"traceEvents\":[");
+  bool first_event = true;
+  std::vector<Record> records;
+  for (size_t i = 0; i < thread_buffers_.size(); i++) {
+    records.clear();
+    thread_buffers_[i]->CopyRecords(&records);
 
-  fprintf(log_file_, "%s", msg.c_str());
+    for (size_t j = 0; j < records.size(); j++) {
+      const Record& record = records[j];
+      unsigned long tid = static_cast<unsigned long>(record.thread_id);
+      if (!first_event)
+        json->append(",");
+      first_event = false;
+      StringAppendF(json,
+                    "{\"cat\":\"%s\",\"pid\":%lu,\"tid\":%lu,"
+                    "\"ts\":%" PRId64 ",\"ph\":\"%s\",\"name\":",
+                    GetCategoryName(record.category), pid, tid,
+                    record.timestamp - start_time,
+                    kEventTypePhases[record.type]);
+      JsonDoubleQuote(std::string(record.name), true, json);
+      if (record.id)
+        StringAppendF(json, ",\"id\":\"%p\"", record.id);
+      json->append(",\"args\":{");
+      if (record.extra[0]) {
+        json->append("\"extra\":");
+        JsonDoubleQuote(std::string(record.extra), true, json);
+      }
+      json->append("}}");
+    }
+  }
+  json->append("]}");
 }
 
 }  // namespace debug
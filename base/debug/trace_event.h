@@ -2,15 +2,18 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
-// Trace events to track application performance.  Events consist of a name
-// a type (BEGIN, END or INSTANT), a tracking id and extra string data.
-// In addition, the current process id, thread id, a timestamp down to the
-// microsecond and a file and line number of the calling location.
+// Trace events to track application performance.  Events consist of a
+// category, a name, a type (BEGIN, END or INSTANT) and a tracking id, plus
+// the current thread id and a timestamp down to the microsecond.
 //
-// The current implementation logs these events into a log file of the form
-// trace_<pid>.log where it's designed to be post-processed to generate a
-// trace report.  In the future, it may use another mechansim to facilitate
-// real-time analysis.
+// Each thread records its events as fixed-size binary records in a ring
+// buffer of its own, without locking, so that tracing can be left on in
+// production: a disabled event costs a load and a test, and an enabled one
+// a few dozen nanoseconds.  The most recent events can be dumped at any time
+// in the JSON format of the Chrome trace viewer (chrome://tracing).
+//
+// Only pointers to the names are recorded, so the names of events must be
+// string literals, or otherwise live for as long as the process.
 
 #ifndef BASE_DEBUG_TRACE_EVENT_H_
 #define BASE_DEBUG_TRACE_EVENT_H_
@@ -27,15 +30,67 @@
 // is controlled by Event Tracing for Windows, which will turn tracing on only
 // if there is someone listening for the events it generates.
 #include "base/debug/trace_event_win.h"
+
+// The categorized events are not implemented with ETW.
+#define TRACE_EVENT0(category, name) ((void) 0)
+#define TRACE_EVENT_BEGIN0(category, name) ((void) 0)
+#define TRACE_EVENT_END0(category, name) ((void) 0)
+#define TRACE_EVENT_INSTANT0(category, name) ((void) 0)
+
 #else  // defined(OS_WIN)
 
 #include <string>
+#include <vector>
 
-#include "base/memory/scoped_ptr.h"
+#include "base/atomicops.h"
+#include "base/base_api.h"
+#include "base/basictypes.h"
 #include "base/memory/singleton.h"
 #include "base/synchronization/lock.h"
+#include "base/threading/thread_local_storage.h"
 #include "base/time.h"
-#include "base/timer.h"
+
+// Use the following macros rather than using the TraceLog class directly as
+// the underlying implementation may change in the future.  |category| is one
+// of the TraceCategory values below, without the TRACE_CATEGORY_ prefix.
+// Here's a sample usage:
+//   void HttpStreamParser::DoLoop() {
+//     TRACE_EVENT0(NET, "HttpStreamParser::DoLoop");
+//     ...
+//   }
+
+// Records an event of |name| that lasts until the end of the current scope.
+#define TRACE_EVENT0(category, name) \
+  base::debug::ScopedTraceEvent TRACE_EVENT_UNIQUE_NAME(trace_event_)( \
+      base::debug::TRACE_CATEGORY_##category, name)
+
+// Records that an event of |name| has begun.  All BEGIN events should have
+// corresponding END events with a matching name, on the same thread.
+#define TRACE_EVENT_BEGIN0(category, name) \
+  TRACE_EVENT_ADD(category, name, base::debug::TraceLog::EVENT_BEGIN)
+
+// Records that an event of |name| has ended.
+#define TRACE_EVENT_END0(category, name) \
+  TRACE_EVENT_ADD(category, name, base::debug::TraceLog::EVENT_END)
+
+// Records that an event of |name| with no duration has happened.
+#define TRACE_EVENT_INSTANT0(category, name) \
+  TRACE_EVENT_ADD(category, name, base::debug::TraceLog::EVENT_INSTANT)
+
+// Implementation details of the macros above.
+#define TRACE_EVENT_ADD(category, name, type) \
+  do { \
+    if (base::debug::TraceLog::IsCategoryEnabled( \
+            base::debug::TRACE_CATEGORY_##category)) { \
+      base::debug::TraceLog::AddEvent( \
+          base::debug::TRACE_CATEGORY_##category, name, type, NULL, NULL); \
+    } \
+  } while (0)
+#define TRACE_EVENT_UNIQUE_NAME(prefix) \
+  TRACE_EVENT_UNIQUE_NAME_CONCAT(prefix, __LINE__)
+#define TRACE_EVENT_UNIQUE_NAME_CONCAT(prefix, line) \
+  TRACE_EVENT_UNIQUE_NAME_CONCAT2(prefix, line)
+#define TRACE_EVENT_UNIQUE_NAME_CONCAT2(prefix, line) prefix##line
 
 #ifndef CHROMIUM_ENABLE_TRACE_EVENT
 #define TRACE_EVENT_BEGIN(name, id, extra) ((void) 0)
@@ -43,8 +98,8 @@
 #define TRACE_EVENT_INSTANT(name, id, extra) ((void) 0)
 
 #else  // CHROMIUM_ENABLE_TRACE_EVENT
-// Use the following macros rather than using the TraceLog class directly as the
-// underlying implementation may change in the future.  Here's a sample usage:
+// These older macros record their events in TRACE_CATEGORY_DEFAULT.  The
+// |extra| string is truncated to a few dozen characters.
 // TRACE_EVENT_BEGIN("v8.run", documentId, scriptLocation);
 // RunScript(script);
 // TRACE_EVENT_END("v8.run", documentId, scriptLocation);
@@ -52,43 +107,43 @@
 // Record that an event (of name, id) has begun.  All BEGIN events should have
 // corresponding END events with a matching (name, id).
 #define TRACE_EVENT_BEGIN(name, id, extra) \
-  base::debug::TraceLog::GetInstance()->Trace( \
-      name, \
-      base::debug::TraceLog::EVENT_BEGIN, \
-      reinterpret_cast<const void*>(id), \
-      extra, \
-      __FILE__, \
-      __LINE__)
+  TRACE_EVENT_ADD_EXTRA(name, base::debug::TraceLog::EVENT_BEGIN, id, extra)
 
 // Record that an event (of name, id) has ended.  All END events should have
 // corresponding BEGIN events with a matching (name, id).
 #define TRACE_EVENT_END(name, id, extra) \
-  base::debug::TraceLog::GetInstance()->Trace( \
-      name, \
-      base::debug::TraceLog::EVENT_END, \
-      reinterpret_cast<const void*>(id), \
-      extra, \
-      __FILE__, \
-      __LINE__)
+  TRACE_EVENT_ADD_EXTRA(name, base::debug::TraceLog::EVENT_END, id, extra)
 
 // Record that an event (of name, id) with no duration has happened.
 #define TRACE_EVENT_INSTANT(name, id, extra) \
-  base::debug::TraceLog::GetInstance()->Trace( \
-      name, \
-      base::debug::TraceLog::EVENT_INSTANT, \
-      reinterpret_cast<const void*>(id), \
-      extra, \
-      __FILE__, \
-      __LINE__)
+  TRACE_EVENT_ADD_EXTRA(name, base::debug::TraceLog::EVENT_INSTANT, id, \
+                        extra)
+
+#define TRACE_EVENT_ADD_EXTRA(name, type, id, extra) \
+  do { \
+    if (base::debug::TraceLog::IsCategoryEnabled( \
+            base::debug::TRACE_CATEGORY_DEFAULT)) { \
+      base::debug::TraceLog::GetInstance()->Trace( \
+          name, type, reinterpret_cast<const void*>(id), extra, __FILE__, \
+          __LINE__); \
+    } \
+  } while (0)
 #endif  // CHROMIUM_ENABLE_TRACE_EVENT
 
 namespace base {
+namespace debug {
 
-class ProcessMetrics;
+// The categories of trace events, which can be enabled separately.
+enum TraceCategory {
+  TRACE_CATEGORY_DEFAULT = 1 << 0,  // TRACE_EVENT_BEGIN and friends.
+  TRACE_CATEGORY_TASK = 1 << 1,     // Tasks run by a MessageLoop.
+  TRACE_CATEGORY_NET = 1 << 2,      // The network stack.
+  TRACE_CATEGORY_DISK_CACHE = 1 << 3,
 
-namespace debug {
+  TRACE_CATEGORY_ALL = (1 << 4) - 1
+};
 
-class TraceLog {
+class BASE_API TraceLog {
  public:
   enum EventType {
     EVENT_BEGIN,
@@ -96,23 +151,54 @@ class TraceLog {
     EVENT_INSTANT
   };
 
+  // The number of events that each thread keeps.
+  enum { kEventsPerThread = 4096 };
+
   static TraceLog* GetInstance();
 
   // Is tracing currently enabled.
   static bool IsTracing();
-  // Start logging trace events.
+  // Start recording trace events of all the categories.  Always succeeds.
   static bool StartTracing();
-  // Stop logging trace events.
+  // Start recording the trace events of |categories|, a mask of
+  // TraceCategory values.  The events recorded before are forgotten.
+  static void StartTracingCategories(int categories);
+  // Stop recording trace events.  The recorded events can still be dumped.
   static void StopTracing();
 
-  // Log a trace event of (name, type, id) with the optional extra string.
-  void Trace(const std::string& name,
+  // Returns true if the events of |category| are recorded.
+  static bool IsCategoryEnabled(TraceCategory category) {
+    return (base::subtle::NoBarrier_Load(&enabled_categories_) & category) !=
+        0;
+  }
+
+  // Records an event of |category| on the current thread.  |name| must live
+  // for as long as the process.  |extra| may be NULL.  This is called by
+  // the macros above after they checked that |category| is enabled.
+  static void AddEvent(TraceCategory category,
+                       const char* name,
+                       EventType type,
+                       const void* id,
+                       const char* extra);
+
+  // Writes the events recorded since tracing was last started to |json|,
+  // in the format of the Chrome trace viewer.  Each thread reports its last
+  // kEventsPerThread - 1 events, since its oldest one may be getting
+  // overwritten.  This may be called on any thread, at any time.
+  static void GetTraceJSON(std::string* json);
+
+  // Returns the number of buffers allocated so far.
+  static size_t GetNumThreadBuffersForTest();
+
+  // Log a trace event of (name, type, id) with the optional extra string, in
+  // TRACE_CATEGORY_DEFAULT.
+  void Trace(const char* name,
              EventType type,
              const void* id,
              const std::wstring& extra,
              const char* file,
              int line);
-  void Trace(const std::string& name,
+  void Trace(const char* name,
              EventType type,
              const void* id,
              const std::string& extra,
@@ -124,23 +210,61 @@ class TraceLog {
   // by the Singleton class.
   friend struct DefaultSingletonTraits<TraceLog>;
 
+  struct Record;
+  class ThreadBuffer;
+
   TraceLog();
   ~TraceLog();
-  bool OpenLogFile();
-  void CloseLogFile();
-  bool Start();
-  void Stop();
-  void Heartbeat();
-  void Log(const std::string& msg);
-
-  bool enabled_;
-  FILE* log_file_;
-  base::Lock file_lock_;
+
+  // Returns the buffer of the current thread, creating it if needed.
+  ThreadBuffer* GetThreadBuffer();
+
+  // Lets another thread adopt the buffer of the exiting thread.
+  static void OnThreadExit(void* buffer);
+
+  void GetJSON(std::string* json);
+
+  // A mask of the enabled TraceCategory values.
+  static base::subtle::Atomic32 enabled_categories_;
+
+  // Protects the fields below.
+  base::Lock lock_;
+
+  // The buffer of each thread that recorded events.
+  base::ThreadLocalStorage::Slot thread_buffer_;
+
+  // The buffers of all the threads that recorded events.  When a thread
+  // exits, its buffer is reused by the next thread that needs one, so there
+  // are no more buffers than threads tracing at the same time.  They are
+  // never deleted, since their threads may still use them.
+  std::vector<ThreadBuffer*> thread_buffers_;
+
   TimeTicks trace_start_time_;
-#ifndef ANDROID
-  scoped_ptr<base::ProcessMetrics> process_metrics_;
-#endif
-  RepeatingTimer<TraceLog> timer_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceLog);
+};
+
+// Records a BEGIN event when constructed and the matching END event when
+// destroyed.  Use TRACE_EVENT0 rather than this class.
+class ScopedTraceEvent {
+ public:
+  ScopedTraceEvent(TraceCategory category, const char* name)
+      : name_(TraceLog::IsCategoryEnabled(category) ? name : NULL),
+        category_(category) {
+    if (name_)
+      TraceLog::AddEvent(category_, name_, TraceLog::EVENT_BEGIN, NULL, NULL);
+  }
+
+  ~ScopedTraceEvent() {
+    if (name_)
+      TraceLog::AddEvent(category_, name_, TraceLog::EVENT_END, NULL, NULL);
+  }
+
+ private:
+  const char* name_;  // NULL if the category was disabled.
+  TraceCategory category_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTraceEvent);
 };
 
 }  // namespace debug
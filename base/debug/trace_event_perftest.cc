@@ -0,0 +1,43 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event.h"
+
+#include "base/perftimer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+const int kNumEvents = 10000000;
+
+// Records |kNumEvents| scoped events in the NET category, and logs the cost
+// of each under |name|.
+void RecordEvents(const char* name) {
+  PerfTimer timer;
+  for (int i = 0; i < kNumEvents / 2; i++) {
+    TRACE_EVENT0(NET, "TraceEventPerfTest");
+  }
+  LogPerfResult(name, timer.Elapsed().InMicroseconds() * 1000.0 / kNumEvents,
+                "ns/event");
+}
+
+}  // namespace
+
+TEST(TraceEventPerfTest, Disabled) {
+  TraceLog::StartTracingCategories(TRACE_CATEGORY_DISK_CACHE);
+  RecordEvents("TraceEvent_disabled");
+  TraceLog::StopTracing();
+}
+
+TEST(TraceEventPerfTest, Enabled) {
+  TraceLog::StartTracingCategories(TRACE_CATEGORY_NET);
+  RecordEvents("TraceEvent_enabled");
+  TraceLog::StopTracing();
+}
+
+}  // namespace debug
+}  // namespace base
@@ -0,0 +1,226 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event.h"
+
+#include <string>
+#include <vector>
+
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/string_util.h"
+#include "base/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+// The parts of a traced event that the tests look at.
+struct Event {
+  std::string category;
+  std::string name;
+  std::string phase;
+  std::string id;
+  std::string extra;
+  int thread_id;
+};
+
+// Returns the recorded events whose name starts with "TraceEventTest".
+std::vector<Event> GetEvents() {
+  std::string json;
+  TraceLog::GetTraceJSON(&json);
+  scoped_ptr<Value> root(JSONReader::Read(json, false));
+  EXPECT_TRUE(root.get()) << json;
+
+  std::vector<Event> events;
+  ListValue* list = NULL;
+  if (!root.get() || !root->IsType(Value::TYPE_DICTIONARY) ||
+      !static_cast<DictionaryValue*>(root.get())->GetList("traceEvents",
+                                                          &list)) {
+    ADD_FAILURE() << json;
+    return events;
+  }
+
+  for (size_t i = 0; i < list->GetSize(); i++) {
+    DictionaryValue* item = NULL;
+    EXPECT_TRUE(list->GetDictionary(i, &item));
+    Event event;
+    EXPECT_TRUE(item->GetString("name", &event.name));
+    if (!StartsWithASCII(event.name, "TraceEventTest", true))
+      continue;
+    EXPECT_TRUE(item->GetString("cat", &event.category));
+    EXPECT_TRUE(item->GetString("ph", &event.phase));
+    EXPECT_TRUE(item->GetInteger("tid", &event.thread_id));
+    item->GetString("id", &event.id);
+    item->GetString("args.extra", &event.extra);
+    events.push_back(event);
+  }
+  return events;
+}
+
+// Records |num_events| instant events.
+class EventRecorder : public DelegateSimpleThread::Delegate {
+ public:
+  explicit EventRecorder(int num_events) : num_events_(num_events) {}
+
+  virtual void Run() {
+    for (int i = 0; i < num_events_; i++)
+      TRACE_EVENT_INSTANT0(NET, "TraceEventTest.Thread");
+  }
+
+ private:
+  int num_events_;
+
+  DISALLOW_COPY_AND_ASSIGN(EventRecorder);
+};
+
+}  // namespace
+
+TEST(TraceEventTest, Categories) {
+  TraceLog::StartTracingCategories(TRACE_CATEGORY_NET);
+  EXPECT_TRUE(TraceLog::IsTracing());
+  EXPECT_TRUE(TraceLog::IsCategoryEnabled(TRACE_CATEGORY_NET));
+  EXPECT_FALSE(TraceLog::IsCategoryEnabled(TRACE_CATEGORY_DISK_CACHE));
+
+  TRACE_EVENT_INSTANT0(NET, "TraceEventTest.Enabled");
+  TRACE_EVENT_INSTANT0(DISK_CACHE, "TraceEventTest.Disabled");
+  TraceLog::StopTracing();
+  EXPECT_FALSE(TraceLog::IsTracing());
+  TRACE_EVENT_INSTANT0(NET, "TraceEventTest.Stopped");
+
+  std::vector<Event> events = GetEvents();
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ("net", events[0].category);
+  EXPECT_EQ("TraceEventTest.Enabled", events[0].name);
+  EXPECT_EQ("I", events[0].phase);
+}
+
+// The events recorded before tracing was started are not reported.
+TEST(TraceEventTest, Restart) {
+  TraceLog::StartTracing();
+  TRACE_EVENT_INSTANT0(NET, "TraceEventTest.Before");
+  TraceLog::StartTracing();
+  TRACE_EVENT_INSTANT0(NET, "TraceEventTest.After");
+  TraceLog::StopTracing();
+
+  std::vector<Event> events = GetEvents();
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ("TraceEventTest.After", events[0].name);
+}
+
+TEST(TraceEventTest, Scoped) {
+  TraceLog::StartTracing();
+  {
+    TRACE_EVENT0(DISK_CACHE, "TraceEventTest.Outer");
+    TRACE_EVENT0(DISK_CACHE, "TraceEventTest.Inner");
+  }
+  TraceLog::StopTracing();
+
+  std::vector<Event> events = GetEvents();
+  ASSERT_EQ(4u, events.size());
+  EXPECT_EQ("TraceEventTest.Outer", events[0].name);
+  EXPECT_EQ("B", events[0].phase);
+  EXPECT_EQ("TraceEventTest.Inner", events[1].name);
+  EXPECT_EQ("B", events[1].phase);
+  EXPECT_EQ("TraceEventTest.Inner", events[2].name);
+  EXPECT_EQ("E", events[2].phase);
+  EXPECT_EQ("TraceEventTest.Outer", events[3].name);
+  EXPECT_EQ("E", events[3].phase);
+  EXPECT_EQ("disk_cache", events[3].category);
+}
+
+TEST(TraceEventTest, IdAndExtra) {
+  TraceLog::StartTracing();
+  TraceLog::GetInstance()->Trace("TraceEventTest.Extra",
+                                 TraceLog::EVENT_INSTANT,
+                                 reinterpret_cast<const void*>(0x1234),
+                                 std::string("some \"extra\" text"),
+                                 __FILE__, __LINE__);
+  TraceLog::StopTracing();
+
+  std::vector<Event> events = GetEvents();
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ("default", events[0].category);
+  EXPECT_NE(std::string::npos, events[0].id.find("1234"));
+  EXPECT_EQ("some \"extra\" text", events[0].extra);
+}
+
+// Each thread keeps its last kEventsPerThread events, but the oldest one is
+// not reported since it may be getting overwritten.
+TEST(TraceEventTest, Wraparound) {
+  const int kNumEvents = TraceLog::kEventsPerThread * 2 + 10;
+  TraceLog::StartTracing();
+  for (int i = 0; i < kNumEvents; i++) {
+    TraceLog::AddEvent(TRACE_CATEGORY_NET, "TraceEventTest.Wraparound",
+                       TraceLog::EVENT_INSTANT,
+                       reinterpret_cast<const void*>(i + 1), NULL);
+  }
+  TraceLog::StopTracing();
+
+  std::vector<Event> events = GetEvents();
+  ASSERT_EQ(static_cast<size_t>(TraceLog::kEventsPerThread - 1),
+            events.size());
+  for (size_t i = 0; i < events.size(); i++) {
+    int id = kNumEvents - events.size() + i + 1;
+    ASSERT_EQ(StringPrintf("%p", reinterpret_cast<const void*>(id)),
+              events[i].id);
+  }
+}
+
+TEST(TraceEventTest, Threads) {
+  const int kNumThreads = 4;
+  const int kNumEventsPerThread = 100;
+  TraceLog::StartTracing();
+
+  EventRecorder recorder(kNumEventsPerThread);
+  std::vector<DelegateSimpleThread*> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.push_back(new DelegateSimpleThread(&recorder, "trace_event"));
+    threads.back()->Start();
+  }
+  for (int i = 0; i < kNumThreads; i++) {
+    threads[i]->Join();
+    delete threads[i];
+  }
+  TraceLog::StopTracing();
+
+  std::vector<Event> events = GetEvents();
+  ASSERT_EQ(static_cast<size_t>(kNumThreads * kNumEventsPerThread),
+            events.size());
+  for (size_t i = 0; i < events.size(); i++) {
+    // The events of each thread are reported together.
+    if (i % kNumEventsPerThread)
+      EXPECT_EQ(events[i - 1].thread_id, events[i].thread_id);
+  }
+}
+
+// The buffers of the threads that exit are reused, without losing their
+// events.
+TEST(TraceEventTest, ReuseBuffers) {
+  const int kNumThreads = 10;
+  const int kNumEventsPerThread = 100;
+  TraceLog::StartTracing();
+  TRACE_EVENT_INSTANT0(NET, "TraceEventTest.Main");
+  size_t num_buffers = TraceLog::GetNumThreadBuffersForTest();
+
+  EventRecorder recorder(kNumEventsPerThread);
+  for (int i = 0; i < kNumThreads; i++) {
+    DelegateSimpleThread thread(&recorder, "trace_event");
+    thread.Start();
+    thread.Join();
+  }
+  TraceLog::StopTracing();
+
+  EXPECT_LE(TraceLog::GetNumThreadBuffersForTest(), num_buffers + 1);
+  std::vector<Event> events = GetEvents();
+  EXPECT_EQ(static_cast<size_t>(kNumThreads * kNumEventsPerThread + 1),
+            events.size());
+}
+
+}  // namespace debug
+}  // namespace base
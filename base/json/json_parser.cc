@@ -0,0 +1,746 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_parser.h"
+
+#include "base/float_util.h"
+#include "base/logging.h"
+#include "base/string_number_conversions.h"
+#include "base/third_party/icu/icu_utf.h"
+#include "base/utf_string_conversion_utils.h"
+
+namespace base {
+
+namespace {
+
+// The maximum depth of nested values, to keep the consumers that recurse
+// over them from overflowing their stack.
+const size_t kStackLimit = 100;
+
+const char kByteOrderMark[] = "\xEF\xBB\xBF";
+const int kByteOrderMarkLength = 3;
+
+const char kNullLiteral[] = "null";
+const char kTrueLiteral[] = "true";
+const char kFalseLiteral[] = "false";
+
+// The characters that end the fast scan of a string: the quote, the
+// backslash, the newline, and the non-ASCII characters.
+const bool kStringSpecialCharacters[256] = {
+  // 0x00 - 0x1F
+  false, false, false, false, false, false, false, false,
+  false, false, true,  false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  // 0x20 - 0x3F
+  false, false, true,  false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  // 0x40 - 0x5F
+  false, false, false, false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  false, false, false, false, true,  false, false, false,
+  // 0x60 - 0x7F
+  false, false, false, false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  false, false, false, false, false, false, false, false,
+  // 0x80 - 0xFF
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+  true, true, true, true, true, true, true, true,
+};
+
+inline bool IsContinuationByte(char c) {
+  return (c & 0xC0) == 0x80;
+}
+
+// Returns true if |length| bytes at |data| are valid UTF-8, like
+// IsStringUTF8(), without copying them to a string.
+bool IsValidUTF8(const char* data, size_t length) {
+  int32 src_len = static_cast<int32>(length);
+  int32 char_index = 0;
+  while (char_index < src_len) {
+    if (!(data[char_index] & 0x80)) {
+      ++char_index;
+      continue;
+    }
+    int32 code_point;
+    CBU8_NEXT(data, char_index, src_len, code_point);
+    if (!IsValidCharacter(code_point))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+JSONParser::JSONParser(Delegate* delegate,
+                       bool check_root,
+                       bool allow_trailing_comma)
+    : delegate_(delegate),
+      check_root_(check_root),
+      allow_trailing_comma_(allow_trailing_comma),
+      expectation_(EXPECT_VALUE),
+      lexer_state_(LEX_NONE),
+      token_is_key_(false),
+      unescaped_start_(0),
+      hex_digits_left_(0),
+      hex_value_(0),
+      hex_is_unicode_(false),
+      high_surrogate_(0),
+      number_state_(NUMBER_START),
+      int_digits_(0),
+      int_leading_zero_(false),
+      literal_(NULL),
+      literal_length_(0),
+      byte_order_mark_length_(0),
+      chunk_(NULL),
+      pos_(NULL),
+      end_(NULL),
+      offset_(0),
+      line_(1),
+      line_start_(0),
+      line_continuation_bytes_(0),
+      token_line_(0),
+      token_column_(0),
+      escape_line_(0),
+      escape_column_(0),
+      error_code_(JSONReader::JSON_NO_ERROR),
+      error_line_(0),
+      error_column_(0) {
+}
+
+JSONParser::~JSONParser() {
+}
+
+bool JSONParser::Parse(const char* data, size_t length) {
+  if (error_code_ != JSONReader::JSON_NO_ERROR)
+    return false;
+
+  chunk_ = data;
+  pos_ = data;
+  end_ = data + length;
+  bool result = ParseChunk();
+  offset_ += length;
+  chunk_ = NULL;
+  pos_ = NULL;
+  end_ = NULL;
+  return result;
+}
+
+bool JSONParser::Finish() {
+  if (error_code_ != JSONReader::JSON_NO_ERROR)
+    return false;
+
+  switch (lexer_state_) {
+    case LEX_NONE:
+    case LEX_LINE_COMMENT:
+    case LEX_BLOCK_COMMENT:
+    case LEX_BLOCK_COMMENT_STAR:
+      // Comments may run to the end of the input.
+      break;
+
+    case LEX_BYTE_ORDER_MARK:
+      return SetError(JSONReader::JSON_UNSUPPORTED_ENCODING, 0, 0);
+
+    case LEX_SLASH:
+      // Not a comment after all.
+      return StartToken('/');
+
+    case LEX_STRING:
+    case LEX_LITERAL:
+      return SetError(JSONReader::JSON_SYNTAX_ERROR, token_line_,
+                      token_column_);
+
+    case LEX_STRING_ESCAPE:
+      return SetError(JSONReader::JSON_INVALID_ESCAPE, line_, Column());
+
+    case LEX_STRING_HEX:
+      return SetError(JSONReader::JSON_INVALID_ESCAPE, escape_line_,
+                      escape_column_);
+
+    case LEX_NUMBER:
+      if (!EndNumber())
+        return false;
+      break;
+  }
+
+  if (expectation_ == EXPECT_NOTHING)
+    return true;
+
+  // Report the missing token as an invalid one at the end of the input.
+  MarkToken();
+  bool result = StartToken('\0');
+  DCHECK(!result);
+  return false;
+}
+
+bool JSONParser::ParseChunk() {
+  while (pos_ < end_) {
+    char c = *pos_;
+    switch (lexer_state_) {
+      case LEX_NONE:
+        if (c == ' ' || c == '\t' || c == '\r') {
+          ++pos_;
+        } else if (c == '\n') {
+          ++pos_;
+          StartLine();
+        } else if (c == '/') {
+          // TODO(tc): This isn't in the RFC so it should be a parser flag.
+          MarkToken();
+          lexer_state_ = LEX_SLASH;
+          ++pos_;
+        } else if (c == kByteOrderMark[0] && offset_ + (pos_ - chunk_) == 0) {
+          lexer_state_ = LEX_BYTE_ORDER_MARK;
+          byte_order_mark_length_ = 1;
+          ++pos_;
+        } else {
+          MarkToken();
+          if (!StartToken(c))
+            return false;
+          ++pos_;
+        }
+        break;
+
+      case LEX_BYTE_ORDER_MARK:
+        if (c != kByteOrderMark[byte_order_mark_length_])
+          return SetError(JSONReader::JSON_UNSUPPORTED_ENCODING, 0, 0);
+        ++pos_;
+        if (++byte_order_mark_length_ == kByteOrderMarkLength) {
+          // Columns are counted from the end of the byte-order mark.
+          line_start_ = kByteOrderMarkLength;
+          lexer_state_ = LEX_NONE;
+        }
+        break;
+
+      case LEX_SLASH:
+        if (c == '/') {
+          lexer_state_ = LEX_LINE_COMMENT;
+        } else if (c == '*') {
+          lexer_state_ = LEX_BLOCK_COMMENT;
+        } else {
+          // Not a comment, so the '/' is an invalid token.
+          return StartToken('/');
+        }
+        ++pos_;
+        break;
+
+      case LEX_LINE_COMMENT:
+        ++pos_;
+        if (c == '\n') {
+          StartLine();
+          lexer_state_ = LEX_NONE;
+        } else if (c == '\r') {
+          lexer_state_ = LEX_NONE;
+        } else if (IsContinuationByte(c)) {
+          ++line_continuation_bytes_;
+        }
+        break;
+
+      case LEX_BLOCK_COMMENT:
+      case LEX_BLOCK_COMMENT_STAR:
+        ++pos_;
+        if (c == '/' && lexer_state_ == LEX_BLOCK_COMMENT_STAR) {
+          lexer_state_ = LEX_NONE;
+          break;
+        }
+        lexer_state_ = c == '*' ? LEX_BLOCK_COMMENT_STAR : LEX_BLOCK_COMMENT;
+        if (c == '\n')
+          StartLine();
+        else if (IsContinuationByte(c))
+          ++line_continuation_bytes_;
+        break;
+
+      case LEX_STRING:
+        if (!ReadString())
+          return false;
+        break;
+
+      case LEX_STRING_ESCAPE:
+        if (!ReadEscape(c))
+          return false;
+        ++pos_;
+        break;
+
+      case LEX_STRING_HEX:
+        if (!ReadHexDigit(c))
+          return false;
+        ++pos_;
+        break;
+
+      case LEX_NUMBER:
+        // The character after the number is left for the next token.
+        if (ReadNumberCharacter(c))
+          ++pos_;
+        else if (!EndNumber())
+          return false;
+        break;
+
+      case LEX_LITERAL:
+        if (c != literal_[literal_length_]) {
+          return SetError(JSONReader::JSON_SYNTAX_ERROR, token_line_,
+                          token_column_);
+        }
+        ++pos_;
+        if (!literal_[++literal_length_]) {
+          lexer_state_ = LEX_NONE;
+          if (literal_ == kNullLiteral)
+            delegate_->OnNull();
+          else
+            delegate_->OnBoolean(literal_ == kTrueLiteral);
+          EndValue();
+        }
+        break;
+    }
+  }
+  return true;
+}
+
+bool JSONParser::StartToken(char c) {
+  switch (expectation_) {
+    case EXPECT_NOTHING:
+      return SetError(JSONReader::JSON_UNEXPECTED_DATA_AFTER_ROOT,
+                      token_line_, token_column_);
+
+    case EXPECT_COLON:
+      if (c != ':') {
+        return SetError(JSONReader::JSON_SYNTAX_ERROR, token_line_,
+                        token_column_);
+      }
+      expectation_ = EXPECT_VALUE;
+      return true;
+
+    case EXPECT_COMMA_OR_END:
+      if (c == ',') {
+        expectation_ = stack_.back() ? EXPECT_KEY : EXPECT_VALUE;
+        return true;
+      }
+      if (c == (stack_.back() ? '}' : ']')) {
+        EndContainer();
+        return true;
+      }
+      return SetError(JSONReader::JSON_SYNTAX_ERROR, token_line_,
+                      token_column_);
+
+    case EXPECT_KEY_OR_OBJECT_END:
+    case EXPECT_KEY:
+      if (c == '}') {
+        // Trailing commas are invalid according to the JSON RFC, but some
+        // consumers need the parsing leniency, so handle accordingly.
+        if (expectation_ == EXPECT_KEY && !allow_trailing_comma_) {
+          return SetError(JSONReader::JSON_TRAILING_COMMA, token_line_,
+                          token_column_);
+        }
+        EndContainer();
+        return true;
+      }
+      if (c != '"') {
+        return SetError(JSONReader::JSON_UNQUOTED_DICTIONARY_KEY,
+                        token_line_, token_column_);
+      }
+      StartString(true);
+      return true;
+
+    case EXPECT_VALUE_OR_ARRAY_END:
+      if (c == ']') {
+        EndContainer();
+        return true;
+      }
+      return StartValue(c);
+
+    case EXPECT_VALUE:
+      // In an array, a value is only expected after a comma.
+      if (c == ']' && !stack_.empty() && !stack_.back()) {
+        if (!allow_trailing_comma_) {
+          return SetError(JSONReader::JSON_TRAILING_COMMA, token_line_,
+                          token_column_);
+        }
+        EndContainer();
+        return true;
+      }
+      return StartValue(c);
+  }
+  NOTREACHED();
+  return false;
+}
+
+bool JSONParser::StartValue(char c) {
+  if (stack_.size() >= kStackLimit) {
+    return SetError(JSONReader::JSON_TOO_MUCH_NESTING, token_line_,
+                    token_column_);
+  }
+
+  // The root token must be an array or an object.
+  if (stack_.empty() && check_root_ && c != '{' && c != '[') {
+    return SetError(JSONReader::JSON_BAD_ROOT_ELEMENT_TYPE, token_line_,
+                    token_column_);
+  }
+
+  switch (c) {
+    case '{':
+      stack_.push_back(true);
+      expectation_ = EXPECT_KEY_OR_OBJECT_END;
+      delegate_->OnObjectBegin();
+      return true;
+
+    case '[':
+      stack_.push_back(false);
+      expectation_ = EXPECT_VALUE_OR_ARRAY_END;
+      delegate_->OnArrayBegin();
+      return true;
+
+    case '"':
+      StartString(false);
+      return true;
+
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      lexer_state_ = LEX_NUMBER;
+      number_state_ = NUMBER_START;
+      token_.clear();
+      ReadNumberCharacter(c);
+      return true;
+
+    case 'n':
+      StartLiteral(kNullLiteral);
+      return true;
+
+    case 't':
+      StartLiteral(kTrueLiteral);
+      return true;
+
+    case 'f':
+      StartLiteral(kFalseLiteral);
+      return true;
+
+    default:
+      // We got a token that's not a value.
+      return SetError(JSONReader::JSON_SYNTAX_ERROR, token_line_,
+                      token_column_);
+  }
+}
+
+void JSONParser::EndValue() {
+  expectation_ = stack_.empty() ? EXPECT_NOTHING : EXPECT_COMMA_OR_END;
+}
+
+void JSONParser::EndContainer() {
+  bool is_object = stack_.back();
+  stack_.pop_back();
+  if (is_object)
+    delegate_->OnObjectEnd();
+  else
+    delegate_->OnArrayEnd();
+  EndValue();
+}
+
+void JSONParser::StartLiteral(const char* literal) {
+  lexer_state_ = LEX_LITERAL;
+  literal_ = literal;
+  literal_length_ = 1;
+}
+
+void JSONParser::StartString(bool is_key) {
+  lexer_state_ = LEX_STRING;
+  token_.clear();
+  token_is_key_ = is_key;
+  unescaped_start_ = 0;
+  high_surrogate_ = 0;
+}
+
+bool JSONParser::ReadString() {
+  const char* run = pos_;
+  const char* p = pos_;
+  for (;;) {
+    while (p < end_ && !kStringSpecialCharacters[static_cast<uint8>(*p)])
+      ++p;
+    if (p == end_ || *p == '"' || *p == '\\')
+      break;
+    if (*p == '\n') {
+      pos_ = p + 1;
+      StartLine();
+    } else if (IsContinuationByte(*p)) {
+      ++line_continuation_bytes_;
+    }
+    ++p;
+  }
+
+  if (p != run) {
+    FlushHighSurrogate();
+    token_.append(run, p - run);
+  }
+  pos_ = p;
+  if (p == end_)
+    return true;
+
+  // The unescaped characters end here.
+  if (!IsValidUTF8(token_.data() + unescaped_start_,
+                   token_.size() - unescaped_start_)) {
+    return SetError(JSONReader::JSON_UNSUPPORTED_ENCODING, 0, 0);
+  }
+  unescaped_start_ = token_.size();
+  ++pos_;
+  if (*p == '\\') {
+    lexer_state_ = LEX_STRING_ESCAPE;
+    return true;
+  }
+
+  FlushHighSurrogate();
+  lexer_state_ = LEX_NONE;
+  if (token_is_key_) {
+    delegate_->OnKey(token_);
+    expectation_ = EXPECT_COLON;
+  } else {
+    delegate_->OnString(token_);
+    EndValue();
+  }
+  return true;
+}
+
+bool JSONParser::ReadEscape(char c) {
+  char decoded;
+  switch (c) {
+    case '"':
+    case '/':
+    case '\\':
+      decoded = c;
+      break;
+    case 'b':
+      decoded = '\b';
+      break;
+    case 'f':
+      decoded = '\f';
+      break;
+    case 'n':
+      decoded = '\n';
+      break;
+    case 'r':
+      decoded = '\r';
+      break;
+    case 't':
+      decoded = '\t';
+      break;
+    case 'v':
+      decoded = '\v';
+      break;
+
+    case 'x':
+    case 'u':
+      lexer_state_ = LEX_STRING_HEX;
+      escape_line_ = line_;
+      escape_column_ = Column();
+      hex_is_unicode_ = c == 'u';
+      hex_digits_left_ = hex_is_unicode_ ? 4 : 2;
+      hex_value_ = 0;
+      return true;
+
+    default:
+      return SetError(JSONReader::JSON_INVALID_ESCAPE, line_, Column());
+  }
+
+  FlushHighSurrogate();
+  token_.push_back(decoded);
+  unescaped_start_ = token_.size();
+  lexer_state_ = LEX_STRING;
+  return true;
+}
+
+bool JSONParser::ReadHexDigit(char c) {
+  uint32 digit;
+  if (c >= '0' && c <= '9') {
+    digit = c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    digit = c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    digit = c - 'A' + 10;
+  } else {
+    return SetError(JSONReader::JSON_INVALID_ESCAPE, escape_line_,
+                    escape_column_);
+  }
+
+  hex_value_ = (hex_value_ << 4) + digit;
+  if (--hex_digits_left_)
+    return true;
+
+  lexer_state_ = LEX_STRING;
+  if (hex_is_unicode_) {
+    AppendCodeUnit(hex_value_);
+  } else {
+    FlushHighSurrogate();
+    WriteUnicodeCharacter(hex_value_, &token_);
+  }
+  unescaped_start_ = token_.size();
+  return true;
+}
+
+void JSONParser::AppendCodeUnit(uint32 code_unit) {
+  if (high_surrogate_) {
+    if (CBU16_IS_TRAIL(code_unit)) {
+      uint32 code_point = CBU16_GET_SUPPLEMENTARY(high_surrogate_, code_unit);
+      high_surrogate_ = 0;
+      WriteUnicodeCharacter(IsValidCharacter(code_point) ? code_point : 0xFFFD,
+                            &token_);
+      return;
+    }
+    FlushHighSurrogate();
+  }
+
+  if (CBU16_IS_LEAD(code_unit)) {
+    high_surrogate_ = code_unit;
+    return;
+  }
+  WriteUnicodeCharacter(IsValidCharacter(code_unit) ? code_unit : 0xFFFD,
+                        &token_);
+}
+
+void JSONParser::FlushHighSurrogate() {
+  if (!high_surrogate_)
+    return;
+  WriteUnicodeCharacter(0xFFFD, &token_);
+  high_surrogate_ = 0;
+  unescaped_start_ = token_.size();
+}
+
+bool JSONParser::ReadNumberCharacter(char c) {
+  bool is_digit = c >= '0' && c <= '9';
+  switch (number_state_) {
+    case NUMBER_START:
+      if (c == '-') {
+        number_state_ = NUMBER_MINUS;
+        break;
+      }
+      // Fall through.
+    case NUMBER_MINUS:
+      if (!is_digit)
+        return false;
+      number_state_ = NUMBER_INT;
+      int_digits_ = 1;
+      int_leading_zero_ = c == '0';
+      break;
+
+    case NUMBER_INT:
+      if (is_digit)
+        ++int_digits_;
+      else if (c == '.')
+        number_state_ = NUMBER_POINT;
+      else if (c == 'e' || c == 'E')
+        number_state_ = NUMBER_E;
+      else
+        return false;
+      break;
+
+    case NUMBER_POINT:
+      if (!is_digit)
+        return false;
+      number_state_ = NUMBER_FRACTION;
+      break;
+
+    case NUMBER_FRACTION:
+      if (c == 'e' || c == 'E')
+        number_state_ = NUMBER_E;
+      else if (!is_digit)
+        return false;
+      break;
+
+    case NUMBER_E:
+      if (c == '-' || c == '+')
+        number_state_ = NUMBER_EXPONENT_SIGN;
+      else if (is_digit)
+        number_state_ = NUMBER_EXPONENT;
+      else
+        return false;
+      break;
+
+    case NUMBER_EXPONENT_SIGN:
+    case NUMBER_EXPONENT:
+      if (!is_digit)
+        return false;
+      number_state_ = NUMBER_EXPONENT;
+      break;
+  }
+  token_.push_back(c);
+  return true;
+}
+
+bool JSONParser::EndNumber() {
+  lexer_state_ = LEX_NONE;
+
+  // According to RFC4627, a valid number is: [minus] int [frac] [exp], and
+  // leading zeros are invalid.
+  bool complete = number_state_ == NUMBER_INT ||
+                  number_state_ == NUMBER_FRACTION ||
+                  number_state_ == NUMBER_EXPONENT;
+  if (!complete || (int_leading_zero_ && int_digits_ > 1)) {
+    return SetError(JSONReader::JSON_SYNTAX_ERROR, token_line_,
+                    token_column_);
+  }
+
+  // Numbers that don't fit in an int are doubles.
+  int int_value;
+  double double_value;
+  if (number_state_ == NUMBER_INT &&
+      StringToInt(token_.data(), token_.data() + token_.size(), &int_value)) {
+    delegate_->OnInteger(int_value);
+  } else if (StringToDouble(token_, &double_value) &&
+             IsFinite(double_value)) {
+    delegate_->OnDouble(double_value);
+  } else {
+    return SetError(JSONReader::JSON_SYNTAX_ERROR, token_line_,
+                    token_column_);
+  }
+  EndValue();
+  return true;
+}
+
+void JSONParser::StartLine() {
+  ++line_;
+  line_start_ = offset_ + (pos_ - chunk_);
+  line_continuation_bytes_ = 0;
+}
+
+void JSONParser::MarkToken() {
+  token_line_ = line_;
+  token_column_ = Column();
+}
+
+int JSONParser::Column() const {
+  return static_cast<int>(offset_ + (pos_ - chunk_) - line_start_ -
+                          line_continuation_bytes_) + 1;
+}
+
+bool JSONParser::SetError(JSONReader::JsonParseError error,
+                          int line,
+                          int column) {
+  error_code_ = error;
+  error_line_ = line;
+  error_column_ = column;
+  return false;
+}
+
+}  // namespace base
@@ -0,0 +1,244 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// A streaming JSON parser.  Rather than building a Value tree, it reports
+// what it parses to a Delegate as it goes, and it can be fed its input in
+// chunks, so that a document can be processed without buffering it, or
+// allocating anything per element.  JSONReader is built on top of it.
+//
+// The parser accepts the same dialect as JSONReader, see json_reader.h:
+// comments, \x and \v escapes, and optionally trailing commas.  The input
+// must be in UTF-8, and a leading byte-order mark is skipped.
+//
+// Usage:
+//   JSONParser parser(&delegate, true, false);
+//   while (ReadChunk(&chunk) && parser.Parse(chunk.data(), chunk.size())) {}
+//   if (!parser.Finish())
+//     LOG(ERROR) << JSONReader::ErrorCodeToString(parser.error_code());
+
+#ifndef BASE_JSON_JSON_PARSER_H_
+#define BASE_JSON_JSON_PARSER_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/base_api.h"
+#include "base/basictypes.h"
+#include "base/json/json_reader.h"
+
+namespace base {
+
+class BASE_API JSONParser {
+ public:
+  // Receives the elements of the document in order.  An object is reported
+  // as OnObjectBegin(), then OnKey() followed by the value of each member,
+  // then OnObjectEnd().  The strings passed to the delegate are only valid
+  // during the call.  Once the parser reports an error, the delegate is not
+  // called anymore, so it may have seen the beginning of an invalid
+  // document.
+  class BASE_API Delegate {
+   public:
+    virtual ~Delegate() {}
+
+    virtual void OnObjectBegin() = 0;
+    virtual void OnObjectEnd() = 0;
+    virtual void OnArrayBegin() = 0;
+    virtual void OnArrayEnd() = 0;
+    virtual void OnKey(const std::string& key) = 0;
+    virtual void OnString(const std::string& value) = 0;
+    virtual void OnInteger(int value) = 0;
+    virtual void OnDouble(double value) = 0;
+    virtual void OnBoolean(bool value) = 0;
+    virtual void OnNull() = 0;
+  };
+
+  // If |check_root| is true, we require that the root element be an object
+  // or an array.  If |allow_trailing_comma| is true, we will ignore trailing
+  // commas in objects and arrays even though this goes against the RFC.
+  JSONParser(Delegate* delegate, bool check_root, bool allow_trailing_comma);
+  ~JSONParser();
+
+  // Parses the next |length| bytes of the document.  Tokens may be split
+  // across chunks.  Returns false if the document is invalid, after which
+  // the rest of the input is ignored.
+  bool Parse(const char* data, size_t length);
+
+  // Tells the parser that the document is complete.  Returns false if it is
+  // invalid, or incomplete.
+  bool Finish();
+
+  // Returns the error code if the document is invalid, or JSON_NO_ERROR.
+  JSONReader::JsonParseError error_code() const { return error_code_; }
+
+  // The position of the error, starting from 1, or 0 if the error has no
+  // position.  Columns are counted in characters.
+  int error_line() const { return error_line_; }
+  int error_column() const { return error_column_; }
+
+ private:
+  // What may come next in the document, once the current token is done.
+  enum Expectation {
+    EXPECT_VALUE,
+    EXPECT_VALUE_OR_ARRAY_END,    // After '['.
+    EXPECT_KEY_OR_OBJECT_END,     // After '{'.
+    EXPECT_KEY,                   // After a ',' in an object.
+    EXPECT_COLON,
+    EXPECT_COMMA_OR_END,          // After a value in an object or array.
+    EXPECT_NOTHING,               // After the root element.
+  };
+
+  // The token being read, if any.
+  enum LexerState {
+    LEX_NONE,
+    LEX_BYTE_ORDER_MARK,
+    LEX_SLASH,                    // The start of a comment.
+    LEX_LINE_COMMENT,
+    LEX_BLOCK_COMMENT,
+    LEX_BLOCK_COMMENT_STAR,       // A '*' in a block comment.
+    LEX_STRING,
+    LEX_STRING_ESCAPE,            // After a '\' in a string.
+    LEX_STRING_HEX,               // The digits of a \x or \u escape.
+    LEX_NUMBER,
+    LEX_LITERAL,                  // null, true or false.
+  };
+
+  // The parts of a number, which is [minus] int [frac] [exp].
+  enum NumberState {
+    NUMBER_START,
+    NUMBER_MINUS,
+    NUMBER_INT,
+    NUMBER_POINT,
+    NUMBER_FRACTION,
+    NUMBER_E,
+    NUMBER_EXPONENT_SIGN,
+    NUMBER_EXPONENT,
+  };
+
+  // Parses the current chunk.  Returns false on error.
+  bool ParseChunk();
+
+  // Handles the first character |c| of a token, which may be '\0' at the
+  // end of the input.  Returns false on error.
+  bool StartToken(char c);
+
+  // Handles the first character |c| of a value.  Returns false on error.
+  bool StartValue(char c);
+
+  // Called when a value has been reported, to decide what comes next.
+  void EndValue();
+
+  // Ends the innermost object or array.
+  void EndContainer();
+
+  void StartLiteral(const char* literal);
+  void StartString(bool is_key);
+
+  // Reads the current string up to its end, an escape or the end of the
+  // chunk, whichever comes first.  Returns false on error.
+  bool ReadString();
+
+  // Handles the character |c| after a backslash.  Returns false on error.
+  bool ReadEscape(char c);
+
+  // Handles the character |c| of a \x or \u escape.  Returns false on
+  // error.
+  bool ReadHexDigit(char c);
+
+  // Appends the UTF-16 |code_unit| of a \u escape to token_, combining
+  // surrogate pairs.  Unpaired surrogates and non-characters are replaced
+  // with U+FFFD.
+  void AppendCodeUnit(uint32 code_unit);
+
+  // Appends U+FFFD for a pending high surrogate, if any.
+  void FlushHighSurrogate();
+
+  // Handles the character |c| of a number.  Returns false if |c| is not
+  // part of it.
+  bool ReadNumberCharacter(char c);
+
+  // Ends and reports the current number.  Returns false on error.
+  bool EndNumber();
+
+  // Called after the current position moved past a newline.
+  void StartLine();
+
+  // Remembers the current position as the start of a token.
+  void MarkToken();
+
+  // Returns the column of the current position.
+  int Column() const;
+
+  // Sets the error.  Always returns false.
+  bool SetError(JSONReader::JsonParseError error, int line, int column);
+
+  Delegate* delegate_;
+  bool check_root_;
+  bool allow_trailing_comma_;
+
+  Expectation expectation_;
+  LexerState lexer_state_;
+
+  // For each open container, whether it is an object.
+  std::vector<bool> stack_;
+
+  // The decoded characters of the current string or number.
+  std::string token_;
+
+  // Whether the current string is a key.
+  bool token_is_key_;
+
+  // Where the last run of unescaped characters starts in token_.  They are
+  // validated when the run ends.
+  size_t unescaped_start_;
+
+  // The current \x or \u escape: its digits, and its value so far.
+  int hex_digits_left_;
+  uint32 hex_value_;
+  bool hex_is_unicode_;
+
+  // A high surrogate waiting for its low surrogate, or 0.
+  uint32 high_surrogate_;
+
+  // The part of the current number being read, and its integer part.
+  NumberState number_state_;
+  size_t int_digits_;
+  bool int_leading_zero_;
+
+  // The current literal, and the number of its characters read so far.
+  const char* literal_;
+  size_t literal_length_;
+
+  // The number of bytes of the byte-order mark read so far.
+  int byte_order_mark_length_;
+
+  // The chunk being parsed, and the position in it.
+  const char* chunk_;
+  const char* pos_;
+  const char* end_;
+
+  // The offset of the chunk in the document, and the line of the current
+  // position.  Columns are counted in characters, so we also count the
+  // UTF-8 continuation bytes since the start of the line.
+  int64 offset_;
+  int line_;
+  int64 line_start_;
+  int64 line_continuation_bytes_;
+
+  // The position of the current token, and of the current escape.
+  int token_line_;
+  int token_column_;
+  int escape_line_;
+  int escape_column_;
+
+  JSONReader::JsonParseError error_code_;
+  int error_line_;
+  int error_column_;
+
+  DISALLOW_COPY_AND_ASSIGN(JSONParser);
+};
+
+}  // namespace base
+
+#endif  // BASE_JSON_JSON_PARSER_H_
@@ -0,0 +1,140 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_parser.h"
+
+#include <algorithm>
+#include <string>
+
+#include "base/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Records the elements reported by a JSONParser as a string.
+class EventRecorder : public JSONParser::Delegate {
+ public:
+  const std::string& events() const { return events_; }
+
+  virtual void OnObjectBegin() { events_.append("{ "); }
+  virtual void OnObjectEnd() { events_.append("} "); }
+  virtual void OnArrayBegin() { events_.append("[ "); }
+  virtual void OnArrayEnd() { events_.append("] "); }
+  virtual void OnKey(const std::string& key) {
+    StringAppendF(&events_, "key:%s ", key.c_str());
+  }
+  virtual void OnString(const std::string& value) {
+    StringAppendF(&events_, "string:%s ", value.c_str());
+  }
+  virtual void OnInteger(int value) {
+    StringAppendF(&events_, "int:%d ", value);
+  }
+  virtual void OnDouble(double value) {
+    StringAppendF(&events_, "double:%g ", value);
+  }
+  virtual void OnBoolean(bool value) {
+    events_.append(value ? "true " : "false ");
+  }
+  virtual void OnNull() { events_.append("null "); }
+
+ private:
+  std::string events_;
+};
+
+// Parses |json| in chunks of |chunk_size| bytes, and returns the events, or
+// the error and its position.
+std::string ParseInChunks(const std::string& json, size_t chunk_size) {
+  EventRecorder recorder;
+  JSONParser parser(&recorder, false, false);
+  bool success = true;
+  for (size_t i = 0; success && i < json.size(); i += chunk_size)
+    success = parser.Parse(json.data() + i, std::min(chunk_size,
+                                                     json.size() - i));
+  if (success && parser.Finish())
+    return recorder.events();
+  return StringPrintf("error:%d at %d:%d", parser.error_code(),
+                      parser.error_line(), parser.error_column());
+}
+
+// Parses |json| whole, and checks that parsing it in chunks of any size
+// gives the same result.
+std::string Parse(const std::string& json) {
+  std::string result = ParseInChunks(json, json.size() + 1);
+  for (size_t chunk_size = 1; chunk_size <= json.size(); chunk_size++)
+    EXPECT_EQ(result, ParseInChunks(json, chunk_size)) << chunk_size;
+  return result;
+}
+
+std::string Error(JSONReader::JsonParseError error, int line, int column) {
+  return StringPrintf("error:%d at %d:%d", error, line, column);
+}
+
+}  // namespace
+
+TEST(JSONParserTest, Events) {
+  EXPECT_EQ("{ key:a [ int:1 double:2.5 string:x true false null ] "
+            "key:b { } } ",
+            Parse("{\"a\": [1, 2.5, \"x\", true, false, null],\n"
+                  " \"b\": {}}"));
+  EXPECT_EQ("int:-12 ", Parse(" -12 "));
+  EXPECT_EQ("double:3e+09 ", Parse("3000000000"));
+  EXPECT_EQ("double:-150 ", Parse("-1.5E2"));
+  EXPECT_EQ("[ ] ", Parse("/* comment */ [] // comment"));
+  EXPECT_EQ("[ ] ", Parse("\xEF\xBB\xBF[]"));
+}
+
+TEST(JSONParserTest, Strings) {
+  EXPECT_EQ("string:a\"/\\\b\f\n\r\t\v ",
+            Parse("\"a\\\"\\/\\\\\\b\\f\\n\\r\\t\\v\""));
+  EXPECT_EQ("string:A\xC3\xA9 ", Parse("\"\\x41\\xe9\""));
+  EXPECT_EQ("string:\xE7\xBD\x91\xE9\xA1\xB5 ",
+            Parse("\"\xE7\xBD\x91\\u9875\""));
+
+  // Surrogate pairs are combined, and unpaired surrogates replaced.
+  EXPECT_EQ("string:\xF0\x9F\x98\x80 ", Parse("\"\\ud83d\\ude00\""));
+  EXPECT_EQ("string:\xEF\xBF\xBD" "a ", Parse("\"\\ud83da\""));
+  EXPECT_EQ("string:\xEF\xBF\xBD\xEF\xBF\xBD ",
+            Parse("\"\\ude00\\ud83d\""));
+
+  EXPECT_EQ(Error(JSONReader::JSON_UNSUPPORTED_ENCODING, 0, 0),
+            Parse("\"123\xC0\x81\""));
+}
+
+TEST(JSONParserTest, Errors) {
+  EXPECT_EQ(Error(JSONReader::JSON_SYNTAX_ERROR, 2, 7),
+            Parse("[1,\n 2, 3 4]"));
+  // Columns are counted in characters.
+  EXPECT_EQ(Error(JSONReader::JSON_SYNTAX_ERROR, 1, 7),
+            Parse("[\"\xC3\xA9\", nul]"));
+  EXPECT_EQ(Error(JSONReader::JSON_SYNTAX_ERROR, 1, 2), Parse("[01]"));
+  EXPECT_EQ(Error(JSONReader::JSON_SYNTAX_ERROR, 1, 2), Parse("[1.]"));
+  EXPECT_EQ(Error(JSONReader::JSON_SYNTAX_ERROR, 1, 2), Parse("[\"abc"));
+  EXPECT_EQ(Error(JSONReader::JSON_SYNTAX_ERROR, 1, 4), Parse("[1,"));
+  EXPECT_EQ(Error(JSONReader::JSON_INVALID_ESCAPE, 1, 4), Parse("\"a\\u12"));
+  EXPECT_EQ(Error(JSONReader::JSON_INVALID_ESCAPE, 1, 4), Parse("\"a\\"));
+  EXPECT_EQ(Error(JSONReader::JSON_UNQUOTED_DICTIONARY_KEY, 1, 2),
+            Parse("{"));
+  EXPECT_EQ(Error(JSONReader::JSON_UNEXPECTED_DATA_AFTER_ROOT, 1, 4),
+            Parse("{} /"));
+  EXPECT_EQ(Error(JSONReader::JSON_SYNTAX_ERROR, 1, 1), Parse(""));
+}
+
+// The parser keeps no more than the current token, so it can parse
+// documents of any size.
+TEST(JSONParserTest, LargeDocument) {
+  EventRecorder recorder;
+  JSONParser parser(&recorder, true, false);
+  const int kNumChunks = 10000;
+  const std::string kChunk = "{\"key\": [1, 2, \"value\"]},";
+  ASSERT_TRUE(parser.Parse("[", 1));
+  for (int i = 0; i < kNumChunks; i++)
+    ASSERT_TRUE(parser.Parse(kChunk.data(), kChunk.size()));
+  ASSERT_TRUE(parser.Parse("null]", 5));
+  ASSERT_TRUE(parser.Finish());
+  EXPECT_EQ(JSONReader::JSON_NO_ERROR, parser.error_code());
+}
+
+}  // namespace base
@@ -467,6 +467,30 @@ TEST(JSONReaderTest, Reading) {
   ASSERT_FALSE(root.get());
 }
 
+TEST(JSONReaderTest, SharedKeys) {
+  // The dictionaries of a document share their keys.
+  scoped_ptr<Value> root(JSONReader::Read(
+      "[{\"a\": 1, \"b\": 2}, {\"b\": 3, \"a\": 4}]", false));
+  ASSERT_TRUE(root.get());
+  ListValue* list = static_cast<ListValue*>(root.get());
+  DictionaryValue* first;
+  DictionaryValue* second;
+  ASSERT_TRUE(list->GetDictionary(0, &first));
+  ASSERT_TRUE(list->GetDictionary(1, &second));
+  DictionaryValue::key_iterator first_key = first->begin_keys();
+  DictionaryValue::key_iterator second_key = second->begin_keys();
+  EXPECT_EQ("a", *first_key);
+  EXPECT_EQ(&*first_key, &*second_key);
+  ++first_key;
+  ++second_key;
+  EXPECT_EQ("b", *first_key);
+  EXPECT_EQ(&*first_key, &*second_key);
+
+  int value = 0;
+  EXPECT_TRUE(second->GetInteger("a", &value));
+  EXPECT_EQ(4, value);
+}
+
 TEST(JSONReaderTest, ErrorMessages) {
   // Error strings should not be modified in case of success.
   std::string error_message;
@@ -12,6 +12,7 @@
 #include <algorithm>
 
 #include "base/compiler_specific.h"
+#include "base/debug/trace_event.h"
 #include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/message_pump_default.h"
@@ -81,6 +82,18 @@ const base::LinearHistogram::DescriptionPair event_descriptions_[] = {
 
 bool enable_histogrammer_ = false;
 
+// How long a task may wait beyond its post time before it runs ahead of the
+// tasks of higher priority, for each MessageLoop::TaskPriority.
+const int64 kPriorityGracePeriodMs[] = { 0, 50, 500 };
+
+// The names of the priorities in the queueing delay histograms.
+const char* const kPriorityNames[] = { "High", "Normal", "BestEffort" };
+
+COMPILE_ASSERT(arraysize(kPriorityGracePeriodMs) ==
+               MessageLoop::NUM_PRIORITIES, grace_period_for_each_priority);
+COMPILE_ASSERT(arraysize(kPriorityNames) == MessageLoop::NUM_PRIORITIES,
+               name_for_each_priority);
+
 }  // namespace
 
 //------------------------------------------------------------------------------
@@ -116,6 +129,18 @@ MessageLoop::TaskObserver::~TaskObserver() {
 MessageLoop::DestructionObserver::~DestructionObserver() {
 }
 
+//------------------------------------------------------------------------------
+// MessageLoop::IncomingTask
+
+struct MessageLoop::IncomingTask {
+  explicit IncomingTask(const PendingTask& pending_task)
+      : pending_task(pending_task), next(NULL) {
+  }
+
+  PendingTask pending_task;
+  IncomingTask* next;  // The task posted before this one.
+};
+
 //------------------------------------------------------------------------------
 
 MessageLoop::MessageLoop(Type type)
@@ -123,6 +148,7 @@ MessageLoop::MessageLoop(Type type)
       nestable_tasks_allowed_(true),
       exception_restoration_(false),
       message_histogram_(NULL),
+      incoming_queue_(0),
       state_(NULL),
 #ifdef OS_WIN
       os_modal_loop_(false),
@@ -130,6 +156,8 @@ MessageLoop::MessageLoop(Type type)
       next_sequence_num_(0) {
   DCHECK(!current()) << "should only have one message loop per thread";
   lazy_tls_ptr.Pointer()->Set(this);
+  for (int i = 0; i < NUM_PRIORITIES; i++)
+    queueing_delay_histograms_[i] = NULL;
 
 // TODO(rvargas): Get rid of the OS guards.
 #if defined(OS_WIN)
@@ -223,22 +251,41 @@ void MessageLoop::RemoveDestructionObserver(
 
 void MessageLoop::PostTask(
     const tracked_objects::Location& from_here, Task* task) {
-  PostTask_Helper(from_here, task, 0, true);
+  PostTask_Helper(from_here, task, 0, true, PRIORITY_NORMAL);
 }
 
 void MessageLoop::PostDelayedTask(
     const tracked_objects::Location& from_here, Task* task, int64 delay_ms) {
-  PostTask_Helper(from_here, task, delay_ms, true);
+  PostTask_Helper(from_here, task, delay_ms, true, PRIORITY_NORMAL);
 }
 
 void MessageLoop::PostNonNestableTask(
     const tracked_objects::Location& from_here, Task* task) {
-  PostTask_Helper(from_here, task, 0, false);
+  PostTask_Helper(from_here, task, 0, false, PRIORITY_NORMAL);
 }
 
 void MessageLoop::PostNonNestableDelayedTask(
     const tracked_objects::Location& from_here, Task* task, int64 delay_ms) {
-  PostTask_Helper(from_here, task, delay_ms, false);
+  PostTask_Helper(from_here, task, delay_ms, false, PRIORITY_NORMAL);
+}
+
+void MessageLoop::PostTaskWithPriority(
+    const tracked_objects::Location& from_here, Task* task,
+    TaskPriority priority) {
+  DCHECK(priority >= 0 && priority < NUM_PRIORITIES);
+  PostTask_Helper(from_here, task, 0, true, priority);
+}
+
+void MessageLoop::AddTimer(base::TimerWheel::Entry* entry,
+                           TimeTicks run_time) {
+  DCHECK_EQ(this, current());
+  TimeTicks next_run_time = GetNextDelayedRunTime();
+  timer_wheel_.Add(entry, run_time);
+
+  // If we changed the first delayed task, then it is time to re-schedule.
+  TimeTicks new_next_run_time = GetNextDelayedRunTime();
+  if (next_run_time.is_null() || new_next_run_time < next_run_time)
+    pump_->ScheduleDelayedWork(new_next_run_time);
 }
 
 void MessageLoop::Run() {
@@ -300,8 +347,7 @@ void MessageLoop::RemoveTaskObserver(TaskObserver* task_observer) {
 
 void MessageLoop::AssertIdle() const {
   // We only check |incoming_queue_|, since we don't want to lock |work_queue_|.
-  base::AutoLock lock(incoming_queue_lock_);
-  DCHECK(incoming_queue_.empty());
+  DCHECK(!base::subtle::Acquire_Load(&incoming_queue_));
 }
 
 //------------------------------------------------------------------------------
@@ -373,7 +419,9 @@ void MessageLoop::RunTask(Task* task) {
   HistogramEvent(kTaskRunEvent);
   FOR_EACH_OBSERVER(TaskObserver, task_observers_,
                     WillProcessTask(task));
+  TRACE_EVENT_BEGIN0(TASK, "MessageLoop::RunTask");
   task->Run();
+  TRACE_EVENT_END0(TASK, "MessageLoop::RunTask");
   FOR_EACH_OBSERVER(TaskObserver, task_observers_, DidProcessTask(task));
   delete task;
 
@@ -404,29 +452,76 @@ void MessageLoop::AddToDelayedWorkQueue(const PendingTask& pending_task) {
   delayed_work_queue_.push(new_pending_task);
 }
 
+TimeTicks MessageLoop::GetNextDelayedRunTime() const {
+  TimeTicks next_run_time = timer_wheel_.NextRunTime();
+  if (!delayed_work_queue_.empty()) {
+    TimeTicks run_time = delayed_work_queue_.top().delayed_run_time;
+    if (next_run_time.is_null() || run_time < next_run_time)
+      next_run_time = run_time;
+  }
+  return next_run_time;
+}
+
 void MessageLoop::ReloadWorkQueue() {
-  // We can improve performance of our loading tasks from incoming_queue_ to
-  // work_queue_ by waiting until the last minute (work_queue_ is empty) to
-  // load.  That reduces the number of locks-per-task significantly when our
-  // queues get large.
-  if (!work_queue_.empty())
-    return;  // Wait till we *really* need to lock and load.
-
-  // Acquire all we can from the inter-thread queue with one lock acquisition.
-  {
-    base::AutoLock lock(incoming_queue_lock_);
-    if (incoming_queue_.empty())
-      return;
-    incoming_queue_.Swap(&work_queue_);  // Constant time
-    DCHECK(incoming_queue_.empty());
+  // We load the incoming tasks as soon as there are some, rather than when
+  // work_queues_ run dry, so that a task of high priority doesn't wait for
+  // the tasks loaded before it.  Checking for them is cheap.
+  if (!base::subtle::NoBarrier_Load(&incoming_queue_))
+    return;
+
+  // Acquire all we can from the inter-thread queue with one atomic operation.
+  IncomingTask* incoming_task = reinterpret_cast<IncomingTask*>(
+      base::subtle::NoBarrier_AtomicExchange(&incoming_queue_, 0));
+  base::subtle::MemoryBarrier();
+
+  // The tasks are linked newest first.
+  IncomingTask* oldest_task = NULL;
+  while (incoming_task) {
+    IncomingTask* next = incoming_task->next;
+    incoming_task->next = oldest_task;
+    oldest_task = incoming_task;
+    incoming_task = next;
+  }
+
+  while (oldest_task) {
+    work_queues_[oldest_task->pending_task.priority].push(
+        oldest_task->pending_task);
+    IncomingTask* next = oldest_task->next;
+    delete oldest_task;
+    oldest_task = next;
+  }
+}
+
+bool MessageLoop::TakeNextWorkTask(PendingTask* pending_task) {
+  // Run the task with the earliest deadline, where the deadline of a task is
+  // its post time plus the grace period of its priority.  Ties go to the
+  // higher priority.
+  TaskQueue* next_queue = NULL;
+  TimeTicks next_deadline;
+  for (int i = 0; i < NUM_PRIORITIES; i++) {
+    TaskQueue& queue = work_queues_[i];
+    if (queue.empty())
+      continue;
+    TimeTicks deadline = queue.front().post_time +
+        TimeDelta::FromMilliseconds(kPriorityGracePeriodMs[i]);
+    if (!next_queue || deadline < next_deadline) {
+      next_queue = &queue;
+      next_deadline = deadline;
+    }
   }
+  if (!next_queue)
+    return false;
+
+  *pending_task = next_queue->front();
+  next_queue->pop();
+  return true;
 }
 
 bool MessageLoop::DeletePendingTasks() {
-  bool did_work = !work_queue_.empty();
-  while (!work_queue_.empty()) {
-    PendingTask pending_task = work_queue_.front();
-    work_queue_.pop();
+  bool did_work = false;
+  PendingTask pending_task(NULL, true);
+  while (TakeNextWorkTask(&pending_task)) {
+    did_work = true;
     if (!pending_task.delayed_run_time.is_null()) {
       // We want to delete delayed tasks in the same order in which they would
       // normally be deleted in case of any funny dependencies between delayed
@@ -465,20 +560,25 @@ bool MessageLoop::DeletePendingTasks() {
     delayed_work_queue_.pop();
     delete task;
   }
+  did_work |= !timer_wheel_.empty();
+  while (base::TimerWheel::Entry* entry = timer_wheel_.PopAny())
+    delete entry->task();
   return did_work;
 }
 
 // Possibly called on a background thread!
 void MessageLoop::PostTask_Helper(
     const tracked_objects::Location& from_here, Task* task, int64 delay_ms,
-    bool nestable) {
+    bool nestable, TaskPriority priority) {
   task->SetBirthPlace(from_here);
 
   PendingTask pending_task(task, nestable);
+  pending_task.priority = priority;
+  pending_task.post_time = TimeTicks::Now();
 
   if (delay_ms > 0) {
     pending_task.delayed_run_time =
-        TimeTicks::Now() + TimeDelta::FromMilliseconds(delay_ms);
+        pending_task.post_time + TimeDelta::FromMilliseconds(delay_ms);
 
 #if defined(OS_WIN)
     if (high_resolution_timer_expiration_.is_null()) {
@@ -513,21 +613,29 @@ void MessageLoop::PostTask_Helper(
   // directly, as it could starve handling of foreign threads.  Put every task
   // into this queue.
 
-  scoped_refptr<base::MessagePump> pump;
-  {
-    base::AutoLock locked(incoming_queue_lock_);
-
-    bool was_empty = incoming_queue_.empty();
-    incoming_queue_.push(pending_task);
-    if (!was_empty)
-      return;  // Someone else should have started the sub-pump.
+  IncomingTask* incoming_task = new IncomingTask(pending_task);
 
-    pump = pump_;
-  }
   // Since the incoming_queue_ may contain a task that destroys this message
-  // loop, we cannot exit incoming_queue_lock_ until we are done with |this|.
-  // We use a stack-based reference to the message pump so that we can call
-  // ScheduleWork outside of incoming_queue_lock_.
+  // loop, we cannot use |this| once our task is in the queue.  We grab a
+  // stack-based reference to the message pump before adding the first task of
+  // an empty queue, so that we can call ScheduleWork afterwards.
+  scoped_refptr<base::MessagePump> pump;
+  base::subtle::AtomicWord head =
+      base::subtle::NoBarrier_Load(&incoming_queue_);
+  for (;;) {
+    if (!head && !pump)
+      pump = pump_;
+    incoming_task->next = reinterpret_cast<IncomingTask*>(head);
+    base::subtle::AtomicWord old_head = base::subtle::Release_CompareAndSwap(
+        &incoming_queue_, head,
+        reinterpret_cast<base::subtle::AtomicWord>(incoming_task));
+    if (old_head == head)
+      break;
+    head = old_head;
+  }
+
+  if (head)
+    return;  // Someone else should have started the sub-pump.
 
   pump->ScheduleWork();
 }
@@ -546,6 +654,14 @@ void MessageLoop::StartHistogrammer() {
         kNumberOfDistinctMessagesDisplayed,
         message_histogram_->kHexRangePrintingFlag);
     message_histogram_->SetRangeDescriptions(event_descriptions_);
+
+    for (int i = 0; i < NUM_PRIORITIES; i++) {
+      queueing_delay_histograms_[i] = base::Histogram::FactoryTimeGet(
+          std::string("MsgLoop.QueueingDelay.") + kPriorityNames[i] + ":" +
+              thread_name_,
+          TimeDelta::FromMilliseconds(1), TimeDelta::FromSeconds(10), 50,
+          base::Histogram::kNoFlags);
+    }
   }
 }
 
@@ -560,25 +676,25 @@ bool MessageLoop::DoWork() {
     return false;
   }
 
+  PendingTask pending_task(NULL, true);
   for (;;) {
     ReloadWorkQueue();
-    if (work_queue_.empty())
+    if (!TakeNextWorkTask(&pending_task))
       break;
 
-    // Execute oldest task.
-    do {
-      PendingTask pending_task = work_queue_.front();
-      work_queue_.pop();
-      if (!pending_task.delayed_run_time.is_null()) {
-        AddToDelayedWorkQueue(pending_task);
-        // If we changed the topmost task, then it is time to re-schedule.
-        if (delayed_work_queue_.top().task == pending_task.task)
-          pump_->ScheduleDelayedWork(pending_task.delayed_run_time);
-      } else {
-        if (DeferOrRunPendingTask(pending_task))
-          return true;
-      }
-    } while (!work_queue_.empty());
+    if (!pending_task.delayed_run_time.is_null()) {
+      AddToDelayedWorkQueue(pending_task);
+      // If we changed the topmost task, then it is time to re-schedule.
+      if (delayed_work_queue_.top().task == pending_task.task)
+        pump_->ScheduleDelayedWork(pending_task.delayed_run_time);
+    } else {
+      base::Histogram* histogram =
+          queueing_delay_histograms_[pending_task.priority];
+      if (histogram)
+        histogram->AddTime(TimeTicks::Now() - pending_task.post_time);
+      if (DeferOrRunPendingTask(pending_task))
+        return true;
+    }
   }
 
   // Nothing happened.
@@ -586,7 +702,8 @@ bool MessageLoop::DoWork() {
 }
 
 bool MessageLoop::DoDelayedWork(base::TimeTicks* next_delayed_work_time) {
-  if (!nestable_tasks_allowed_ || delayed_work_queue_.empty()) {
+  if (!nestable_tasks_allowed_ ||
+      (delayed_work_queue_.empty() && timer_wheel_.empty())) {
     recent_time_ = *next_delayed_work_time = TimeTicks();
     return false;
   }
@@ -598,7 +715,7 @@ bool MessageLoop::DoDelayedWork(base::TimeTicks* next_delayed_work_time) {
   // fall behind (and have a lot of ready-to-run delayed tasks), the more
   // efficient we'll be at handling the tasks.
 
-  TimeTicks next_run_time = delayed_work_queue_.top().delayed_run_time;
+  TimeTicks next_run_time = GetNextDelayedRunTime();
   if (next_run_time > recent_time_) {
     recent_time_ = TimeTicks::Now();  // Get a better view of Now();
     if (next_run_time > recent_time_) {
@@ -607,11 +724,25 @@ bool MessageLoop::DoDelayedWork(base::TimeTicks* next_delayed_work_time) {
     }
   }
 
-  PendingTask pending_task = delayed_work_queue_.top();
-  delayed_work_queue_.pop();
+  PendingTask pending_task(NULL, true);
+  if (!delayed_work_queue_.empty() &&
+      delayed_work_queue_.top().delayed_run_time == next_run_time) {
+    pending_task = delayed_work_queue_.top();
+    delayed_work_queue_.pop();
+  } else {
+    // The run time of the timer wheel may be too early when its next timer
+    // is more than a few milliseconds away, so there may be nothing to run.
+    base::TimerWheel::Entry* entry = timer_wheel_.PopExpired(recent_time_);
+    if (!entry) {
+      *next_delayed_work_time = GetNextDelayedRunTime();
+      return false;
+    }
+    pending_task.task = entry->task();
+  }
 
-  if (!delayed_work_queue_.empty())
-    *next_delayed_work_time = delayed_work_queue_.top().delayed_run_time;
+  next_run_time = GetNextDelayedRunTime();
+  if (!next_run_time.is_null())
+    *next_delayed_work_time = next_run_time;
 
   return DeferOrRunPendingTask(pending_task);
 }
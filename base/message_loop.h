@@ -9,6 +9,7 @@
 #include <queue>
 #include <string>
 
+#include "base/atomicops.h"
 #include "base/base_api.h"
 #include "base/basictypes.h"
 #include "base/memory/ref_counted.h"
@@ -16,6 +17,7 @@
 #include "base/observer_list.h"
 #include "base/synchronization/lock.h"
 #include "base/task.h"
+#include "base/timer_wheel.h"
 
 #if defined(OS_WIN)
 // We need this to declare base::MessagePumpWin::Dispatcher, which we should
@@ -163,6 +165,24 @@ class BASE_API MessageLoop : public base::MessagePump::Delegate {
   void PostNonNestableDelayedTask(
       const tracked_objects::Location& from_here, Task* task, int64 delay_ms);
 
+  // The priorities of the tasks posted with PostTaskWithPriority.  When
+  // several tasks are ready to run, those of a higher priority run first,
+  // unless a task of lower priority has been waiting for longer than the
+  // grace period of its priority: 50 ms for PRIORITY_NORMAL and 500 ms for
+  // PRIORITY_BEST_EFFORT.  Tasks of the same priority run in FIFO order.
+  //
+  // PostTask uses PRIORITY_NORMAL, as do delayed and non-nestable tasks.
+  enum TaskPriority {
+    PRIORITY_HIGH,         // For latency sensitive work, such as IO.
+    PRIORITY_NORMAL,
+    PRIORITY_BEST_EFFORT,  // For background work, such as statistics.
+    NUM_PRIORITIES
+  };
+
+  void PostTaskWithPriority(
+      const tracked_objects::Location& from_here, Task* task,
+      TaskPriority priority);
+
   // A variant on PostTask that deletes the given object.  This is useful
   // if the object needs to live until the next run of the MessageLoop (for
   // example, deleting a RenderProcessHost from within an IPC callback is not
@@ -193,6 +213,13 @@ class BASE_API MessageLoop : public base::MessagePump::Delegate {
     PostNonNestableTask(from_here, new ReleaseTask<T>(object));
   }
 
+  // Schedules the task of |entry| to run at |run_time|, like a delayed task.
+  // Until it runs, the task can be cancelled in constant time with
+  // entry->Cancel(), after which the caller owns it again.  Unlike
+  // PostDelayedTask, this may only be called on the thread that runs this
+  // loop.  This is what base::Timer uses.
+  void AddTimer(base::TimerWheel::Entry* entry, base::TimeTicks run_time);
+
   // Run the message loop.
   void Run();
 
@@ -357,7 +384,8 @@ class BASE_API MessageLoop : public base::MessagePump::Delegate {
   // This structure is copied around by value.
   struct PendingTask {
     PendingTask(Task* task, bool nestable)
-        : task(task), sequence_num(0), nestable(nestable) {
+        : task(task), sequence_num(0), nestable(nestable),
+          priority(PRIORITY_NORMAL) {
     }
 
     // Used to support sorting.
@@ -365,8 +393,10 @@ class BASE_API MessageLoop : public base::MessagePump::Delegate {
 
     Task* task;                        // The task to run.
     base::TimeTicks delayed_run_time;  // The time when the task should be run.
+    base::TimeTicks post_time;         // The time when the task was posted.
     int sequence_num;                  // Secondary sort key for run time.
     bool nestable;                     // OK to dispatch from a nested loop.
+    TaskPriority priority;             // Selects the queue of the task.
   };
 
   class TaskQueue : public std::queue<PendingTask> {
@@ -378,6 +408,9 @@ class BASE_API MessageLoop : public base::MessagePump::Delegate {
 
   typedef std::priority_queue<PendingTask> DelayedTaskQueue;
 
+  // A node of incoming_queue_.
+  struct IncomingTask;
+
 #if defined(OS_WIN)
   base::MessagePumpWin* pump_win() {
     return static_cast<base::MessagePumpWin*>(pump_.get());
@@ -416,11 +449,19 @@ class BASE_API MessageLoop : public base::MessagePump::Delegate {
   // Adds the pending task to delayed_work_queue_.
   void AddToDelayedWorkQueue(const PendingTask& pending_task);
 
-  // Load tasks from the incoming_queue_ into work_queue_ if the latter is
-  // empty.  The former requires a lock to access, while the latter is directly
-  // accessible on this thread.
+  // Returns the earliest run time of delayed_work_queue_ and timer_wheel_, or
+  // a null TimeTicks if both are empty.
+  base::TimeTicks GetNextDelayedRunTime() const;
+
+  // Load tasks from the incoming_queue_ into work_queues_.  The former is
+  // shared with other threads, while the latter are directly accessible on
+  // this thread.
   void ReloadWorkQueue();
 
+  // Removes the next task to run from work_queues_ into |pending_task|.
+  // Returns false if there is none.
+  bool TakeNextWorkTask(PendingTask* pending_task);
+
   // Delete tasks that haven't run yet without running them.  Used in the
   // destructor to make sure all the task's destructors get called.  Returns
   // true if some work was done.
@@ -428,7 +469,7 @@ class BASE_API MessageLoop : public base::MessagePump::Delegate {
 
   // Post a task to our incomming queue.
   void PostTask_Helper(const tracked_objects::Location& from_here, Task* task,
-                       int64 delay_ms, bool nestable);
+                       int64 delay_ms, bool nestable, TaskPriority priority);
 
   // Start recording histogram info about events and action IF it was enabled
   // and IF the statistics recorder can accept a registration of our histogram.
@@ -446,13 +487,17 @@ class BASE_API MessageLoop : public base::MessagePump::Delegate {
 
   Type type_;
 
-  // A list of tasks that need to be processed by this instance.  Note that
-  // this queue is only accessed (push/pop) by our current thread.
-  TaskQueue work_queue_;
+  // The tasks that need to be processed by this instance, one queue per
+  // priority.  Note that these queues are only accessed (push/pop) by our
+  // current thread.
+  TaskQueue work_queues_[NUM_PRIORITIES];
 
   // Contains delayed tasks, sorted by their 'delayed_run_time' property.
   DelayedTaskQueue delayed_work_queue_;
 
+  // Contains the tasks added with AddTimer.
+  base::TimerWheel timer_wheel_;
+
   // A recent snapshot of Time::Now(), used to check delayed_work_queue_.
   base::TimeTicks recent_time_;
 
@@ -474,14 +519,15 @@ class BASE_API MessageLoop : public base::MessagePump::Delegate {
   std::string thread_name_;
   // A profiling histogram showing the counts of various messages and events.
   base::Histogram* message_histogram_;
+  // Profiling histograms of how long the tasks of each priority wait to run.
+  base::Histogram* queueing_delay_histograms_[NUM_PRIORITIES];
 
   // A null terminated list which creates an incoming_queue of tasks that are
-  // acquired under a mutex for processing on this instance's thread. These
-  // tasks have not yet been sorted out into items for our work_queue_ vs
-  // items that will be handled by the TimerManager.
-  TaskQueue incoming_queue_;
-  // Protect access to incoming_queue_.
-  mutable base::Lock incoming_queue_lock_;
+  // pushed without locking by any thread, newest first, and taken all at once
+  // for processing on this instance's thread. These tasks have not yet been
+  // sorted out into items for our work_queue_ vs items that will be handled by
+  // the TimerManager.
+  base::subtle::AtomicWord incoming_queue_;  // An IncomingTask*.
 
   RunState* state_;
 
@@ -0,0 +1,221 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_loop.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/perftimer.h"
+#include "base/stl_util-inl.h"
+#include "base/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/task.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
+#include "base/threading/thread.h"
+#include "base/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using base::TimeDelta;
+using base::TimeTicks;
+
+namespace {
+
+const int kNumTasks = 200000;
+const int kMaxPostingThreads = 16;
+const int kNumWakeUps = 1000;
+const int kNumBackgroundTasks = 100;
+const int kBackgroundTaskUs = 20;
+
+const char* LoopName(MessageLoop::Type type) {
+  return type == MessageLoop::TYPE_IO ? "IO" : "Default";
+}
+
+// Signals |done| when it is the last of |num_tasks| tasks to run.
+class CountingTask : public Task {
+ public:
+  CountingTask(int* num_run, int num_tasks, base::WaitableEvent* done)
+      : num_run_(num_run), num_tasks_(num_tasks), done_(done) {}
+
+  virtual void Run() {
+    if (++(*num_run_) == num_tasks_)
+      done_->Signal();
+  }
+
+ private:
+  int* num_run_;  // Only used on the thread of the message loop.
+  int num_tasks_;
+  base::WaitableEvent* done_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingTask);
+};
+
+// Posts |num_posts| CountingTasks to |loop|.
+class Poster : public base::DelegateSimpleThread::Delegate {
+ public:
+  Poster(MessageLoop* loop, int num_posts, int* num_run, int num_tasks,
+         base::WaitableEvent* done)
+      : loop_(loop), num_posts_(num_posts), num_run_(num_run),
+        num_tasks_(num_tasks), done_(done) {}
+
+  virtual void Run() {
+    for (int i = 0; i < num_posts_; i++)
+      loop_->PostTask(FROM_HERE, new CountingTask(num_run_, num_tasks_, done_));
+  }
+
+ private:
+  MessageLoop* loop_;
+  int num_posts_;
+  int* num_run_;
+  int num_tasks_;
+  base::WaitableEvent* done_;
+
+  DISALLOW_COPY_AND_ASSIGN(Poster);
+};
+
+// Records how long it took to run after being posted.
+class TimedTask : public Task {
+ public:
+  TimedTask(TimeDelta* latency, base::WaitableEvent* done)
+      : latency_(latency), done_(done), posted_(TimeTicks::Now()) {}
+
+  virtual void Run() {
+    *latency_ = TimeTicks::Now() - posted_;
+    done_->Signal();
+  }
+
+ private:
+  TimeDelta* latency_;
+  base::WaitableEvent* done_;
+  TimeTicks posted_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimedTask);
+};
+
+// Keeps the thread busy for |kBackgroundTaskUs|.
+class BusyTask : public Task {
+ public:
+  BusyTask() {}
+
+  virtual void Run() {
+    TimeTicks end = TimeTicks::Now() +
+        TimeDelta::FromMicroseconds(kBackgroundTaskUs);
+    while (TimeTicks::Now() < end) {}
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BusyTask);
+};
+
+void LogLatencies(const std::string& test_name,
+                  std::vector<TimeDelta>* latencies) {
+  std::sort(latencies->begin(), latencies->end());
+  LogPerfResult((test_name + "_median").c_str(),
+                (*latencies)[latencies->size() / 2].InMicroseconds(), "us");
+  LogPerfResult((test_name + "_p99").c_str(),
+                (*latencies)[latencies->size() * 99 / 100].InMicroseconds(),
+                "us");
+}
+
+// Posts |kNumTasks| tasks to a message loop of the given |type|, split among
+// |num_threads| threads.
+void PostFromThreads(MessageLoop::Type type, int num_threads) {
+  base::Thread thread("loop");
+  ASSERT_TRUE(thread.StartWithOptions(base::Thread::Options(type, 0)));
+
+  int num_posts = kNumTasks / num_threads;
+  int num_tasks = num_posts * num_threads;
+  int num_run = 0;
+  base::WaitableEvent done(false, false);
+  std::vector<Poster*> posters;
+  std::vector<base::DelegateSimpleThread*> threads;
+  for (int i = 0; i < num_threads; i++) {
+    posters.push_back(new Poster(thread.message_loop(), num_posts, &num_run,
+                                 num_tasks, &done));
+    threads.push_back(new base::DelegateSimpleThread(posters.back(),
+                                                     "poster"));
+  }
+
+  PerfTimer timer;
+  for (int i = 0; i < num_threads; i++)
+    threads[i]->Start();
+  for (int i = 0; i < num_threads; i++)
+    threads[i]->Join();
+  EXPECT_TRUE(done.Wait());
+  TimeDelta elapsed = timer.Elapsed();
+
+  std::string test_name = base::StringPrintf(
+      "MessageLoop_%s_post_from_%d_threads", LoopName(type), num_threads);
+  LogPerfResult(test_name.c_str(), num_tasks / elapsed.InSecondsF(),
+                "tasks/s");
+
+  STLDeleteElements(&threads);
+  STLDeleteElements(&posters);
+}
+
+// Measures how long an idle message loop of the given |type| takes to run a
+// task posted from another thread.
+void MeasureWakeUpLatency(MessageLoop::Type type) {
+  base::Thread thread("loop");
+  ASSERT_TRUE(thread.StartWithOptions(base::Thread::Options(type, 0)));
+
+  std::vector<TimeDelta> latencies(kNumWakeUps);
+  base::WaitableEvent done(false, false);
+  for (int i = 0; i < kNumWakeUps; i++) {
+    // Give the loop time to go to sleep.
+    base::PlatformThread::Sleep(1);
+    thread.message_loop()->PostTask(FROM_HERE,
+                                    new TimedTask(&latencies[i], &done));
+    EXPECT_TRUE(done.Wait());
+  }
+
+  LogLatencies(base::StringPrintf("MessageLoop_%s_wake_up", LoopName(type)),
+               &latencies);
+}
+
+// Measures how long a task posted with |priority| takes to run while the
+// loop is busy with a backlog of tasks posted with |background_priority|.
+void MeasureLatencyUnderLoad(MessageLoop::TaskPriority priority,
+                             MessageLoop::TaskPriority background_priority,
+                             const char* name) {
+  base::Thread thread("loop");
+  ASSERT_TRUE(thread.StartWithOptions(
+      base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+  MessageLoop* loop = thread.message_loop();
+
+  std::vector<TimeDelta> latencies(kNumWakeUps);
+  base::WaitableEvent done(false, false);
+  for (int i = 0; i < kNumWakeUps; i++) {
+    for (int j = 0; j < kNumBackgroundTasks; j++)
+      loop->PostTaskWithPriority(FROM_HERE, new BusyTask, background_priority);
+    loop->PostTaskWithPriority(FROM_HERE, new TimedTask(&latencies[i], &done),
+                               priority);
+    EXPECT_TRUE(done.Wait());
+  }
+
+  LogLatencies(base::StringPrintf("MessageLoop_latency_under_load_%s", name),
+               &latencies);
+}
+
+}  // namespace
+
+TEST(MessageLoopPerfTest, PostFromThreads) {
+  for (int i = 1; i <= kMaxPostingThreads; i *= 2) {
+    PostFromThreads(MessageLoop::TYPE_DEFAULT, i);
+    PostFromThreads(MessageLoop::TYPE_IO, i);
+  }
+}
+
+TEST(MessageLoopPerfTest, WakeUpLatency) {
+  MeasureWakeUpLatency(MessageLoop::TYPE_DEFAULT);
+  MeasureWakeUpLatency(MessageLoop::TYPE_IO);
+}
+
+TEST(MessageLoopPerfTest, LatencyUnderLoad) {
+  MeasureLatencyUnderLoad(MessageLoop::PRIORITY_NORMAL,
+                          MessageLoop::PRIORITY_NORMAL, "fifo");
+  MeasureLatencyUnderLoad(MessageLoop::PRIORITY_HIGH,
+                          MessageLoop::PRIORITY_BEST_EFFORT, "prioritized");
+}
@@ -1151,6 +1151,64 @@ void RunTest_NonNestableInNestedLoop(MessageLoop::Type message_loop_type,
   EXPECT_EQ(order[11], TaskItem(QUITMESSAGELOOP, 6, false));
 }
 
+// Tests that tasks run by priority, and in FIFO order within a priority.
+void RunTest_PostTaskWithPriority(MessageLoop::Type message_loop_type) {
+  MessageLoop loop(message_loop_type);
+
+  TaskList order;
+  MessageLoop::current()->PostTaskWithPriority(
+      FROM_HERE, new OrderedTasks(&order, 1),
+      MessageLoop::PRIORITY_BEST_EFFORT);
+  MessageLoop::current()->PostTaskWithPriority(
+      FROM_HERE, new QuitTask(&order, 2), MessageLoop::PRIORITY_BEST_EFFORT);
+  MessageLoop::current()->PostTask(FROM_HERE, new OrderedTasks(&order, 3));
+  MessageLoop::current()->PostTaskWithPriority(
+      FROM_HERE, new OrderedTasks(&order, 4), MessageLoop::PRIORITY_HIGH);
+  MessageLoop::current()->PostTaskWithPriority(
+      FROM_HERE, new OrderedTasks(&order, 5), MessageLoop::PRIORITY_NORMAL);
+  MessageLoop::current()->PostTaskWithPriority(
+      FROM_HERE, new OrderedTasks(&order, 6), MessageLoop::PRIORITY_HIGH);
+  MessageLoop::current()->Run();
+
+  ASSERT_EQ(12U, order.size());
+  EXPECT_EQ(order[ 0], TaskItem(ORDERERD, 4, true));
+  EXPECT_EQ(order[ 1], TaskItem(ORDERERD, 4, false));
+  EXPECT_EQ(order[ 2], TaskItem(ORDERERD, 6, true));
+  EXPECT_EQ(order[ 3], TaskItem(ORDERERD, 6, false));
+  EXPECT_EQ(order[ 4], TaskItem(ORDERERD, 3, true));
+  EXPECT_EQ(order[ 5], TaskItem(ORDERERD, 3, false));
+  EXPECT_EQ(order[ 6], TaskItem(ORDERERD, 5, true));
+  EXPECT_EQ(order[ 7], TaskItem(ORDERERD, 5, false));
+  EXPECT_EQ(order[ 8], TaskItem(ORDERERD, 1, true));
+  EXPECT_EQ(order[ 9], TaskItem(ORDERERD, 1, false));
+  EXPECT_EQ(order[10], TaskItem(QUITMESSAGELOOP, 2, true));
+  EXPECT_EQ(order[11], TaskItem(QUITMESSAGELOOP, 2, false));
+}
+
+// Tests that a task that waited for longer than the grace period of its
+// priority runs before the tasks of higher priority.
+void RunTest_PostTaskWithPriority_GracePeriod(
+    MessageLoop::Type message_loop_type) {
+  MessageLoop loop(message_loop_type);
+
+  TaskList order;
+  MessageLoop::current()->PostTask(FROM_HERE, new OrderedTasks(&order, 1));
+  PlatformThread::Sleep(60);
+  MessageLoop::current()->PostTaskWithPriority(
+      FROM_HERE, new OrderedTasks(&order, 2), MessageLoop::PRIORITY_HIGH);
+  MessageLoop::current()->PostTaskWithPriority(
+      FROM_HERE, new QuitTask(&order, 3), MessageLoop::PRIORITY_HIGH);
+  MessageLoop::current()->Run();
+
+  ASSERT_EQ(6U, order.size());
+  EXPECT_EQ(order[ 0], TaskItem(ORDERERD, 1, true));
+  EXPECT_EQ(order[ 1], TaskItem(ORDERERD, 1, false));
+  EXPECT_EQ(order[ 2], TaskItem(ORDERERD, 2, true));
+  EXPECT_EQ(order[ 3], TaskItem(ORDERERD, 2, false));
+  EXPECT_EQ(order[ 4], TaskItem(QUITMESSAGELOOP, 3, true));
+  EXPECT_EQ(order[ 5], TaskItem(QUITMESSAGELOOP, 3, false));
+}
+
 #if defined(OS_WIN)
 
 class DispatcherImpl : public MessageLoopForUI::Dispatcher {
@@ -1518,6 +1576,18 @@ TEST(MessageLoopTest, NonNestableDelayedInNestedLoop) {
   RunTest_NonNestableInNestedLoop(MessageLoop::TYPE_IO, true);
 }
 
+TEST(MessageLoopTest, PostTaskWithPriority) {
+  RunTest_PostTaskWithPriority(MessageLoop::TYPE_DEFAULT);
+  RunTest_PostTaskWithPriority(MessageLoop::TYPE_UI);
+  RunTest_PostTaskWithPriority(MessageLoop::TYPE_IO);
+}
+
+TEST(MessageLoopTest, PostTaskWithPriority_GracePeriod) {
+  RunTest_PostTaskWithPriority_GracePeriod(MessageLoop::TYPE_DEFAULT);
+  RunTest_PostTaskWithPriority_GracePeriod(MessageLoop::TYPE_UI);
+  RunTest_PostTaskWithPriority_GracePeriod(MessageLoop::TYPE_IO);
+}
+
 class DummyTask : public Task {
  public:
   explicit DummyTask(int num_tasks) : num_tasks_(num_tasks) {}
@@ -11,7 +11,8 @@ namespace base {
 
 MessagePumpDefault::MessagePumpDefault()
     : keep_running_(true),
-      event_(false, false) {
+      event_(false, false),
+      work_scheduled_(0) {
 }
 
 void MessagePumpDefault::Run(Delegate* delegate) {
@@ -20,6 +21,10 @@ void MessagePumpDefault::Run(Delegate* delegate) {
   for (;;) {
     mac::ScopedNSAutoreleasePool autorelease_pool;
 
+    // Work scheduled from now on may not be seen by DoWork().
+    subtle::Release_Store(&work_scheduled_, 0);
+    subtle::MemoryBarrier();
+
     bool did_work = delegate->DoWork();
     if (!keep_running_)
       break;
@@ -63,7 +68,10 @@ void MessagePumpDefault::Quit() {
 
 void MessagePumpDefault::ScheduleWork() {
   // Since this can be called on any thread, we need to ensure that our Run
-  // loop wakes up.
+  // loop wakes up.  There is no need to signal again if Run() has not looked
+  // for work since the last time.
+  if (subtle::Acquire_CompareAndSwap(&work_scheduled_, 0, 1))
+    return;
   event_.Signal();
 }
 
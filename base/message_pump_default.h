@@ -6,6 +6,7 @@
 #define BASE_MESSAGE_PUMP_DEFAULT_H_
 #pragma once
 
+#include "base/atomicops.h"
 #include "base/message_pump.h"
 #include "base/time.h"
 #include "base/synchronization/waitable_event.h"
@@ -30,6 +31,9 @@ class MessagePumpDefault : public MessagePump {
   // Used to sleep until there is more work to do.
   WaitableEvent event_;
 
+  // Non-zero if ScheduleWork() was called since Run() last looked for work.
+  subtle::Atomic32 work_scheduled_;
+
   // The time at which we should call DoDelayedWork.
   TimeTicks delayed_work_time_;
 
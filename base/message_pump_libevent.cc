@@ -109,7 +109,8 @@ MessagePumpLibevent::MessagePumpLibevent()
       in_run_(false),
       event_base_(event_base_new()),
       wakeup_pipe_in_(-1),
-      wakeup_pipe_out_(-1) {
+      wakeup_pipe_out_(-1),
+      wakeup_pending_(0) {
   if (!Init())
      NOTREACHED();
 }
@@ -271,6 +272,11 @@ void MessagePumpLibevent::Quit() {
 }
 
 void MessagePumpLibevent::ScheduleWork() {
+  // If there is a wakeup byte that OnWakeup() has not read yet, Run() will
+  // wake up anyway, and will look for work after reading it.
+  if (subtle::Acquire_CompareAndSwap(&wakeup_pending_, 0, 1))
+    return;
+
   // Tell libevent (in a threadsafe way) that it should break out of its loop.
   char buf = 0;
   int nwrite = HANDLE_EINTR(write(wakeup_pipe_in_, &buf, 1));
@@ -348,6 +354,10 @@ void MessagePumpLibevent::OnWakeup(int socket, short flags, void* context) {
   char buf;
   int nread = HANDLE_EINTR(read(socket, &buf, 1));
   DCHECK_EQ(nread, 1);
+  // A new ScheduleWork() will write another byte. The store must be visible
+  // before Run() looks for work, or that call may be missed.
+  subtle::Release_Store(&that->wakeup_pending_, 0);
+  subtle::MemoryBarrier();
   // Tell libevent to break out of inner loop.
   event_base_loopbreak(that->event_base_);
 }
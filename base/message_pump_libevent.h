@@ -6,6 +6,7 @@
 #define BASE_MESSAGE_PUMP_LIBEVENT_H_
 #pragma once
 
+#include "base/atomicops.h"
 #include "base/basictypes.h"
 #include "base/message_pump.h"
 #include "base/observer_list.h"
@@ -155,6 +156,9 @@ class MessagePumpLibevent : public MessagePump {
   int wakeup_pipe_out_;
   // ... libevent wrapper for read end
   event* wakeup_event_;
+  // ... non-zero while there is a byte in the pipe, so that ScheduleWork()
+  // doesn't have to write another one
+  subtle::Atomic32 wakeup_pending_;
 
   ObserverList<IOObserver> io_observers_;
 
@@ -10,17 +10,158 @@
 #include "base/metrics/histogram.h"
 
 #include <math.h>
+#include <string.h>
 
 #include <algorithm>
 #include <string>
 
+#include "base/bits.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/pickle.h"
 #include "base/stringprintf.h"
 #include "base/synchronization/lock.h"
+#include "base/threading/thread_local_storage.h"
 
 namespace base {
 
+namespace {
+
+// The number of histograms created so far.
+subtle::Atomic32 g_num_histograms = 0;
+
+// Adds |count| to |counter|, which no other thread writes to.
+void Increment(volatile subtle::Atomic32* counter, subtle::Atomic32 count) {
+  subtle::NoBarrier_Store(counter, subtle::NoBarrier_Load(counter) + count);
+}
+
+}  // namespace
+
+// The counters of a histogram that are updated by a single thread, the owner
+// of the shard, while any thread may read them.  When its owner exits, the
+// shard may be adopted by another thread.
+class Histogram::Shard {
+ public:
+  // The shard is owned by the current thread.
+  explicit Shard(size_t bucket_count)
+      : counts_(bucket_count, 0),
+        sum_low_(0),
+        sum_high_(0),
+        redundant_count_(0),
+        in_use_(1),
+        next_(NULL) {
+  }
+
+  // Makes the current thread the owner of the shard, if it has none.
+  bool TryAcquire() {
+    return subtle::Acquire_CompareAndSwap(&in_use_, 0, 1) == 0;
+  }
+
+  // Called by the owner when it exits.
+  void Release() {
+    subtle::Release_Store(&in_use_, 0);
+  }
+
+  // Only called by the owner.
+  void Accumulate(Sample value, Count count, size_t index) {
+    Increment(&counts_[index], count);
+    int64 sum = (static_cast<int64>(subtle::NoBarrier_Load(&sum_high_)) << 32) +
+                static_cast<uint32>(subtle::NoBarrier_Load(&sum_low_)) +
+                static_cast<int64>(count) * value;
+    subtle::NoBarrier_Store(&sum_low_, static_cast<subtle::Atomic32>(sum));
+    subtle::NoBarrier_Store(&sum_high_,
+                            static_cast<subtle::Atomic32>(sum >> 32));
+    Increment(&redundant_count_, count);
+  }
+
+  // Adds our samples to |sample|.  A sample that is being added as we read
+  // may be partly accounted for, and the sum may be off by 2^32 if its high
+  // word is being changed.  The next snapshot will be right.
+  void AddTo(SampleSet* sample) const {
+    DCHECK_EQ(counts_.size(), sample->counts_.size());
+    for (size_t index = 0; index < counts_.size(); ++index)
+      sample->counts_[index] += subtle::NoBarrier_Load(&counts_[index]);
+    int64 sum_high = subtle::NoBarrier_Load(&sum_high_);
+    uint32 sum_low = static_cast<uint32>(subtle::NoBarrier_Load(&sum_low_));
+    sample->sum_ += (sum_high << 32) + sum_low;
+    sample->redundant_count_ += subtle::NoBarrier_Load(&redundant_count_);
+  }
+
+  Shard* next() const { return next_; }
+  void set_next(Shard* next) { next_ = next; }
+
+ private:
+  std::vector<subtle::Atomic32> counts_;
+  subtle::Atomic32 sum_low_;
+  subtle::Atomic32 sum_high_;
+  subtle::Atomic32 redundant_count_;
+
+  // 1 while a thread owns the shard.
+  subtle::Atomic32 in_use_;
+
+  // The next shard of the histogram.  Set before the shard is published.
+  Shard* next_;
+
+  DISALLOW_COPY_AND_ASSIGN(Shard);
+};
+
+// The shards owned by the current thread, indexed by the id of their
+// histogram.  They are released when the thread exits.
+class Histogram::ThreadShards {
+ public:
+  // Returns the shards of the current thread.
+  static ThreadShards* GetCurrent() {
+    ThreadLocalStorage::Slot& slot = slot_.Get().slot;
+    ThreadShards* thread_shards = static_cast<ThreadShards*>(slot.Get());
+    if (!thread_shards) {
+      thread_shards = new ThreadShards;
+      slot.Set(thread_shards);
+    }
+    return thread_shards;
+  }
+
+  Shard* shard(size_t id) const {
+    return id < shards_.size() ? shards_[id] : NULL;
+  }
+
+  void set_shard(size_t id, Shard* shard) {
+    if (id >= shards_.size())
+      shards_.resize(id + 1, NULL);
+    shards_[id] = shard;
+  }
+
+ private:
+  // Holds the TLS slot, so that it can be lazily created.
+  struct SlotHolder {
+    SlotHolder() : slot(&ThreadShards::OnThreadExit) {}
+    ThreadLocalStorage::Slot slot;
+  };
+
+  ThreadShards() {}
+
+  // Lets other threads adopt the shards of the exiting thread.
+  static void OnThreadExit(void* value) {
+    ThreadShards* thread_shards = static_cast<ThreadShards*>(value);
+    for (size_t id = 0; id < thread_shards->shards_.size(); ++id) {
+      if (thread_shards->shards_[id])
+        thread_shards->shards_[id]->Release();
+    }
+    delete thread_shards;
+  }
+
+  // Leaky, since samples may be added during shutdown.
+  static LazyInstance<SlotHolder, LeakyLazyInstanceTraits<SlotHolder> > slot_;
+
+  std::vector<Shard*> shards_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadShards);
+};
+
+// static
+LazyInstance<Histogram::ThreadShards::SlotHolder,
+             LeakyLazyInstanceTraits<Histogram::ThreadShards::SlotHolder> >
+    Histogram::ThreadShards::slot_(LINKER_INITIALIZED);
+
 // Static table of checksums for all possible 8 bit bytes.
 const uint32 Histogram::kCrcTable[256] = {0x0, 0x77073096L, 0xee0e612cL,
 0x990951baL, 0x76dc419L, 0x706af48fL, 0xe963a535L, 0x9e6495a3L, 0xedb8832L,
@@ -361,11 +502,16 @@ size_t Histogram::bucket_count() const {
   return bucket_count_;
 }
 
-// Do a safe atomic snapshot of sample data.
-// This implementation assumes we are on a safe single thread.
+// Merge the shards into |sample|.  The samples that are being added while we
+// do so may be only partly accounted for, which FindCorruption() tolerates.
 void Histogram::SnapshotSample(SampleSet* sample) const {
-  // Note locking not done in this version!!!
   *sample = sample_;
+  for (const Shard* shard =
+           reinterpret_cast<const Shard*>(subtle::Acquire_Load(&shards_));
+       shard;
+       shard = shard->next()) {
+    shard->AddTo(sample);
+  }
 }
 
 bool Histogram::HasConstructorArguments(Sample minimum,
@@ -396,7 +542,10 @@ Histogram::Histogram(const std::string& name, Sample minimum,
     flags_(kNoFlags),
     ranges_(bucket_count + 1, 0),
     range_checksum_(0),
-    sample_() {
+    id_(subtle::NoBarrier_AtomicIncrement(&g_num_histograms, 1) - 1),
+    sample_(),
+    shards_(0) {
+  memset(log2_bucket_index_, 0, sizeof(log2_bucket_index_));
   Initialize();
 }
 
@@ -409,7 +558,10 @@ Histogram::Histogram(const std::string& name, TimeDelta minimum,
     flags_(kNoFlags),
     ranges_(bucket_count + 1, 0),
     range_checksum_(0),
-    sample_() {
+    id_(subtle::NoBarrier_AtomicIncrement(&g_num_histograms, 1) - 1),
+    sample_(),
+    shards_(0) {
+  memset(log2_bucket_index_, 0, sizeof(log2_bucket_index_));
   Initialize();
 }
 
@@ -422,6 +574,11 @@ Histogram::~Histogram() {
 
   // Just to make sure most derived class did this properly...
   DCHECK(ValidateBucketRanges());
+
+  // Threads keep pointers to their shards until they exit, so a histogram
+  // can't be deleted once samples were added to it.  Only duplicates are
+  // deleted, right after being created.
+  DCHECK(!shards_);
 }
 
 // Calculate what range of values are held in each bucket.
@@ -464,12 +621,13 @@ bool Histogram::PrintEmptyBucket(size_t index) const {
 }
 
 size_t Histogram::BucketIndex(Sample value) const {
-  // Use simple binary search.  This is very general, but there are better
-  // approaches if we knew that the buckets were linearly distributed.
+  // Use a binary search over the buckets that can hold the power of 2 of
+  // |value|.  There are only a few of them in exponential histograms.
   DCHECK_LE(ranges(0), value);
   DCHECK_GT(ranges(bucket_count()), value);
-  size_t under = 0;
-  size_t over = bucket_count();
+  int log2 = value ? bits::Log2Floor(value) + 1 : 0;
+  size_t under = log2_bucket_index_[log2];
+  size_t over = log2_bucket_index_[log2 + 1] + 1;
   size_t mid;
 
   do {
@@ -503,6 +661,8 @@ double Histogram::GetBucketSize(Count current, size_t i) const {
 }
 
 void Histogram::ResetRangeChecksum() {
+  // The ranges are final by now.
+  InitializeBucketIndexTable();
   range_checksum_ = CalculateRangeChecksum();
 }
 
@@ -517,8 +677,8 @@ const std::string Histogram::GetAsciiBucketRange(size_t i) const {
 
 // Update histogram data with new sample.
 void Histogram::Accumulate(Sample value, Count count, size_t index) {
-  // Note locking not done in this version!!!
-  sample_.Accumulate(value, count, index);
+  DCHECK(count == 1 || count == -1);
+  GetShard()->Accumulate(value, count, index);
 }
 
 void Histogram::SetBucketRange(size_t i, Sample value) {
@@ -559,6 +719,46 @@ void Histogram::Initialize() {
   ranges_[bucket_count_] = kSampleType_MAX;
 }
 
+void Histogram::InitializeBucketIndexTable() {
+  const size_t kNumEntries = arraysize(log2_bucket_index_);
+  COMPILE_ASSERT(kBucketCount_MAX <= kuint16max, bucket_index_overflows);
+  DCHECK_EQ(bucket_count_ + 1, ranges_.size());
+  for (size_t i = 0; i < kNumEntries - 1; ++i) {
+    Sample value = i ? 1 << (i - 1) : 0;
+    size_t index = std::upper_bound(ranges_.begin(), ranges_.end(), value) -
+                   ranges_.begin() - 1;
+    log2_bucket_index_[i] = static_cast<uint16>(index);
+  }
+  log2_bucket_index_[kNumEntries - 1] = static_cast<uint16>(bucket_count_ - 1);
+}
+
+Histogram::Shard* Histogram::GetShard() {
+  ThreadShards* thread_shards = ThreadShards::GetCurrent();
+  Shard* shard = thread_shards->shard(id_);
+  if (shard)
+    return shard;
+
+  // Adopt the shard of a thread that exited, if any.
+  for (shard = reinterpret_cast<Shard*>(subtle::Acquire_Load(&shards_));
+       shard && !shard->TryAcquire();
+       shard = shard->next()) {
+  }
+
+  if (!shard) {
+    shard = new Shard(bucket_count_);
+    subtle::AtomicWord head;
+    do {
+      head = subtle::NoBarrier_Load(&shards_);
+      shard->set_next(reinterpret_cast<Shard*>(head));
+    } while (subtle::Release_CompareAndSwap(
+                 &shards_, head, reinterpret_cast<subtle::AtomicWord>(shard)) !=
+             head);
+  }
+
+  thread_shards->set_shard(id_, shard);
+  return shard;
+}
+
 // We generate the CRC-32 using the low order bits to select whether to XOR in
 // the reversed polynomial 0xedb88320L.  This is nice and simple, and allows us
 // to keep the quotient in a uint32.  Since we're not concerned about the nature
@@ -862,6 +1062,23 @@ const std::string LinearHistogram::GetAsciiBucketRange(size_t i) const {
   return it->second;
 }
 
+size_t LinearHistogram::BucketIndex(Sample value) const {
+  if (value < declared_min())
+    return 0;
+  if (value >= declared_max())
+    return bucket_count() - 1;
+
+  // The ranges were rounded to integers, so the estimate may be one off.
+  size_t index = 1 + static_cast<size_t>(
+      static_cast<int64>(value - declared_min()) * (bucket_count() - 2) /
+      (declared_max() - declared_min()));
+  while (ranges(index) > value)
+    --index;
+  while (ranges(index + 1) <= value)
+    ++index;
+  return index;
+}
+
 bool LinearHistogram::PrintEmptyBucket(size_t index) const {
   return bucket_description_.find(ranges(index)) == bucket_description_.end();
 }
@@ -37,6 +37,13 @@
 // and relatively fast, set of counters.  To avoid races at shutdown, the static
 // pointer is NOT deleted, and we leak the histograms at process termination.
 
+// Samples are added without locking.  Each thread accumulates its samples
+// in a shard of the histogram that only it writes to, so that adding a sample
+// needs neither atomic increments nor cache lines shared with other threads.
+// The shards are merged when the histogram is snapshotted.  The bucket of a
+// sample is found by looking up its power of 2 in a table (or computed
+// directly for linear histograms) rather than by a search of all the ranges.
+
 #ifndef BASE_METRICS_HISTOGRAM_H_
 #define BASE_METRICS_HISTOGRAM_H_
 #pragma once
@@ -45,6 +52,7 @@
 #include <string>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/base_api.h"
 #include "base/gtest_prod_util.h"
 #include "base/logging.h"
@@ -360,6 +368,9 @@ class BASE_API Histogram {
     // Allow tests to corrupt our innards for testing purposes.
     FRIEND_TEST(HistogramTest, CorruptSampleCounts);
 
+    // To merge the shards of a histogram into its snapshots.
+    friend class Histogram;
+
     // To help identify memory corruption, we reduntantly save the number of
     // samples we've accumulated into all of our buckets.  We can compare this
     // count to the sum of the counts in all buckets, and detect problems.  Note
@@ -487,9 +498,9 @@ class BASE_API Histogram {
   virtual const std::string GetAsciiBucketRange(size_t it) const;
 
   //----------------------------------------------------------------------------
-  // Methods to override to create thread safe histogram.
+  // Methods to override to store samples differently.
   //----------------------------------------------------------------------------
-  // Update all our internal data, including histogram
+  // Update all our internal data, including histogram.  This is thread safe.
   virtual void Accumulate(Sample value, Count count, size_t index);
 
   //----------------------------------------------------------------------------
@@ -512,9 +523,21 @@ class BASE_API Histogram {
 
   friend class StatisticsRecorder;  // To allow it to delete duplicates.
 
+  // The samples added by one thread at a time.
+  class Shard;
+
+  // The shards owned by a thread.
+  class ThreadShards;
+
   // Post constructor initialization.
   void Initialize();
 
+  // Fill in log2_bucket_index_, once the ranges are known.
+  void InitializeBucketIndexTable();
+
+  // Returns the shard of the current thread, creating it if needed.
+  Shard* GetShard();
+
   // Checksum function for accumulating range values into a checksum.
   static uint32 Crc32(uint32 sum, Sample range);
 
@@ -570,9 +593,21 @@ class BASE_API Histogram {
   // have been corrupted.
   uint32 range_checksum_;
 
+  // Identifies this histogram in the ThreadShards of each thread.
+  size_t id_;
+
+  // Entry i is the index of the bucket that holds 2^(i-1), or 0 for i == 0.
+  // The last entry is the overflow bucket.  A sample between 2^(i-1) and 2^i
+  // falls in one of the buckets from entry i to entry i + 1, so BucketIndex()
+  // only needs to search that much.
+  uint16 log2_bucket_index_[33];
+
   // Finally, provide the state that changes with the addition of each new
-  // sample.
+  // sample.  |sample_| holds the samples added with AddSampleSet(), and the
+  // shards the others.  |shards_| is the head of a list of Shard, which only
+  // grows.
   SampleSet sample_;
+  base::subtle::AtomicWord shards_;
 
   DISALLOW_COPY_AND_ASSIGN(Histogram);
 };
@@ -616,6 +651,9 @@ class BASE_API LinearHistogram : public Histogram {
   void InitializeBucketRange();
   virtual double GetBucketSize(Count current, size_t i) const;
 
+  // Overridden from Histogram, to compute the bucket of |value| directly.
+  virtual size_t BucketIndex(Sample value) const;
+
   // If we have a description for a bucket, then return that.  Otherwise
   // let parent class provide a (numeric) description.
   virtual const std::string GetAsciiBucketRange(size_t i) const;
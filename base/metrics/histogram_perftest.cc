@@ -0,0 +1,70 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <vector>
+
+#include "base/metrics/histogram.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kNumSamples = 10000000;
+
+// Adds |kNumSamples| samples spread over the range of |histogram|.
+class SampleAdder : public DelegateSimpleThread::Delegate {
+ public:
+  explicit SampleAdder(Histogram* histogram) : histogram_(histogram) {}
+
+  virtual void Run() {
+    for (int i = 0; i < kNumSamples; i++)
+      histogram_->Add(i & 0x3fff);
+  }
+
+ private:
+  Histogram* histogram_;
+
+  DISALLOW_COPY_AND_ASSIGN(SampleAdder);
+};
+
+// Adds samples to |histogram| on |num_threads| threads at once, and logs the
+// cost of each sample under |name|.
+void AddSamples(const char* name, Histogram* histogram, int num_threads) {
+  SampleAdder adder(histogram);
+  std::vector<DelegateSimpleThread*> threads;
+  PerfTimer timer;
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(new DelegateSimpleThread(&adder, "histogram"));
+    threads.back()->Start();
+  }
+  for (int i = 0; i < num_threads; i++) {
+    threads[i]->Join();
+    delete threads[i];
+  }
+  LogPerfResult(StringPrintf("%s_%dthreads", name, num_threads).c_str(),
+                timer.Elapsed().InMicroseconds() * 1000.0 / kNumSamples,
+                "ns/sample");
+}
+
+}  // namespace
+
+TEST(HistogramPerfTest, Exponential) {
+  Histogram* histogram = Histogram::FactoryGet(
+      "HistogramPerfTest.Exponential", 1, 10000, 50, Histogram::kNoFlags);
+  AddSamples("Histogram_exponential", histogram, 1);
+  AddSamples("Histogram_exponential", histogram, 4);
+}
+
+TEST(HistogramPerfTest, Linear) {
+  Histogram* histogram = LinearHistogram::FactoryGet(
+      "HistogramPerfTest.Linear", 1, 10000, 100, Histogram::kNoFlags);
+  AddSamples("Histogram_linear", histogram, 1);
+  AddSamples("Histogram_linear", histogram, 4);
+}
+
+}  // namespace base
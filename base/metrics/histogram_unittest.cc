@@ -4,8 +4,11 @@
 
 // Test of Histogram class
 
+#include <algorithm>
+
 #include "base/metrics/histogram.h"
 #include "base/scoped_ptr.h"
+#include "base/threading/simple_thread.h"
 #include "base/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -15,6 +18,49 @@ namespace {
 class HistogramTest : public testing::Test {
 };
 
+// Checks that each sample up to |max_value| goes to the bucket that a plain
+// search of the ranges would find.
+void ExpectBucketIndexes(Histogram* histogram, int max_value) {
+  std::vector<int> ranges;
+  for (size_t i = 0; i <= histogram->bucket_count(); i++)
+    ranges.push_back(histogram->ranges(i));
+
+  Histogram::SampleSet before;
+  histogram->SnapshotSample(&before);
+  for (int value = 0; value <= max_value; value++) {
+    size_t index = std::upper_bound(ranges.begin(), ranges.end(), value) -
+                   ranges.begin() - 1;
+    histogram->Add(value);
+    Histogram::SampleSet after;
+    histogram->SnapshotSample(&after);
+    ASSERT_EQ(before.counts(index) + 1, after.counts(index))
+        << histogram->histogram_name() << " " << value;
+    before = after;
+  }
+}
+
+// Adds |num_samples| samples of |value| to |histogram|.
+class SampleAdder : public DelegateSimpleThread::Delegate {
+ public:
+  SampleAdder(Histogram* histogram, int value, int num_samples)
+      : histogram_(histogram),
+        value_(value),
+        num_samples_(num_samples) {
+  }
+
+  virtual void Run() {
+    for (int i = 0; i < num_samples_; i++)
+      histogram_->Add(value_);
+  }
+
+ private:
+  Histogram* histogram_;
+  int value_;
+  int num_samples_;
+
+  DISALLOW_COPY_AND_ASSIGN(SampleAdder);
+};
+
 // Check for basic syntax and use.
 TEST(HistogramTest, StartupShutdownTest) {
   // Try basic construction
@@ -322,6 +368,66 @@ TEST(HistogramTest, BucketPlacementTest) {
     EXPECT_EQ(i + 1, sample.counts(i));
 }
 
+TEST(HistogramTest, BucketIndexTest) {
+  ExpectBucketIndexes(Histogram::FactoryGet(
+      "ExponentialIndex", 1, 10000, 50, Histogram::kNoFlags), 12000);
+  ExpectBucketIndexes(Histogram::FactoryGet(
+      "ExponentialIndexShort", 5, 40, 30, Histogram::kNoFlags), 50);
+  ExpectBucketIndexes(LinearHistogram::FactoryGet(
+      "LinearIndex", 1, 1000, 37, Histogram::kNoFlags), 1200);
+  ExpectBucketIndexes(LinearHistogram::FactoryGet(
+      "LinearIndexEnum", 1, 130, 131, Histogram::kNoFlags), 140);
+  ExpectBucketIndexes(BooleanHistogram::FactoryGet(
+      "BooleanIndex", Histogram::kNoFlags), 3);
+
+  std::vector<int> custom_ranges;
+  custom_ranges.push_back(3);
+  custom_ranges.push_back(100);
+  custom_ranges.push_back(101);
+  custom_ranges.push_back(5000);
+  ExpectBucketIndexes(CustomHistogram::FactoryGet(
+      "CustomIndex", custom_ranges, Histogram::kNoFlags), 6000);
+}
+
+// Samples added on several threads at once are all accounted for.
+TEST(HistogramTest, ThreadedAddTest) {
+  const int kNumThreads = 12;
+  const int kNumSamples = 20000;
+  const int kLargeValue = 1 << 30;
+  Histogram* histogram(Histogram::FactoryGet(
+      "ThreadedHistogram", 1, kLargeValue, 50, Histogram::kNoFlags));
+
+  SampleAdder small_adder(histogram, 10, kNumSamples);
+  SampleAdder large_adder(histogram, kLargeValue, kNumSamples);
+  std::vector<DelegateSimpleThread*> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.push_back(new DelegateSimpleThread(
+        i % 2 ? &large_adder : &small_adder, "histogram"));
+    threads.back()->Start();
+
+    // Let the last threads adopt the shards of the first ones.
+    if (i == kNumThreads / 2) {
+      for (int j = 0; j < i; j++)
+        threads[j]->Join();
+    }
+  }
+  for (int i = kNumThreads / 2; i < kNumThreads; i++)
+    threads[i]->Join();
+  for (int i = 0; i < kNumThreads; i++)
+    delete threads[i];
+
+  Histogram::SampleSet sample;
+  histogram->SnapshotSample(&sample);
+  EXPECT_EQ(0, histogram->FindCorruption(sample));
+  EXPECT_EQ(kNumThreads * kNumSamples, sample.TotalCount());
+  EXPECT_EQ(kNumThreads * kNumSamples, sample.redundant_count());
+  EXPECT_EQ(kNumThreads / 2 * kNumSamples,
+            sample.counts(histogram->bucket_count() - 1));
+  int64 expected_sum = static_cast<int64>(kNumThreads / 2) * kNumSamples *
+                       (static_cast<int64>(kLargeValue) + 10);
+  EXPECT_EQ(expected_sum, sample.sum());
+}
+
 }  // namespace
 
 //------------------------------------------------------------------------------
@@ -332,12 +438,12 @@ TEST(HistogramTest, CorruptSampleCounts) {
   Histogram* histogram(Histogram::FactoryGet(
       "Histogram", 1, 64, 8, Histogram::kNoFlags));  // As per header file.
 
-  EXPECT_EQ(0, histogram->sample_.redundant_count());
+  Histogram::SampleSet snapshot;
+  histogram->SnapshotSample(&snapshot);
+  EXPECT_EQ(0, snapshot.redundant_count());
   histogram->Add(20);  // Add some samples.
   histogram->Add(40);
-  EXPECT_EQ(2, histogram->sample_.redundant_count());
 
-  Histogram::SampleSet snapshot;
   histogram->SnapshotSample(&snapshot);
   EXPECT_EQ(Histogram::NO_INCONSISTENCIES, 0);
   EXPECT_EQ(0, histogram->FindCorruption(snapshot));  // No default corruption.
@@ -4,8 +4,11 @@
 
 #include "base/metrics/stats_table.h"
 
+#include "base/atomicops.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/metrics/histogram.h"
+#include "base/metrics/stats_table_format.h"
 #include "base/process_util.h"
 #include "base/shared_memory.h"
 #include "base/string_piece.h"
@@ -20,21 +23,8 @@
 
 namespace base {
 
-// The StatsTable uses a shared memory segment that is laid out as follows
-//
-// +-------------------------------------------+
-// | Version | Size | MaxCounters | MaxThreads |
-// +-------------------------------------------+
-// | Thread names table                        |
-// +-------------------------------------------+
-// | Thread TID table                          |
-// +-------------------------------------------+
-// | Thread PID table                          |
-// +-------------------------------------------+
-// | Counter names table                       |
-// +-------------------------------------------+
-// | Data                                      |
-// +-------------------------------------------+
+// The StatsTable uses a shared memory segment whose layout is described in
+// stats_table_format.h.
 //
 // The data layout is a grid, where the columns are the thread_ids and the
 // rows are the counter_ids.
@@ -63,6 +53,11 @@ namespace base {
 // each process maintains its own cache.  We avoid complexity here by never
 // de-allocating from the hash table.  (Counters are dynamically added,
 // but not dynamically removed).
+//
+// Histograms are exported the same way: their entries are added under the
+// shared-memory lock, and never removed.  Each entry is then only written by
+// the process that added it, under a sequence number that lets readers
+// detect torn copies.
 
 // In order for external viewers to be able to read our shared memory,
 // we all need to use the same size ints.
@@ -70,10 +65,6 @@ COMPILE_ASSERT(sizeof(int)==4, expect_4_byte_ints);
 
 namespace {
 
-// An internal version in case we ever change the format of this
-// file, and so that we can identify our table.
-const int kTableVersion = 0x13131313;
-
 // The name for un-named counters and threads in the table.
 const char kUnknownName[] = "<unknown>";
 
@@ -86,6 +77,48 @@ inline int AlignedSize(int size) {
   return size + AlignOffset(size);
 }
 
+// The histogram entries hold int64s.
+inline int AlignedSize64(int size) {
+  return (size + 7) & ~7;
+}
+
+// Fills in the size and offsets of |header| for the given dimensions.
+void ComputeLayout(int max_counters, int max_threads, int histograms_size,
+                   StatsTableHeader* header) {
+  memset(header, 0, sizeof(*header));
+  header->version = kStatsTableVersion;
+  header->max_counters = max_counters;
+  header->max_threads = max_threads;
+  header->header_size = sizeof(*header);
+  header->max_thread_name_length = StatsTable::kMaxThreadNameLength;
+  header->max_counter_name_length = StatsTable::kMaxCounterNameLength;
+
+  int offset = AlignedSize(sizeof(*header));
+  header->thread_names_offset = offset;
+  offset += AlignedSize(max_threads * StatsTable::kMaxThreadNameLength);
+  header->thread_tids_offset = offset;
+  offset += AlignedSize(max_threads * sizeof(int));
+  header->thread_pids_offset = offset;
+  offset += AlignedSize(max_threads * sizeof(int));
+  header->counter_names_offset = offset;
+  offset += AlignedSize(max_counters * StatsTable::kMaxCounterNameLength);
+  header->data_offset = offset;
+  offset += AlignedSize(max_counters * max_threads * sizeof(int));
+  header->histograms_offset = AlignedSize64(offset);
+  header->histograms_size = AlignedSize64(histograms_size);
+  header->histograms_used = 0;
+  header->size = header->histograms_offset + header->histograms_size;
+}
+
+// Returns the ranges and counts that follow |entry|.
+int32* HistogramRanges(StatsTableHistogram* entry) {
+  return reinterpret_cast<int32*>(entry + 1);
+}
+
+int32* HistogramCounts(StatsTableHistogram* entry) {
+  return HistogramRanges(entry) + entry->bucket_count + 1;
+}
+
 }  // namespace
 
 // The StatsTable::Private maintains convenience pointers into the
@@ -93,23 +126,15 @@ inline int AlignedSize(int size) {
 // clean and accessible.
 class StatsTable::Private {
  public:
-  // Various header information contained in the memory mapped segment.
-  struct TableHeader {
-    int version;
-    int size;
-    int max_counters;
-    int max_threads;
-  };
-
-  // Construct a new Private based on expected size parameters, or
-  // return NULL on failure.
-  static Private* New(const std::string& name, int size,
-                                int max_threads, int max_counters);
+  // Construct a new Private based on the layout of |header|, or return NULL
+  // on failure.
+  static Private* New(const std::string& name,
+                      const StatsTableHeader& header);
 
   SharedMemory* shared_memory() { return &shared_memory_; }
 
   // Accessors for our header pointers
-  TableHeader* table_header() const { return table_header_; }
+  StatsTableHeader* table_header() const { return table_header_; }
   int version() const { return table_header_->version; }
   int size() const { return table_header_->size; }
   int max_counters() const { return table_header_->max_counters; }
@@ -134,6 +159,11 @@ class StatsTable::Private {
     return &data_table_[(counter_id-1) * max_threads()];
   }
 
+  // The histogram entry at |offset| in the histograms section.
+  StatsTableHistogram* histogram(int offset) const {
+    return reinterpret_cast<StatsTableHistogram*>(histograms_table_ + offset);
+  }
+
  private:
   // Constructor is private because you should use New() instead.
   Private()
@@ -142,34 +172,35 @@ class StatsTable::Private {
         thread_tid_table_(NULL),
         thread_pid_table_(NULL),
         counter_names_table_(NULL),
-        data_table_(NULL) {
+        data_table_(NULL),
+        histograms_table_(NULL) {
   }
 
   // Initializes the table on first access.  Sets header values
   // appropriately and zeroes all counters.
-  void InitializeTable(void* memory, int size, int max_counters,
-                       int max_threads);
+  void InitializeTable(void* memory, const StatsTableHeader& header);
 
   // Initializes our in-memory pointers into a pre-created StatsTable.
   void ComputeMappedPointers(void* memory);
 
   SharedMemory shared_memory_;
-  TableHeader* table_header_;
+  StatsTableHeader* table_header_;
   char* thread_names_table_;
   PlatformThreadId* thread_tid_table_;
   int* thread_pid_table_;
   char* counter_names_table_;
   int* data_table_;
+  char* histograms_table_;
 };
 
 // static
-StatsTable::Private* StatsTable::Private::New(const std::string& name,
-                                              int size,
-                                              int max_threads,
-                                              int max_counters) {
+StatsTable::Private* StatsTable::Private::New(
+    const std::string& name,
+    const StatsTableHeader& layout) {
 #ifdef ANDROID
   return NULL;
 #else
+  int size = layout.size;
   scoped_ptr<Private> priv(new Private());
   if (!priv->shared_memory_.CreateNamed(name, true, size))
     return NULL;
@@ -177,12 +208,12 @@ StatsTable::Private* StatsTable::Private::New(const std::string& name,
     return NULL;
   void* memory = priv->shared_memory_.memory();
 
-  TableHeader* header = static_cast<TableHeader*>(memory);
+  StatsTableHeader* header = static_cast<StatsTableHeader*>(memory);
 
   // If the version does not match, then assume the table needs
   // to be initialized.
-  if (header->version != kTableVersion)
-    priv->InitializeTable(memory, size, max_counters, max_threads);
+  if (header->version != kStatsTableVersion)
+    priv->InitializeTable(memory, layout);
 
   // We have a valid table, so compute our pointers.
   priv->ComputeMappedPointers(memory);
@@ -191,53 +222,30 @@ StatsTable::Private* StatsTable::Private::New(const std::string& name,
 #endif
 }
 
-void StatsTable::Private::InitializeTable(void* memory, int size,
-                                          int max_counters,
-                                          int max_threads) {
+void StatsTable::Private::InitializeTable(void* memory,
+                                          const StatsTableHeader& header) {
   // Zero everything.
-  memset(memory, 0, size);
+  memset(memory, 0, header.size);
 
   // Initialize the header.
-  TableHeader* header = static_cast<TableHeader*>(memory);
-  header->version = kTableVersion;
-  header->size = size;
-  header->max_counters = max_counters;
-  header->max_threads = max_threads;
+  *static_cast<StatsTableHeader*>(memory) = header;
 }
 
 void StatsTable::Private::ComputeMappedPointers(void* memory) {
   char* data = static_cast<char*>(memory);
-  int offset = 0;
-
-  table_header_ = reinterpret_cast<TableHeader*>(data);
-  offset += sizeof(*table_header_);
-  offset += AlignOffset(offset);
+  table_header_ = reinterpret_cast<StatsTableHeader*>(data);
 
   // Verify we're looking at a valid StatsTable.
-  DCHECK_EQ(table_header_->version, kTableVersion);
-
-  thread_names_table_ = reinterpret_cast<char*>(data + offset);
-  offset += sizeof(char) *
-            max_threads() * StatsTable::kMaxThreadNameLength;
-  offset += AlignOffset(offset);
-
-  thread_tid_table_ = reinterpret_cast<PlatformThreadId*>(data + offset);
-  offset += sizeof(int) * max_threads();
-  offset += AlignOffset(offset);
-
-  thread_pid_table_ = reinterpret_cast<int*>(data + offset);
-  offset += sizeof(int) * max_threads();
-  offset += AlignOffset(offset);
-
-  counter_names_table_ = reinterpret_cast<char*>(data + offset);
-  offset += sizeof(char) *
-            max_counters() * StatsTable::kMaxCounterNameLength;
-  offset += AlignOffset(offset);
-
-  data_table_ = reinterpret_cast<int*>(data + offset);
-  offset += sizeof(int) * max_threads() * max_counters();
-
-  DCHECK_EQ(offset, size());
+  DCHECK_EQ(table_header_->version, kStatsTableVersion);
+
+  thread_names_table_ = data + table_header_->thread_names_offset;
+  thread_tid_table_ = reinterpret_cast<PlatformThreadId*>(
+      data + table_header_->thread_tids_offset);
+  thread_pid_table_ = reinterpret_cast<int*>(
+      data + table_header_->thread_pids_offset);
+  counter_names_table_ = data + table_header_->counter_names_offset;
+  data_table_ = reinterpret_cast<int*>(data + table_header_->data_offset);
+  histograms_table_ = data + table_header_->histograms_offset;
 }
 
 // TLSData carries the data stored in the TLS slots for the
@@ -258,18 +266,14 @@ StatsTable::StatsTable(const std::string& name, int max_threads,
                        int max_counters)
     : impl_(NULL),
       tls_index_(SlotReturnFunction) {
-  int table_size =
-    AlignedSize(sizeof(Private::TableHeader)) +
-    AlignedSize((max_counters * sizeof(char) * kMaxCounterNameLength)) +
-    AlignedSize((max_threads * sizeof(char) * kMaxThreadNameLength)) +
-    AlignedSize(max_threads * sizeof(int)) +
-    AlignedSize(max_threads * sizeof(int)) +
-    AlignedSize((sizeof(int) * (max_counters * max_threads)));
-
-  impl_ = Private::New(name, table_size, max_threads, max_counters);
+  Initialize(name, max_threads, max_counters, 0);
+}
 
-  if (!impl_)
-    PLOG(ERROR) << "StatsTable did not initialize";
+StatsTable::StatsTable(const std::string& name, int max_threads,
+                       int max_counters, int histograms_size)
+    : impl_(NULL),
+      tls_index_(SlotReturnFunction) {
+  Initialize(name, max_threads, max_counters, histograms_size);
 }
 
 StatsTable::~StatsTable() {
@@ -430,6 +434,37 @@ int StatsTable::GetMaxThreads() const {
   return impl_->max_threads();
 }
 
+void StatsTable::ExportHistograms() {
+  if (!impl_)
+    return;
+
+  StatisticsRecorder::Histograms histograms;
+  StatisticsRecorder::GetHistograms(&histograms);
+
+  AutoLock lock(histograms_lock_);
+  for (size_t i = 0; i < histograms.size(); ++i) {
+    const Histogram& histogram = *histograms[i];
+    int offset = FindOrAddHistogram(histogram);
+    if (offset < 0)
+      continue;
+
+    Histogram::SampleSet snapshot;
+    histogram.SnapshotSample(&snapshot);
+
+    // Let readers know that the entry is changing while we write it.
+    StatsTableHistogram* entry = impl_->histogram(offset);
+    volatile subtle::Atomic32* sequence = &entry->sequence;
+    subtle::NoBarrier_Store(sequence, *sequence + 1);
+    subtle::MemoryBarrier();
+    int32* counts = HistogramCounts(entry);
+    for (int index = 0; index < entry->bucket_count; ++index)
+      counts[index] = snapshot.counts(index);
+    entry->sum = snapshot.sum();
+    entry->count = snapshot.redundant_count();
+    subtle::Release_Store(sequence, *sequence + 1);
+  }
+}
+
 int* StatsTable::FindLocation(const char* name) {
   // Get the static StatsTable
   StatsTable *table = StatsTable::current();
@@ -559,6 +594,57 @@ int StatsTable::AddCounter(const std::string& name) {
 #endif
 }
 
+int StatsTable::FindOrAddHistogram(const Histogram& histogram) {
+#ifdef ANDROID
+  return -1;
+#else
+  const std::string& name = histogram.histogram_name();
+  CountersMap::const_iterator it = histograms_.find(name);
+  if (it != histograms_.end())
+    return it->second;
+
+  int bucket_count = static_cast<int>(histogram.bucket_count());
+  int entry_size = AlignedSize64(sizeof(StatsTableHistogram) +
+                                 (2 * bucket_count + 1) * sizeof(int32));
+  int offset;
+  {
+    // Other processes may be adding histograms too.
+    SharedMemoryAutoLock lock(impl_->shared_memory());
+    StatsTableHeader* header = impl_->table_header();
+    int used = header->histograms_used;
+    if (entry_size > header->histograms_size - used)
+      return -1;  // The table is full.
+
+    StatsTableHistogram* entry = impl_->histogram(used);
+    memset(entry, 0, entry_size);
+    entry->size = entry_size;
+    entry->pid = GetCurrentProcId();
+    entry->bucket_count = bucket_count;
+    strlcpy(entry->name, name.c_str(), sizeof(entry->name));
+    int32* ranges = HistogramRanges(entry);
+    for (int index = 0; index <= bucket_count; ++index)
+      ranges[index] = histogram.ranges(index);
+
+    // Publish the entry.
+    subtle::Release_Store(&header->histograms_used, used + entry_size);
+    offset = used;
+  }
+
+  histograms_[name] = offset;
+  return offset;
+#endif
+}
+
+void StatsTable::Initialize(const std::string& name, int max_threads,
+                            int max_counters, int histograms_size) {
+  StatsTableHeader layout;
+  ComputeLayout(max_counters, max_threads, histograms_size, &layout);
+  impl_ = Private::New(name, layout);
+
+  if (!impl_)
+    PLOG(ERROR) << "StatsTable did not initialize";
+}
+
 StatsTable::TLSData* StatsTable::GetTLSData() const {
   TLSData* data =
     static_cast<TLSData*>(tls_index_.Get());
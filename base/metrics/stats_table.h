@@ -16,6 +16,11 @@
 // which governs the maximum number of counters and concurrent
 // threads/processes which can use it.
 //
+// The table can also hold snapshots of the histograms of the process, which
+// are refreshed by ExportHistograms().  The layout of the shared memory is
+// described in stats_table_format.h, so that external programs can read the
+// table of a live process.
+//
 
 #ifndef BASE_METRICS_STATS_TABLE_H_
 #define BASE_METRICS_STATS_TABLE_H_
@@ -31,6 +36,8 @@
 
 namespace base {
 
+class Histogram;
+
 class BASE_API StatsTable {
  public:
   // Create a new StatsTable.
@@ -47,6 +54,11 @@ class BASE_API StatsTable {
   // If the StatsTable already exists, this number is ignored.
   StatsTable(const std::string& name, int max_threads, int max_counters);
 
+  // Same as above, also reserving |histograms_size| bytes for the histograms
+  // exported by ExportHistograms().
+  StatsTable(const std::string& name, int max_threads, int max_counters,
+             int histograms_size);
+
   // Destroys the StatsTable.  When the last StatsTable is destroyed
   // (across all processes), the StatsTable is removed from disk.
   ~StatsTable();
@@ -130,6 +142,13 @@ class BASE_API StatsTable {
   // the thread if it is not already registered.
   static int* FindLocation(const char *name);
 
+  // Copies a snapshot of each histogram of the StatisticsRecorder to the
+  // table, adding the histograms that are not in it yet.  The histograms
+  // that don't fit in the space reserved for them are skipped.  This takes
+  // no lock that samples are added under, so it can be called periodically,
+  // on any thread.
+  void ExportHistograms();
+
  private:
   class Private;
   struct TLSData;
@@ -169,6 +188,15 @@ class BASE_API StatsTable {
   // On failure, returns 0.
   int AddCounter(const std::string& name);
 
+  // Returns the offset of the entry of |histogram| in the histograms
+  // section, adding one if needed, or -1 if there is no space left.  The
+  // caller must hold histograms_lock_.
+  int FindOrAddHistogram(const Histogram& histogram);
+
+  // Sets up our members.  Called by the constructors.
+  void Initialize(const std::string& name, int max_threads, int max_counters,
+                  int histograms_size);
+
   // Get the TLS data for the calling thread.  Returns NULL if none is
   // initialized.
   TLSData* GetTLSData() const;
@@ -186,6 +214,12 @@ class BASE_API StatsTable {
   CountersMap counters_;
   ThreadLocalStorage::Slot tls_index_;
 
+  // Protects histograms_, and serializes the exports of histograms.
+  base::Lock histograms_lock_;
+
+  // The offsets of the entries of our histograms, by name.
+  CountersMap histograms_;
+
   static StatsTable* global_table_;
 
   DISALLOW_COPY_AND_ASSIGN(StatsTable);
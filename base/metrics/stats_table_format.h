@@ -0,0 +1,98 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// The layout of the shared memory of a StatsTable.  It is meant for the
+// programs that read the table of a live process without linking base, such
+// as stats_table_scraper, so it only defines plain structures.
+//
+// The table is laid out as follows.  All the offsets are from the start of
+// the table, and are stored in the header.
+//
+// +-------------------------------------------+
+// | StatsTableHeader                          |
+// +-------------------------------------------+
+// | Thread names table                        |  max_threads names.
+// +-------------------------------------------+
+// | Thread TID table                          |  max_threads int32.
+// +-------------------------------------------+
+// | Thread PID table                          |  max_threads int32.
+// +-------------------------------------------+
+// | Counter names table                       |  max_counters names.
+// +-------------------------------------------+
+// | Data                                      |  max_counters rows of
+// |                                           |  max_threads int32.
+// +-------------------------------------------+
+// | Histograms                                |  StatsTableHistogram
+// |                                           |  entries.
+// +-------------------------------------------+
+//
+// A thread (column) or counter (row) whose name starts with '\0' is unused.
+// The value of a counter is the sum of its row, or of the columns of a given
+// process.  The name of a counter tells its kind: "c:" for counters, "t:" for
+// timers (in milliseconds), and anything else for gauges, such as the maxima
+// recorded by StatsRate.
+//
+// Readers don't need any lock.  The histogram entries are appended, and
+// published by updating histograms_used last.  Each entry is then updated in
+// place: its sequence number is odd while it is being written, so a reader
+// should copy it and retry if the sequence number was odd or changed.
+
+#ifndef BASE_METRICS_STATS_TABLE_FORMAT_H_
+#define BASE_METRICS_STATS_TABLE_FORMAT_H_
+#pragma once
+
+#include "base/basictypes.h"
+
+namespace base {
+
+// Identifies a StatsTable, and the version of its format.  Tables of another
+// version are reinitialized when opened.
+const int32 kStatsTableVersion = 0x13131314;
+
+struct StatsTableHeader {
+  int32 version;  // kStatsTableVersion.
+  int32 size;     // Of the whole table, in bytes.
+  int32 max_counters;
+  int32 max_threads;
+  int32 header_size;  // sizeof(StatsTableHeader).
+  int32 max_thread_name_length;   // Including the null terminator.
+  int32 max_counter_name_length;  // Including the null terminator.
+
+  // The offsets of the sections of the table.
+  int32 thread_names_offset;
+  int32 thread_tids_offset;
+  int32 thread_pids_offset;
+  int32 counter_names_offset;
+  int32 data_offset;
+  int32 histograms_offset;
+
+  // The size of the histograms section, and how much of it holds entries.
+  int32 histograms_size;
+  int32 histograms_used;
+};
+
+// A histogram exported by StatsTable::ExportHistograms(), followed by its
+// int32 ranges[bucket_count + 1] and int32 counts[bucket_count].  A sample
+// goes in bucket i if ranges[i] <= sample < ranges[i + 1].
+struct StatsTableHistogram {
+  // Including the name length and terminator.
+  enum { kMaxNameLength = 128 };
+
+  int32 size;      // Of the entry and its arrays, a multiple of 8 bytes.
+  int32 sequence;  // Odd while the entry is being updated.
+  int32 pid;       // Of the process that exports the histogram.
+  int32 bucket_count;
+  int64 sum;       // Of the samples.
+  int64 count;     // Of the samples.
+  char name[kMaxNameLength];
+};
+
+COMPILE_ASSERT(sizeof(StatsTableHeader) == 15 * 4,
+               stats_table_header_has_no_padding);
+COMPILE_ASSERT(sizeof(StatsTableHistogram) == 160,
+               stats_table_histogram_has_no_padding);
+
+}  // namespace base
+
+#endif  // BASE_METRICS_STATS_TABLE_FORMAT_H_
@@ -0,0 +1,257 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Prints the counters and histograms of a live StatsTable in the text format
+// of Prometheus, so that a monitoring agent can scrape them.
+//
+//   stats_table_scraper <table name or path>
+//
+// A table name is looked up in /dev/shm, where base::SharedMemory keeps the
+// named shared memory on Linux.  This only reads the table, and does not
+// link with base, so it can run next to a process without disturbing it.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/metrics/stats_table_format.h"
+
+namespace {
+
+const char kShmemPrefix[] = "/dev/shm/com.google.chrome.shmem.";
+
+// The number of times a histogram is copied before giving up on it, if it
+// keeps changing while being copied.
+const int kMaxReadAttempts = 100;
+
+// Returns |value| escaped for a Prometheus label value.
+std::string EscapeLabel(const char* value) {
+  std::string escaped;
+  for (; *value; ++value) {
+    if (*value == '\\' || *value == '"')
+      escaped += '\\';
+    if (*value == '\n')
+      escaped += "\\n";
+    else
+      escaped += *value;
+  }
+  return escaped;
+}
+
+// Returns true if |count| items of |item_size| bytes, starting at |offset|,
+// fit in a table of |size| bytes.  |offset| must be a multiple of |alignment|.
+bool IsValidSection(int32 offset, int64 count, int64 item_size, int32 size,
+                    int alignment) {
+  if (offset < 0 || offset > size || offset % alignment || count < 0 ||
+      item_size < 0) {
+    return false;
+  }
+  return !item_size || count <= (size - offset) / item_size;
+}
+
+// Returns true if |header| describes a table that fits in a file of
+// |file_size| bytes, so that its sections can be read.
+bool IsValidHeader(const base::StatsTableHeader& header, off_t file_size) {
+  if (header.version != base::kStatsTableVersion ||
+      header.header_size != sizeof(header) ||
+      header.size < header.header_size || header.size > file_size ||
+      header.max_counters < 0 || header.max_threads < 0 ||
+      header.max_counter_name_length < 1) {
+    return false;
+  }
+
+  int64 cells = static_cast<int64>(header.max_counters) * header.max_threads;
+  return IsValidSection(header.thread_pids_offset, header.max_threads,
+                        sizeof(int32), header.size, sizeof(int32)) &&
+         IsValidSection(header.counter_names_offset, header.max_counters,
+                        header.max_counter_name_length, header.size, 1) &&
+         IsValidSection(header.data_offset, cells, sizeof(int32),
+                        header.size, sizeof(int32)) &&
+         IsValidSection(header.histograms_offset, header.histograms_size, 1,
+                        header.size, sizeof(int64));
+}
+
+// Returns the name of the counter of the table in |row|, or NULL if the row
+// is unused or its name is not terminated.
+const char* CounterName(const char* table,
+                        const base::StatsTableHeader& header, int row) {
+  const char* name = table + header.counter_names_offset +
+                     row * header.max_counter_name_length;
+  if (!name[0] || !memchr(name, '\0', header.max_counter_name_length))
+    return NULL;
+  return name;
+}
+
+// Prints the counters of |table|, one sample per counter and process.
+void PrintCounters(const char* table, const base::StatsTableHeader& header) {
+  const int32* pids = reinterpret_cast<const int32*>(
+      table + header.thread_pids_offset);
+  const int32* data = reinterpret_cast<const int32*>(
+      table + header.data_offset);
+
+  printf("# TYPE stats_table_counter counter\n");
+  printf("# TYPE stats_table_timer_milliseconds counter\n");
+  printf("# TYPE stats_table_gauge gauge\n");
+  for (int row = 0; row < header.max_counters; ++row) {
+    const char* name = CounterName(table, header, row);
+    if (!name)
+      continue;
+
+    const char* metric = "stats_table_gauge";
+    if (name[0] == 'c' && name[1] == ':') {
+      metric = "stats_table_counter";
+      name += 2;
+    } else if (name[0] == 't' && name[1] == ':') {
+      metric = "stats_table_timer_milliseconds";
+      name += 2;
+    }
+
+    // Sum the columns of each process.
+    std::map<int32, int64> values;
+    const int32* values_row = data + row * header.max_threads;
+    for (int column = 0; column < header.max_threads; ++column) {
+      if (pids[column])
+        values[pids[column]] += values_row[column];
+    }
+
+    std::string label = EscapeLabel(name);
+    for (std::map<int32, int64>::const_iterator it = values.begin();
+         it != values.end(); ++it) {
+      printf("%s{name=\"%s\",pid=\"%d\"} %lld\n", metric, label.c_str(),
+             it->first, static_cast<long long>(it->second));
+    }
+  }
+}
+
+// Copies the histogram entry at |entry| to |copy|, which is resized to hold
+// the entry and its arrays.  Returns false if the entry kept changing.
+bool CopyHistogram(const char* entry, int size, std::vector<char>* copy) {
+  const volatile int32* sequence = &reinterpret_cast<
+      const base::StatsTableHistogram*>(entry)->sequence;
+  copy->resize(size);
+  for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt) {
+    int32 before = *sequence;
+    __sync_synchronize();
+    memcpy(&(*copy)[0], entry, size);
+    __sync_synchronize();
+    if (!(before & 1) && *sequence == before)
+      return true;
+  }
+  return false;
+}
+
+// Prints the histograms of |table|, as cumulative buckets.
+void PrintHistograms(const char* table, const base::StatsTableHeader& header) {
+  printf("# TYPE stats_table_histogram histogram\n");
+  const char* histograms = table + header.histograms_offset;
+  int used = *const_cast<const volatile int32*>(&header.histograms_used);
+  __sync_synchronize();
+  if (used < 0 || used > header.histograms_size)
+    return;
+
+  std::vector<char> copy;
+  int offset = 0;
+  while (offset + static_cast<int>(sizeof(base::StatsTableHistogram)) <=
+         used) {
+    const base::StatsTableHistogram* entry =
+        reinterpret_cast<const base::StatsTableHistogram*>(
+            histograms + offset);
+    int size = entry->size;
+    int bucket_count = entry->bucket_count;
+    if (size <= 0 || size > used - offset || bucket_count < 0 ||
+        sizeof(*entry) + (2 * bucket_count + 1) * sizeof(int32) >
+            static_cast<size_t>(size)) {
+      fprintf(stderr, "Corrupt histogram entry at offset %d\n", offset);
+      return;
+    }
+    offset += size;
+    if (!CopyHistogram(reinterpret_cast<const char*>(entry), size, &copy))
+      continue;
+
+    const base::StatsTableHistogram* histogram =
+        reinterpret_cast<const base::StatsTableHistogram*>(&copy[0]);
+    const int32* ranges = reinterpret_cast<const int32*>(histogram + 1);
+    const int32* counts = ranges + bucket_count + 1;
+    std::string name(histogram->name,
+                     strnlen(histogram->name, sizeof(histogram->name)));
+    std::string labels = "name=\"" + EscapeLabel(name.c_str()) + "\",pid=\"";
+    char pid[16];
+    snprintf(pid, sizeof(pid), "%d\"", histogram->pid);
+    labels += pid;
+
+    int64 cumulative = 0;
+    for (int i = 0; i < bucket_count; ++i) {
+      cumulative += counts[i];
+      if (i + 1 < bucket_count) {
+        printf("stats_table_histogram_bucket{%s,le=\"%d\"} %lld\n",
+               labels.c_str(), ranges[i + 1] - 1,
+               static_cast<long long>(cumulative));
+      } else {
+        printf("stats_table_histogram_bucket{%s,le=\"+Inf\"} %lld\n",
+               labels.c_str(), static_cast<long long>(cumulative));
+      }
+    }
+    printf("stats_table_histogram_sum{%s} %lld\n", labels.c_str(),
+           static_cast<long long>(histogram->sum));
+    printf("stats_table_histogram_count{%s} %lld\n", labels.c_str(),
+           static_cast<long long>(histogram->count));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <table name or path>\n", argv[0]);
+    return 1;
+  }
+
+  std::string path = argv[1];
+  if (path.find('/') == std::string::npos)
+    path = kShmemPrefix + path;
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    perror(path.c_str());
+    return 1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 ||
+      st.st_size < static_cast<off_t>(sizeof(base::StatsTableHeader))) {
+    fprintf(stderr, "%s is not a StatsTable\n", path.c_str());
+    close(fd);
+    return 1;
+  }
+  void* memory = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+
+  // The header is validated on a copy, so that it cannot change afterwards.
+  const char* table = static_cast<const char*>(memory);
+  base::StatsTableHeader header;
+  memcpy(&header, table, sizeof(header));
+  __sync_synchronize();
+  if (!IsValidHeader(header, st.st_size)) {
+    fprintf(stderr, "%s is not a StatsTable of version %x\n", path.c_str(),
+            base::kStatsTableVersion);
+    munmap(memory, st.st_size);
+    return 1;
+  }
+
+  PrintCounters(table, header);
+  PrintHistograms(table, header);
+  munmap(memory, st.st_size);
+  return 0;
+}
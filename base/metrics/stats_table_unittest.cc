@@ -2,8 +2,10 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "base/metrics/histogram.h"
 #include "base/metrics/stats_counters.h"
 #include "base/metrics/stats_table.h"
+#include "base/metrics/stats_table_format.h"
 #include "base/shared_memory.h"
 #include "base/string_piece.h"
 #include "base/string_util.h"
@@ -408,4 +410,86 @@ TEST_F(StatsTableTest, StatsScope) {
   DeleteShmem(kTableName);
 }
 
+// Returns the entry of the histogram named |name| in the table mapped by
+// |memory|, as an external reader would find it, or NULL.
+const StatsTableHistogram* FindExportedHistogram(const SharedMemory& memory,
+                                                 const std::string& name) {
+  const char* table = static_cast<const char*>(memory.memory());
+  const StatsTableHeader* header =
+      reinterpret_cast<const StatsTableHeader*>(table);
+  const char* histograms = table + header->histograms_offset;
+  for (int offset = 0; offset < header->histograms_used;) {
+    const StatsTableHistogram* entry =
+        reinterpret_cast<const StatsTableHistogram*>(histograms + offset);
+    if (name == entry->name)
+      return entry;
+    offset += entry->size;
+  }
+  return NULL;
+}
+
+// Export histograms, and read them back through the shared memory.
+TEST_F(StatsTableTest, ExportHistograms) {
+  const std::string kTableName = "ExportHistogramsStatTable";
+  const int kMaxThreads = 2;
+  const int kMaxCounter = 2;
+  const int kHistogramsSize = 64 * 1024;
+  DeleteShmem(kTableName);
+  StatisticsRecorder recorder;
+  StatsTable table(kTableName, kMaxThreads, kMaxCounter, kHistogramsSize);
+
+  Histogram* histogram = LinearHistogram::FactoryGet(
+      "StatsTableTest.Exported", 1, 10, 11, Histogram::kNoFlags);
+  histogram->Add(3);
+  histogram->Add(3);
+  histogram->Add(7);
+  table.ExportHistograms();
+
+  SharedMemory memory;
+  ASSERT_TRUE(memory.Open(kTableName, true));
+  ASSERT_TRUE(memory.Map(sizeof(StatsTableHeader)));
+  const StatsTableHeader* header =
+      static_cast<const StatsTableHeader*>(memory.memory());
+  EXPECT_EQ(kStatsTableVersion, header->version);
+  EXPECT_EQ(kMaxCounter, header->max_counters);
+  EXPECT_EQ(kMaxThreads, header->max_threads);
+  EXPECT_EQ(kHistogramsSize, header->histograms_size);
+  EXPECT_EQ(0, header->histograms_offset % 8);
+  EXPECT_EQ(header->size, header->histograms_offset + kHistogramsSize);
+  uint32 size = header->size;
+  memory.Close();
+  ASSERT_TRUE(memory.Open(kTableName, true));
+  ASSERT_TRUE(memory.Map(size));
+  header = static_cast<const StatsTableHeader*>(memory.memory());
+
+  const StatsTableHistogram* entry =
+      FindExportedHistogram(memory, "StatsTableTest.Exported");
+  ASSERT_TRUE(entry != NULL);
+  EXPECT_EQ(0, entry->sequence % 2);
+  EXPECT_EQ(static_cast<int>(GetCurrentProcId()), entry->pid);
+  ASSERT_EQ(static_cast<int>(histogram->bucket_count()), entry->bucket_count);
+  EXPECT_EQ(3, entry->count);
+  EXPECT_EQ(13, entry->sum);
+  const int32* ranges = reinterpret_cast<const int32*>(entry + 1);
+  const int32* counts = ranges + entry->bucket_count + 1;
+  for (int i = 0; i <= entry->bucket_count; i++)
+    EXPECT_EQ(histogram->ranges(i), ranges[i]);
+  // Each of the samples from 1 to 10 has its own bucket.
+  EXPECT_EQ(3, ranges[3]);
+  EXPECT_EQ(2, counts[3]);
+  EXPECT_EQ(7, ranges[7]);
+  EXPECT_EQ(1, counts[7]);
+
+  // Exporting again updates the entry in place.
+  int used = header->histograms_used;
+  histogram->Add(7);
+  table.ExportHistograms();
+  EXPECT_EQ(used, header->histograms_used);
+  EXPECT_EQ(entry, FindExportedHistogram(memory, "StatsTableTest.Exported"));
+  EXPECT_EQ(4, entry->count);
+  EXPECT_EQ(2, counts[7]);
+
+  DeleteShmem(kTableName);
+}
+
 }  // namespace base
@@ -400,6 +400,34 @@ TEST(StringUtilTest, IsStringUTF8) {
   EXPECT_FALSE(IsStringUTF8("embedded\xc0\x80U+0000"));
 }
 
+// IsStringASCII() and IsStringUTF8() check 16 characters at a time where they
+// can.  Check that a non-ASCII character is found wherever it is.
+TEST(StringUtilTest, IsStringASCIIAndUTF8LongStrings) {
+  for (size_t pos = 0; pos < 40; ++pos) {
+    std::string ascii(40, 'a');
+    EXPECT_TRUE(IsStringASCII(ascii));
+    EXPECT_TRUE(IsStringUTF8(ascii));
+
+    std::string latin1(ascii);
+    latin1[pos] = '\xe9';
+    EXPECT_FALSE(IsStringASCII(latin1));
+    EXPECT_FALSE(IsStringUTF8(latin1));
+
+    std::string utf8(ascii);
+    utf8.replace(pos, 1, "\xc3\xa9");
+    EXPECT_FALSE(IsStringASCII(utf8));
+    EXPECT_TRUE(IsStringUTF8(utf8));
+
+    std::wstring wide(40, L'a');
+    wide[pos] = 0xe9;
+    EXPECT_FALSE(IsStringASCII(wide));
+    string16 utf16(40, 'a');
+    EXPECT_TRUE(IsStringASCII(utf16));
+    utf16[pos] = 0x100;
+    EXPECT_FALSE(IsStringASCII(utf16));
+  }
+}
+
 TEST(StringUtilTest, ConvertASCII) {
   static const char* char_cases[] = {
     "Google Video",
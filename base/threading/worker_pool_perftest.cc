@@ -0,0 +1,105 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/threading/worker_pool_posix.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/atomic_sequence_num.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/task.h"
+#include "base/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kNumTasks = 100000;
+const int kMaxWorkers = 64;
+
+// The results of a single run.
+struct RunStats {
+  explicit RunStats(int num_tasks)
+      : delays(num_tasks), done(true, false) {}
+
+  std::vector<TimeDelta> delays;  // The queueing delay of each task.
+  AtomicSequenceNumber num_run;
+  WaitableEvent done;
+};
+
+// Records how long it waited to run, after posting |num_children| more tasks.
+class TimedTask : public Task {
+ public:
+  TimedTask(WorkStealingThreadPool* pool, int num_children, RunStats* stats)
+      : pool_(pool),
+        num_children_(num_children),
+        stats_(stats),
+        posted_(TimeTicks::Now()) {}
+
+  virtual void Run() {
+    TimeDelta delay = TimeTicks::Now() - posted_;
+    for (int i = 0; i < num_children_; i++)
+      pool_->PostTask(new TimedTask(pool_, 0, stats_));
+
+    int slot = stats_->num_run.GetNext();
+    stats_->delays[slot] = delay;
+    if (slot + 1 == static_cast<int>(stats_->delays.size()))
+      stats_->done.Signal();
+  }
+
+ private:
+  WorkStealingThreadPool* pool_;
+  int num_children_;
+  RunStats* stats_;
+  TimeTicks posted_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimedTask);
+};
+
+// Runs |kNumTasks| tasks on a pool with |num_workers| threads. The tasks are
+// posted as |num_roots| tasks from this thread, each of them posting the rest
+// of its share from a worker thread.
+void RunTasks(const char* name, int num_workers, int num_roots) {
+  scoped_refptr<WorkStealingThreadPool> pool(
+      new WorkStealingThreadPool("perf_pool", num_workers));
+  RunStats stats(kNumTasks);
+  int num_children = kNumTasks / num_roots - 1;
+
+  PerfTimer timer;
+  for (int i = 0; i < num_roots; i++)
+    pool->PostTask(new TimedTask(pool.get(), num_children, &stats));
+  EXPECT_TRUE(stats.done.Wait());
+  TimeDelta elapsed = timer.Elapsed();
+  pool->Terminate();
+
+  std::vector<TimeDelta>& delays = stats.delays;
+  std::vector<TimeDelta>::iterator p99 = delays.begin() + kNumTasks * 99 / 100;
+  std::nth_element(delays.begin(), p99, delays.end());
+
+  std::string test_name = StringPrintf("%s_%d_threads", name, num_workers);
+  LogPerfResult((test_name + "_throughput").c_str(),
+                kNumTasks / elapsed.InSecondsF(), "tasks/s");
+  LogPerfResult((test_name + "_p99_delay").c_str(),
+                p99->InMillisecondsF(), "ms");
+}
+
+}  // namespace
+
+// All the tasks go through the shared queue.
+TEST(WorkerPoolPerfTest, PostFromOutside) {
+  for (int num_workers = 1; num_workers <= kMaxWorkers; num_workers *= 2)
+    RunTasks("WorkerPool_post_from_outside", num_workers, kNumTasks);
+}
+
+// Most of the tasks are posted by the workers to their own deques.
+TEST(WorkerPoolPerfTest, PostFromWorkers) {
+  for (int num_workers = 1; num_workers <= kMaxWorkers; num_workers *= 2)
+    RunTasks("WorkerPool_post_from_workers", num_workers, 100);
+}
+
+}  // namespace base
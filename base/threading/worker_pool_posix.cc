@@ -4,10 +4,14 @@
 
 #include "base/threading/worker_pool_posix.h"
 
+#include <algorithm>
+
 #include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
+#include "base/stl_util-inl.h"
 #include "base/stringprintf.h"
+#include "base/sys_info.h"
 #include "base/task.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/worker_pool.h"
@@ -21,6 +25,14 @@ const int kIdleSecondsBeforeExit = 10 * 60;
 // function of NSS because of NSS bug 439169.
 const int kWorkerThreadStackSize = 128 * 1024;
 
+// The number of tasks that fit in the deque of each work-stealing thread. Must
+// be a power of two.
+const int kDequeCapacity = 256;
+
+// The maximum number of tasks that a work-stealing thread moves from the shared
+// queue to its own deque at once.
+const int kMaxInjectedBatch = 32;
+
 class WorkerPoolImpl {
  public:
   WorkerPoolImpl();
@@ -30,22 +42,31 @@ class WorkerPoolImpl {
                 bool task_is_slow);
 
  private:
+  // Tasks that may block go to a pool that grows as needed.
   scoped_refptr<base::PosixDynamicThreadPool> pool_;
+  // Everything else runs on one thread per processor.
+  scoped_refptr<base::WorkStealingThreadPool> fast_pool_;
 };
 
 WorkerPoolImpl::WorkerPoolImpl()
     : pool_(new base::PosixDynamicThreadPool("WorkerPool",
-                                             kIdleSecondsBeforeExit)) {
+                                             kIdleSecondsBeforeExit)),
+      fast_pool_(new base::WorkStealingThreadPool(
+          "FastWorkerPool", std::max(2, SysInfo::NumberOfProcessors()))) {
 }
 
 WorkerPoolImpl::~WorkerPoolImpl() {
   pool_->Terminate();
+  fast_pool_->Terminate();
 }
 
 void WorkerPoolImpl::PostTask(const tracked_objects::Location& from_here,
                               Task* task, bool task_is_slow) {
   task->SetBirthPlace(from_here);
-  pool_->PostTask(task);
+  if (task_is_slow)
+    pool_->PostTask(task);
+  else
+    fast_pool_->PostTask(task);
 }
 
 base::LazyInstance<WorkerPoolImpl> g_lazy_worker_pool(base::LINKER_INITIALIZED);
@@ -85,6 +106,35 @@ void WorkerThread::ThreadMain() {
   delete this;
 }
 
+class StealingWorkerThread : public PlatformThread::Delegate {
+ public:
+  StealingWorkerThread(const std::string& name_prefix, int index,
+                       base::WorkStealingThreadPool* pool)
+      : name_prefix_(name_prefix),
+        index_(index),
+        pool_(pool) {}
+
+  virtual void ThreadMain();
+
+ private:
+  const std::string name_prefix_;
+  const int index_;
+  scoped_refptr<base::WorkStealingThreadPool> pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(StealingWorkerThread);
+};
+
+void StealingWorkerThread::ThreadMain() {
+  const std::string name = base::StringPrintf(
+      "%s/%d", name_prefix_.c_str(), PlatformThread::CurrentId());
+  PlatformThread::SetName(name.c_str());
+
+  pool_->RunWorker(index_);
+
+  // The StealingWorkerThread is non-joinable, so it deletes itself.
+  delete this;
+}
+
 }  // namespace
 
 bool WorkerPool::PostTask(const tracked_objects::Location& from_here,
@@ -166,4 +216,250 @@ Task* PosixDynamicThreadPool::WaitForTask() {
   return task;
 }
 
+// A Chase-Lev work-stealing deque with a fixed capacity. Only the thread that
+// owns the deque can call Push() and Pop(), which work on the bottom end.
+// Any thread can Steal() from the top end.
+class WorkStealingThreadPool::TaskDeque {
+ public:
+  TaskDeque() : top_(0), bottom_(0) {}
+
+  // Returns false if the deque is full.
+  bool Push(Task* task) {
+    subtle::AtomicWord bottom = subtle::NoBarrier_Load(&bottom_);
+    subtle::AtomicWord top = subtle::Acquire_Load(&top_);
+    if (bottom - top >= kDequeCapacity)
+      return false;
+
+    subtle::NoBarrier_Store(&tasks_[bottom & (kDequeCapacity - 1)],
+                            reinterpret_cast<subtle::AtomicWord>(task));
+    subtle::Release_Store(&bottom_, bottom + 1);
+    return true;
+  }
+
+  // Returns the last task pushed, or NULL if the deque is empty.
+  Task* Pop() {
+    subtle::AtomicWord bottom = subtle::NoBarrier_Load(&bottom_) - 1;
+    subtle::NoBarrier_Store(&bottom_, bottom);
+    subtle::MemoryBarrier();
+    subtle::AtomicWord top = subtle::NoBarrier_Load(&top_);
+    if (bottom < top) {
+      subtle::NoBarrier_Store(&bottom_, top);
+      return NULL;
+    }
+
+    Task* task = reinterpret_cast<Task*>(
+        subtle::NoBarrier_Load(&tasks_[bottom & (kDequeCapacity - 1)]));
+    if (bottom > top)
+      return task;
+
+    // This is the last task, so we may be racing with a thief.
+    if (subtle::Acquire_CompareAndSwap(&top_, top, top + 1) != top)
+      task = NULL;
+    subtle::NoBarrier_Store(&bottom_, top + 1);
+    return task;
+  }
+
+  // Returns the oldest task, or NULL if the deque is empty or we lost a race
+  // with another thread.
+  Task* Steal() {
+    subtle::AtomicWord top = subtle::Acquire_Load(&top_);
+    subtle::MemoryBarrier();
+    subtle::AtomicWord bottom = subtle::Acquire_Load(&bottom_);
+    if (bottom <= top)
+      return NULL;
+
+    // The slot cannot be reused before |top_| moves past it, so the task is
+    // still there if the CAS succeeds.
+    Task* task = reinterpret_cast<Task*>(
+        subtle::NoBarrier_Load(&tasks_[top & (kDequeCapacity - 1)]));
+    if (subtle::Acquire_CompareAndSwap(&top_, top, top + 1) != top)
+      return NULL;
+    return task;
+  }
+
+  bool IsEmpty() const {
+    subtle::AtomicWord top = subtle::Acquire_Load(&top_);
+    return subtle::Acquire_Load(&bottom_) <= top;
+  }
+
+ private:
+  volatile subtle::AtomicWord top_;  // The next task to steal.
+  volatile subtle::AtomicWord bottom_;  // The next slot to push to.
+  volatile subtle::AtomicWord tasks_[kDequeCapacity];
+
+  DISALLOW_COPY_AND_ASSIGN(TaskDeque);
+};
+
+WorkStealingThreadPool::WorkStealingThreadPool(const std::string& name_prefix,
+                                               int num_workers)
+    : name_prefix_(name_prefix),
+      num_workers_(num_workers),
+      num_parked_threads_(0),
+      num_injected_tasks_(0),
+      terminated_(0),
+      num_started_threads_(0),
+      tasks_available_cv_(&lock_),
+      num_pending_wakeups_(0) {
+  DCHECK_GT(num_workers, 0);
+  for (int i = 0; i < num_workers; i++)
+    deques_.push_back(new TaskDeque);
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  // All the worker threads are gone, so nobody else is using the deques.
+  for (size_t i = 0; i < deques_.size(); i++) {
+    while (Task* task = deques_[i]->Steal())
+      delete task;
+  }
+  STLDeleteElements(&deques_);
+
+  while (!tasks_.empty()) {
+    Task* task = tasks_.front();
+    tasks_.pop();
+    delete task;
+  }
+}
+
+void WorkStealingThreadPool::Terminate() {
+  {
+    AutoLock locked(lock_);
+    DCHECK(!subtle::NoBarrier_Load(&terminated_)) <<
+        "Thread pool is already terminated.";
+    subtle::Release_Store(&terminated_, 1);
+  }
+  tasks_available_cv_.Broadcast();
+}
+
+void WorkStealingThreadPool::PostTask(Task* task) {
+  DCHECK(!subtle::NoBarrier_Load(&terminated_)) <<
+      "This thread pool is already terminated.  Do not post new tasks.";
+
+  TaskDeque* deque = current_deque_.Get();
+  if (deque && deque->Push(task)) {
+    // This pairs with the barrier in RunWorker(): either we see the parked
+    // thread, or it sees the new task before going to sleep.
+    subtle::MemoryBarrier();
+    if (subtle::NoBarrier_Load(&num_parked_threads_) > 0 ||
+        subtle::NoBarrier_Load(&num_started_threads_) < num_workers_) {
+      AutoLock locked(lock_);
+      WakeUpWorkerLocked();
+    }
+    return;
+  }
+
+  // We are not on a worker thread, or its deque is full.
+  AutoLock locked(lock_);
+  tasks_.push(task);
+  subtle::NoBarrier_Store(&num_injected_tasks_,
+                          static_cast<subtle::Atomic32>(tasks_.size()));
+  WakeUpWorkerLocked();
+}
+
+void WorkStealingThreadPool::RunWorker(int index) {
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, num_workers_);
+  TaskDeque* deque = deques_[index];
+  current_deque_.Set(deque);
+
+  for (;;) {
+    if (subtle::Acquire_Load(&terminated_))
+      break;
+
+    Task* task = FindTask(deque, index);
+    if (task) {
+      task->Run();
+      delete task;
+      continue;
+    }
+
+    // Nothing to do, so park this thread. The parked count has to be visible
+    // before we look at the deques for the last time; see PostTask().
+    AutoLock locked(lock_);
+    if (subtle::NoBarrier_Load(&terminated_))
+      break;
+    subtle::Barrier_AtomicIncrement(&num_parked_threads_, 1);
+    if (!HasPendingTasks())
+      tasks_available_cv_.Wait();
+    subtle::NoBarrier_AtomicIncrement(&num_parked_threads_, -1);
+    if (num_pending_wakeups_)
+      num_pending_wakeups_--;
+  }
+
+  current_deque_.Set(NULL);
+}
+
+Task* WorkStealingThreadPool::FindTask(TaskDeque* deque, int index) {
+  Task* task = deque->Pop();
+  if (task)
+    return task;
+
+  if (subtle::Acquire_Load(&num_injected_tasks_) > 0) {
+    task = TakeInjectedTasks(deque);
+    if (task)
+      return task;
+  }
+
+  // Steal from the other workers, starting with the next one.
+  for (int i = 1; i < num_workers_; i++) {
+    task = deques_[(index + i) % num_workers_]->Steal();
+    if (task)
+      return task;
+  }
+  return NULL;
+}
+
+Task* WorkStealingThreadPool::TakeInjectedTasks(TaskDeque* deque) {
+  AutoLock locked(lock_);
+  if (tasks_.empty())
+    return NULL;
+
+  Task* task = tasks_.front();
+  tasks_.pop();
+
+  // Leave at least half of the tasks for other workers.
+  int batch = std::min(kMaxInjectedBatch, static_cast<int>(tasks_.size() / 2));
+  for (int i = 0; i < batch && deque->Push(tasks_.front()); i++)
+    tasks_.pop();
+  subtle::NoBarrier_Store(&num_injected_tasks_,
+                          static_cast<subtle::Atomic32>(tasks_.size()));
+
+  if (!tasks_.empty() || !deque->IsEmpty())
+    WakeUpWorkerLocked();
+  return task;
+}
+
+bool WorkStealingThreadPool::HasPendingTasks() {
+  lock_.AssertAcquired();
+  if (!tasks_.empty())
+    return true;
+  for (size_t i = 0; i < deques_.size(); i++) {
+    if (!deques_[i]->IsEmpty())
+      return true;
+  }
+  return false;
+}
+
+void WorkStealingThreadPool::WakeUpWorkerLocked() {
+  lock_.AssertAcquired();
+  if (subtle::NoBarrier_Load(&terminated_))
+    return;
+
+  // Signal()ing a thread that is already waking up would not add any worker.
+  if (subtle::NoBarrier_Load(&num_parked_threads_) > num_pending_wakeups_) {
+    num_pending_wakeups_++;
+    tasks_available_cv_.Signal();
+    return;
+  }
+
+  int num_started = subtle::NoBarrier_Load(&num_started_threads_);
+  if (num_started < num_workers_) {
+    subtle::NoBarrier_Store(&num_started_threads_, num_started + 1);
+    // The new PlatformThread will take ownership of the StealingWorkerThread
+    // object, which will delete itself on exit.
+    StealingWorkerThread* worker =
+        new StealingWorkerThread(name_prefix_, num_started, this);
+    PlatformThread::CreateNonJoinable(kWorkerThreadStackSize, worker);
+  }
+}
+
 }  // namespace base
@@ -17,6 +17,14 @@
 // worker threads exit.  The owner of PosixDynamicThreadPool should likewise
 // maintain a scoped_refptr to the PosixDynamicThreadPool instance.
 //
+// Because every task goes through one locked queue, PosixDynamicThreadPool is
+// only used for tasks that are expected to block (|task_is_slow|).  Short
+// tasks run on a WorkStealingThreadPool, which has a fixed number of worker
+// threads, each with its own task deque.  Tasks posted by a worker go to its
+// own deque, and idle workers steal from the deques of busy ones, so the
+// shared lock is only taken for tasks posted from outside the pool and for
+// parking idle workers.
+//
 // NOTE: The classes defined in this file are only meant for use by the POSIX
 // implementation of WorkerPool.  No one else should be using these classes.
 // These symbols are exported in a header purely for testing purposes.
@@ -27,13 +35,16 @@
 
 #include <queue>
 #include <string>
+#include <vector>
 
+#include "base/atomicops.h"
 #include "base/basictypes.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/synchronization/condition_variable.h"
 #include "base/synchronization/lock.h"
 #include "base/threading/platform_thread.h"
+#include "base/threading/thread_local.h"
 
 class Task;
 
@@ -84,6 +95,71 @@ class PosixDynamicThreadPool
   DISALLOW_COPY_AND_ASSIGN(PosixDynamicThreadPool);
 };
 
+class WorkStealingThreadPool
+    : public RefCountedThreadSafe<WorkStealingThreadPool> {
+ public:
+  // Worker threads are started as needed, up to |num_workers|, and all share
+  // the same |name_prefix|.  They park when there is no work, and only exit
+  // when the pool is terminated.
+  WorkStealingThreadPool(const std::string& name_prefix, int num_workers);
+  ~WorkStealingThreadPool();
+
+  // Indicates that the thread pool is going away.  Stops handing out tasks to
+  // worker threads.  Wakes up all the parked threads to let them exit.
+  void Terminate();
+
+  // Adds |task| to the thread pool.  WorkStealingThreadPool assumes ownership
+  // of |task|.
+  void PostTask(Task* task);
+
+  // Worker thread method that runs tasks until the pool is terminated.
+  // |index| identifies the deque owned by the calling thread.
+  void RunWorker(int index);
+
+ private:
+  class TaskDeque;
+
+  // Returns the next task for the worker that owns |deque|, or NULL.
+  Task* FindTask(TaskDeque* deque, int index);
+
+  // Takes a task from the shared queue, moving a few more to |deque| so that
+  // other workers can steal them.
+  Task* TakeInjectedTasks(TaskDeque* deque);
+
+  // Returns true if there is any task waiting to run.
+  bool HasPendingTasks();
+
+  // Wakes up a parked worker if there is one, or starts a new one if we can.
+  void WakeUpWorkerLocked();
+
+  const std::string name_prefix_;
+  const int num_workers_;
+
+  // One deque per worker thread, created up front so that the array never
+  // changes while other workers are stealing from it.
+  std::vector<TaskDeque*> deques_;
+
+  // The deque owned by the current thread, if it is one of our workers.
+  ThreadLocalPointer<TaskDeque> current_deque_;
+
+  subtle::Atomic32 num_parked_threads_;
+  subtle::Atomic32 num_injected_tasks_;  // The size of |tasks_|.
+  subtle::Atomic32 terminated_;
+  subtle::Atomic32 num_started_threads_;  // Only modified with |lock_| held.
+
+  Lock lock_;  // Protects all the variables below.
+
+  // Signal()s parked worker threads to let them know more tasks are available.
+  // Also used for Broadcast()'ing to worker threads to let them know the pool
+  // is being deleted and they can exit.
+  ConditionVariable tasks_available_cv_;
+  // The number of parked threads that have been Signal()ed but not woken up.
+  int num_pending_wakeups_;
+  std::queue<Task*> tasks_;  // Tasks posted from outside of the pool.
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingThreadPool);
+};
+
 }  // namespace base
 
 #endif  // BASE_THREADING_WORKER_POOL_POSIX_H_
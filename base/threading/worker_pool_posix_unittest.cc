@@ -6,6 +6,7 @@
 
 #include <set>
 
+#include "base/atomic_sequence_num.h"
 #include "base/synchronization/condition_variable.h"
 #include "base/synchronization/lock.h"
 #include "base/task.h"
@@ -175,6 +176,73 @@ class PosixDynamicThreadPoolTest : public testing::Test {
   base::WaitableEvent start_;
 };
 
+// CountingTask increments a counter, signals |done| when the counter reaches
+// |num_tasks|, and posts |num_children| more CountingTasks to |pool| first.
+class CountingTask : public Task {
+ public:
+  CountingTask(WorkStealingThreadPool* pool, int num_children,
+               AtomicSequenceNumber* counter, int num_tasks,
+               Lock* unique_threads_lock,
+               std::set<PlatformThreadId>* unique_threads,
+               WaitableEvent* done)
+      : pool_(pool),
+        num_children_(num_children),
+        counter_(counter),
+        num_tasks_(num_tasks),
+        unique_threads_lock_(unique_threads_lock),
+        unique_threads_(unique_threads),
+        done_(done) {}
+
+  virtual void Run() {
+    for (int i = 0; i < num_children_; i++) {
+      pool_->PostTask(new CountingTask(pool_, 0, counter_, num_tasks_,
+                                       unique_threads_lock_, unique_threads_,
+                                       done_));
+    }
+    {
+      base::AutoLock locked(*unique_threads_lock_);
+      unique_threads_->insert(PlatformThread::CurrentId());
+    }
+    if (counter_->GetNext() + 1 == num_tasks_)
+      done_->Signal();
+  }
+
+ private:
+  WorkStealingThreadPool* pool_;
+  int num_children_;
+  AtomicSequenceNumber* counter_;
+  int num_tasks_;
+  Lock* unique_threads_lock_;
+  std::set<PlatformThreadId>* unique_threads_;
+  WaitableEvent* done_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingTask);
+};
+
+class WorkStealingThreadPoolTest : public testing::Test {
+ protected:
+  static const int kNumWorkers = 4;
+
+  WorkStealingThreadPoolTest()
+      : pool_(new base::WorkStealingThreadPool("stealing_pool", kNumWorkers)),
+        done_(true, false) {}
+
+  virtual void TearDown() {
+    pool_->Terminate();
+  }
+
+  Task* CreateNewCountingTask(int num_children, int num_tasks) {
+    return new CountingTask(pool_.get(), num_children, &counter_, num_tasks,
+                            &unique_threads_lock_, &unique_threads_, &done_);
+  }
+
+  scoped_refptr<base::WorkStealingThreadPool> pool_;
+  AtomicSequenceNumber counter_;
+  Lock unique_threads_lock_;
+  std::set<PlatformThreadId> unique_threads_;
+  base::WaitableEvent done_;
+};
+
 }  // namespace
 
 TEST_F(PosixDynamicThreadPoolTest, Basic) {
@@ -265,4 +333,33 @@ TEST_F(PosixDynamicThreadPoolTest, Complex) {
   EXPECT_EQ(4, counter_);
 }
 
+TEST_F(WorkStealingThreadPoolTest, Basic) {
+  pool_->PostTask(CreateNewCountingTask(0, 1));
+  EXPECT_TRUE(done_.Wait());
+  EXPECT_EQ(1U, unique_threads_.size());
+}
+
+TEST_F(WorkStealingThreadPoolTest, ManyTasks) {
+  // All the tasks go through the shared queue.
+  const int kNumTasks = 10000;
+  for (int i = 0; i < kNumTasks; i++)
+    pool_->PostTask(CreateNewCountingTask(0, kNumTasks));
+
+  EXPECT_TRUE(done_.Wait());
+  EXPECT_LE(unique_threads_.size(), static_cast<size_t>(kNumWorkers));
+}
+
+TEST_F(WorkStealingThreadPoolTest, NestedTasks) {
+  // Every task posts more tasks from a worker thread, which go to the deque of
+  // that worker and overflow it.
+  const int kNumRoots = 10;
+  const int kNumChildren = 1000;
+  const int kNumTasks = kNumRoots * (kNumChildren + 1);
+  for (int i = 0; i < kNumRoots; i++)
+    pool_->PostTask(CreateNewCountingTask(kNumChildren, kNumTasks));
+
+  EXPECT_TRUE(done_.Wait());
+  EXPECT_LE(unique_threads_.size(), static_cast<size_t>(kNumWorkers));
+}
+
 }  // namespace base
@@ -1,4 +1,4 @@
-// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
@@ -10,8 +10,15 @@ namespace base {
 
 void BaseTimer_Helper::OrphanDelayedTask() {
   if (delayed_task_) {
+    TimerTask* task = delayed_task_;
     delayed_task_->timer_ = NULL;
     delayed_task_ = NULL;
+
+    // Once cancelled, the MessageLoop no longer owns the task.
+    if (task->wheel_entry_.IsScheduled()) {
+      task->wheel_entry_.Cancel();
+      delete task;
+    }
   }
 }
 
@@ -20,9 +27,18 @@ void BaseTimer_Helper::InitiateDelayedTask(TimerTask* timer_task) {
 
   delayed_task_ = timer_task;
   delayed_task_->timer_ = this;
-  MessageLoop::current()->PostDelayedTask(
-      FROM_HERE, timer_task,
-      static_cast<int>(timer_task->delay_.InMillisecondsRoundedUp()));
+  MessageLoop::current()->AddTimer(&timer_task->wheel_entry_,
+                                   TimeTicks::Now() + timer_task->delay_);
+}
+
+bool BaseTimer_Helper::RescheduleDelayedTask() {
+  DCHECK(delayed_task_);
+  if (!delayed_task_->wheel_entry_.IsScheduled())
+    return false;
+
+  MessageLoop::current()->AddTimer(&delayed_task_->wheel_entry_,
+                                   TimeTicks::Now() + delayed_task_->delay_);
+  return true;
 }
 
 }  // namespace base
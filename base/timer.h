@@ -48,9 +48,11 @@
 // should be able to tell the difference.
 
 #include "base/base_api.h"
+#include "base/compiler_specific.h"
 #include "base/logging.h"
 #include "base/task.h"
 #include "base/time.h"
+#include "base/timer_wheel.h"
 
 class MessageLoop;
 
@@ -87,20 +89,30 @@ class BASE_API BaseTimer_Helper {
   // We have access to the timer_ member so we can orphan this task.
   class TimerTask : public Task {
    public:
-    explicit TimerTask(TimeDelta delay) : timer_(NULL), delay_(delay) {
+    explicit TimerTask(TimeDelta delay)
+        : timer_(NULL),
+          delay_(delay),
+          ALLOW_THIS_IN_INITIALIZER_LIST(wheel_entry_(this)) {
     }
     virtual ~TimerTask() {}
     BaseTimer_Helper* timer_;
     TimeDelta delay_;
+    // Scheduled in the timer wheel of the MessageLoop until the task runs.
+    TimerWheel::Entry wheel_entry_;
   };
 
-  // Used to orphan delayed_task_ so that when it runs it does nothing.
+  // Used to orphan delayed_task_ so that it does not run.  If it has not been
+  // run yet, it is cancelled and deleted.
   void OrphanDelayedTask();
 
   // Used to initiated a new delayed task.  This has the side-effect of
   // orphaning delayed_task_ if it is non-null.
   void InitiateDelayedTask(TimerTask* timer_task);
 
+  // Moves delayed_task_ to run |delay_| from now, and returns true.  Returns
+  // false if delayed_task_ is running, since it cannot be scheduled again.
+  bool RescheduleDelayedTask();
+
   TimerTask* delayed_task_;
 
   DISALLOW_COPY_AND_ASSIGN(BaseTimer_Helper);
@@ -130,7 +142,8 @@ class BaseTimer : public BaseTimer_Helper {
   // Call this method to reset the timer delay of an already running timer.
   void Reset() {
     DCHECK(IsRunning());
-    InitiateDelayedTask(static_cast<TimerTask*>(delayed_task_)->Clone());
+    if (!RescheduleDelayedTask())
+      InitiateDelayedTask(static_cast<TimerTask*>(delayed_task_)->Clone());
   }
 
  private:
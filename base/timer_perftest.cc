@@ -0,0 +1,100 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer.h"
+
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/task.h"
+#include "base/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const int kNumTimers = 100000;
+const int kNumRounds = 10;
+
+// Does nothing when it fires; the timers under test are not meant to.
+class Receiver {
+ public:
+  Receiver() {}
+  void OnTimer() { NOTREACHED(); }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Receiver);
+};
+
+typedef base::OneShotTimer<Receiver> Timer;
+
+// Starts |kNumTimers| timers with delays spread over |max_delay_ms|, then
+// resets all of them |kNumRounds| times, as idle timeouts do on a busy
+// network thread.
+void ResetTimers(int max_delay_ms) {
+  Receiver receiver;
+  scoped_array<Timer> timers(new Timer[kNumTimers]);
+
+  // Include the time it takes the loop to get rid of cancelled tasks.
+  PerfTimer timer;
+  scoped_ptr<MessageLoop> loop(new MessageLoop);
+  for (int i = 0; i < kNumTimers; i++) {
+    timers[i].Start(base::TimeDelta::FromMilliseconds(
+                        1000 + (i * 7919) % max_delay_ms),
+                    &receiver, &Receiver::OnTimer);
+  }
+  for (int round = 0; round < kNumRounds; round++) {
+    for (int i = 0; i < kNumTimers; i++)
+      timers[i].Reset();
+  }
+  for (int i = 0; i < kNumTimers; i++)
+    timers[i].Stop();
+  loop.reset();
+  base::TimeDelta elapsed = timer.Elapsed();
+
+  std::string test_name = base::StringPrintf("Timer_reset_%d_ms",
+                                             max_delay_ms);
+  LogPerfResult(test_name.c_str(),
+                kNumTimers * (kNumRounds + 2) / elapsed.InSecondsF(), "ops/s");
+}
+
+// Starts and stops timers, as timeouts that almost never fire do.
+void StartStopTimers(int max_delay_ms) {
+  Receiver receiver;
+  scoped_array<Timer> timers(new Timer[kNumTimers]);
+
+  // Include the time it takes the loop to get rid of cancelled tasks.
+  PerfTimer timer;
+  scoped_ptr<MessageLoop> loop(new MessageLoop);
+  for (int round = 0; round < kNumRounds; round++) {
+    for (int i = 0; i < kNumTimers; i++) {
+      timers[i].Start(base::TimeDelta::FromMilliseconds(
+                          1000 + (i * 7919) % max_delay_ms),
+                      &receiver, &Receiver::OnTimer);
+    }
+    for (int i = 0; i < kNumTimers; i++)
+      timers[i].Stop();
+  }
+  loop.reset();
+  base::TimeDelta elapsed = timer.Elapsed();
+
+  std::string test_name = base::StringPrintf("Timer_start_stop_%d_ms",
+                                             max_delay_ms);
+  LogPerfResult(test_name.c_str(),
+                kNumTimers * kNumRounds * 2 / elapsed.InSecondsF(), "ops/s");
+}
+
+}  // namespace
+
+TEST(TimerPerfTest, Reset) {
+  ResetTimers(1000);
+  ResetTimers(60 * 1000);
+  ResetTimers(3600 * 1000);
+}
+
+TEST(TimerPerfTest, StartStop) {
+  StartStopTimers(1000);
+  StartStopTimers(60 * 1000);
+  StartStopTimers(3600 * 1000);
+}
@@ -0,0 +1,262 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer_wheel.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace {
+
+const int64 kMicrosecondsPerTick = base::Time::kMicrosecondsPerMillisecond;
+
+// Run times are rounded up, so that timers never expire early.
+int64 RunTimeToTick(base::TimeTicks run_time) {
+  return (run_time.ToInternalValue() + kMicrosecondsPerTick - 1) /
+         kMicrosecondsPerTick;
+}
+
+int64 NowToTick(base::TimeTicks now) {
+  return now.ToInternalValue() / kMicrosecondsPerTick;
+}
+
+base::TimeTicks TickToTime(int64 tick) {
+  return base::TimeTicks() + base::TimeDelta::FromMilliseconds(tick);
+}
+
+}  // namespace
+
+namespace base {
+
+TimerWheel::Entry::Entry(Task* task)
+    : task_(task),
+      wheel_(NULL),
+      prev_(NULL),
+      next_(NULL),
+      tick_(0),
+      level_(0),
+      slot_(0) {
+}
+
+TimerWheel::Entry::~Entry() {
+  Cancel();
+}
+
+void TimerWheel::Entry::Cancel() {
+  if (wheel_)
+    wheel_->Remove(this);
+}
+
+TimerWheel::TimerWheel()
+    : current_tick_(NowToTick(TimeTicks::Now())),
+      size_(0) {
+  memset(slots_, 0, sizeof(slots_));
+  memset(occupied_, 0, sizeof(occupied_));
+}
+
+TimerWheel::~TimerWheel() {
+  // Leave the entries in a consistent state.
+  while (PopAny()) {}
+}
+
+void TimerWheel::Add(Entry* entry, TimeTicks run_time) {
+  if (entry->wheel_)
+    entry->wheel_->Remove(entry);
+
+  // Don't make the next call to PopExpired() go over all the time that the
+  // wheel was idle.
+  if (!size_)
+    current_tick_ = std::max(current_tick_, NowToTick(TimeTicks::Now()));
+
+  entry->tick_ = RunTimeToTick(run_time);
+  entry->wheel_ = this;
+  Link(entry);
+  size_++;
+}
+
+void TimerWheel::Remove(Entry* entry) {
+  DCHECK_EQ(this, entry->wheel_);
+  Unlink(entry);
+  entry->wheel_ = NULL;
+  size_--;
+}
+
+TimerWheel::Entry* TimerWheel::PopExpired(TimeTicks now) {
+  int64 now_tick = NowToTick(now);
+  if (!size_) {
+    current_tick_ = std::max(current_tick_, now_tick);
+    return NULL;
+  }
+
+  Advance(now_tick);
+  if (current_tick_ > now_tick)
+    return NULL;
+
+  Entry* entry = slots_[0][current_tick_ & (kNumSlots - 1)].head;
+  if (!entry)
+    return NULL;
+
+  DCHECK_LE(entry->tick_, current_tick_);
+  Remove(entry);
+  return entry;
+}
+
+TimerWheel::Entry* TimerWheel::PopAny() {
+  for (int level = 0; level < kNumLevels; level++) {
+    int slot = NextOccupiedSlot(level, 0);
+    if (slot == kNumSlots)
+      continue;
+
+    Entry* entry = slots_[level][slot].head;
+    Remove(entry);
+    return entry;
+  }
+  DCHECK(!size_);
+  return NULL;
+}
+
+TimeTicks TimerWheel::NextRunTime() const {
+  if (!size_)
+    return TimeTicks();
+
+  int64 next_tick = kint64max;
+  for (int level = 0; level < kNumLevels; level++) {
+    if (!occupied_[level])
+      continue;
+
+    int shift = kBitsPerLevel * level;
+    int64 position = current_tick_ >> shift;
+    int slot = static_cast<int>(position & (kNumSlots - 1));
+
+    // The current slot of level 0 holds the entries that are due now. The
+    // current slot of any other level has already been cascaded, so anything
+    // in it is due in the next round.
+    int next_slot = NextOccupiedSlot(level, level ? slot + 1 : slot);
+    if (next_slot == kNumSlots)
+      next_slot = kNumSlots + NextOccupiedSlot(level, 0);
+
+    // The entries of a higher level are due no sooner than the start of
+    // their slot.
+    int64 tick = (position + next_slot - slot) << shift;
+    next_tick = std::min(next_tick, std::max(tick, current_tick_));
+  }
+  return TickToTime(next_tick);
+}
+
+void TimerWheel::Link(Entry* entry) {
+  int64 tick = entry->tick_;
+  int64 delta = tick - current_tick_;
+  int level = 0;
+  if (delta < 0) {
+    // This entry is already due.
+    tick = current_tick_;
+  } else {
+    while (level < kNumLevels - 1 &&
+           delta >= (GG_INT64_C(1) << (kBitsPerLevel * (level + 1)))) {
+      level++;
+    }
+
+    // Entries beyond the range of the wheel wait at the end of the last level.
+    const int64 kMaxDelta = (GG_INT64_C(1) << (kBitsPerLevel * kNumLevels)) - 1;
+    if (delta > kMaxDelta)
+      tick = current_tick_ + kMaxDelta;
+  }
+
+  int slot = static_cast<int>((tick >> (kBitsPerLevel * level)) &
+                              (kNumSlots - 1));
+  entry->level_ = level;
+  entry->slot_ = slot;
+
+  Slot& list = slots_[level][slot];
+  entry->prev_ = list.tail;
+  entry->next_ = NULL;
+  if (list.tail)
+    list.tail->next_ = entry;
+  else
+    list.head = entry;
+  list.tail = entry;
+  occupied_[level] |= GG_UINT64_C(1) << slot;
+}
+
+void TimerWheel::Unlink(Entry* entry) {
+  Slot& list = slots_[entry->level_][entry->slot_];
+  if (entry->prev_)
+    entry->prev_->next_ = entry->next_;
+  else
+    list.head = entry->next_;
+
+  if (entry->next_)
+    entry->next_->prev_ = entry->prev_;
+  else
+    list.tail = entry->prev_;
+
+  if (!list.head)
+    occupied_[entry->level_] &= ~(GG_UINT64_C(1) << entry->slot_);
+  entry->prev_ = NULL;
+  entry->next_ = NULL;
+}
+
+void TimerWheel::Cascade(int level) {
+  int slot = static_cast<int>((current_tick_ >> (kBitsPerLevel * level)) &
+                              (kNumSlots - 1));
+  Slot& list = slots_[level][slot];
+  Entry* entry = list.head;
+  list.head = NULL;
+  list.tail = NULL;
+  occupied_[level] &= ~(GG_UINT64_C(1) << slot);
+
+  while (entry) {
+    Entry* next = entry->next_;
+    Link(entry);
+    entry = next;
+  }
+}
+
+void TimerWheel::Advance(int64 now_tick) {
+  while (current_tick_ < now_tick) {
+    int slot = static_cast<int>(current_tick_ & (kNumSlots - 1));
+    if (occupied_[0] & (GG_UINT64_C(1) << slot))
+      return;
+
+    // Skip the empty slots, stopping at the end of level 0.
+    int next_slot = NextOccupiedSlot(0, slot + 1);
+    int64 next_tick = current_tick_ + next_slot - slot;
+    if (next_tick > now_tick) {
+      current_tick_ = now_tick;
+      return;
+    }
+
+    current_tick_ = next_tick;
+    if (next_slot < kNumSlots)
+      continue;
+
+    // Level 0 wrapped around, so move down the entries of the next slot of
+    // each level that wrapped.
+    for (int level = 1; level < kNumLevels; level++) {
+      Cascade(level);
+      if ((current_tick_ >> (kBitsPerLevel * level)) & (kNumSlots - 1))
+        break;
+    }
+  }
+}
+
+int TimerWheel::NextOccupiedSlot(int level, int slot) const {
+  if (slot >= kNumSlots)
+    return kNumSlots;
+
+  uint64 bits = occupied_[level] >> slot;
+  if (!bits)
+    return kNumSlots;
+
+  while (!(bits & 1)) {
+    bits >>= 1;
+    slot++;
+  }
+  return slot;
+}
+
+}  // namespace base
@@ -0,0 +1,127 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// TimerWheel keeps track of a large number of timers, with constant time
+// insertion and cancellation.  It is a hierarchical timing wheel: the timers
+// due within the next 64 ms are stored in one list per millisecond, those due
+// within 4 s in one list per 64 ms, and so on for four levels.  As time goes
+// by, the timers of a higher level are moved down to the level below.  Timers
+// due in more than 4.6 hours are kept in the last level until they get closer.
+//
+// The resolution of the wheel is one millisecond, and timers never expire
+// early.  Timers that expire in the same millisecond may be returned in any
+// order.
+//
+// This class is not thread safe.  MessageLoop uses it to run the tasks of
+// base::Timer; most code should not need to use it directly.
+
+#ifndef BASE_TIMER_WHEEL_H_
+#define BASE_TIMER_WHEEL_H_
+#pragma once
+
+#include "base/base_api.h"
+#include "base/basictypes.h"
+#include "base/time.h"
+
+class Task;
+
+namespace base {
+
+class BASE_API TimerWheel {
+ public:
+  // An entry of the wheel.  It is meant to be embedded in the object that
+  // represents the timer.
+  class BASE_API Entry {
+   public:
+    explicit Entry(Task* task);
+    ~Entry();
+
+    // The task to run when the timer expires.  The wheel does not own it.
+    Task* task() const { return task_; }
+
+    // Returns true if this entry is in a wheel.
+    bool IsScheduled() const { return wheel_ != NULL; }
+
+    // Removes this entry from its wheel.  It is a no-op if the entry is not
+    // scheduled.
+    void Cancel();
+
+   private:
+    friend class TimerWheel;
+
+    Task* task_;
+    TimerWheel* wheel_;
+    Entry* prev_;
+    Entry* next_;
+    int64 tick_;  // The millisecond at which we expire.
+    int level_;
+    int slot_;
+
+    DISALLOW_COPY_AND_ASSIGN(Entry);
+  };
+
+  TimerWheel();
+  ~TimerWheel();
+
+  // Adds |entry| to expire at |run_time|.  If |entry| is already scheduled,
+  // it is moved to the new time.
+  void Add(Entry* entry, TimeTicks run_time);
+
+  // Removes |entry| from the wheel.
+  void Remove(Entry* entry);
+
+  // Removes and returns an entry that has expired at |now|, or NULL if there
+  // is none.  |now| should not go back in time between calls.
+  Entry* PopExpired(TimeTicks now);
+
+  // Removes and returns any entry, or NULL if the wheel is empty.
+  Entry* PopAny();
+
+  // Returns a time at or before the expiration of the next entry, or a null
+  // TimeTicks if the wheel is empty.  The result is exact unless the next
+  // entry is more than 64 ms away.
+  TimeTicks NextRunTime() const;
+
+  bool empty() const { return size_ == 0; }
+  int size() const { return size_; }
+
+ private:
+  enum {
+    kBitsPerLevel = 6,
+    kNumSlots = 1 << kBitsPerLevel,
+    kNumLevels = 4
+  };
+
+  struct Slot {
+    Entry* head;
+    Entry* tail;
+  };
+
+  // Links |entry| in the right slot for its tick.
+  void Link(Entry* entry);
+  void Unlink(Entry* entry);
+
+  // Moves the entries of the current slot of |level| to lower levels.
+  void Cascade(int level);
+
+  // Moves |current_tick_| to the next occupied tick, up to |now_tick|.
+  void Advance(int64 now_tick);
+
+  // Returns the first occupied slot of |level| at or after |slot|, looking
+  // no further than the last slot of the level, or kNumSlots if there is none.
+  int NextOccupiedSlot(int level, int slot) const;
+
+  Slot slots_[kNumLevels][kNumSlots];
+  uint64 occupied_[kNumLevels];  // A bit per non-empty slot.
+
+  // Every tick before this one has been processed.
+  int64 current_tick_;
+  int size_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace base
+
+#endif  // BASE_TIMER_WHEEL_H_
@@ -0,0 +1,196 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer_wheel.h"
+
+#include <vector>
+
+#include "base/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+TimeDelta Ms(int64 ms) {
+  return TimeDelta::FromMilliseconds(ms);
+}
+
+// Pops all the entries that expire at |now| into |entries|, and returns how
+// many there were.
+int PopAll(TimerWheel* wheel, TimeTicks now,
+           std::vector<TimerWheel::Entry*>* entries) {
+  int count = 0;
+  while (TimerWheel::Entry* entry = wheel->PopExpired(now)) {
+    entries->push_back(entry);
+    count++;
+  }
+  return count;
+}
+
+class TimerWheelTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    // Start from a millisecond boundary, to make the rounding predictable.
+    start_ = TimeTicks() + Ms((TimeTicks::Now() - TimeTicks()).InMilliseconds());
+  }
+
+  TimeTicks start_;
+};
+
+}  // namespace
+
+TEST_F(TimerWheelTest, Empty) {
+  TimerWheel wheel;
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_TRUE(wheel.NextRunTime().is_null());
+  EXPECT_TRUE(wheel.PopExpired(start_ + Ms(1000)) == NULL);
+  EXPECT_TRUE(wheel.PopAny() == NULL);
+}
+
+TEST_F(TimerWheelTest, Order) {
+  TimerWheel wheel;
+  TimerWheel::Entry a(NULL), b(NULL), c(NULL);
+  wheel.Add(&c, start_ + Ms(30));
+  wheel.Add(&a, start_ + Ms(10));
+  wheel.Add(&b, start_ + Ms(20));
+  EXPECT_EQ(3, wheel.size());
+  EXPECT_EQ(start_ + Ms(10), wheel.NextRunTime());
+
+  EXPECT_TRUE(wheel.PopExpired(start_ + Ms(9)) == NULL);
+  EXPECT_EQ(&a, wheel.PopExpired(start_ + Ms(10)));
+  EXPECT_FALSE(a.IsScheduled());
+  EXPECT_EQ(start_ + Ms(20), wheel.NextRunTime());
+
+  // Both remaining entries are due.
+  EXPECT_EQ(&b, wheel.PopExpired(start_ + Ms(100)));
+  EXPECT_EQ(&c, wheel.PopExpired(start_ + Ms(100)));
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST_F(TimerWheelTest, NeverEarly) {
+  TimerWheel wheel;
+  TimerWheel::Entry a(NULL);
+  wheel.Add(&a, start_ + TimeDelta::FromMicroseconds(5500));
+  EXPECT_EQ(start_ + Ms(6), wheel.NextRunTime());
+  EXPECT_TRUE(wheel.PopExpired(start_ + TimeDelta::FromMicroseconds(5999)) ==
+              NULL);
+  EXPECT_EQ(&a, wheel.PopExpired(start_ + Ms(6)));
+}
+
+TEST_F(TimerWheelTest, Cancel) {
+  TimerWheel wheel;
+  TimerWheel::Entry a(NULL), b(NULL);
+  wheel.Add(&a, start_ + Ms(10));
+  wheel.Add(&b, start_ + Ms(10));
+  a.Cancel();
+  EXPECT_FALSE(a.IsScheduled());
+  EXPECT_EQ(1, wheel.size());
+  a.Cancel();  // Cancelling twice is harmless.
+
+  EXPECT_EQ(&b, wheel.PopExpired(start_ + Ms(10)));
+  EXPECT_TRUE(wheel.PopExpired(start_ + Ms(10)) == NULL);
+
+  {
+    TimerWheel::Entry c(NULL);
+    wheel.Add(&c, start_ + Ms(20));
+  }
+  // Destroying an entry cancels it.
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST_F(TimerWheelTest, Move) {
+  TimerWheel wheel;
+  TimerWheel::Entry a(NULL), b(NULL);
+  wheel.Add(&a, start_ + Ms(10));
+  wheel.Add(&b, start_ + Ms(20));
+  wheel.Add(&a, start_ + Ms(5000));
+  EXPECT_EQ(2, wheel.size());
+  EXPECT_EQ(start_ + Ms(20), wheel.NextRunTime());
+  EXPECT_EQ(&b, wheel.PopExpired(start_ + Ms(4999)));
+  EXPECT_TRUE(wheel.PopExpired(start_ + Ms(4999)) == NULL);
+  EXPECT_EQ(&a, wheel.PopExpired(start_ + Ms(5000)));
+}
+
+TEST_F(TimerWheelTest, PastDue) {
+  TimerWheel wheel;
+  TimerWheel::Entry a(NULL), b(NULL);
+  wheel.Add(&a, start_ + Ms(10));
+  EXPECT_TRUE(wheel.PopExpired(start_ + Ms(5)) == NULL);
+  wheel.Add(&b, start_ - Ms(1000));
+  EXPECT_EQ(start_ + Ms(5), wheel.NextRunTime());
+  EXPECT_EQ(&b, wheel.PopExpired(start_ + Ms(5)));
+  EXPECT_EQ(&a, wheel.PopExpired(start_ + Ms(10)));
+}
+
+// Entries of the higher levels are moved down as their time comes, and are
+// returned in order.
+TEST_F(TimerWheelTest, Cascade) {
+  const int64 kDelays[] = {
+    1, 63, 64, 65, 100, 4095, 4096, 4097, 100000, 262143, 262144, 262145,
+    5000000, 16777215, 16777216, 30000000,
+  };
+  const size_t kNumDelays = arraysize(kDelays);
+
+  TimerWheel wheel;
+  std::vector<TimerWheel::Entry*> entries;
+  for (size_t i = 0; i < kNumDelays; i++) {
+    entries.push_back(new TimerWheel::Entry(NULL));
+    wheel.Add(entries.back(), start_ + Ms(kDelays[i]));
+  }
+
+  for (size_t i = 0; i < kNumDelays; i++) {
+    // The next run time is a lower bound, so it never skips an entry.
+    TimeTicks next_run_time = wheel.NextRunTime();
+    ASSERT_LE(next_run_time, start_ + Ms(kDelays[i]));
+
+    // Jump from one run time to the next, as MessageLoop does.
+    std::vector<TimerWheel::Entry*> popped;
+    while (popped.empty()) {
+      PopAll(&wheel, wheel.NextRunTime(), &popped);
+    }
+    ASSERT_EQ(1u, popped.size()) << i;
+    EXPECT_EQ(entries[i], popped[0]) << i;
+  }
+  EXPECT_TRUE(wheel.empty());
+
+  for (size_t i = 0; i < kNumDelays; i++)
+    delete entries[i];
+}
+
+// An entry further away than the range of the wheel still expires on time.
+TEST_F(TimerWheelTest, BeyondRange) {
+  const TimeDelta kDelay = TimeDelta::FromHours(10);
+  TimerWheel wheel;
+  TimerWheel::Entry a(NULL);
+  wheel.Add(&a, start_ + kDelay);
+
+  std::vector<TimerWheel::Entry*> popped;
+  TimeTicks now = start_;
+  while (popped.empty()) {
+    ASSERT_LT(now, start_ + kDelay + Ms(1));
+    now = wheel.NextRunTime();
+    PopAll(&wheel, now, &popped);
+  }
+  EXPECT_EQ(&a, popped[0]);
+  EXPECT_EQ(start_ + kDelay, now);
+}
+
+TEST_F(TimerWheelTest, PopAny) {
+  TimerWheel wheel;
+  TimerWheel::Entry a(NULL), b(NULL), c(NULL);
+  wheel.Add(&a, start_ + Ms(1));
+  wheel.Add(&b, start_ + Ms(1000));
+  wheel.Add(&c, start_ + Ms(1000000));
+
+  int count = 0;
+  while (TimerWheel::Entry* entry = wheel.PopAny()) {
+    EXPECT_FALSE(entry->IsScheduled());
+    count++;
+  }
+  EXPECT_EQ(3, count);
+  EXPECT_TRUE(wheel.empty());
+}
+
+}  // namespace base
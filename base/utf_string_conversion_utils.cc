@@ -5,9 +5,191 @@
 #include "base/utf_string_conversion_utils.h"
 
 #include "base/third_party/icu/icu_utf.h"
+#include "build/build_config.h"
+
+// GCC only accepts SSE2 intrinsics when the target has SSE2, in which case no
+// runtime check is needed.  32-bit MSVC builds do not assume SSE2, and check
+// the CPU before using it.
+#if defined(ARCH_CPU_X86_FAMILY) && (defined(__SSE2__) || defined(_MSC_VER))
+#define USE_SSE2_ASCII_RUNS
+#include <emmintrin.h>
+#if defined(ARCH_CPU_X86) && !defined(__SSE2__)
+#include "base/cpu.h"
+#endif
+#endif
 
 namespace base {
 
+namespace {
+
+// Returns true if |c| is ASCII, whether CHAR is signed or not.
+template<typename CHAR>
+inline bool IsASCIIUnit(CHAR c) {
+  return (c & ~0x7F) == 0;
+}
+
+template<typename CHAR>
+size_t CountLeadingASCIIT(const CHAR* src, size_t src_len, size_t i) {
+  while (i < src_len && IsASCIIUnit(src[i]))
+    i++;
+  return i;
+}
+
+// Appends |count| ASCII characters to |output|, one at a time.
+template<typename SRC_CHAR, typename STRING>
+void AppendASCIIRunT(const SRC_CHAR* src, size_t count, STRING* output) {
+  size_t offset = output->length();
+  output->resize(offset + count);
+  typename STRING::value_type* dest = &(*output)[offset];
+  for (size_t i = 0; i < count; i++)
+    dest[i] = static_cast<typename STRING::value_type>(src[i]);
+}
+
+#if defined(USE_SSE2_ASCII_RUNS)
+
+bool CanUseSSE2() {
+#if defined(__SSE2__) || defined(ARCH_CPU_X86_64)
+  return true;
+#else
+  // The answer never changes, so threads racing to fill it in all store the
+  // same value.
+  static int has_sse2 = -1;
+  if (has_sse2 < 0)
+    has_sse2 = CPU().has_sse2() ? 1 : 0;
+  return has_sse2 == 1;
+#endif
+}
+
+inline __m128i Load(const void* src) {
+  return _mm_loadu_si128(static_cast<const __m128i*>(src));
+}
+
+inline void Store(void* dest, __m128i value) {
+  _mm_storeu_si128(static_cast<__m128i*>(dest), value);
+}
+
+// Each of these returns the length of the ASCII prefix of |src|, in whole
+// blocks of 16 characters; the caller checks the rest one by one.
+size_t CountLeadingASCIISSE2(const char* src, size_t src_len) {
+  size_t i = 0;
+  for (; i + 16 <= src_len; i += 16) {
+    if (_mm_movemask_epi8(Load(src + i)))
+      break;
+  }
+  return i;
+}
+
+size_t CountLeadingASCIISSE2(const char16* src, size_t src_len) {
+  const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= src_len; i += 16) {
+    __m128i bits = _mm_and_si128(
+        _mm_or_si128(Load(src + i), Load(src + i + 8)), non_ascii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(bits, zero)) != 0xFFFF)
+      break;
+  }
+  return i;
+}
+
+#if defined(WCHAR_T_IS_UTF32)
+size_t CountLeadingASCIISSE2(const wchar_t* src, size_t src_len) {
+  const __m128i non_ascii = _mm_set1_epi32(~0x7F);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= src_len; i += 16) {
+    __m128i bits = _mm_or_si128(
+        _mm_or_si128(Load(src + i), Load(src + i + 4)),
+        _mm_or_si128(Load(src + i + 8), Load(src + i + 12)));
+    bits = _mm_and_si128(bits, non_ascii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(bits, zero)) != 0xFFFF)
+      break;
+  }
+  return i;
+}
+#endif  // defined(WCHAR_T_IS_UTF32)
+
+// Each of these converts the whole blocks of 16 characters at the start of
+// |src| to |dest|, and returns the number of characters converted.  Since the
+// characters are ASCII, widening is zero-extension and narrowing cannot
+// saturate.
+size_t ConvertASCIISSE2(const char* src, size_t count, char16* dest) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i chars = Load(src + i);
+    Store(dest + i, _mm_unpacklo_epi8(chars, zero));
+    Store(dest + i + 8, _mm_unpackhi_epi8(chars, zero));
+  }
+  return i;
+}
+
+size_t ConvertASCIISSE2(const char16* src, size_t count, char* dest) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+    Store(dest + i, _mm_packus_epi16(Load(src + i), Load(src + i + 8)));
+  return i;
+}
+
+#if defined(WCHAR_T_IS_UTF32)
+size_t ConvertASCIISSE2(const char* src, size_t count, wchar_t* dest) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i chars = Load(src + i);
+    __m128i low = _mm_unpacklo_epi8(chars, zero);
+    __m128i high = _mm_unpackhi_epi8(chars, zero);
+    Store(dest + i, _mm_unpacklo_epi16(low, zero));
+    Store(dest + i + 4, _mm_unpackhi_epi16(low, zero));
+    Store(dest + i + 8, _mm_unpacklo_epi16(high, zero));
+    Store(dest + i + 12, _mm_unpackhi_epi16(high, zero));
+  }
+  return i;
+}
+
+size_t ConvertASCIISSE2(const wchar_t* src, size_t count, char* dest) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i low = _mm_packs_epi32(Load(src + i), Load(src + i + 4));
+    __m128i high = _mm_packs_epi32(Load(src + i + 8), Load(src + i + 12));
+    Store(dest + i, _mm_packus_epi16(low, high));
+  }
+  return i;
+}
+#endif  // defined(WCHAR_T_IS_UTF32)
+
+#endif  // defined(USE_SSE2_ASCII_RUNS)
+
+// Converts |count| ASCII characters and appends them to |output|, using the
+// SSE2 converter for the bulk of the run when the CPU supports it.
+template<typename SRC_CHAR, typename STRING>
+void AppendASCIIRunSIMD(const SRC_CHAR* src, size_t count, STRING* output) {
+#if defined(USE_SSE2_ASCII_RUNS)
+  if (count >= 16 && CanUseSSE2()) {
+    size_t offset = output->length();
+    output->resize(offset + count);
+    typename STRING::value_type* dest = &(*output)[offset];
+    size_t done = ConvertASCIISSE2(src, count, dest);
+    for (size_t i = done; i < count; i++)
+      dest[i] = static_cast<typename STRING::value_type>(src[i]);
+    return;
+  }
+#endif
+  AppendASCIIRunT(src, count, output);
+}
+
+template<typename CHAR>
+size_t CountLeadingASCIISIMD(const CHAR* src, size_t src_len) {
+  size_t i = 0;
+#if defined(USE_SSE2_ASCII_RUNS)
+  if (src_len >= 16 && CanUseSSE2())
+    i = CountLeadingASCIISSE2(src, src_len);
+#endif
+  return CountLeadingASCIIT(src, src_len, i);
+}
+
+}  // namespace
+
 // ReadUnicodeCharacter --------------------------------------------------------
 
 bool ReadUnicodeCharacter(const char* src,
@@ -102,6 +284,50 @@ size_t WriteUnicodeCharacter(uint32 code_point, string16* output) {
   return CBU16_MAX_LENGTH;
 }
 
+// ASCII runs ------------------------------------------------------------------
+
+size_t CountLeadingASCII(const char* src, size_t src_len) {
+  return CountLeadingASCIISIMD(src, src_len);
+}
+
+size_t CountLeadingASCII(const char16* src, size_t src_len) {
+  return CountLeadingASCIISIMD(src, src_len);
+}
+
+#if defined(WCHAR_T_IS_UTF32)
+size_t CountLeadingASCII(const wchar_t* src, size_t src_len) {
+  return CountLeadingASCIISIMD(src, src_len);
+}
+#endif  // defined(WCHAR_T_IS_UTF32)
+
+void AppendASCIIRun(const char* src, size_t count, string16* output) {
+  AppendASCIIRunSIMD(src, count, output);
+}
+
+void AppendASCIIRun(const char16* src, size_t count, std::string* output) {
+  AppendASCIIRunSIMD(src, count, output);
+}
+
+#if defined(WCHAR_T_IS_UTF32)
+void AppendASCIIRun(const char* src, size_t count, std::wstring* output) {
+  AppendASCIIRunSIMD(src, count, output);
+}
+
+void AppendASCIIRun(const wchar_t* src, size_t count, std::string* output) {
+  AppendASCIIRunSIMD(src, count, output);
+}
+
+// Between UTF-16 and UTF-32 every character is copied as is, so there is
+// little to gain from SIMD.
+void AppendASCIIRun(const char16* src, size_t count, std::wstring* output) {
+  AppendASCIIRunT(src, count, output);
+}
+
+void AppendASCIIRun(const wchar_t* src, size_t count, string16* output) {
+  AppendASCIIRunT(src, count, output);
+}
+#endif  // defined(WCHAR_T_IS_UTF32)
+
 // Generalized Unicode converter -----------------------------------------------
 
 template<typename CHAR>
@@ -76,6 +76,30 @@ inline size_t WriteUnicodeCharacter(uint32 code_point, std::wstring* output) {
 }
 #endif  // defined(WCHAR_T_IS_UTF32)
 
+// ASCII runs ------------------------------------------------------------------
+
+// Returns the number of characters at the start of |src| that are ASCII.
+// Most of the text we convert (URLs, headers, history rows) is mostly ASCII,
+// so the converters copy runs of it in bulk instead of decoding it one
+// character at a time.  Where the CPU has SSE2, 16 bytes are checked at once.
+size_t CountLeadingASCII(const char* src, size_t src_len);
+size_t CountLeadingASCII(const char16* src, size_t src_len);
+#if defined(WCHAR_T_IS_UTF32)
+size_t CountLeadingASCII(const wchar_t* src, size_t src_len);
+#endif  // defined(WCHAR_T_IS_UTF32)
+
+// Appends the |count| characters at |src|, which must all be ASCII (see
+// CountLeadingASCII()), to |output|, widening or narrowing each of them to the
+// character type of |output|.
+void AppendASCIIRun(const char* src, size_t count, string16* output);
+void AppendASCIIRun(const char16* src, size_t count, std::string* output);
+#if defined(WCHAR_T_IS_UTF32)
+void AppendASCIIRun(const char* src, size_t count, std::wstring* output);
+void AppendASCIIRun(const wchar_t* src, size_t count, std::string* output);
+void AppendASCIIRun(const char16* src, size_t count, std::wstring* output);
+void AppendASCIIRun(const wchar_t* src, size_t count, string16* output);
+#endif  // defined(WCHAR_T_IS_UTF32)
+
 // Generalized Unicode converter -----------------------------------------------
 
 // Guesses the length of the output in UTF-8 in bytes, clears that output
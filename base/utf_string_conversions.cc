@@ -8,6 +8,8 @@
 #include "base/string_util.h"
 #include "base/utf_string_conversion_utils.h"
 
+using base::AppendASCIIRun;
+using base::CountLeadingASCII;
 using base::PrepareForUTF8Output;
 using base::PrepareForUTF16Or32Output;
 using base::ReadUnicodeCharacter;
@@ -29,6 +31,18 @@ bool ConvertUnicode(const SRC_CHAR* src,
   bool success = true;
   int32 src_len32 = static_cast<int32>(src_len);
   for (int32 i = 0; i < src_len32; i++) {
+    // Copy runs of ASCII in bulk: most of the text we convert is ASCII.  A
+    // lone ASCII character, like a space between words, is cheaper to convert
+    // on its own.
+    if ((src[i] & ~0x7F) == 0 && i + 1 < src_len32 &&
+        (src[i + 1] & ~0x7F) == 0) {
+      size_t ascii_len = CountLeadingASCII(src + i, src_len32 - i);
+      AppendASCIIRun(src + i, ascii_len, output);
+      i += static_cast<int32>(ascii_len);
+      if (i == src_len32)
+        break;
+    }
+
     uint32 code_point;
     if (ReadUnicodeCharacter(src, src_len32, &i, &code_point)) {
       WriteUnicodeCharacter(code_point, output);
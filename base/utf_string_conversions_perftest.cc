@@ -0,0 +1,76 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/utf_string_conversions.h"
+
+#include "base/perftimer.h"
+#include "base/string_util.h"
+#include "base/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const size_t kTextSize = 1 << 20;
+const int kNumRounds = 100;
+
+// Returns about |kTextSize| bytes of UTF-8 made of |piece| repeated.
+std::string MakeText(const char* piece) {
+  std::string text;
+  while (text.length() < kTextSize)
+    text.append(piece);
+  return text;
+}
+
+// Converts |utf8| to UTF-16 and back, and validates it, |kNumRounds| times
+// each, and logs the throughput of each under |name|.
+void ConvertText(const char* name, const std::string& utf8) {
+  double megabytes = kNumRounds * utf8.length() / (1024.0 * 1024.0);
+  string16 utf16;
+  {
+    PerfTimer timer;
+    for (int i = 0; i < kNumRounds; i++)
+      UTF8ToUTF16(utf8.data(), utf8.length(), &utf16);
+    LogPerfResult(base::StringPrintf("UTF8ToUTF16_%s", name).c_str(),
+                  megabytes / timer.Elapsed().InSecondsF(), "MB/s");
+  }
+  {
+    std::string back;
+    PerfTimer timer;
+    for (int i = 0; i < kNumRounds; i++)
+      UTF16ToUTF8(utf16.data(), utf16.length(), &back);
+    LogPerfResult(base::StringPrintf("UTF16ToUTF8_%s", name).c_str(),
+                  megabytes / timer.Elapsed().InSecondsF(), "MB/s");
+    EXPECT_EQ(utf8, back);
+  }
+  {
+    bool valid = true;
+    PerfTimer timer;
+    for (int i = 0; i < kNumRounds; i++)
+      valid &= IsStringUTF8(utf8);
+    LogPerfResult(base::StringPrintf("IsStringUTF8_%s", name).c_str(),
+                  megabytes / timer.Elapsed().InSecondsF(), "MB/s");
+    EXPECT_TRUE(valid);
+  }
+}
+
+}  // namespace
+
+TEST(UTFStringConversionsPerfTest, ASCII) {
+  ConvertText("ascii", MakeText(
+      "http://www.example.com/search?q=chromium&hl=en&start=10\n"));
+}
+
+TEST(UTFStringConversionsPerfTest, MostlyASCII) {
+  // A French sentence: short runs of ASCII between accented letters.
+  ConvertText("mostly_ascii", MakeText(
+      "Le caf\xc3\xa9 est d\xc3\xa9j\xc3\xa0 pr\xc3\xaat, "
+      "dit la ma\xc3\xaetresse d'h\xc3\xb4tel.\n"));
+}
+
+TEST(UTFStringConversionsPerfTest, NonASCII) {
+  // "网页 图片 资讯更多 »"
+  ConvertText("non_ascii", MakeText(
+      "\xe7\xbd\x91\xe9\xa1\xb5 \xe5\x9b\xbe\xe7\x89\x87 "
+      "\xe8\xb5\x84\xe8\xae\xaf\xe6\x9b\xb4\xe5\xa4\x9a \xc2\xbb\n"));
+}
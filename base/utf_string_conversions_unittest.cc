@@ -208,4 +208,38 @@ TEST(UTFStringConversionsTest, ConvertMultiString) {
   EXPECT_EQ(expected, converted);
 }
 
+// The converters copy runs of ASCII in bulk, in blocks of 16 characters where
+// they can.  Check runs that end at and around block boundaries.
+TEST(UTFStringConversionsTest, ConvertASCIIRuns) {
+  for (size_t run = 0; run < 40; ++run) {
+    std::string utf8(run, 'a');
+    utf8.append("\xc3\xa9");  // U+00E9
+    utf8.append(run, 'b');
+    string16 utf16(run, 'a');
+    utf16.push_back(0xe9);
+    utf16.append(run, 'b');
+    std::wstring wide(run, L'a');
+    wide.push_back(0xe9);
+    wide.append(run, L'b');
+
+    EXPECT_EQ(utf16, UTF8ToUTF16(utf8));
+    EXPECT_EQ(utf8, UTF16ToUTF8(utf16));
+    EXPECT_EQ(wide, UTF8ToWide(utf8));
+    EXPECT_EQ(utf8, WideToUTF8(wide));
+    EXPECT_EQ(utf16, WideToUTF16(wide));
+    EXPECT_EQ(wide, UTF16ToWide(utf16));
+
+    // An invalid byte right after a run is still replaced.
+    std::string invalid(run, 'a');
+    invalid.append("\xff");
+    invalid.append(run, 'b');
+    string16 converted;
+    EXPECT_FALSE(UTF8ToUTF16(invalid.data(), invalid.length(), &converted));
+    string16 expected(run, 'a');
+    expected.push_back(0xfffd);
+    expected.append(run, 'b');
+    EXPECT_EQ(expected, converted);
+  }
+}
+
 }  // base
@@ -59,6 +59,14 @@ Value* CopyWithoutEmptyChildren(Value* node) {
 
 }  // namespace
 
+///////////////////// SharedString ////////////////////
+
+SharedString::SharedString(const std::string& value) : value_(value) {
+}
+
+SharedString::~SharedString() {
+}
+
 ///////////////////// Value ////////////////////
 
 Value::~Value() {
@@ -226,13 +234,13 @@ bool FundamentalValue::Equals(const Value* other) const {
 
 StringValue::StringValue(const std::string& in_value)
     : Value(TYPE_STRING),
-      value_(in_value) {
+      value_(new SharedString(in_value)) {
   DCHECK(IsStringUTF8(in_value));
 }
 
 StringValue::StringValue(const string16& in_value)
     : Value(TYPE_STRING),
-      value_(UTF16ToUTF8(in_value)) {
+      value_(new SharedString(UTF16ToUTF8(in_value))) {
 }
 
 StringValue::~StringValue() {
@@ -240,25 +248,30 @@ StringValue::~StringValue() {
 
 bool StringValue::GetAsString(std::string* out_value) const {
   if (out_value)
-    *out_value = value_;
+    *out_value = value_->value();
   return true;
 }
 
 bool StringValue::GetAsString(string16* out_value) const {
   if (out_value)
-    *out_value = UTF8ToUTF16(value_);
+    *out_value = UTF8ToUTF16(value_->value());
   return true;
 }
 
 StringValue* StringValue::DeepCopy() const {
-  return CreateStringValue(value_);
+  return new StringValue(value_.get());
 }
 
 bool StringValue::Equals(const Value* other) const {
   if (other->GetType() != GetType())
     return false;
-  std::string lhs, rhs;
-  return GetAsString(&lhs) && other->GetAsString(&rhs) && lhs == rhs;
+  const StringValue* other_string = static_cast<const StringValue*>(other);
+  return value_->value() == other_string->value_->value();
+}
+
+StringValue::StringValue(SharedString* in_value)
+    : Value(TYPE_STRING),
+      value_(in_value) {
 }
 
 ///////////////////// BinaryValue ////////////////////
@@ -320,19 +333,19 @@ DictionaryValue::~DictionaryValue() {
 
 bool DictionaryValue::HasKey(const std::string& key) const {
   DCHECK(IsStringUTF8(key));
-  ValueMap::const_iterator current_entry = dictionary_.find(key);
-  DCHECK((current_entry == dictionary_.end()) || current_entry->second);
-  return current_entry != dictionary_.end();
+  size_t index = LowerBound(key);
+  DCHECK(!HasKeyAt(index, key) || entries_[index].value);
+  return HasKeyAt(index, key);
 }
 
 void DictionaryValue::Clear() {
-  ValueMap::iterator dict_iterator = dictionary_.begin();
-  while (dict_iterator != dictionary_.end()) {
-    delete dict_iterator->second;
-    ++dict_iterator;
+  for (EntryVector::iterator i(entries_.begin()); i != entries_.end(); ++i) {
+    delete i->value;
+    i->key->Release();
   }
 
-  dictionary_.clear();
+  // Unlike clear(), this frees the array.
+  EntryVector().swap(entries_);
 }
 
 void DictionaryValue::Set(const std::string& path, Value* in_value) {
@@ -383,14 +396,21 @@ void DictionaryValue::SetString(const std::string& path,
 
 void DictionaryValue::SetWithoutPathExpansion(const std::string& key,
                                               Value* in_value) {
-  // If there's an existing value here, we need to delete it, because
-  // we own all our children.
-  if (HasKey(key)) {
-    DCHECK(dictionary_[key] != in_value);  // This would be bogus
-    delete dictionary_[key];
-  }
+  DCHECK(IsStringUTF8(key));
+  size_t index = LowerBound(key);
+  if (HasKeyAt(index, key))
+    ReplaceAt(index, in_value);
+  else
+    InsertAt(index, new SharedString(key), in_value);
+}
 
-  dictionary_[key] = in_value;
+void DictionaryValue::SetWithSharedKey(SharedString* key, Value* in_value) {
+  DCHECK(IsStringUTF8(key->value()));
+  size_t index = LowerBound(key->value());
+  if (HasKeyAt(index, key->value()))
+    ReplaceAt(index, in_value);
+  else
+    InsertAt(index, key, in_value);
 }
 
 bool DictionaryValue::Get(const std::string& path, Value** out_value) const {
@@ -514,13 +534,12 @@ bool DictionaryValue::GetList(const std::string& path,
 bool DictionaryValue::GetWithoutPathExpansion(const std::string& key,
                                               Value** out_value) const {
   DCHECK(IsStringUTF8(key));
-  ValueMap::const_iterator entry_iterator = dictionary_.find(key);
-  if (entry_iterator == dictionary_.end())
+  size_t index = LowerBound(key);
+  if (!HasKeyAt(index, key))
     return false;
 
-  Value* entry = entry_iterator->second;
   if (out_value)
-    *out_value = entry;
+    *out_value = entries_[index].value;
   return true;
 }
 
@@ -608,16 +627,17 @@ bool DictionaryValue::Remove(const std::string& path, Value** out_value) {
 bool DictionaryValue::RemoveWithoutPathExpansion(const std::string& key,
                                                  Value** out_value) {
   DCHECK(IsStringUTF8(key));
-  ValueMap::iterator entry_iterator = dictionary_.find(key);
-  if (entry_iterator == dictionary_.end())
+  size_t index = LowerBound(key);
+  if (!HasKeyAt(index, key))
     return false;
 
-  Value* entry = entry_iterator->second;
+  Entry entry = entries_[index];
+  entries_.erase(entries_.begin() + index);
+  entry.key->Release();
   if (out_value)
-    *out_value = entry;
+    *out_value = entry.value;
   else
-    delete entry;
-  dictionary_.erase(entry_iterator);
+    delete entry.value;
   return true;
 }
 
@@ -627,32 +647,34 @@ DictionaryValue* DictionaryValue::DeepCopyWithoutEmptyChildren() {
 }
 
 void DictionaryValue::MergeDictionary(const DictionaryValue* dictionary) {
-  for (DictionaryValue::key_iterator key(dictionary->begin_keys());
-       key != dictionary->end_keys(); ++key) {
-    Value* merge_value;
-    if (dictionary->GetWithoutPathExpansion(*key, &merge_value)) {
-      // Check whether we have to merge dictionaries.
-      if (merge_value->IsType(Value::TYPE_DICTIONARY)) {
-        DictionaryValue* sub_dict;
-        if (GetDictionaryWithoutPathExpansion(*key, &sub_dict)) {
-          sub_dict->MergeDictionary(
-              static_cast<const DictionaryValue*>(merge_value));
-          continue;
-        }
+  for (EntryVector::const_iterator i(dictionary->entries_.begin());
+       i != dictionary->entries_.end(); ++i) {
+    const std::string& key = i->key->value();
+    Value* merge_value = i->value;
+    // Check whether we have to merge dictionaries.
+    if (merge_value->IsType(Value::TYPE_DICTIONARY)) {
+      DictionaryValue* sub_dict;
+      if (GetDictionaryWithoutPathExpansion(key, &sub_dict)) {
+        sub_dict->MergeDictionary(
+            static_cast<const DictionaryValue*>(merge_value));
+        continue;
       }
-      // All other cases: Make a copy and hook it up.
-      SetWithoutPathExpansion(*key, merge_value->DeepCopy());
     }
+    // All other cases: Make a copy and hook it up.
+    SetWithSharedKey(i->key, merge_value->DeepCopy());
   }
 }
 
 DictionaryValue* DictionaryValue::DeepCopy() const {
   DictionaryValue* result = new DictionaryValue;
 
-  for (ValueMap::const_iterator current_entry(dictionary_.begin());
-       current_entry != dictionary_.end(); ++current_entry) {
-    result->SetWithoutPathExpansion(current_entry->first,
-                                    current_entry->second->DeepCopy());
+  // The entries are already sorted, and the copy shares their keys.
+  result->entries_.reserve(entries_.size());
+  for (EntryVector::const_iterator i(entries_.begin()); i != entries_.end();
+       ++i) {
+    Entry entry = { i->key, i->value->DeepCopy() };
+    entry.key->AddRef();
+    result->entries_.push_back(entry);
   }
 
   return result;
@@ -684,6 +706,45 @@ bool DictionaryValue::Equals(const Value* other) const {
   return true;
 }
 
+size_t DictionaryValue::LowerBound(const std::string& key) const {
+  // Keys are often added in order, such as when reading back what
+  // JSONWriter wrote, so check the end first.
+  if (entries_.empty() || entries_.back().key->value() < key)
+    return entries_.size();
+
+  size_t begin = 0;
+  size_t end = entries_.size();
+  while (begin < end) {
+    size_t middle = begin + (end - begin) / 2;
+    if (entries_[middle].key->value() < key)
+      begin = middle + 1;
+    else
+      end = middle;
+  }
+  return begin;
+}
+
+bool DictionaryValue::HasKeyAt(size_t index, const std::string& key) const {
+  return index < entries_.size() && entries_[index].key->value() == key;
+}
+
+void DictionaryValue::ReplaceAt(size_t index, Value* in_value) {
+  DCHECK(in_value);
+  // We need to delete the existing value, because we own all our children.
+  DCHECK(entries_[index].value != in_value);  // This would be bogus
+  delete entries_[index].value;
+  entries_[index].value = in_value;
+}
+
+void DictionaryValue::InsertAt(size_t index,
+                               SharedString* key,
+                               Value* in_value) {
+  DCHECK(in_value);
+  Entry entry = { key, in_value };
+  key->AddRef();
+  entries_.insert(entries_.begin() + index, entry);
+}
+
 ///////////////////// ListValue ////////////////////
 
 ListValue::ListValue() : Value(TYPE_LIST) {
@@ -29,6 +29,7 @@
 
 #include "base/base_api.h"
 #include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
 #include "base/string16.h"
 #include "build/build_config.h"
 
@@ -40,7 +41,24 @@ class StringValue;
 class Value;
 
 typedef std::vector<Value*> ValueVector;
-typedef std::map<std::string, Value*> ValueMap;
+
+// An immutable string that Values share instead of copying it.  The copies of
+// a dictionary share its keys, and the copies of a StringValue its string.
+class BASE_API SharedString
+    : public base::RefCountedThreadSafe<SharedString> {
+ public:
+  explicit SharedString(const std::string& value);
+
+  const std::string& value() const { return value_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<SharedString>;
+  ~SharedString();
+
+  const std::string value_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedString);
+};
 
 // The Value class is the base class for Values.  A Value can be
 // instantiated via the Create*Value() factory methods, or by directly
@@ -164,7 +182,10 @@ class BASE_API StringValue : public Value {
   virtual bool Equals(const Value* other) const;
 
  private:
-  std::string value_;
+  // Shares |in_value| with the other StringValue holding it.
+  explicit StringValue(SharedString* in_value);
+
+  scoped_refptr<SharedString> value_;
 
   DISALLOW_COPY_AND_ASSIGN(StringValue);
 };
@@ -207,6 +228,17 @@ class BASE_API BinaryValue: public Value {
 // parsing for recursive access; see the comment at the top of the file. Keys
 // are |std::string|s and should be UTF-8 encoded.
 class BASE_API DictionaryValue : public Value {
+ private:
+  // An entry of the dictionary, which holds a reference to its key and owns
+  // its value.  The entries are kept in a single array sorted by key, which
+  // takes much less memory than a tree with a node per entry, and is searched
+  // as fast.
+  struct Entry {
+    SharedString* key;
+    Value* value;
+  };
+  typedef std::vector<Entry> EntryVector;
+
  public:
   DictionaryValue();
   virtual ~DictionaryValue();
@@ -215,10 +247,10 @@ class BASE_API DictionaryValue : public Value {
   bool HasKey(const std::string& key) const;
 
   // Returns the number of Values in this dictionary.
-  size_t size() const { return dictionary_.size(); }
+  size_t size() const { return entries_.size(); }
 
   // Returns whether the dictionary is empty.
-  bool empty() const { return dictionary_.empty(); }
+  bool empty() const { return entries_.empty(); }
 
   // Clears any current contents of this dictionary.
   void Clear();
@@ -246,6 +278,12 @@ class BASE_API DictionaryValue : public Value {
   // be used as paths.
   void SetWithoutPathExpansion(const std::string& key, Value* in_value);
 
+  // Like SetWithoutPathExpansion(), but shares |key| instead of copying it.
+  // This lets many dictionaries with the same keys, such as the elements of
+  // a list parsed from JSON, hold a single copy of each key.  The caller
+  // keeps its own reference to |key|.
+  void SetWithSharedKey(SharedString* key, Value* in_value);
+
   // Gets the Value associated with the given path starting from this object.
   // A path has the form "<key>" or "<key>.<key>.[...]", where "." indexes
   // into the next DictionaryValue down.  If the path can be resolved
@@ -317,28 +355,40 @@ class BASE_API DictionaryValue : public Value {
   class BASE_API key_iterator
       : private std::iterator<std::input_iterator_tag, const std::string> {
    public:
-    explicit key_iterator(ValueMap::const_iterator itr) { itr_ = itr; }
+    explicit key_iterator(EntryVector::const_iterator itr) { itr_ = itr; }
     key_iterator operator++() {
       ++itr_;
       return *this;
     }
-    const std::string& operator*() { return itr_->first; }
+    const std::string& operator*() { return itr_->key->value(); }
     bool operator!=(const key_iterator& other) { return itr_ != other.itr_; }
     bool operator==(const key_iterator& other) { return itr_ == other.itr_; }
 
    private:
-    ValueMap::const_iterator itr_;
+    EntryVector::const_iterator itr_;
   };
 
-  key_iterator begin_keys() const { return key_iterator(dictionary_.begin()); }
-  key_iterator end_keys() const { return key_iterator(dictionary_.end()); }
+  key_iterator begin_keys() const { return key_iterator(entries_.begin()); }
+  key_iterator end_keys() const { return key_iterator(entries_.end()); }
 
   // Overridden from Value:
   virtual DictionaryValue* DeepCopy() const;
   virtual bool Equals(const Value* other) const;
 
  private:
-  ValueMap dictionary_;
+  // Returns the index of the first entry whose key is not less than |key|.
+  size_t LowerBound(const std::string& key) const;
+
+  // Returns true if the entry at |index| exists and has the given |key|.
+  bool HasKeyAt(size_t index, const std::string& key) const;
+
+  // Replaces the value of the entry at |index|.
+  void ReplaceAt(size_t index, Value* in_value);
+
+  // Inserts an entry at |index|, which must keep the entries sorted.
+  void InsertAt(size_t index, SharedString* key, Value* in_value);
+
+  EntryVector entries_;
 
   DISALLOW_COPY_AND_ASSIGN(DictionaryValue);
 };
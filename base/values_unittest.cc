@@ -319,6 +319,52 @@ TEST_F(ValuesTest, DictionaryWithoutPathExpansion) {
   EXPECT_EQ(Value::TYPE_NULL, value4->GetType());
 }
 
+TEST_F(ValuesTest, DictionaryKeyOrder) {
+  // The keys are iterated in order, whatever order they were set in.
+  DictionaryValue dict;
+  const char* keys[] = { "d", "b", "e", "a", "c", "bb", "" };
+  for (size_t i = 0; i < arraysize(keys); ++i)
+    dict.SetWithoutPathExpansion(keys[i], Value::CreateIntegerValue(i));
+  dict.SetWithoutPathExpansion("b", Value::CreateIntegerValue(10));
+  EXPECT_TRUE(dict.RemoveWithoutPathExpansion("c", NULL));
+  EXPECT_FALSE(dict.RemoveWithoutPathExpansion("c", NULL));
+
+  std::string all_keys;
+  for (DictionaryValue::key_iterator it = dict.begin_keys();
+       it != dict.end_keys(); ++it) {
+    all_keys += "<" + *it + ">";
+  }
+  EXPECT_EQ("<><a><b><bb><d><e>", all_keys);
+  EXPECT_EQ(6U, dict.size());
+
+  int value = 0;
+  EXPECT_TRUE(dict.GetInteger("b", &value));
+  EXPECT_EQ(10, value);
+  EXPECT_TRUE(dict.GetIntegerWithoutPathExpansion("", &value));
+  EXPECT_EQ(6, value);
+  EXPECT_FALSE(dict.HasKey("c"));
+  EXPECT_FALSE(dict.HasKey("f"));
+}
+
+TEST_F(ValuesTest, DeepCopySharesStrings) {
+  DictionaryValue original;
+  original.SetString("key", "value");
+  scoped_ptr<DictionaryValue> copy(original.DeepCopy());
+
+  // The copy holds the same key, not a copy of it.
+  EXPECT_EQ(&*original.begin_keys(), &*copy->begin_keys());
+
+  // Changing the copy doesn't change the original.
+  copy->SetString("key", "other value");
+  std::string value;
+  EXPECT_TRUE(original.GetString("key", &value));
+  EXPECT_EQ("value", value);
+  copy.reset();
+  EXPECT_TRUE(original.GetString("key", &value));
+  EXPECT_EQ("value", value);
+  EXPECT_EQ("key", *original.begin_keys());
+}
+
 TEST_F(ValuesTest, DeepCopy) {
   DictionaryValue original_dict;
   Value* original_null = Value::CreateNullValue();
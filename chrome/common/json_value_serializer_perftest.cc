@@ -2,12 +2,18 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+#include <string>
 #include <vector>
 
 #include "base/file_util.h"
+#include "base/format_macros.h"
+#include "base/json/json_parser.h"
+#include "base/json/json_reader.h"
 #include "base/path_service.h"
 #include "base/perftimer.h"
 #include "base/string_util.h"
+#include "base/stringprintf.h"
 #include "base/values.h"
 #include "chrome/common/chrome_paths.h"
 #include "chrome/common/logging_chrome.h"
@@ -15,6 +21,34 @@
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace {
+
+// The size of the large documents, and of the chunks they are parsed in.
+const size_t kLargeDocumentSize = 8 * 1024 * 1024;
+const size_t kChunkSize = 64 * 1024;
+
+// Ignores what it is told, to time the parser alone.
+class NullDelegate : public base::JSONParser::Delegate {
+ public:
+  virtual void OnObjectBegin() {}
+  virtual void OnObjectEnd() {}
+  virtual void OnArrayBegin() {}
+  virtual void OnArrayEnd() {}
+  virtual void OnKey(const std::string& key) {}
+  virtual void OnString(const std::string& value) {}
+  virtual void OnInteger(int value) {}
+  virtual void OnDouble(double value) {}
+  virtual void OnBoolean(bool value) {}
+  virtual void OnNull() {}
+};
+
+// Logs the throughput of parsing |bytes| in |timer|.
+void LogThroughput(const std::string& name, size_t bytes,
+                   const PerfTimer& timer) {
+  double megabytes = bytes / (1024.0 * 1024.0);
+  LogPerfResult(name.c_str(), megabytes / timer.Elapsed().InSecondsF(),
+                "MB/s");
+}
+
 class JSONValueSerializerTests : public testing::Test {
  protected:
   virtual void SetUp() {
@@ -36,6 +70,20 @@ class JSONValueSerializerTests : public testing::Test {
     }
   }
 
+  // Returns a document of at least kLargeDocumentSize bytes: a list that
+  // repeats |test_case|.
+  static std::string MakeLargeDocument(const std::string& test_case) {
+    std::string document = "[";
+    document.reserve(kLargeDocumentSize + test_case.size() + 2);
+    while (document.size() < kLargeDocumentSize) {
+      if (document.size() > 1)
+        document.append(",");
+      document.append(test_case);
+    }
+    document.append("]");
+    return document;
+  }
+
   // Holds json strings to be tested.
   std::vector<std::string> test_cases_;
 };
@@ -60,6 +108,38 @@ TEST_F(JSONValueSerializerTests, Reading) {
   chrome_timer.Done();
 }
 
+// Measures the throughput of parsing multi-megabyte documents, into Values
+// and with the streaming parser alone.
+TEST_F(JSONValueSerializerTests, ReadingLargeDocuments) {
+  printf("\n");
+  const int kIterations = 5;
+  for (size_t i = 0; i < test_cases_.size(); ++i) {
+    std::string document = MakeLargeDocument(test_cases_[i]);
+
+    PerfTimer reader_timer;
+    for (int j = 0; j < kIterations; ++j) {
+      scoped_ptr<Value> root(base::JSONReader::Read(document, false));
+      ASSERT_TRUE(root.get());
+    }
+    LogThroughput(base::StringPrintf("json_reader_%" PRIuS, i),
+                  document.size() * kIterations, reader_timer);
+
+    PerfTimer parser_timer;
+    for (int j = 0; j < kIterations; ++j) {
+      NullDelegate delegate;
+      base::JSONParser parser(&delegate, true, false);
+      for (size_t offset = 0; offset < document.size(); offset += kChunkSize) {
+        ASSERT_TRUE(parser.Parse(document.data() + offset,
+                                 std::min(kChunkSize,
+                                          document.size() - offset)));
+      }
+      ASSERT_TRUE(parser.Finish());
+    }
+    LogThroughput(base::StringPrintf("json_parser_%" PRIuS, i),
+                  document.size() * kIterations, parser_timer);
+  }
+}
+
 TEST_F(JSONValueSerializerTests, CompactWriting) {
   printf("\n");
   const int kIterations = 100000;
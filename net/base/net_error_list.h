@@ -444,6 +444,10 @@ NET_ERROR(RESPONSE_HEADERS_MULTIPLE_CONTENT_LENGTH, -346)
 // headers are missing, so we're expecting additional frames to complete them.
 NET_ERROR(INCOMPLETE_SPDY_HEADERS, -347)
 
+// The request was pipelined behind another on the same connection, and the
+// pipeline broke before its response could be read.  It is safe to resend.
+NET_ERROR(PIPELINE_EVICTION, -348)
+
 // SPDY server didn't respond to the PING message.
 NET_ERROR(SPDY_PING_FAILED, -352)
 
@@ -23,7 +23,8 @@ class FileStream;
 // of data are added.
 class ChunkCallback {
  public:
-  // Invoked when a new data chunk was given for a chunked transfer upload.
+  // Invoked when a new data chunk was given for a chunked transfer upload, or
+  // when file data read by UploadDataStream::EnableAsyncFileReads() arrives.
   virtual void OnChunkAvailable() = 0;
 
  protected:
@@ -136,6 +137,8 @@ class UploadData : public base::RefCounted<UploadData> {
     FileStream* file_stream_;
 
     FRIEND_TEST_ALL_PREFIXES(UploadDataStreamTest, FileSmallerThanLength);
+    FRIEND_TEST_ALL_PREFIXES(UploadDataStreamTest,
+                             AsyncFileReadsSmallerThanLength);
     FRIEND_TEST_ALL_PREFIXES(HttpNetworkTransactionTest,
                              UploadFileSmallerThanLength);
   };
@@ -6,15 +6,133 @@
 
 #include "base/file_util.h"
 #include "base/logging.h"
+#include "base/message_loop_proxy.h"
+#include "base/task.h"
+#include "base/threading/worker_pool.h"
 #include "net/base/file_stream.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 
 namespace net {
 
+// Reads a file on a worker thread, one buffer ahead of the data the stream
+// consumes, so that the disk and the network are kept busy at the same time.
+// It is reference counted because a read may still be running on the worker
+// thread when the stream goes away.
+class UploadDataStream::FileReader
+    : public base::RefCountedThreadSafe<UploadDataStream::FileReader> {
+ public:
+  // Takes ownership of |file|, of which |length| bytes are to be read.
+  FileReader(UploadDataStream* owner, FileStream* file, uint64 length)
+      : owner_(owner),
+        owner_loop_(base::MessageLoopProxy::CreateForCurrentThread()),
+        file_(file),
+        remaining_(length),
+        read_pending_(false),
+        ready_len_(0),
+        ready_offset_(0) {
+  }
+
+  // Starts reading the next buffer, unless there is one already being read
+  // or waiting to be consumed.
+  void ReadAhead() {
+    if (read_pending_ || ready_buf_ || !remaining_)
+      return;
+
+    int len = static_cast<int>(
+        std::min(remaining_, static_cast<uint64>(kBufSize)));
+    remaining_ -= len;
+    read_pending_ = true;
+    base::WorkerPool::PostTask(FROM_HERE, NewRunnableMethod(
+        this, &FileReader::Read, make_scoped_refptr(new IOBuffer(kBufSize)),
+        len), true);
+  }
+
+  // Moves the data read so far to the end of |*buf|, which holds |*buf_len|
+  // bytes, and starts reading the next buffer.  When |*buf| is empty and the
+  // whole read buffer fits, the buffers are swapped instead of copied.
+  // Returns the number of bytes moved.
+  size_t MoveData(scoped_refptr<IOBuffer>* buf, size_t* buf_len) {
+    if (!ready_buf_)
+      return 0;
+
+    size_t count = std::min(ready_len_ - ready_offset_, kBufSize - *buf_len);
+    if (!*buf_len && count == ready_len_) {
+      buf->swap(ready_buf_);
+    } else {
+      memcpy((*buf)->data() + *buf_len, ready_buf_->data() + ready_offset_,
+             count);
+    }
+    *buf_len += count;
+    ready_offset_ += count;
+
+    if (ready_offset_ == ready_len_) {
+      ready_buf_ = NULL;
+      ready_len_ = 0;
+      ready_offset_ = 0;
+      ReadAhead();
+    }
+    return count;
+  }
+
+  // Stops reporting to the stream, which is going away.
+  void Cancel() {
+    owner_ = NULL;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<UploadDataStream::FileReader>;
+
+  ~FileReader() {}
+
+  // Runs on a worker thread.
+  void Read(scoped_refptr<IOBuffer> buf, int len) {
+    int rv = file_->ReadUntilComplete(buf->data(), len);
+    if (rv < len) {
+      // If there's less data to read than we initially observed, then pad
+      // with zero.  Otherwise the server will hang waiting for the rest of
+      // the data.
+      rv = std::max(rv, 0);
+      memset(buf->data() + rv, 0, len - rv);
+    }
+    owner_loop_->PostTask(FROM_HERE, NewRunnableMethod(
+        this, &FileReader::OnReadComplete, buf, len));
+  }
+
+  void OnReadComplete(scoped_refptr<IOBuffer> buf, int len) {
+    read_pending_ = false;
+    if (!owner_)
+      return;
+
+    ready_buf_ = buf;
+    ready_len_ = len;
+    owner_->OnFileDataRead();
+  }
+
+  UploadDataStream* owner_;
+  scoped_refptr<base::MessageLoopProxy> owner_loop_;
+
+  // Only used on the worker thread while a read is pending.
+  scoped_ptr<FileStream> file_;
+
+  // The number of bytes of |file_| that remain to be requested.
+  uint64 remaining_;
+
+  bool read_pending_;
+
+  // The buffer read last, waiting to be moved to the stream.
+  scoped_refptr<IOBuffer> ready_buf_;
+  size_t ready_len_;
+  size_t ready_offset_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileReader);
+};
+
 bool UploadDataStream::merge_chunks_ = true;
 
 UploadDataStream::~UploadDataStream() {
+  if (file_reader_)
+    file_reader_->Cancel();
 }
 
 UploadDataStream* UploadDataStream::Create(UploadData* data, int* error_code) {
@@ -43,6 +161,16 @@ void UploadDataStream::MarkConsumedAndFillBuffer(size_t num_bytes) {
   current_position_ += num_bytes;
 }
 
+void UploadDataStream::EnableAsyncFileReads(ChunkCallback* callback) {
+  DCHECK(!is_chunked());
+  async_file_reads_ = true;
+  file_read_callback_ = callback;
+
+  // Start reading the file that comes next, while the buffer is sent.
+  if (!eof_)
+    FillBuf();
+}
+
 UploadDataStream::UploadDataStream(UploadData* data)
     : data_(data),
       buf_(new IOBuffer(kBufSize)),
@@ -50,6 +178,8 @@ UploadDataStream::UploadDataStream(UploadData* data)
       next_element_(0),
       next_element_offset_(0),
       next_element_remaining_(0),
+      async_file_reads_(false),
+      file_read_callback_(NULL),
       total_size_(data->is_chunked() ? 0 : data->GetContentLength()),
       current_position_(0),
       eof_(false) {
@@ -88,56 +218,53 @@ int UploadDataStream::FillBuf() {
       DCHECK(element.type() == UploadData::TYPE_FILE);
 
       if (!next_element_remaining_) {
-        // If the underlying file has been changed, treat it as error.
-        // Note that the expected modification time from WebKit is based on
-        // time_t precision. So we have to convert both to time_t to compare.
-        if (!element.expected_file_modification_time().is_null()) {
-          base::PlatformFileInfo info;
-          if (file_util::GetFileInfo(element.file_path(), &info) &&
-              element.expected_file_modification_time().ToTimeT() !=
-                  info.last_modified.ToTimeT()) {
-            return ERR_UPLOAD_FILE_CHANGED;
-          }
-        }
-        next_element_remaining_ = element.GetContentLength();
-#ifdef ANDROID
-        if (element.file_path().value().find("content://") == 0) {
-            next_element_java_stream_.reset(
-                new android::JavaISWrapper(element.file_path()));
-        } else
-#endif
-        next_element_stream_.reset(element.NewFileStreamForReading());
+        int rv = OpenFileElement(&element);
+        if (rv != OK)
+          return rv;
       }
 
-      int rv = 0;
-      int count =
-          static_cast<int>(std::min(next_element_remaining_,
-                                    static_cast<uint64>(size_remaining)));
-      if (count > 0) {
+      if (async_file_reads_ && next_element_remaining_ &&
+          (file_reader_ || next_element_stream_.get())) {
+        // Take whatever the worker thread has read ahead of us.
+        if (!file_reader_)
+          StartFileReader();
+        next_element_remaining_ -= file_reader_->MoveData(&buf_, &buf_len_);
+        if (next_element_remaining_)
+          break;  // Wait for the worker thread to read more.
+        advance_to_next_element = true;
+      } else {
+        int rv = 0;
+        int count =
+            static_cast<int>(std::min(next_element_remaining_,
+                                      static_cast<uint64>(size_remaining)));
+        if (count > 0) {
 #ifdef ANDROID
-        if (next_element_java_stream_.get())
-            rv = next_element_java_stream_->Read(buf_->data() + buf_len_, count);
-        else {
+          if (next_element_java_stream_.get())
+              rv = next_element_java_stream_->Read(buf_->data() + buf_len_,
+                                                   count);
+          else {
 #endif
-        if (next_element_stream_.get())
-          rv = next_element_stream_->Read(buf_->data() + buf_len_, count, NULL);
+          if (next_element_stream_.get())
+            rv = next_element_stream_->Read(buf_->data() + buf_len_, count,
+                                            NULL);
 #ifdef ANDROID
-        }
+          }
 #endif
-        if (rv <= 0) {
-          // If there's less data to read than we initially observed, then
-          // pad with zero.  Otherwise the server will hang waiting for the
-          // rest of the data.
-          memset(buf_->data() + buf_len_, 0, count);
-          rv = count;
+          if (rv <= 0) {
+            // If there's less data to read than we initially observed, then
+            // pad with zero.  Otherwise the server will hang waiting for the
+            // rest of the data.
+            memset(buf_->data() + buf_len_, 0, count);
+            rv = count;
+          }
+          buf_len_ += rv;
         }
-        buf_len_ += rv;
-      }
 
-      if (static_cast<int>(next_element_remaining_) == rv) {
-        advance_to_next_element = true;
-      } else {
-        next_element_remaining_ -= rv;
+        if (static_cast<int>(next_element_remaining_) == rv) {
+          advance_to_next_element = true;
+        } else {
+          next_element_remaining_ -= rv;
+        }
       }
     }
 
@@ -146,12 +273,23 @@ int UploadDataStream::FillBuf() {
       next_element_offset_ = 0;
       next_element_remaining_ = 0;
       next_element_stream_.reset();
+      file_reader_ = NULL;
     }
 
     if (is_chunked() && !merge_chunks_)
       break;
   }
 
+  // Once the buffer is full, start reading the file that comes next so that
+  // its data is ready by the time the buffer has been sent.
+  if (async_file_reads_ && !file_reader_ && next_element_ < elements.size() &&
+      elements[next_element_].type() == UploadData::TYPE_FILE) {
+    if (!next_element_remaining_)
+      OpenFileElement(&elements[next_element_]);
+    if (next_element_remaining_ && next_element_stream_.get())
+      StartFileReader();
+  }
+
   if (next_element_ == elements.size() && !buf_len_) {
     if (!data_->is_chunked() ||
         (!elements.empty() && elements.back().is_last_chunk())) {
@@ -162,6 +300,48 @@ int UploadDataStream::FillBuf() {
   return OK;
 }
 
+int UploadDataStream::OpenFileElement(UploadData::Element* element) {
+  // If the underlying file has been changed, treat it as error.
+  // Note that the expected modification time from WebKit is based on
+  // time_t precision. So we have to convert both to time_t to compare.
+  if (!element->expected_file_modification_time().is_null()) {
+    base::PlatformFileInfo info;
+    if (file_util::GetFileInfo(element->file_path(), &info) &&
+        element->expected_file_modification_time().ToTimeT() !=
+            info.last_modified.ToTimeT()) {
+      return ERR_UPLOAD_FILE_CHANGED;
+    }
+  }
+  next_element_remaining_ = element->GetContentLength();
+#ifdef ANDROID
+  if (element->file_path().value().find("content://") == 0) {
+      next_element_java_stream_.reset(
+          new android::JavaISWrapper(element->file_path()));
+  } else
+#endif
+  next_element_stream_.reset(element->NewFileStreamForReading());
+  return OK;
+}
+
+void UploadDataStream::StartFileReader() {
+  DCHECK(!file_reader_);
+  file_reader_ = new FileReader(this, next_element_stream_.release(),
+                                next_element_remaining_);
+  file_reader_->ReadAhead();
+}
+
+void UploadDataStream::OnFileDataRead() {
+  // Data that arrives while the buffer still holds some is picked up by the
+  // next MarkConsumedAndFillBuffer(); only a consumer that ran dry waits for
+  // the callback.
+  if (buf_len_)
+    return;
+
+  FillBuf();
+  if (buf_len_ && file_read_callback_)
+    file_read_callback_->OnChunkAvailable();
+}
+
 bool UploadDataStream::IsOnLastChunk() const {
   const std::vector<UploadData::Element>& elements = *data_->elements();
   DCHECK(data_->is_chunked());
@@ -6,6 +6,7 @@
 #define NET_BASE_UPLOAD_DATA_STREAM_H_
 #pragma once
 
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "net/base/upload_data.h"
 
@@ -47,6 +48,13 @@ class UploadDataStream {
     data_->set_chunk_callback(callback);
   }
 
+  // Makes the stream read files on a worker thread, one buffer ahead of the
+  // data being consumed, instead of on the calling thread.  buf() may then be
+  // empty before eof(); |callback| is invoked when more data is available.
+  // The calling thread must have a MessageLoop, and |callback| must outlive
+  // the stream.
+  void EnableAsyncFileReads(ChunkCallback* callback);
+
   // Returns the total size of the data stream and the current position.
   // size() is not to be used to determine whether the stream has ended
   // because it is possible for the stream to end before its size is reached,
@@ -71,6 +79,8 @@ class UploadDataStream {
 #endif
 
  private:
+  class FileReader;
+
   enum { kBufSize = 16384 };
 
   // Protects from public access since now we have a static creator function
@@ -82,6 +92,16 @@ class UploadDataStream {
   // Returns OK if the operation succeeds. Otherwise error code is returned.
   int FillBuf();
 
+  // Prepares next_element_, a TYPE_FILE element, for reading.
+  // Returns OK if the operation succeeds. Otherwise error code is returned.
+  int OpenFileElement(UploadData::Element* element);
+
+  // Starts reading the open file of next_element_ on a worker thread.
+  void StartFileReader();
+
+  // Called by |file_reader_| when it has read more data.
+  void OnFileDataRead();
+
   scoped_refptr<UploadData> data_;
 
   // This buffer is filled with data to be uploaded.  The data to be sent is
@@ -110,6 +130,12 @@ class UploadDataStream {
   // if the next element is of TYPE_FILE.
   uint64 next_element_remaining_;
 
+  // Reads next_element_stream_ on a worker thread, when file reads are
+  // asynchronous.
+  scoped_refptr<FileReader> file_reader_;
+  bool async_file_reads_;
+  ChunkCallback* file_read_callback_;
+
   // Size and current read position within the stream.
   uint64 total_size_;
   uint64 current_position_;
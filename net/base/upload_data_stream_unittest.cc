@@ -4,13 +4,18 @@
 
 #include "net/base/upload_data_stream.h"
 
+#include <algorithm>
+#include <string>
 #include <vector>
 
 #include "base/basictypes.h"
 #include "base/file_path.h"
 #include "base/file_util.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/threading/platform_thread.h"
 #include "base/time.h"
+#include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/upload_data.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -23,6 +28,41 @@ namespace {
 const char kTestData[] = "0123456789";
 const int kTestDataSize = arraysize(kTestData) - 1;
 
+// Quits the current message loop when file data arrives.
+class QuitOnDataCallback : public ChunkCallback {
+ public:
+  QuitOnDataCallback() : count_(0) {}
+
+  virtual void OnChunkAvailable() {
+    ++count_;
+    MessageLoop::current()->Quit();
+  }
+
+  int count() const { return count_; }
+
+ private:
+  int count_;
+};
+
+// Consumes |stream| to the end, |max_consumed| bytes at a time, waiting for
+// file data to be read whenever the buffer runs dry.
+std::string ReadAsync(UploadDataStream* stream, QuitOnDataCallback* callback,
+                      size_t max_consumed) {
+  std::string data;
+  while (!stream->eof()) {
+    if (!stream->buf_len()) {
+      int count = callback->count();
+      MessageLoop::current()->Run();
+      EXPECT_EQ(count + 1, callback->count());
+      EXPECT_LT(0u, stream->buf_len());
+    }
+    size_t consumed = std::min(stream->buf_len(), max_consumed);
+    data.append(stream->buf()->data(), consumed);
+    stream->MarkConsumedAndFillBuffer(consumed);
+  }
+  return data;
+}
+
 }  // namespace
 
 class UploadDataStreamTest : public PlatformTest {
@@ -85,6 +125,97 @@ TEST_F(UploadDataStreamTest, FileSmallerThanLength) {
   file_util::Delete(temp_file_path, false);
 }
 
+TEST_F(UploadDataStreamTest, AsyncFileReads) {
+  std::string file_data;
+  for (int i = 0; file_data.size() < 100000; ++i)
+    file_data.append(1, static_cast<char>(i * 7));
+  FilePath temp_file_path;
+  ASSERT_TRUE(file_util::CreateTemporaryFile(&temp_file_path));
+  ASSERT_EQ(static_cast<int>(file_data.size()),
+            file_util::WriteFile(temp_file_path, file_data.data(),
+                                 file_data.size()));
+
+  // The file is read from the middle of a multipart body.
+  std::string expected;
+  upload_data_->AppendBytes(kTestData, kTestDataSize);
+  expected.append(kTestData, kTestDataSize);
+  upload_data_->AppendFileRange(temp_file_path, 3, file_data.size() - 5,
+                                base::Time());
+  expected.append(file_data, 3, file_data.size() - 5);
+  upload_data_->AppendBytes(kTestData, kTestDataSize);
+  expected.append(kTestData, kTestDataSize);
+
+  // Consume the stream whole buffers at a time and in odd sized pieces.
+  const size_t kMaxConsumed[] = { 1 << 20, 1000 };
+  for (size_t i = 0; i < arraysize(kMaxConsumed); ++i) {
+    scoped_ptr<UploadDataStream> stream(
+        UploadDataStream::Create(upload_data_, NULL));
+    ASSERT_TRUE(stream.get());
+    QuitOnDataCallback callback;
+    stream->EnableAsyncFileReads(&callback);
+    std::string data = ReadAsync(stream.get(), &callback, kMaxConsumed[i]);
+    EXPECT_EQ(expected.size(), stream->position());
+    EXPECT_TRUE(expected == data);
+  }
+
+  file_util::Delete(temp_file_path, false);
+}
+
+TEST_F(UploadDataStreamTest, AsyncFileReadsSmallerThanLength) {
+  FilePath temp_file_path;
+  ASSERT_TRUE(file_util::CreateTemporaryFile(&temp_file_path));
+  ASSERT_EQ(kTestDataSize, file_util::WriteFile(temp_file_path,
+                                                kTestData, kTestDataSize));
+  const uint64 kFakeSize = 50000;
+
+  std::vector<UploadData::Element> elements;
+  UploadData::Element element;
+  element.SetToFilePath(temp_file_path);
+  element.SetContentLength(kFakeSize);
+  elements.push_back(element);
+  upload_data_->SetElements(elements);
+
+  scoped_ptr<UploadDataStream> stream(
+      UploadDataStream::Create(upload_data_, NULL));
+  ASSERT_TRUE(stream.get());
+  QuitOnDataCallback callback;
+  stream->EnableAsyncFileReads(&callback);
+  std::string data = ReadAsync(stream.get(), &callback, 1 << 20);
+
+  // The missing data is padded with zeros, like for synchronous reads.
+  std::string expected(kTestData, kTestDataSize);
+  expected.resize(kFakeSize, '\0');
+  EXPECT_TRUE(expected == data);
+
+  file_util::Delete(temp_file_path, false);
+}
+
+TEST_F(UploadDataStreamTest, DeleteWhileReadingFile) {
+  std::string file_data(100000, 'x');
+  FilePath temp_file_path;
+  ASSERT_TRUE(file_util::CreateTemporaryFile(&temp_file_path));
+  ASSERT_EQ(static_cast<int>(file_data.size()),
+            file_util::WriteFile(temp_file_path, file_data.data(),
+                                 file_data.size()));
+  upload_data_->AppendFileRange(temp_file_path, 0, kuint64max, base::Time());
+
+  scoped_ptr<UploadDataStream> stream(
+      UploadDataStream::Create(upload_data_, NULL));
+  ASSERT_TRUE(stream.get());
+  QuitOnDataCallback callback;
+  stream->EnableAsyncFileReads(&callback);
+  stream->MarkConsumedAndFillBuffer(stream->buf_len());
+  stream.reset();
+
+  // The read that was still running must not call back.
+  MessageLoop::current()->RunAllPending();
+  base::PlatformThread::Sleep(10);
+  MessageLoop::current()->RunAllPending();
+  EXPECT_EQ(0, callback.count());
+
+  file_util::Delete(temp_file_path, false);
+}
+
 void UploadDataStreamTest::FileChangedHelper(const FilePath& file_path,
                                              const base::Time& time,
                                              bool error_expected) {
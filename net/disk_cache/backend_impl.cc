@@ -7,10 +7,12 @@
 #include "base/file_path.h"
 #include "base/file_util.h"
 #include "base/message_loop.h"
+#include "base/message_loop_proxy.h"
 #include "base/metrics/field_trial.h"
 #include "base/metrics/histogram.h"
 #include "base/metrics/stats_counters.h"
 #include "base/rand_util.h"
+#include "base/string_number_conversions.h"
 #include "base/string_util.h"
 #include "base/stringprintf.h"
 #include "base/sys_info.h"
@@ -38,8 +40,13 @@ using base::TimeTicks;
 namespace {
 
 const char* kIndexName = "index";
+const char* kSketchName = "index_lfu";
+const char* kContentName = "index_dedup";
 const int kMaxOldFolders = 100;
 
+// Maximum number of tasks used to check the index after a crash.
+const int kMaxIndexCheckWorkers = 8;
+
 // Seems like ~240 MB correspond to less than 50k entries for 99% of the people.
 // Note that the actual target is to keep the index table load factor under 55%
 // for most users.
@@ -354,6 +361,7 @@ BackendImpl::BackendImpl(const FilePath& path,
       disabled_(false),
       new_eviction_(false),
       first_timer_(true),
+      index_check_reported_(false),
       net_log_(net_log),
       done_(true, false),
       ALLOW_THIS_IN_INITIALIZER_LIST(factory_(this)),
@@ -380,6 +388,7 @@ BackendImpl::BackendImpl(const FilePath& path,
       disabled_(false),
       new_eviction_(false),
       first_timer_(true),
+      index_check_reported_(false),
       net_log_(net_log),
       done_(true, false),
       ALLOW_THIS_IN_INITIALIZER_LIST(factory_(this)),
@@ -481,13 +490,17 @@ int BackendImpl::SyncInit() {
   if (!data_->header.this_id)
     data_->header.this_id++;
 
-  if (data_->header.crash) {
+  bool previous_crash = data_->header.crash != 0;
+  if (previous_crash) {
     ReportError(ERR_PREVIOUS_CRASH);
   } else {
     ReportError(0);
     data_->header.crash = 1;
   }
 
+  if (user_flags_ & kBatchWrites)
+    block_files_.SetBatchWrites(true, (user_flags_ & kSyncWrites) != 0);
+
   if (!block_files_.Init(create_files))
     return net::ERR_FAILED;
 
@@ -501,6 +514,37 @@ int BackendImpl::SyncInit() {
   if (cache_type() == net::DISK_CACHE)
     SetFieldTrialInfo(GetSizeGroup());
 
+  if ((user_flags_ & kTinyLfu) ||
+      data_->header.experiment == EXPERIMENT_TINY_LFU_IN) {
+    sketch_.reset(new FrequencySketch());
+    if (!sketch_->Init(path_.AppendASCII(kSketchName), mask_ + 1)) {
+      // The cache works just fine without the admission policy.
+      sketch_.reset();
+    }
+  }
+
+  // Once some data is shared, we have to keep track of the shared files.
+  FilePath content_name = path_.AppendASCII(kContentName);
+  if (!read_only_ &&
+      ((user_flags_ & kDedup) || file_util::PathExists(content_name))) {
+    content_store_.reset(new ContentStore());
+    if (!content_store_->Init(content_name, mask_ + 1)) {
+      LOG(ERROR) << "Unable to share data between entries";
+      content_store_.reset();
+    } else if (previous_crash) {
+      // The reference counts are updated before saving the entries that use
+      // them, so they cannot be trusted after a crash. An entry that points to
+      // an unknown shared file never deletes it: we may leak a few files, but
+      // we'll not lose data that is still in use.
+      LOG(ERROR) << "Resetting the content table after a crash";
+      content_store_->Reset();
+    }
+  }
+
+  // Compressed streams can always be read, regardless of this policy.
+  if (!read_only_ && (user_flags_ & kCompression))
+    compression_policy_.reset(new CompressionPolicy());
+
   eviction_.Init(this);
 
   // stats_ and rankings_ may end up calling back to us so we better be enabled.
@@ -510,6 +554,20 @@ int BackendImpl::SyncInit() {
 
   disabled_ = !rankings_.Init(this, new_eviction_);
 
+  if (!disabled_ && (user_flags_ & kIndexFilter)) {
+    // The filter is never deleted (while the backend is alive) because it may
+    // be in use by the thread that owns this object.
+    if (!index_filter_.get())
+      index_filter_.reset(new IndexFilter());
+    index_filter_->Init(data_->table, mask_ + 1);
+  }
+
+  // The unit tests decide when to check the index.
+  if (!disabled_ && !read_only_ &&
+      ((previous_crash && !unit_test_) || (user_flags_ & kCheckIndex))) {
+    StartIndexCheck();
+  }
+
   return disabled_ ? net::ERR_FAILED : net::OK;
 }
 
@@ -517,6 +575,10 @@ void BackendImpl::CleanupCache() {
   Trace("Backend Cleanup");
   eviction_.Stop();
   timer_.Stop();
+  if (index_checker_) {
+    index_checker_->Stop();
+    index_checker_ = NULL;
+  }
 
   if (init_) {
     stats_.Store();
@@ -553,6 +615,10 @@ int BackendImpl::SyncOpenEntry(const std::string& key, Entry** entry) {
 int BackendImpl::SyncCreateEntry(const std::string& key, Entry** entry) {
   DCHECK(entry);
   *entry = CreateEntryImpl(key);
+
+  // The entry is now linked through the index (or we failed to create it).
+  if (index_filter_.get())
+    index_filter_->RemovePending(Hash(key));
   return (*entry) ? net::OK : net::ERR_FAILED;
 }
 
@@ -671,6 +737,9 @@ EntryImpl* BackendImpl::OpenEntryImpl(const std::string& key) {
   uint32 hash = Hash(key);
   Trace("Open hash 0x%x", hash);
 
+  if (index_checker_ && !index_check_reported_)
+    ReportIndexCheckProgress();
+
   bool error;
   EntryImpl* cache_entry = MatchEntry(key, hash, false, Addr(), &error);
   if (!cache_entry) {
@@ -768,8 +837,9 @@ EntryImpl* BackendImpl::CreateEntryImpl(const std::string& key) {
   // We are not failing the operation; let's add this to the map.
   open_entries_[entry_address.value()] = cache_entry;
 
-  // Save the entry.
-  block_files_.GetFile(entry_address)->Store(cache_entry->entry());
+  // Save the entry. The index and the lists are updated right away, so the
+  // entry cannot wait for a batched write.
+  block_files_.GetFile(entry_address)->StoreNow(cache_entry->entry());
   block_files_.GetFile(node_address)->Store(cache_entry->rankings());
   IncreaseNumEntries();
   entry_count_++;
@@ -778,7 +848,7 @@ EntryImpl* BackendImpl::CreateEntryImpl(const std::string& key) {
   if (parent.get()) {
     parent->SetNextAddress(entry_address);
   } else {
-    data_->table[hash & mask_] = entry_address.value();
+    SetIndexSlot(hash, entry_address.value());
   }
 
   // Link this entry through the lists.
@@ -906,7 +976,7 @@ void BackendImpl::RecoveredEntry(CacheRankingsBlock* rankings) {
   if (data_->table[hash & mask_])
     return;
 
-  data_->table[hash & mask_] = address.value();
+  SetIndexSlot(hash, address.value());
 }
 
 void BackendImpl::InternalDoomEntry(EntryImpl* entry) {
@@ -933,7 +1003,7 @@ void BackendImpl::InternalDoomEntry(EntryImpl* entry) {
     parent_entry->SetNextAddress(Addr(child));
     parent_entry->Release();
   } else if (!error) {
-    data_->table[hash & mask_] = child;
+    SetIndexSlot(hash, child);
   }
 }
 
@@ -1144,11 +1214,27 @@ void BackendImpl::OnWrite(int32 bytes) {
   OnRead(bytes);
 }
 
+void BackendImpl::OnCompression(int input_bytes, int output_bytes) {
+  DCHECK_GE(input_bytes, output_bytes);
+  stats_.SetCounter(Stats::COMPRESS_INPUT,
+                    stats_.GetCounter(Stats::COMPRESS_INPUT) + input_bytes);
+  stats_.SetCounter(Stats::COMPRESS_OUTPUT,
+                    stats_.GetCounter(Stats::COMPRESS_OUTPUT) + output_bytes);
+}
+
 void BackendImpl::OnStatsTimer() {
   stats_.OnEvent(Stats::TIMER);
   int64 time = stats_.GetCounter(Stats::TIMER);
   int64 current = stats_.GetCounter(Stats::OPEN_ENTRIES);
 
+  if (index_filter_.get()) {
+    // Misses resolved by the filter never reached the cache thread.
+    int fast_misses = index_filter_->GetAndResetFastMisses();
+    stats_.SetCounter(Stats::OPEN_MISS,
+                      stats_.GetCounter(Stats::OPEN_MISS) + fast_misses);
+    CACHE_UMA(COUNTS_10000, "FastMissRate", 0, fast_misses);
+  }
+
   // OPEN_ENTRIES is a sampled average of the number of open entries, avoiding
   // the bias towards 0.
   if (num_refs_ && (current != num_refs_)) {
@@ -1180,6 +1266,37 @@ void BackendImpl::OnStatsTimer() {
     stats_.Store();
 }
 
+void BackendImpl::OnIndexChecked() {
+  // This may be the notification from a checker that was already discarded.
+  if (!index_checker_ || !index_checker_->done())
+    return;
+
+  scoped_refptr<IndexChecker> checker;
+  checker.swap(index_checker_);
+  if (disabled_ || checker->table_len() != static_cast<int>(mask_ + 1))
+    return;
+
+  // Go through the damaged buckets with the regular lookup code, which takes
+  // care of removing any entry that cannot be trusted.
+  int32 num_entries = data_->header.num_entries;
+  for (int i = 0; i < checker->table_len() && !disabled_; i++) {
+    if (checker->GetBucketState(i) != IndexChecker::BUCKET_DAMAGED)
+      continue;
+    bool error;
+    scoped_refptr<EntryImpl> cache_entry;
+    EntryImpl* tmp = MatchEntry(std::string(), i, false, Addr(), &error);
+    cache_entry.swap(&tmp);
+    DCHECK(!cache_entry);
+  }
+
+  Trace("Index check done, %d damaged buckets", checker->num_damaged());
+  CACHE_UMA(AGE_MS, "IndexCheckTime", 0, index_check_start_);
+  CACHE_UMA(COUNTS_10000, "IndexCheckDamagedBuckets", 0,
+            checker->num_damaged());
+  CACHE_UMA(COUNTS_10000, "IndexCheckRemovedEntries", 0,
+            num_entries - data_->header.num_entries);
+}
+
 void BackendImpl::IncrementIoCount() {
   num_pending_io_++;
 }
@@ -1231,6 +1348,13 @@ void BackendImpl::TrimDeletedListForTest(bool empty) {
   eviction_.TrimDeletedList(empty);
 }
 
+void BackendImpl::WaitForIndexCheckForTest() {
+  if (!index_checker_)
+    return;
+  index_checker_->WaitForCompletion();
+  OnIndexChecked();
+}
+
 int BackendImpl::SelfCheck() {
   if (!init_) {
     LOG(ERROR) << "Init failed";
@@ -1271,6 +1395,11 @@ int32 BackendImpl::GetEntryCount() const {
 int BackendImpl::OpenEntry(const std::string& key, Entry** entry,
                            CompletionCallback* callback) {
   DCHECK(callback);
+  if (IsKnownMiss(key)) {
+    index_filter_->OnFastMiss();
+    return net::ERR_FAILED;
+  }
+
   background_queue_.OpenEntry(key, entry, callback);
   return net::ERR_IO_PENDING;
 }
@@ -1278,6 +1407,11 @@ int BackendImpl::OpenEntry(const std::string& key, Entry** entry,
 int BackendImpl::CreateEntry(const std::string& key, Entry** entry,
                              CompletionCallback* callback) {
   DCHECK(callback);
+  // Make sure that nobody gets a miss for this key while the operation is in
+  // flight. The cache thread will remove the pending mark.
+  if (index_filter_.get())
+    index_filter_->AddPending(Hash(key));
+
   background_queue_.CreateEntry(key, entry, callback);
   return net::ERR_IO_PENDING;
 }
@@ -1285,6 +1419,9 @@ int BackendImpl::CreateEntry(const std::string& key, Entry** entry,
 int BackendImpl::DoomEntry(const std::string& key,
                            CompletionCallback* callback) {
   DCHECK(callback);
+  if (IsKnownMiss(key))
+    return net::ERR_FAILED;
+
   background_queue_.DoomEntry(key, callback);
   return net::ERR_IO_PENDING;
 }
@@ -1344,6 +1481,26 @@ void BackendImpl::GetStats(StatsItems* stats) {
   item.second = base::StringPrintf("%d", data_->header.num_bytes);
   stats->push_back(item);
 
+  int64 block_writes, block_bytes;
+  block_files_.GetWriteStats(&block_writes, &block_bytes);
+  item.first = "Block writes";
+  item.second = base::Int64ToString(block_writes);
+  stats->push_back(item);
+
+  item.first = "Block bytes written";
+  item.second = base::Int64ToString(block_bytes);
+  stats->push_back(item);
+
+  if (content_store_.get()) {
+    item.first = "Shared bytes";
+    item.second = base::Int64ToString(content_store_->stored_bytes());
+    stats->push_back(item);
+
+    item.first = "Dedup saved bytes";
+    item.second = base::Int64ToString(content_store_->saved_bytes());
+    stats->push_back(item);
+  }
+
   stats_.GetItems(stats);
 }
 
@@ -1480,6 +1637,9 @@ void BackendImpl::PrepareForRestart() {
   if (!(user_flags_ & kMask))
     mask_ = 0;
 
+  if (index_filter_.get())
+    index_filter_->Disable();
+
   if (!(user_flags_ & kNewEviction))
     new_eviction_ = false;
 
@@ -1491,6 +1651,13 @@ void BackendImpl::PrepareForRestart() {
 #ifdef ANDROID
   }
 #endif
+  sketch_.reset();
+  content_store_.reset();
+  compression_policy_.reset();
+  if (index_checker_) {
+    index_checker_->Stop();
+    index_checker_ = NULL;
+  }
   index_ = NULL;
   data_ = NULL;
   block_files_.CloseFiles();
@@ -1568,6 +1735,20 @@ int BackendImpl::NewEntry(Addr address, EntryImpl** entry) {
   return 0;
 }
 
+void BackendImpl::SetIndexSlot(uint32 hash, CacheAddr value) {
+  CacheAddr* slot = &data_->table[hash & mask_];
+  if (index_filter_.get())
+    index_filter_->UpdateSlot(hash, *slot, value);
+  *slot = value;
+}
+
+bool BackendImpl::IsKnownMiss(const std::string& key) {
+  if (!index_filter_.get())
+    return false;
+
+  return !index_filter_->MayContain(Hash(key));
+}
+
 EntryImpl* BackendImpl::MatchEntry(const std::string& key, uint32 hash,
                                    bool find_parent, Addr entry_addr,
                                    bool* match_error) {
@@ -1611,7 +1792,7 @@ EntryImpl* BackendImpl::MatchEntry(const std::string& key, uint32 hash,
         parent_entry->SetNextAddress(child);
         parent_entry = NULL;
       } else {
-        data_->table[hash & mask_] = child.value();
+        SetIndexSlot(hash, child.value());
       }
 
       Trace("MatchEntry dirty %d 0x%x 0x%x", find_parent, entry_addr.value(),
@@ -1947,6 +2128,23 @@ void BackendImpl::ReportStats() {
   CACHE_UMA(HOURS, "UseTime", 0, static_cast<int>(use_hours));
   CACHE_UMA(PERCENTAGE, "HitRatio", data_->header.experiment,
             stats_.GetHitRatio());
+  if (sketch_.get()) {
+    CACHE_UMA(PERCENTAGE, "KeptHitRatio", data_->header.experiment,
+              stats_.GetKeptHitRatio());
+  }
+  if (content_store_.get()) {
+    CACHE_UMA(PERCENTAGE, "DedupRatio", 0, stats_.GetDedupRatio());
+    int64 total = content_store_->stored_bytes() +
+                  content_store_->saved_bytes();
+    if (total) {
+      CACHE_UMA(PERCENTAGE, "DedupSavedBytes", 0,
+                static_cast<int>(content_store_->saved_bytes() * 100 / total));
+    }
+  }
+  if (compression_policy_.get()) {
+    CACHE_UMA(PERCENTAGE, "CompressionRatio", 0,
+              stats_.GetCompressionRatio());
+  }
 
   int64 trim_rate = stats_.GetCounter(Stats::TRIM_ENTRY) / use_hours;
   CACHE_UMA(COUNTS, "TrimRate", 0, static_cast<int>(trim_rate));
@@ -2051,6 +2249,31 @@ bool BackendImpl::CheckIndex() {
   return index_->Read(buf.get(), current_size, 0);
 }
 
+void BackendImpl::StartIndexCheck() {
+  DCHECK(!index_checker_);
+  index_check_start_ = TimeTicks::Now();
+  index_check_reported_ = false;
+
+  // Entries currently in use by this instance are marked with the current id,
+  // so this has to be called after updating it.
+  index_checker_ = new IndexChecker(path_, data_->table, mask_ + 1,
+                                    GetCurrentEntryId());
+  int num_workers = std::min(base::SysInfo::NumberOfProcessors(),
+                             kMaxIndexCheckWorkers);
+  index_checker_->Start(std::max(num_workers, 1),
+                        base::MessageLoopProxy::CreateForCurrentThread(),
+                        factory_.NewRunnableMethod(
+                            &BackendImpl::OnIndexChecked));
+}
+
+void BackendImpl::ReportIndexCheckProgress() {
+  index_check_reported_ = true;
+  int progress = static_cast<int>(
+      static_cast<int64>(index_checker_->num_checked()) * 100 /
+      index_checker_->table_len());
+  CACHE_UMA(PERCENTAGE, "IndexCheckProgress", 0, progress);
+}
+
 int BackendImpl::CheckAllEntries() {
   int num_dirty = 0;
   int num_entries = 0;
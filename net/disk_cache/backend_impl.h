@@ -10,11 +10,17 @@
 
 #include "base/file_path.h"
 #include "base/hash_tables.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/timer.h"
 #include "net/disk_cache/block_files.h"
+#include "net/disk_cache/compression.h"
+#include "net/disk_cache/content_store.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/eviction.h"
+#include "net/disk_cache/frequency_sketch.h"
 #include "net/disk_cache/in_flight_backend_io.h"
+#include "net/disk_cache/index_checker.h"
+#include "net/disk_cache/index_filter.h"
 #include "net/disk_cache/rankings.h"
 #include "net/disk_cache/stats.h"
 #include "net/disk_cache/trace.h"
@@ -34,7 +40,14 @@ enum BackendFlags {
   kNewEviction = 1 << 4,        // Use of new eviction was specified.
   kNoRandom = 1 << 5,           // Don't add randomness to the behavior.
   kNoLoadProtection = 1 << 6,   // Don't act conservatively under load.
-  kNoBuffering = 1 << 7         // Disable extended IO buffering.
+  kNoBuffering = 1 << 7,        // Disable extended IO buffering.
+  kIndexFilter = 1 << 8,        // Resolve known misses on the caller thread.
+  kBatchWrites = 1 << 9,        // Write modified blocks once per task.
+  kSyncWrites = 1 << 10,        // Flush batched writes all the way to disk.
+  kTinyLfu = 1 << 11,           // Use access frequency to protect entries.
+  kCheckIndex = 1 << 12,        // Validate all entries in the background.
+  kDedup = 1 << 13,             // Share the files of identical streams.
+  kCompression = 1 << 14        // Compress the data streams.
 };
 
 // This class implements the Backend interface. An object of this
@@ -105,6 +118,18 @@ class BackendImpl : public Backend {
   // Creates an external storage file.
   bool CreateExternalFile(Addr* address);
 
+  // Returns the object that tracks shared external files, or NULL if data is
+  // not shared by this cache.
+  ContentStore* content_store() {
+    return content_store_.get();
+  }
+
+  // Returns the policy that decides which streams are compressed, or NULL if
+  // new data is not compressed by this cache.
+  const CompressionPolicy* compression_policy() const {
+    return compression_policy_.get();
+  }
+
   // Creates a new storage block of size block_count.
   bool CreateBlock(FileType block_type, int block_count,
                    Addr* block_address);
@@ -205,9 +230,15 @@ class BackendImpl : public Backend {
   void OnRead(int bytes);
   void OnWrite(int bytes);
 
+  // Keeps track of the size of a data stream before and after compression.
+  void OnCompression(int input_bytes, int output_bytes);
+
   // Timer callback to calculate usage statistics.
   void OnStatsTimer();
 
+  // Called when the background check of the index is done.
+  void OnIndexChecked();
+
   // Handles the pending asynchronous IO count.
   void IncrementIoCount();
   void DecrementIoCount();
@@ -242,6 +273,10 @@ class BackendImpl : public Backend {
   // entries. This method should be called directly on the cache thread.
   void TrimDeletedListForTest(bool empty);
 
+  // Waits until the background check of the index is done, and processes the
+  // result. This method should be called directly on the cache thread.
+  void WaitForIndexCheckForTest();
+
   // Peforms a simple self-check, and returns the number of dirty items
   // or an error code (negative value).
   int SelfCheck();
@@ -280,6 +315,14 @@ class BackendImpl : public Backend {
   // on failure.
   int NewEntry(Addr address, EntryImpl** entry);
 
+  // Stores |value| on the index table slot for |hash|. All modifications of
+  // the table should go through this method, to keep index_filter_ current.
+  void SetIndexSlot(uint32 hash, CacheAddr value);
+
+  // Returns true if there is no need to ask the cache thread about |key|,
+  // because the entry is not on the cache.
+  bool IsKnownMiss(const std::string& key);
+
   // Returns a given entry from the cache. The entry to match is determined by
   // key and hash, and the returned entry may be the matched one or it's parent
   // on the list of entries with the same hash (or bucket). To look for a parent
@@ -330,6 +373,12 @@ class BackendImpl : public Backend {
   // Performs basic checks on the index file. Returns false on failure.
   bool CheckIndex();
 
+  // Starts validating the entries on the worker pool, after a crash.
+  void StartIndexCheck();
+
+  // Records how much of the index was checked when the first request arrived.
+  void ReportIndexCheckProgress();
+
   // Part of the selt test. Returns the number or dirty entries, or an error.
   int CheckAllEntries();
 
@@ -343,6 +392,12 @@ class BackendImpl : public Backend {
   scoped_refptr<MappedFile> index_;  // The main cache index.
   FilePath path_;  // Path to the folder used as backing storage.
   Index* data_;  // Pointer to the index data.
+  scoped_ptr<IndexFilter> index_filter_;  // Summary of the index.
+  scoped_ptr<FrequencySketch> sketch_;  // Access frequency of the entries.
+  scoped_ptr<ContentStore> content_store_;  // Files shared by entries.
+  scoped_ptr<CompressionPolicy> compression_policy_;
+  scoped_refptr<IndexChecker> index_checker_;  // Check after a crash.
+  base::TimeTicks index_check_start_;
   BlockFiles block_files_;  // Set of files used to store all data.
   Rankings rankings_;  // Rankings to be able to trim the cache.
   uint32 mask_;  // Binary mask to map a hash to the hash table.
@@ -367,6 +422,7 @@ class BackendImpl : public Backend {
   bool new_eviction_;  // What eviction algorithm should be used.
   bool first_timer_;  // True if the timer has not been called.
   bool throttle_requests_;
+  bool index_check_reported_;  // Progress of the index check was reported.
 
   net::NetLog* net_log_;
 
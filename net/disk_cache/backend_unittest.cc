@@ -4,6 +4,7 @@
 
 #include "base/basictypes.h"
 #include "base/file_util.h"
+#include "base/string_number_conversions.h"
 #include "base/string_util.h"
 #include "base/stringprintf.h"
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
@@ -252,6 +253,575 @@ TEST_F(DiskCacheBackendTest, ExternalFiles) {
   EXPECT_EQ(0, memcmp(buffer1->data(), buffer2->data(), kSize));
 }
 
+// Tests that the index filter resolves misses without going to the cache
+// thread, and never hides an existing (or pending) entry.
+TEST_F(DiskCacheTest, IndexFilter) {
+  TestCompletionCallback cb;
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  disk_cache::Backend* cache;
+  int rv = disk_cache::BackendImpl::CreateBackend(
+               path, false, 0, net::DISK_CACHE,
+               disk_cache::kNoRandom | disk_cache::kIndexFilter,
+               cache_thread.message_loop_proxy(), NULL, &cache, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+
+  // An empty cache doesn't need the cache thread to report a miss.
+  disk_cache::Entry* entry;
+  EXPECT_EQ(net::ERR_FAILED, cache->OpenEntry("the first key", &entry, &cb));
+  EXPECT_EQ(net::ERR_FAILED, cache->DoomEntry("the first key", &cb));
+
+  // Don't wait for the creation to complete before opening the entry.
+  TestCompletionCallback cb2;
+  disk_cache::Entry* entry2;
+  rv = cache->CreateEntry("the first key", &entry, &cb);
+  int rv2 = cache->OpenEntry("the first key", &entry2, &cb2);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  ASSERT_EQ(net::OK, cb2.GetResult(rv2));
+  entry->Close();
+  entry2->Close();
+
+  rv = cache->OpenEntry("the first key", &entry, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  entry->Doom();
+  entry->Close();
+
+  rv = cache->OpenEntry("the first key", &entry, &cb);
+  EXPECT_NE(net::OK, cb.GetResult(rv));
+
+  // Misses on a cache with some entries should still work as before.
+  for (int i = 0; i < 50; i++) {
+    std::string key = base::StringPrintf("key %d", i);
+    rv = cache->CreateEntry(key, &entry, &cb);
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+    entry->Close();
+  }
+  for (int i = 0; i < 100; i++) {
+    std::string key = base::StringPrintf("key %d", i);
+    rv = cache->OpenEntry(key, &entry, &cb);
+    if (i < 50) {
+      ASSERT_EQ(net::OK, cb.GetResult(rv));
+      entry->Close();
+    } else {
+      EXPECT_NE(net::OK, cb.GetResult(rv));
+    }
+  }
+
+  delete cache;
+}
+
+// Tests that the data stored with batched writes survives a restart.
+TEST_F(DiskCacheTest, BatchWrites) {
+  TestCompletionCallback cb;
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  disk_cache::Backend* cache;
+  int rv = disk_cache::BackendImpl::CreateBackend(
+               path, false, 0, net::DISK_CACHE,
+               disk_cache::kNoRandom | disk_cache::kBatchWrites,
+               cache_thread.message_loop_proxy(), NULL, &cache, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+
+  const int kSize = 200;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer->data(), kSize, false);
+
+  disk_cache::Entry* entry;
+  for (int i = 0; i < 20; i++) {
+    std::string key = base::StringPrintf("key %d", i);
+    rv = cache->CreateEntry(key, &entry, &cb);
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+    rv = entry->WriteData(0, 0, buffer, kSize, &cb, false);
+    EXPECT_EQ(kSize, cb.GetResult(rv));
+    entry->Close();
+  }
+  delete cache;
+
+  rv = disk_cache::BackendImpl::CreateBackend(
+           path, false, 0, net::DISK_CACHE, disk_cache::kNoRandom,
+           cache_thread.message_loop_proxy(), NULL, &cache, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  EXPECT_EQ(20, cache->GetEntryCount());
+
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kSize));
+  for (int i = 0; i < 20; i++) {
+    std::string key = base::StringPrintf("key %d", i);
+    rv = cache->OpenEntry(key, &entry, &cb);
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+    EXPECT_EQ(key, entry->GetKey());
+    rv = entry->ReadData(0, 0, buffer2, kSize, &cb);
+    EXPECT_EQ(kSize, cb.GetResult(rv));
+    EXPECT_EQ(0, memcmp(buffer->data(), buffer2->data(), kSize));
+    entry->Close();
+  }
+
+  delete cache;
+}
+
+namespace {
+
+// Stores a set of popular entries on a cache created with the given |flags|,
+// followed by a scan of entries that are never used again, and returns the
+// number of popular entries that are still stored.
+int PopularEntriesAfterScan(const FilePath& path, uint32 flags) {
+  TestCompletionCallback cb;
+  EXPECT_TRUE(DeleteCache(path));
+  base::Thread cache_thread("CacheThread");
+  EXPECT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  const int kSize = 16 * 1024;
+  const int kNumPopular = 64;  // 1 MB.
+  const int kNumScan = 160;  // 2.5 MB.
+  disk_cache::Backend* cache;
+  int rv = disk_cache::BackendImpl::CreateBackend(
+               path, false, 3 * 1024 * 1024, net::DISK_CACHE,
+               disk_cache::kNoRandom | disk_cache::kNoLoadProtection | flags,
+               cache_thread.message_loop_proxy(), NULL, &cache, &cb);
+  rv = cb.GetResult(rv);
+  EXPECT_EQ(net::OK, rv);
+  if (rv != net::OK)
+    return -1;
+
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer->data(), kSize, false);
+
+  disk_cache::Entry* entry;
+  for (int i = 0; i < kNumPopular; i++) {
+    std::string key = base::StringPrintf("popular %d", i);
+    rv = cache->CreateEntry(key, &entry, &cb);
+    EXPECT_EQ(net::OK, cb.GetResult(rv));
+    rv = entry->WriteData(0, 0, buffer, kSize, &cb, false);
+    EXPECT_EQ(kSize, cb.GetResult(rv));
+    entry->Close();
+  }
+  for (int j = 0; j < 3; j++) {
+    for (int i = 0; i < kNumPopular; i++) {
+      std::string key = base::StringPrintf("popular %d", i);
+      rv = cache->OpenEntry(key, &entry, &cb);
+      EXPECT_EQ(net::OK, cb.GetResult(rv));
+      entry->Close();
+    }
+  }
+
+  for (int i = 0; i < kNumScan; i++) {
+    std::string key = base::StringPrintf("scan %d", i);
+    rv = cache->CreateEntry(key, &entry, &cb);
+    EXPECT_EQ(net::OK, cb.GetResult(rv));
+    rv = entry->WriteData(0, 0, buffer, kSize, &cb, false);
+    EXPECT_EQ(kSize, cb.GetResult(rv));
+    entry->Close();
+  }
+
+  int found = 0;
+  for (int i = 0; i < kNumPopular; i++) {
+    std::string key = base::StringPrintf("popular %d", i);
+    rv = cache->OpenEntry(key, &entry, &cb);
+    if (cb.GetResult(rv) == net::OK) {
+      found++;
+      entry->Close();
+    }
+  }
+  delete cache;
+  return found;
+}
+
+}  // namespace
+
+// Tests that a scan of entries that are not reused doesn't flush the popular
+// entries when the frequency based admission policy is enabled.
+TEST_F(DiskCacheTest, TinyLfuKeepsPopularEntries) {
+  FilePath path = GetCacheFilePath();
+  EXPECT_EQ(0, PopularEntriesAfterScan(path, 0));
+  EXPECT_EQ(64, PopularEntriesAfterScan(path, disk_cache::kTinyLfu));
+}
+
+namespace {
+
+class IndexCheckTask : public Task {
+ public:
+  explicit IndexCheckTask(disk_cache::BackendImpl* backend)
+      : backend_(backend) {}
+
+  virtual void Run() {
+    backend_->WaitForIndexCheckForTest();
+  }
+
+ private:
+  disk_cache::BackendImpl* backend_;
+};
+
+}  // namespace
+
+// Tests that the background check of the index removes the entries that were
+// in use when the cache crashed. We'll be leaking memory from this test.
+TEST_F(DiskCacheTest, IndexCheckAfterCrash) {
+  TestCompletionCallback cb;
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  disk_cache::BackendImpl* cache = new disk_cache::BackendImpl(
+      path, cache_thread.message_loop_proxy(), NULL);
+  cache->SetFlags(disk_cache::kNoRandom);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->Init(&cb)));
+
+  const int kNumEntries = 100;
+  const int kSize = 200;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer->data(), kSize, false);
+  for (int i = 0; i < kNumEntries; i++) {
+    std::string key = base::StringPrintf("key %d", i);
+    disk_cache::Entry* entry;
+    int rv = cache->CreateEntry(key, &entry, &cb);
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+    rv = entry->WriteData(0, 0, buffer, kSize, &cb, false);
+    EXPECT_EQ(kSize, cb.GetResult(rv));
+
+    // Leave one out of ten entries open.
+    if (i % 10)
+      entry->Close();
+  }
+
+  // Simulate a crash.
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  cache->ClearRefCountForTest();
+  delete cache;
+
+  cache = new disk_cache::BackendImpl(path, cache_thread.message_loop_proxy(),
+                                      NULL);
+  cache->SetFlags(disk_cache::kNoRandom | disk_cache::kCheckIndex);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->Init(&cb)));
+  int rv = cache->RunTaskForTest(new IndexCheckTask(cache), &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+
+  // The entries were removed without having to look for them.
+  EXPECT_EQ(kNumEntries * 9 / 10, cache->GetEntryCount());
+  for (int i = 0; i < kNumEntries; i++) {
+    std::string key = base::StringPrintf("key %d", i);
+    disk_cache::Entry* entry;
+    rv = cache->OpenEntry(key, &entry, &cb);
+    if (i % 10) {
+      ASSERT_EQ(net::OK, cb.GetResult(rv));
+      entry->Close();
+    } else {
+      EXPECT_NE(net::OK, cb.GetResult(rv));
+    }
+  }
+  delete cache;
+  EXPECT_TRUE(CheckCacheIntegrity(path, false));
+}
+
+namespace {
+
+// Stores |buffer| as the data stream of a new entry, with two writes.
+void StoreEntryData(disk_cache::Backend* cache, const std::string& key,
+                    net::IOBuffer* buffer, int size) {
+  TestCompletionCallback cb;
+  disk_cache::Entry* entry;
+  int rv = cache->CreateEntry(key, &entry, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  rv = entry->WriteData(1, 0, buffer, size / 2, &cb, false);
+  EXPECT_EQ(size / 2, cb.GetResult(rv));
+  scoped_refptr<net::IOBuffer> second_half(
+      new net::WrappedIOBuffer(buffer->data() + size / 2));
+  rv = entry->WriteData(1, size / 2, second_half, size - size / 2, &cb, false);
+  EXPECT_EQ(size - size / 2, cb.GetResult(rv));
+  entry->Close();
+}
+
+// Verifies that the data stream of the entry stored under |key| matches
+// |size| bytes from |buffer|.
+void CheckEntryData(disk_cache::Backend* cache, const std::string& key,
+                    net::IOBuffer* buffer, int size) {
+  TestCompletionCallback cb;
+  disk_cache::Entry* entry;
+  int rv = cache->OpenEntry(key, &entry, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(size));
+  rv = entry->ReadData(1, 0, buffer2, size, &cb);
+  EXPECT_EQ(size, cb.GetResult(rv));
+  EXPECT_EQ(0, memcmp(buffer->data(), buffer2->data(), size));
+  entry->Close();
+}
+
+int CountExternalFiles(const FilePath& path) {
+  file_util::FileEnumerator iter(path, false,
+                                 file_util::FileEnumerator::FILES,
+                                 FILE_PATH_LITERAL("f_*"));
+  int count = 0;
+  for (FilePath file = iter.Next(); !file.value().empty(); file = iter.Next())
+    count++;
+  return count;
+}
+
+std::string GetStatsItem(disk_cache::Backend* cache, const std::string& name) {
+  std::vector<std::pair<std::string, std::string> > stats;
+  cache->GetStats(&stats);
+  for (size_t i = 0; i < stats.size(); i++) {
+    if (stats[i].first == name)
+      return stats[i].second;
+  }
+  return std::string();
+}
+
+}  // namespace
+
+// Tests that entries with the same data share a single file.
+TEST_F(DiskCacheTest, Dedup) {
+  TestCompletionCallback cb;
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  disk_cache::BackendImpl* cache = new disk_cache::BackendImpl(
+      path, cache_thread.message_loop_proxy(), NULL);
+  cache->SetFlags(disk_cache::kNoRandom | disk_cache::kDedup);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->Init(&cb)));
+
+  const int kSize = 40000;
+  scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer1->data(), kSize, false);
+  CacheTestFillBuffer(buffer2->data(), kSize, false);
+
+  StoreEntryData(cache, "first", buffer1, kSize);
+  StoreEntryData(cache, "second", buffer1, kSize);
+  StoreEntryData(cache, "third", buffer1, kSize);
+  StoreEntryData(cache, "fourth", buffer2, kSize);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+
+  EXPECT_EQ(2, CountExternalFiles(path));
+  EXPECT_EQ("0x2", GetStatsItem(cache, "Dedup hit"));
+  EXPECT_EQ("0x2", GetStatsItem(cache, "Dedup miss"));
+  EXPECT_EQ(base::IntToString(kSize * 2), GetStatsItem(cache, "Shared bytes"));
+  EXPECT_EQ(base::IntToString(kSize * 2),
+            GetStatsItem(cache, "Dedup saved bytes"));
+
+  // Only one copy of the data is accounted for (plus 22 bytes of keys).
+  EXPECT_EQ(base::IntToString(kSize * 2 + 22),
+            GetStatsItem(cache, "Current size"));
+  CheckEntryData(cache, "second", buffer1, kSize);
+  CheckEntryData(cache, "fourth", buffer2, kSize);
+
+  // Modifying an entry doesn't change the others.
+  disk_cache::Entry* entry;
+  int rv = cache->OpenEntry("second", &entry, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  rv = entry->WriteData(1, kSize, buffer2, kSize, &cb, false);
+  EXPECT_EQ(kSize, cb.GetResult(rv));
+  entry->Close();
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(3, CountExternalFiles(path));
+  CheckEntryData(cache, "first", buffer1, kSize);
+  CheckEntryData(cache, "third", buffer1, kSize);
+
+  rv = cache->OpenEntry("second", &entry, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  scoped_refptr<net::IOBuffer> buffer3(new net::IOBuffer(kSize * 2));
+  rv = entry->ReadData(1, 0, buffer3, kSize * 2, &cb);
+  EXPECT_EQ(kSize * 2, cb.GetResult(rv));
+  EXPECT_EQ(0, memcmp(buffer1->data(), buffer3->data(), kSize));
+  EXPECT_EQ(0, memcmp(buffer2->data(), buffer3->data() + kSize, kSize));
+  entry->Close();
+
+  // The shared file goes away with the last entry.
+  ASSERT_EQ(net::OK, cb.GetResult(cache->DoomEntry("first", &cb)));
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(3, CountExternalFiles(path));
+  CheckEntryData(cache, "third", buffer1, kSize);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->DoomEntry("third", &cb)));
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(2, CountExternalFiles(path));
+  EXPECT_EQ(base::IntToString(kSize), GetStatsItem(cache, "Shared bytes"));
+  EXPECT_EQ("0", GetStatsItem(cache, "Dedup saved bytes"));
+
+  // Replacing the data of the last entry reuses its file.
+  rv = cache->OpenEntry("fourth", &entry, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  rv = entry->WriteData(1, 0, buffer1, kSize, &cb, true);
+  EXPECT_EQ(kSize, cb.GetResult(rv));
+  entry->Close();
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(2, CountExternalFiles(path));
+  EXPECT_EQ("0x2", GetStatsItem(cache, "Dedup hit"));
+  EXPECT_EQ("0x3", GetStatsItem(cache, "Dedup miss"));
+
+  EXPECT_EQ(2, cache->GetEntryCount());
+  delete cache;
+  EXPECT_TRUE(CheckCacheIntegrity(path, false));
+}
+
+// Tests that shared files are not deleted after a crash.
+TEST_F(DiskCacheTest, DedupAfterCrash) {
+  TestCompletionCallback cb;
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  disk_cache::BackendImpl* cache = new disk_cache::BackendImpl(
+      path, cache_thread.message_loop_proxy(), NULL);
+  cache->SetFlags(disk_cache::kNoRandom | disk_cache::kDedup);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->Init(&cb)));
+
+  const int kSize = 40000;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer->data(), kSize, false);
+  StoreEntryData(cache, "first", buffer, kSize);
+  StoreEntryData(cache, "second", buffer, kSize);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(1, CountExternalFiles(path));
+  delete cache;
+
+  // Pretend that the cache was not closed properly.
+  {
+    scoped_refptr<disk_cache::MappedFile> file(new disk_cache::MappedFile);
+    disk_cache::IndexHeader* header = static_cast<disk_cache::IndexHeader*>(
+        file->Init(path.AppendASCII("index"), 0));
+    ASSERT_TRUE(header);
+    header->crash = 1;
+  }
+
+  cache = new disk_cache::BackendImpl(path, cache_thread.message_loop_proxy(),
+                                      NULL);
+  cache->SetFlags(disk_cache::kNoRandom | disk_cache::kDedup);
+  cache->SetUnitTestMode();
+  ASSERT_EQ(net::OK, cb.GetResult(cache->Init(&cb)));
+  EXPECT_EQ("0", GetStatsItem(cache, "Shared bytes"));
+
+  // The reference count of the file is gone, so it stays around.
+  ASSERT_EQ(net::OK, cb.GetResult(cache->DoomEntry("first", &cb)));
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(1, CountExternalFiles(path));
+  CheckEntryData(cache, "second", buffer, kSize);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->DoomEntry("second", &cb)));
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(1, CountExternalFiles(path));
+
+  EXPECT_EQ(0, cache->GetEntryCount());
+  delete cache;
+}
+
+// Tests that the data of an entry is compressed transparently.
+TEST_F(DiskCacheTest, Compression) {
+  TestCompletionCallback cb;
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  disk_cache::BackendImpl* cache = new disk_cache::BackendImpl(
+      path, cache_thread.message_loop_proxy(), NULL);
+  cache->SetFlags(disk_cache::kNoRandom | disk_cache::kCompression);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->Init(&cb)));
+
+  const int kSize = 100000;
+  scoped_refptr<net::IOBuffer> text(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> binary(new net::IOBuffer(kSize));
+  CacheTestFillTextBuffer(text->data(), kSize);
+  CacheTestFillBuffer(binary->data(), kSize, false);
+
+  // Random data doesn't compress.
+  StoreEntryData(cache, "text", text, kSize);
+  StoreEntryData(cache, "binary", binary, kSize);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(2, CountExternalFiles(path));
+  EXPECT_EQ(base::StringPrintf("0x%x", kSize),
+            GetStatsItem(cache, "Compress input bytes"));
+
+  int current_size;
+  ASSERT_TRUE(base::StringToInt(GetStatsItem(cache, "Current size"),
+                                &current_size));
+  EXPECT_LT(current_size, kSize + kSize / 2);
+  EXPECT_GT(current_size, kSize);
+  CheckEntryData(cache, "text", text, kSize);
+  CheckEntryData(cache, "binary", binary, kSize);
+
+  // Reads that don't start at the beginning, or go backwards.
+  disk_cache::Entry* entry;
+  int rv = cache->OpenEntry("text", &entry, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  rv = entry->ReadData(1, kSize / 2, buffer, 1000, &cb);
+  EXPECT_EQ(1000, cb.GetResult(rv));
+  EXPECT_EQ(0, memcmp(text->data() + kSize / 2, buffer->data(), 1000));
+  rv = entry->ReadData(1, kSize / 2 + 1000, buffer, kSize, &cb);
+  EXPECT_EQ(kSize / 2 - 1000, cb.GetResult(rv));
+  EXPECT_EQ(0, memcmp(text->data() + kSize / 2 + 1000, buffer->data(),
+                      kSize / 2 - 1000));
+  rv = entry->ReadData(1, 100, buffer, 1000, &cb);
+  EXPECT_EQ(1000, cb.GetResult(rv));
+  EXPECT_EQ(0, memcmp(text->data() + 100, buffer->data(), 1000));
+
+  // The file doesn't hold the actual data.
+  base::PlatformFile file;
+  int64 offset;
+  rv = entry->GetDataFile(1, &file, &offset, &cb);
+  EXPECT_EQ(net::ERR_FAILED, cb.GetResult(rv));
+
+  // Modifying the data restores the original file.
+  rv = entry->WriteData(1, kSize, binary, 1000, &cb, false);
+  EXPECT_EQ(1000, cb.GetResult(rv));
+  entry->Close();
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(2, CountExternalFiles(path));
+
+  rv = cache->OpenEntry("text", &entry, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  rv = entry->ReadData(1, 0, buffer, kSize, &cb);
+  EXPECT_EQ(kSize, cb.GetResult(rv));
+  EXPECT_EQ(0, memcmp(text->data(), buffer->data(), kSize));
+  rv = entry->ReadData(1, kSize, buffer, kSize, &cb);
+  EXPECT_EQ(1000, cb.GetResult(rv));
+  EXPECT_EQ(0, memcmp(binary->data(), buffer->data(), 1000));
+  entry->Close();
+
+  // Replacing the data compresses it again.
+  rv = cache->OpenEntry("text", &entry, &cb);
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  rv = entry->WriteData(1, 0, text, kSize, &cb, true);
+  EXPECT_EQ(kSize, cb.GetResult(rv));
+  entry->Close();
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(base::StringPrintf("0x%x", kSize * 2),
+            GetStatsItem(cache, "Compress input bytes"));
+  CheckEntryData(cache, "text", text, kSize);
+
+  // Dooming the entry gets rid of the compressed file.
+  ASSERT_EQ(net::OK, cb.GetResult(cache->DoomEntry("text", &cb)));
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(1, CountExternalFiles(path));
+  EXPECT_EQ(base::IntToString(kSize + 6), GetStatsItem(cache, "Current size"));
+
+  // Big streams are not compressed.
+  const int kBigSize = 1024 * 1024;
+  scoped_refptr<net::IOBuffer> big_text(new net::IOBuffer(kBigSize));
+  CacheTestFillTextBuffer(big_text->data(), kBigSize);
+  StoreEntryData(cache, "big", big_text, kBigSize);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+  EXPECT_EQ(base::StringPrintf("0x%x", kSize * 2),
+            GetStatsItem(cache, "Compress input bytes"));
+  CheckEntryData(cache, "big", big_text, kBigSize);
+
+  delete cache;
+  EXPECT_TRUE(CheckCacheIntegrity(path, false));
+}
+
 // Tests that we deal with file-level pending operations at destruction time.
 TEST_F(DiskCacheTest, ShutdownWithPendingIO) {
   TestCompletionCallback cb;
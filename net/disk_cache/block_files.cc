@@ -187,7 +187,8 @@ bool NeedToGrowBlockFile(const disk_cache::BlockFileHeader* header,
 namespace disk_cache {
 
 BlockFiles::BlockFiles(const FilePath& path)
-    : init_(false), zero_buffer_(NULL), path_(path) {
+    : init_(false), batch_writes_(false), sync_writes_(false),
+      zero_buffer_(NULL), path_(path) {
 }
 
 BlockFiles::~BlockFiles() {
@@ -290,6 +291,10 @@ void BlockFiles::DeleteBlock(Addr address, bool deep) {
   size_t size = address.BlockSize() * address.num_blocks();
   size_t offset = address.start_block() * address.BlockSize() +
                   kBlockHeaderSize;
+
+  // Any buffered store for this block is now stale, and it would overwrite the
+  // next user of the block.
+  file->DropPendingWrites(offset, size);
   if (deep)
     file->Write(zero_buffer_, size, offset);
 
@@ -312,6 +317,7 @@ void BlockFiles::CloseFiles() {
   init_ = false;
   for (unsigned int i = 0; i < block_files_.size(); i++) {
     if (block_files_[i]) {
+      block_files_[i]->Flush();
       block_files_[i]->Release();
       block_files_[i] = NULL;
     }
@@ -319,6 +325,39 @@ void BlockFiles::CloseFiles() {
   block_files_.clear();
 }
 
+void BlockFiles::SetBatchWrites(bool batch, bool sync) {
+  batch_writes_ = batch;
+  sync_writes_ = sync;
+  for (unsigned int i = 0; i < block_files_.size(); i++) {
+    MappedFile* file = block_files_[i];
+    if (!file)
+      continue;
+    BlockFileHeader* header =
+        reinterpret_cast<BlockFileHeader*>(file->buffer());
+    if (Addr::BlockSizeForFileType(RANKINGS) != header->entry_size)
+      file->SetBatchWrites(batch, sync);
+  }
+}
+
+void BlockFiles::FlushWrites() {
+  DCHECK(thread_checker_->CalledOnValidThread());
+  for (unsigned int i = 0; i < block_files_.size(); i++) {
+    if (block_files_[i])
+      block_files_[i]->Flush();
+  }
+}
+
+void BlockFiles::GetWriteStats(int64* num_writes, int64* num_bytes) {
+  *num_writes = 0;
+  *num_bytes = 0;
+  for (unsigned int i = 0; i < block_files_.size(); i++) {
+    if (block_files_[i]) {
+      *num_writes += block_files_[i]->num_block_writes();
+      *num_bytes += block_files_[i]->block_bytes_written();
+    }
+  }
+}
+
 void BlockFiles::ReportStats() {
   DCHECK(thread_checker_->CalledOnValidThread());
   int used_blocks[kFirstAdditionalBlockFile];
@@ -432,6 +471,13 @@ bool BlockFiles::OpenBlockFile(int index) {
       return false;
   }
 
+  // The rankings list relies on the order of the writes (and the state of the
+  // list header) to survive a crash, so only other blocks can be buffered.
+  if (batch_writes_ &&
+      Addr::BlockSizeForFileType(RANKINGS) != header->entry_size) {
+    file->SetBatchWrites(true, sync_writes_);
+  }
+
   DCHECK(!block_files_[index]);
   file.swap(&block_files_[index]);
   return true;
@@ -49,6 +49,18 @@ class BlockFiles {
   // cache is being purged.
   void CloseFiles();
 
+  // Enables or disables buffering the stores of entries (and other blocks that
+  // are not part of the rankings list) for a short time, so that they can be
+  // written in file order with as few IO operations as possible. See
+  // MappedFile::SetBatchWrites() for the meaning of |sync|.
+  void SetBatchWrites(bool batch, bool sync);
+
+  // Writes to disk any buffered store.
+  void FlushWrites();
+
+  // Returns the number of IO operations and bytes used to store blocks so far.
+  void GetWriteStats(int64* num_writes, int64* num_bytes);
+
   // Sends UMA stats.
   void ReportStats();
 
@@ -86,6 +98,8 @@ class BlockFiles {
   FilePath Name(int index);
 
   bool init_;
+  bool batch_writes_;
+  bool sync_writes_;
   char* zero_buffer_;  // Buffer to speed-up cleaning deleted entries.
   FilePath path_;  // Path to the backing folder.
   std::vector<MappedFile*> block_files_;  // The actual files.
@@ -7,6 +7,8 @@
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/disk_cache_test_base.h"
 #include "net/disk_cache/disk_cache_test_util.h"
+#include "net/disk_cache/storage_block.h"
+#include "net/disk_cache/storage_block-inl.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 using base::Time;
@@ -249,6 +251,107 @@ TEST_F(DiskCacheTest, BlockFiles_Stats) {
   EXPECT_EQ(0, load);
 }
 
+// Tests that stores are buffered and merged when batching writes.
+TEST_F(DiskCacheTest, BlockFiles_BatchWrites) {
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  ASSERT_TRUE(file_util::CreateDirectory(path));
+
+  BlockFiles files(path);
+  files.SetBatchWrites(true, false);
+  ASSERT_TRUE(files.Init(true));
+
+  const int kNumEntries = 4;
+  Addr address[kNumEntries];
+  for (int i = 0; i < kNumEntries; i++) {
+    ASSERT_TRUE(files.CreateBlock(BLOCK_256, 1, &address[i]));
+    if (i)
+      ASSERT_EQ(address[i - 1].start_block() + 1, address[i].start_block());
+
+    CacheEntryBlock entry(files.GetFile(address[i]), address[i]);
+    entry.Data()->hash = i + 1;
+    EXPECT_TRUE(entry.Store());
+  }
+
+  int64 num_writes, num_bytes;
+  files.GetWriteStats(&num_writes, &num_bytes);
+  EXPECT_EQ(0, num_writes);
+
+  // The buffered data is visible before reaching the disk.
+  MappedFile* file = files.GetFile(address[2]);
+  CacheEntryBlock entry(file, address[2]);
+  ASSERT_TRUE(entry.Load());
+  EXPECT_EQ(3U, entry.Data()->hash);
+
+  // All the blocks are written at once.
+  files.FlushWrites();
+  files.GetWriteStats(&num_writes, &num_bytes);
+  EXPECT_EQ(1, num_writes);
+  EXPECT_EQ(kNumEntries * 256, num_bytes);
+
+  EntryStore data;
+  size_t offset = address[1].start_block() * 256 + kBlockHeaderSize;
+  ASSERT_TRUE(file->Read(&data, sizeof(data), offset));
+  EXPECT_EQ(2U, data.hash);
+
+  // Deleting a block discards the buffered stores for it.
+  entry.Data()->hash = 10;
+  EXPECT_TRUE(entry.Store());
+  files.DeleteBlock(address[2], false);
+  files.FlushWrites();
+  files.GetWriteStats(&num_writes, &num_bytes);
+  EXPECT_EQ(1, num_writes);
+
+  offset = address[2].start_block() * 256 + kBlockHeaderSize;
+  ASSERT_TRUE(file->Read(&data, sizeof(data), offset));
+  EXPECT_EQ(3U, data.hash);
+
+  // Rankings nodes are not buffered.
+  Addr node_address;
+  ASSERT_TRUE(files.CreateBlock(RANKINGS, 1, &node_address));
+  CacheRankingsBlock node(files.GetFile(node_address), node_address);
+  node.Data()->contents = 0x1234;
+  EXPECT_TRUE(node.Store());
+  files.GetWriteStats(&num_writes, &num_bytes);
+  EXPECT_EQ(2, num_writes);
+}
+
+// Tests that a block can bypass the buffered stores.
+TEST_F(DiskCacheTest, BlockFiles_StoreNow) {
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  ASSERT_TRUE(file_util::CreateDirectory(path));
+
+  BlockFiles files(path);
+  files.SetBatchWrites(true, false);
+  ASSERT_TRUE(files.Init(true));
+
+  Addr address;
+  ASSERT_TRUE(files.CreateBlock(BLOCK_256, 1, &address));
+  MappedFile* file = files.GetFile(address);
+  CacheEntryBlock entry(file, address);
+  entry.Data()->hash = 1;
+  EXPECT_TRUE(entry.Store());
+
+  // The block reaches the disk without waiting for a flush, and the buffered
+  // store is not written later on top of it.
+  entry.Data()->hash = 2;
+  EXPECT_TRUE(file->StoreNow(&entry));
+
+  int64 num_writes, num_bytes;
+  files.GetWriteStats(&num_writes, &num_bytes);
+  EXPECT_EQ(1, num_writes);
+
+  EntryStore data;
+  size_t offset = address.start_block() * 256 + kBlockHeaderSize;
+  ASSERT_TRUE(file->Read(&data, sizeof(data), offset));
+  EXPECT_EQ(2U, data.hash);
+
+  files.FlushWrites();
+  files.GetWriteStats(&num_writes, &num_bytes);
+  EXPECT_EQ(1, num_writes);
+}
+
 // Tests that we add and remove blocks correctly.
 TEST_F(DiskCacheTest, AllocationMap) {
   FilePath path = GetCacheFilePath();
@@ -0,0 +1,203 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/compression.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(USE_SYSTEM_ZLIB)
+#include <zlib.h>
+#else
+#include "third_party/zlib/zlib.h"
+#endif
+
+#include "base/logging.h"
+
+namespace {
+
+// Good enough for text, while keeping the cost low.
+const int kCompressionLevel = 6;
+
+// Number of bytes inspected to decide if the data is text.
+const int kTextProbeSize = 512;
+
+struct Signature {
+  int offset;
+  int len;
+  const char* bytes;
+};
+
+// Formats that don't benefit from another round of compression.
+const Signature kCompressedFormats[] = {
+  { 0, 2, "\x1f\x8b" },              // gzip.
+  { 0, 8, "\x89PNG\r\n\x1a\n" },     // PNG.
+  { 0, 3, "\xff\xd8\xff" },          // JPEG.
+  { 0, 4, "GIF8" },                  // GIF.
+  { 0, 4, "PK\x03\x04" },            // zip, jar, docx, etc.
+  { 8, 4, "WEBP" },                  // WebP (RIFF container).
+  { 0, 4, "wOFF" },                  // WOFF.
+  { 0, 4, "wOF2" },                  // WOFF2.
+  { 0, 3, "BZh" },                   // bzip2.
+  { 0, 6, "7z\xbc\xaf\x27\x1c" },    // 7-Zip.
+  { 0, 6, "\xfd" "7zXZ\0" },         // xz.
+  { 0, 3, "ID3" },                   // MP3.
+  { 0, 4, "OggS" },                  // Ogg.
+  { 4, 4, "ftyp" },                  // MP4, QuickTime.
+  { 0, 4, "\x1a\x45\xdf\xa3" },      // Matroska, WebM.
+  { 0, 3, "FWS" },                   // Flash.
+  { 0, 3, "CWS" },                   // Compressed Flash.
+};
+
+bool IsTextByte(unsigned char value) {
+  if (value >= 0x20)
+    return value != 0x7f;
+  return value == '\t' || value == '\n' || value == '\r' || value == '\f';
+}
+
+class ZlibCodec : public disk_cache::Codec {
+ public:
+  explicit ZlibCodec(bool compress);
+  virtual ~ZlibCodec();
+
+  bool Init();
+
+  // Codec interface.
+  virtual bool Process(const char* input, int* input_len, char* output,
+                       int* output_len, bool finish);
+  virtual bool done() const { return done_; }
+
+ private:
+  z_stream stream_;
+  bool compress_;
+  bool initialized_;
+  bool done_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZlibCodec);
+};
+
+ZlibCodec::ZlibCodec(bool compress)
+    : compress_(compress), initialized_(false), done_(false) {
+  memset(&stream_, 0, sizeof(stream_));
+}
+
+ZlibCodec::~ZlibCodec() {
+  if (!initialized_)
+    return;
+  if (compress_)
+    deflateEnd(&stream_);
+  else
+    inflateEnd(&stream_);
+}
+
+bool ZlibCodec::Init() {
+  // Use a raw stream: the cache keeps track of the size of the data, and the
+  // checksum of a zlib stream would not buy us much.
+  int rv;
+  if (compress_) {
+    rv = deflateInit2(&stream_, kCompressionLevel, Z_DEFLATED, -MAX_WBITS,
+                      8, Z_DEFAULT_STRATEGY);
+  } else {
+    rv = inflateInit2(&stream_, -MAX_WBITS);
+  }
+  initialized_ = (rv == Z_OK);
+  return initialized_;
+}
+
+bool ZlibCodec::Process(const char* input, int* input_len, char* output,
+                        int* output_len, bool finish) {
+  DCHECK(initialized_);
+  if (done_) {
+    *input_len = 0;
+    *output_len = 0;
+    return true;
+  }
+
+  stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+  stream_.avail_in = *input_len;
+  stream_.next_out = reinterpret_cast<Bytef*>(output);
+  stream_.avail_out = *output_len;
+
+  int rv;
+  if (compress_)
+    rv = deflate(&stream_, finish ? Z_FINISH : Z_NO_FLUSH);
+  else
+    rv = inflate(&stream_, Z_NO_FLUSH);
+
+  *input_len -= stream_.avail_in;
+  *output_len -= stream_.avail_out;
+
+  if (rv == Z_STREAM_END) {
+    done_ = true;
+    return true;
+  }
+
+  // Z_BUF_ERROR just means that no progress was possible.
+  if (rv != Z_OK && rv != Z_BUF_ERROR)
+    return false;
+
+  // A truncated stream is an error.
+  if (!compress_ && finish && !*input_len && !*output_len)
+    return false;
+
+  return true;
+}
+
+}  // namespace
+
+namespace disk_cache {
+
+// static
+Codec* Codec::Create(CodecType type, bool compress) {
+  switch (type) {
+    case CODEC_ZLIB: {
+      ZlibCodec* codec = new ZlibCodec(compress);
+      if (!codec->Init()) {
+        delete codec;
+        return NULL;
+      }
+      return codec;
+    }
+    default:
+      return NULL;
+  }
+}
+
+CompressionPolicy::CompressionPolicy() {
+  codecs_[CONTENT_TEXT] = CODEC_ZLIB;
+  codecs_[CONTENT_BINARY] = CODEC_ZLIB;
+  codecs_[CONTENT_COMPRESSED] = CODEC_NONE;
+}
+
+void CompressionPolicy::SetCodec(ContentType type, CodecType codec) {
+  DCHECK(type >= 0 && type < CONTENT_MAX);
+  DCHECK(codec >= 0 && codec < CODEC_MAX);
+  codecs_[type] = codec;
+}
+
+CodecType CompressionPolicy::GetCodec(const char* data, int len) const {
+  return codecs_[GetContentType(data, len)];
+}
+
+// static
+ContentType CompressionPolicy::GetContentType(const char* data, int len) {
+  for (size_t i = 0; i < arraysize(kCompressedFormats); i++) {
+    const Signature& signature = kCompressedFormats[i];
+    if (len >= signature.offset + signature.len &&
+        !memcmp(data + signature.offset, signature.bytes, signature.len)) {
+      return CONTENT_COMPRESSED;
+    }
+  }
+
+  // Bytes above 0x7f are accepted as text, so that utf-8 is not penalized.
+  int probe = std::min(len, kTextProbeSize);
+  for (int i = 0; i < probe; i++) {
+    if (!IsTextByte(static_cast<unsigned char>(data[i])))
+      return CONTENT_BINARY;
+  }
+  return CONTENT_TEXT;
+}
+
+}  // namespace disk_cache
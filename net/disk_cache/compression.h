@@ -0,0 +1,76 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface of the cache.
+
+#ifndef NET_DISK_CACHE_COMPRESSION_H_
+#define NET_DISK_CACHE_COMPRESSION_H_
+#pragma once
+
+#include "base/basictypes.h"
+
+namespace disk_cache {
+
+// Identifies the format of compressed data. These values are stored on disk,
+// so they should not be reused.
+enum CodecType {
+  CODEC_NONE = 0,
+  CODEC_ZLIB = 1,   // Raw deflate stream.
+  CODEC_MAX
+};
+
+// Interface for the objects that compress or decompress a stream of data.
+class Codec {
+ public:
+  virtual ~Codec() {}
+
+  // Returns a new object to compress (if |compress| is true) or decompress
+  // data of the given |type|, or NULL if |type| is not supported.
+  static Codec* Create(CodecType type, bool compress);
+
+  // Consumes up to |*input_len| bytes from |input|, and writes up to
+  // |*output_len| bytes to |output|. On return, |*input_len| and |*output_len|
+  // contain the number of bytes actually consumed and produced. |finish| tells
+  // the codec that there is no more input, in which case this method should be
+  // called until done() returns true. Returns false on error.
+  virtual bool Process(const char* input, int* input_len, char* output,
+                       int* output_len, bool finish) = 0;
+
+  // Returns true when all the output has been produced.
+  virtual bool done() const = 0;
+};
+
+// The kind of data stored by a stream, as far as compression is concerned.
+enum ContentType {
+  CONTENT_TEXT = 0,     // HTML, JSON, scripts, style sheets, etc.
+  CONTENT_BINARY,       // Anything that is not text nor compressed.
+  CONTENT_COMPRESSED,   // Images, archives, media and other packed formats.
+  CONTENT_MAX
+};
+
+// Decides which streams should be compressed, based on the type of their
+// contents. By default, text and unknown binary data are compressed with
+// zlib. Note that the data is kept uncompressed if the codec doesn't reduce
+// its size significantly.
+class CompressionPolicy {
+ public:
+  CompressionPolicy();
+
+  // Sets the |codec| to use for a given content |type|.
+  void SetCodec(ContentType type, CodecType codec);
+
+  // Returns the codec to use for a stream that starts with the provided
+  // |len| bytes of |data|.
+  CodecType GetCodec(const char* data, int len) const;
+
+  // Returns the type of a stream that starts with the provided data.
+  static ContentType GetContentType(const char* data, int len);
+
+ private:
+  CodecType codecs_[CONTENT_MAX];
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_COMPRESSION_H_
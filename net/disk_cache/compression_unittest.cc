@@ -0,0 +1,106 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
+#include "net/disk_cache/compression.h"
+#include "net/disk_cache/disk_cache_test_base.h"
+#include "net/disk_cache/disk_cache_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+// Runs |input| through |codec|, using small buffers to exercise the streaming
+// interface.
+bool RunCodec(Codec* codec, const std::string& input, std::string* output) {
+  const int kChunkSize = 1000;
+  char buffer[kChunkSize];
+  size_t consumed = 0;
+  while (!codec->done()) {
+    int input_len = static_cast<int>(
+        std::min(input.size() - consumed, static_cast<size_t>(kChunkSize)));
+    int output_len = kChunkSize;
+    bool finish = consumed + input_len == input.size();
+    if (!codec->Process(input.data() + consumed, &input_len, buffer,
+                        &output_len, finish)) {
+      return false;
+    }
+    if (finish && !input_len && !output_len && !codec->done())
+      return false;
+    consumed += input_len;
+    output->append(buffer, output_len);
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST_F(DiskCacheTest, Compression_Codec) {
+  const int kSize = 200000;
+  scoped_array<char> data(new char[kSize]);
+  CacheTestFillTextBuffer(data.get(), kSize);
+  std::string input(data.get(), kSize);
+
+  scoped_ptr<Codec> compressor(Codec::Create(CODEC_ZLIB, true));
+  ASSERT_TRUE(compressor.get());
+  std::string compressed;
+  ASSERT_TRUE(RunCodec(compressor.get(), input, &compressed));
+  EXPECT_LT(compressed.size(), input.size() / 2);
+
+  scoped_ptr<Codec> decompressor(Codec::Create(CODEC_ZLIB, false));
+  ASSERT_TRUE(decompressor.get());
+  std::string output;
+  ASSERT_TRUE(RunCodec(decompressor.get(), compressed, &output));
+  EXPECT_TRUE(input == output);
+
+  // Truncated data is detected.
+  decompressor.reset(Codec::Create(CODEC_ZLIB, false));
+  output.clear();
+  EXPECT_FALSE(RunCodec(decompressor.get(),
+                        compressed.substr(0, compressed.size() / 2), &output));
+
+  EXPECT_FALSE(Codec::Create(CODEC_NONE, true));
+}
+
+TEST_F(DiskCacheTest, Compression_Policy) {
+  const char kHtml[] = "<!DOCTYPE html>\n<html>\r\n\t<body>caf\xc3\xa9</body>";
+  const char kPng[] = "\x89PNG\r\n\x1a\n\0\0\0\rIHDR";
+  const char kWebP[] = "RIFF\x10\0\0\0WEBPVP8 ";
+  const char kMp4[] = "\0\0\0\x18" "ftypmp42";
+  const char kGzip[] = "\x1f\x8b\x08";
+  const char kBinary[] = "\x01\x02\x03\x04\x05";
+
+  EXPECT_EQ(CONTENT_TEXT,
+            CompressionPolicy::GetContentType(kHtml, sizeof(kHtml) - 1));
+  EXPECT_EQ(CONTENT_COMPRESSED,
+            CompressionPolicy::GetContentType(kPng, sizeof(kPng) - 1));
+  EXPECT_EQ(CONTENT_COMPRESSED,
+            CompressionPolicy::GetContentType(kWebP, sizeof(kWebP) - 1));
+  EXPECT_EQ(CONTENT_COMPRESSED,
+            CompressionPolicy::GetContentType(kMp4, sizeof(kMp4) - 1));
+  EXPECT_EQ(CONTENT_BINARY,
+            CompressionPolicy::GetContentType(kBinary, sizeof(kBinary) - 1));
+  EXPECT_EQ(CONTENT_COMPRESSED,
+            CompressionPolicy::GetContentType(kGzip, sizeof(kGzip) - 1));
+
+  // Not enough data to identify the format.
+  EXPECT_EQ(CONTENT_BINARY, CompressionPolicy::GetContentType(kGzip, 1));
+
+  CompressionPolicy policy;
+  EXPECT_EQ(CODEC_ZLIB, policy.GetCodec(kHtml, sizeof(kHtml) - 1));
+  EXPECT_EQ(CODEC_NONE, policy.GetCodec(kPng, sizeof(kPng) - 1));
+  EXPECT_EQ(CODEC_ZLIB, policy.GetCodec(kBinary, sizeof(kBinary) - 1));
+
+  policy.SetCodec(CONTENT_BINARY, CODEC_NONE);
+  EXPECT_EQ(CODEC_NONE, policy.GetCodec(kBinary, sizeof(kBinary) - 1));
+  EXPECT_EQ(CODEC_ZLIB, policy.GetCodec(kHtml, sizeof(kHtml) - 1));
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,241 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/content_store.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "base/file_path.h"
+#include "base/logging.h"
+#include "base/platform_file.h"
+#include "net/disk_cache/disk_format.h"
+#include "net/disk_cache/mapped_file.h"
+
+namespace {
+
+const int kMinRecords = 1024;
+
+// Only bodies stored on external files are shared, so we need far fewer
+// records than entries.
+const int kSlotsPerRecord = 4;
+
+// The table is considered full when this percentage of the records is used.
+const int kMaxLoad = 75;
+
+// Released records are purged when this percentage of the table is taken by
+// records that were released since the last purge.
+const int kPurgeLoad = 20;
+
+}  // namespace
+
+namespace disk_cache {
+
+ContentStore::ContentStore()
+    : header_(NULL), table_(NULL), mask_(0), next_purge_(0) {
+}
+
+ContentStore::~ContentStore() {
+}
+
+bool ContentStore::Init(const FilePath& name, int table_len) {
+  DCHECK(!file_.get());
+  int num_records = kMinRecords;
+  while (num_records * kSlotsPerRecord < table_len)
+    num_records *= 2;
+  size_t size = sizeof(ContentHeader) + num_records * sizeof(ContentRecord);
+
+  int flags = base::PLATFORM_FILE_READ |
+              base::PLATFORM_FILE_WRITE |
+              base::PLATFORM_FILE_OPEN_ALWAYS |
+              base::PLATFORM_FILE_EXCLUSIVE_WRITE;
+  bool created = false;
+  scoped_refptr<File> file(new File(
+      base::CreatePlatformFile(name, flags, &created, NULL)));
+  if (!file->IsValid())
+    return false;
+
+  bool reset = created || file->GetLength() != size;
+  if (reset && !file->SetLength(size))
+    return false;
+  file = NULL;
+
+  file_ = new MappedFile();
+  header_ = reinterpret_cast<ContentHeader*>(file_->Init(name, size));
+  if (!header_) {
+    LOG(ERROR) << "Unable to map the content table";
+    file_ = NULL;
+    return false;
+  }
+  table_ = reinterpret_cast<ContentRecord*>(header_ + 1);
+  mask_ = num_records - 1;
+
+  if (reset || header_->magic != kContentMagic ||
+      header_->version != kContentVersion ||
+      header_->table_len != num_records) {
+    // Note that any file that was shared will not be deleted.
+    LOG_IF(ERROR, !reset) << "Resetting the content table";
+    *header_ = ContentHeader();
+    header_->table_len = num_records;
+    Reset();
+  }
+  next_purge_ = header_->num_deleted + num_records * kPurgeLoad / 100;
+  return true;
+}
+
+int ContentStore::Find(const char* hash, int size) const {
+  DCHECK(header_);
+  uint32 start = GetStart(hash);
+  for (uint32 i = 0; i <= mask_; i++) {
+    int record = (start + i) & mask_;
+    const ContentRecord& current = table_[record];
+    if (!current.address) {
+      if (!current.refs)
+        break;
+      continue;
+    }
+    if (current.size == size && !memcmp(current.hash, hash, kHashSize))
+      return record;
+  }
+  return -1;
+}
+
+int ContentStore::Insert(const char* hash, Addr address, int size) {
+  DCHECK(header_);
+  DCHECK(address.is_separate_file());
+  DCHECK_EQ(-1, Find(hash, size));
+  if (header_->num_records * 100 >= header_->table_len * kMaxLoad)
+    return -1;
+
+  uint32 start = GetStart(hash);
+  for (uint32 i = 0; i <= mask_; i++) {
+    int record = (start + i) & mask_;
+    ContentRecord& current = table_[record];
+    if (current.address)
+      continue;
+
+    if (current.refs)
+      header_->num_deleted--;
+    memcpy(current.hash, hash, kHashSize);
+    current.address = address.value();
+    current.refs = 1;
+    current.size = size;
+    header_->num_records++;
+    header_->stored_bytes += size;
+    return record;
+  }
+  NOTREACHED();
+  return -1;
+}
+
+bool ContentStore::IsValid(int record, Addr address) const {
+  DCHECK(header_);
+  if (record < 0 || record > static_cast<int>(mask_))
+    return false;
+  return address.is_initialized() && table_[record].address == address.value();
+}
+
+Addr ContentStore::GetAddress(int record) const {
+  DCHECK(header_);
+  DCHECK(record >= 0 && record <= static_cast<int>(mask_));
+  return Addr(table_[record].address);
+}
+
+int ContentStore::GetRefs(int record) const {
+  DCHECK(header_);
+  DCHECK(record >= 0 && record <= static_cast<int>(mask_));
+  DCHECK(table_[record].address);
+  return table_[record].refs;
+}
+
+void ContentStore::AddRef(int record) {
+  DCHECK(header_);
+  ContentRecord& current = table_[record];
+  DCHECK(current.address);
+  DCHECK_GT(current.refs, 0);
+  current.refs++;
+  header_->saved_bytes += current.size;
+}
+
+bool ContentStore::Release(int record) {
+  DCHECK(header_);
+  ContentRecord& current = table_[record];
+  DCHECK(current.address);
+  DCHECK_GT(current.refs, 0);
+  if (--current.refs) {
+    header_->saved_bytes -= current.size;
+    return false;
+  }
+
+  header_->stored_bytes -= current.size;
+  header_->num_records--;
+  header_->num_deleted++;
+  memset(&current, 0, sizeof(current));
+  current.refs = -1;
+
+  // Get rid of the deleted records as soon as possible.
+  if (!header_->num_records)
+    Reset();
+  else if (header_->num_deleted >= next_purge_)
+    PurgeDeletedRecords();
+  return true;
+}
+
+int64 ContentStore::stored_bytes() const {
+  DCHECK(header_);
+  return header_->stored_bytes;
+}
+
+int64 ContentStore::saved_bytes() const {
+  DCHECK(header_);
+  return header_->saved_bytes;
+}
+
+int ContentStore::num_deleted() const {
+  DCHECK(header_);
+  return header_->num_deleted;
+}
+
+void ContentStore::Reset() {
+  DCHECK(header_);
+  header_->num_records = 0;
+  header_->num_deleted = 0;
+  header_->stored_bytes = 0;
+  header_->saved_bytes = 0;
+  memset(table_, 0, header_->table_len * sizeof(ContentRecord));
+  next_purge_ = header_->table_len * kPurgeLoad / 100;
+}
+
+uint32 ContentStore::GetStart(const char* hash) const {
+  uint32 start;
+  memcpy(&start, hash, sizeof(start));
+  return start & mask_;
+}
+
+void ContentStore::PurgeDeletedRecords() {
+  // A released record has to stay only if it is between the first slot of a
+  // record in use and the slot where that record is stored.
+  int table_len = header_->table_len;
+  std::vector<bool> needed(table_len, false);
+  for (int i = 0; i < table_len; i++) {
+    if (!table_[i].address)
+      continue;
+    for (uint32 j = GetStart(table_[i].hash); j != static_cast<uint32>(i);
+         j = (j + 1) & mask_) {
+      needed[j] = true;
+    }
+  }
+
+  for (int i = 0; i < table_len; i++) {
+    ContentRecord& current = table_[i];
+    if (!current.address && current.refs && !needed[i]) {
+      current.refs = 0;
+      header_->num_deleted--;
+    }
+  }
+  next_purge_ = header_->num_deleted + table_len * kPurgeLoad / 100;
+}
+
+}  // namespace disk_cache
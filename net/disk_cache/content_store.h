@@ -0,0 +1,104 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface of the cache.
+
+#ifndef NET_DISK_CACHE_CONTENT_STORE_H_
+#define NET_DISK_CACHE_CONTENT_STORE_H_
+#pragma once
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "net/disk_cache/addr.h"
+
+class FilePath;
+
+namespace disk_cache {
+
+class MappedFile;
+struct ContentHeader;
+struct ContentRecord;
+
+// This class keeps track of the external files that store data for more than
+// one entry, so that entries with identical data (the same resource stored
+// under different urls, for instance) use a single file. Files are identified
+// by the SHA-256 of their contents, and each file has a reference count: the
+// entries that use a shared file store the number of the record that tracks
+// it, and the file is deleted when the last entry goes away.
+//
+// The table is stored on a memory mapped file (next to the index file), so it
+// survives browser restarts. The table has a fixed size, and new files are not
+// shared when the table is full. All methods must be called from the cache
+// thread.
+class ContentStore {
+ public:
+  // Length of the hash of the contents.
+  static const int kHashSize = 32;
+
+  ContentStore();
+  ~ContentStore();
+
+  // Maps the table stored on the file |name|, creating (or resetting) it if
+  // needed. |table_len| is the number of slots of the index table, and controls
+  // the number of records to use.
+  bool Init(const FilePath& name, int table_len);
+
+  // Returns the record that tracks a file of |size| bytes with the given |hash|
+  // (kHashSize bytes), or -1.
+  int Find(const char* hash, int size) const;
+
+  // Starts tracking the file at |address|, with |size| bytes of data (and the
+  // given |hash|), with a single reference. Returns the new record, or -1 if the
+  // table is full.
+  int Insert(const char* hash, Addr address, int size);
+
+  // Returns true if |record| tracks the file at |address|.
+  bool IsValid(int record, Addr address) const;
+
+  // Returns the address of the file tracked by |record|.
+  Addr GetAddress(int record) const;
+
+  // Returns the number of references of |record|.
+  int GetRefs(int record) const;
+
+  // Adds one reference to |record|.
+  void AddRef(int record);
+
+  // Removes one reference from |record|. Returns true if this was the last
+  // reference, in which case the record is no longer valid, and the caller
+  // owns the file.
+  bool Release(int record);
+
+  // Returns the size of the files tracked by this object, and the number of
+  // bytes that would be stored without sharing files.
+  int64 stored_bytes() const;
+  int64 saved_bytes() const;
+
+  // Returns the number of released records that still take a slot.
+  int num_deleted() const;
+
+  // Removes all records.
+  void Reset();
+
+ private:
+  // Returns the first slot to look at for |hash|.
+  uint32 GetStart(const char* hash) const;
+
+  // Frees the slots of released records that are not needed to reach any
+  // record in use. Records are never moved, so the record numbers stored by
+  // the entries remain valid.
+  void PurgeDeletedRecords();
+
+  scoped_refptr<MappedFile> file_;
+  ContentHeader* header_;
+  ContentRecord* table_;
+  uint32 mask_;  // Maps a hash to the table.
+  int next_purge_;  // Number of released records that triggers a purge.
+
+  DISALLOW_COPY_AND_ASSIGN(ContentStore);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_CONTENT_STORE_H_
@@ -0,0 +1,157 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include "base/file_path.h"
+#include "base/file_util.h"
+#include "net/disk_cache/content_store.h"
+#include "net/disk_cache/disk_cache_test_base.h"
+#include "net/disk_cache/disk_cache_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+void FillHash(char* hash, char value) {
+  memset(hash, value, ContentStore::kHashSize);
+}
+
+}  // namespace
+
+TEST_F(DiskCacheTest, ContentStore_Basics) {
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  ASSERT_TRUE(file_util::CreateDirectory(path));
+
+  ContentStore store;
+  ASSERT_TRUE(store.Init(path.AppendASCII("index_dedup"), 1024));
+
+  char hash1[ContentStore::kHashSize];
+  char hash2[ContentStore::kHashSize];
+  FillHash(hash1, 1);
+  FillHash(hash2, 2);
+  Addr address1(0x80000001);
+  Addr address2(0x80000002);
+
+  EXPECT_EQ(-1, store.Find(hash1, 20000));
+  int record1 = store.Insert(hash1, address1, 20000);
+  ASSERT_NE(-1, record1);
+  EXPECT_EQ(record1, store.Find(hash1, 20000));
+  EXPECT_EQ(-1, store.Find(hash1, 30000));
+  EXPECT_EQ(-1, store.Find(hash2, 20000));
+  EXPECT_TRUE(store.IsValid(record1, address1));
+  EXPECT_FALSE(store.IsValid(record1, address2));
+  EXPECT_EQ(address1.value(), store.GetAddress(record1).value());
+
+  // Same start, different hash.
+  hash2[0] = 1;
+  int record2 = store.Insert(hash2, address2, 20000);
+  ASSERT_NE(-1, record2);
+  EXPECT_NE(record1, record2);
+  EXPECT_EQ(record2, store.Find(hash2, 20000));
+  EXPECT_EQ(40000, store.stored_bytes());
+  EXPECT_EQ(0, store.saved_bytes());
+
+  store.AddRef(record1);
+  store.AddRef(record1);
+  EXPECT_EQ(40000, store.saved_bytes());
+
+  EXPECT_FALSE(store.Release(record1));
+  EXPECT_FALSE(store.Release(record1));
+  EXPECT_EQ(0, store.saved_bytes());
+  EXPECT_TRUE(store.Release(record1));
+  EXPECT_FALSE(store.IsValid(record1, address1));
+  EXPECT_EQ(-1, store.Find(hash1, 20000));
+  EXPECT_EQ(20000, store.stored_bytes());
+
+  // The second record is found after removing the first one.
+  EXPECT_EQ(record2, store.Find(hash2, 20000));
+  EXPECT_TRUE(store.Release(record2));
+  EXPECT_EQ(0, store.stored_bytes());
+}
+
+// Tests that the table survives a restart, and that it has a size limit.
+TEST_F(DiskCacheTest, ContentStore_Persistence) {
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  ASSERT_TRUE(file_util::CreateDirectory(path));
+  FilePath name = path.AppendASCII("index_dedup");
+
+  char hash[ContentStore::kHashSize];
+  int records[1024];
+  int num_records = 0;
+  {
+    ContentStore store;
+    ASSERT_TRUE(store.Init(name, 1024));
+    for (int i = 0; i < 1024; i++) {
+      FillHash(hash, 0);
+      memcpy(hash + 4, &i, sizeof(i));
+      records[i] = store.Insert(hash, Addr(0x80000001 + i), 20000);
+      if (records[i] < 0)
+        break;
+      num_records++;
+    }
+  }
+  EXPECT_GT(num_records, 512);
+  EXPECT_LT(num_records, 1024);
+
+  {
+    ContentStore store;
+    ASSERT_TRUE(store.Init(name, 1024));
+    EXPECT_EQ(20000 * num_records, store.stored_bytes());
+    for (int i = 0; i < num_records; i++) {
+      FillHash(hash, 0);
+      memcpy(hash + 4, &i, sizeof(i));
+      ASSERT_EQ(records[i], store.Find(hash, 20000));
+      ASSERT_TRUE(store.IsValid(records[i], Addr(0x80000001 + i)));
+    }
+  }
+
+  // A different index size discards the data.
+  ContentStore store;
+  ASSERT_TRUE(store.Init(name, 16 * 1024));
+  EXPECT_EQ(0, store.stored_bytes());
+}
+
+// Tests that released records don't pile up on the table.
+TEST_F(DiskCacheTest, ContentStore_PurgeDeleted) {
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  ASSERT_TRUE(file_util::CreateDirectory(path));
+
+  ContentStore store;
+  ASSERT_TRUE(store.Init(path.AppendASCII("index_dedup"), 1024));
+
+  // Two records with the same start: the first one is needed to find the
+  // second one.
+  char hash1[ContentStore::kHashSize];
+  char hash2[ContentStore::kHashSize];
+  FillHash(hash1, 3);
+  FillHash(hash2, 3);
+  hash2[4] = 2;
+  int record1 = store.Insert(hash1, Addr(0x80000001), 20000);
+  int record2 = store.Insert(hash2, Addr(0x80000002), 20000);
+  ASSERT_NE(-1, record1);
+  ASSERT_NE(-1, record2);
+  EXPECT_TRUE(store.Release(record1));
+  EXPECT_EQ(1, store.num_deleted());
+
+  char hash[ContentStore::kHashSize];
+  for (int i = 0; i < 700; i++) {
+    FillHash(hash, 0);
+    memcpy(hash, &i, sizeof(i));
+    int record = store.Insert(hash, Addr(0x80000010 + i), 20000);
+    ASSERT_NE(-1, record);
+    EXPECT_TRUE(store.Release(record));
+  }
+
+  EXPECT_GT(store.num_deleted(), 0);
+  EXPECT_LT(store.num_deleted(), 1024 / 4);
+  EXPECT_EQ(record2, store.Find(hash2, 20000));
+  EXPECT_EQ(20000, store.stored_bytes());
+}
+
+}  // namespace disk_cache
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "base/basictypes.h"
+#include "base/platform_file.h"
 #include "base/time.h"
 #include "net/base/cache_type.h"
 #include "net/base/completion_callback.h"
@@ -191,6 +192,21 @@ class Entry {
                         CompletionCallback* completion_callback,
                         bool truncate) = 0;
 
+  // Provides direct access to the file that stores the data with the given
+  // index, so that the data can be sent to a socket without going through user
+  // space (for instance, with sendfile()). This only works when the data is
+  // stored on a dedicated file (large streams); otherwise this method returns
+  // ERR_FAILED and the data must be retrieved with ReadData(). On success, the
+  // return value is the size of the data, |file| receives a new handle that can
+  // be used to read the file (and must be closed by the caller), and |offset|
+  // the position of the first byte of the data on that file. If this method
+  // returns ERR_IO_PENDING, the |completion_callback| will be invoked when the
+  // operation completes, and |file| and |offset| must remain valid until that
+  // point. The data is not guaranteed to stay on the file after the entry is
+  // modified.
+  virtual int GetDataFile(int index, base::PlatformFile* file, int64* offset,
+                          CompletionCallback* completion_callback) = 0;
+
   // Sparse entries support:
   //
   // A Backend implementation can support sparse entries, so the cache keeps
@@ -2,23 +2,37 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <stdio.h>
+
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/basictypes.h"
+#include "base/command_line.h"
 #include "base/file_path.h"
 #include "base/file_util.h"
 #include "base/perftimer.h"
+#include "base/process_util.h"
+#include "base/stl_util-inl.h"
+#include "base/string_number_conversions.h"
+#include "base/string_split.h"
 #include "base/string_util.h"
+#include "base/stringprintf.h"
+#include "base/threading/simple_thread.h"
 #include "base/threading/thread.h"
 #include "base/test/test_file_util.h"
 #include "base/timer.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/test_completion_callback.h"
+#include "net/disk_cache/backend_impl.h"
 #include "net/disk_cache/block_files.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/disk_cache_test_util.h"
 #include "net/disk_cache/hash.h"
+#include "net/disk_cache/index_filter.h"
+#include "net/disk_cache/mem_backend_impl.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/platform_test.h"
 
@@ -143,6 +157,252 @@ int BlockSize() {
   return (rand() & 0x3) + 1;
 }
 
+// Opens |num_entries| keys, half of them not stored on the cache, and returns
+// the number of successful opens.
+int TimeOpen(int num_entries, disk_cache::Backend* cache,
+             const TestEntries& entries, const char* message) {
+  PerfTimeLogger timer(message);
+  int hits = 0;
+  for (int i = 0; i < num_entries; i++) {
+    std::string key = (i & 1) ? entries[i].key : GenerateKey(true);
+    disk_cache::Entry* cache_entry;
+    TestCompletionCallback cb;
+    int rv = cache->OpenEntry(key, &cache_entry, &cb);
+    if (net::OK == cb.GetResult(rv)) {
+      hits++;
+      cache_entry->Close();
+    }
+  }
+  timer.Done();
+  return hits;
+}
+
+// Performs lookups on an IndexFilter from a given thread.
+class FilterLookupDelegate : public base::DelegateSimpleThread::Delegate {
+ public:
+  FilterLookupDelegate(const disk_cache::IndexFilter* filter, int num_lookups)
+      : filter_(filter), num_lookups_(num_lookups), found_(0) {}
+
+  virtual void Run() {
+    uint32 hash = static_cast<uint32>(rand());
+    for (int i = 0; i < num_lookups_; i++) {
+      // A cheap LCG is enough to spread the lookups over the buckets.
+      hash = hash * 1103515245 + 12345;
+      if (filter_->MayContain(hash))
+        found_++;
+    }
+  }
+
+  int found() const { return found_; }
+
+ private:
+  const disk_cache::IndexFilter* filter_;
+  int num_lookups_;
+  int found_;
+  DISALLOW_COPY_AND_ASSIGN(FilterLookupDelegate);
+};
+
+// Returns the value of the stat with the given |name|, or -1.
+int64 GetStat(disk_cache::Backend* cache, const char* name) {
+  std::vector<std::pair<std::string, std::string> > stats;
+  cache->GetStats(&stats);
+  for (size_t i = 0; i < stats.size(); i++) {
+    int64 value;
+    if (stats[i].first == name && base::StringToInt64(stats[i].second, &value))
+      return value;
+  }
+  return -1;
+}
+
+// Runs a write-heavy mix of operations: every entry is created and written,
+// and then half of them are updated and a fourth of them is deleted.
+void WriteMix(disk_cache::BackendImpl* cache, int num_entries) {
+  const int kSize = 500;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer->data(), kSize, false);
+
+  TestCompletionCallback cb;
+  disk_cache::Entry* entry;
+  for (int i = 0; i < num_entries; i++) {
+    std::string key = base::StringPrintf("key %d", i);
+    int rv = cache->CreateEntry(key, &entry, &cb);
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+    rv = entry->WriteData(0, 0, buffer, 100, &cb, false);
+    ASSERT_EQ(100, cb.GetResult(rv));
+    rv = entry->WriteData(1, 0, buffer, kSize, &cb, false);
+    ASSERT_EQ(kSize, cb.GetResult(rv));
+    entry->Close();
+  }
+
+  for (int i = 0; i < num_entries; i += 2) {
+    std::string key = base::StringPrintf("key %d", i);
+    int rv = cache->OpenEntry(key, &entry, &cb);
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+    rv = entry->WriteData(0, 0, buffer, 50, &cb, true);
+    ASSERT_EQ(50, cb.GetResult(rv));
+    if (i % 4 == 0)
+      entry->Doom();
+    entry->Close();
+  }
+
+  ASSERT_EQ(net::OK, cb.GetResult(cache->FlushQueueForTest(&cb)));
+}
+
+const int kReadSize = 4096;
+
+// Keeps issuing asynchronous reads of random blocks of a file until a given
+// number of reads complete.
+class ReadChain : public disk_cache::FileIOCallback {
+ public:
+  ReadChain(disk_cache::File* file, int file_len, int* reads_left,
+            int* chains_running)
+      : file_(file), file_len_(file_len), reads_left_(reads_left),
+        chains_running_(chains_running) {}
+  virtual ~ReadChain() {}
+
+  // Starts the next read, or quits the message loop after the last read.
+  void Start();
+
+  virtual void OnFileIOComplete(int bytes_copied);
+
+ private:
+  disk_cache::File* file_;
+  int file_len_;
+  int* reads_left_;
+  int* chains_running_;
+  char buffer_[kReadSize];
+
+  DISALLOW_COPY_AND_ASSIGN(ReadChain);
+};
+
+void ReadChain::Start() {
+  if (!*reads_left_) {
+    if (!--*chains_running_)
+      MessageLoop::current()->Quit();
+    return;
+  }
+  (*reads_left_)--;
+
+  size_t offset = (rand() % (file_len_ / kReadSize)) * kReadSize;
+  bool completed;
+  EXPECT_TRUE(file_->Read(buffer_, kReadSize, offset, this, &completed));
+  if (completed)
+    OnFileIOComplete(kReadSize);
+}
+
+void ReadChain::OnFileIOComplete(int bytes_copied) {
+  EXPECT_EQ(kReadSize, bytes_copied);
+  Start();
+}
+
+// A cache request, as recorded by disk_cache::Trace().
+struct TraceRecord {
+  bool create;
+  uint32 hash;
+};
+typedef std::vector<TraceRecord> TraceRecords;
+
+// Reads the open and create requests from a dump of the cache traces ("Open
+// hash 0x%x" and "Create hash 0x%x" lines) stored on |name|.
+bool LoadTrace(const FilePath& name, TraceRecords* records) {
+  std::string contents;
+  if (!file_util::ReadFileToString(name, &contents))
+    return false;
+
+  std::vector<std::string> lines;
+  base::SplitString(contents, '\n', &lines);
+  for (size_t i = 0; i < lines.size(); i++) {
+    TraceRecord record;
+    unsigned int hash;
+    if (sscanf(lines[i].c_str(), "Open hash 0x%x", &hash) == 1) {
+      record.create = false;
+    } else if (sscanf(lines[i].c_str(), "Create hash 0x%x", &hash) == 1) {
+      record.create = true;
+    } else {
+      continue;
+    }
+    record.hash = hash;
+    records->push_back(record);
+  }
+  return !records->empty();
+}
+
+// Generates requests for a set of popular resources (some of them much more
+// popular than others), mixed with scans of resources that are never requested
+// again. Every request is an open followed by a create (that fails for hits).
+void GenerateTrace(TraceRecords* records) {
+  const int kNumRequests = 40000;
+  const int kNumPopular = 1500;
+  const int kScanInterval = 10000;
+  const int kScanLength = 2500;
+
+  uint32 seed = 1;
+  uint32 next_scan = 0x80000000;
+  for (int i = 0; i < kNumRequests; i++) {
+    uint32 hash;
+    if (i % kScanInterval >= kScanInterval - kScanLength) {
+      hash = next_scan++;
+    } else {
+      seed = seed * 1103515245 + 12345;
+      double r = static_cast<double>(seed >> 8) / (1 << 24);
+      hash = static_cast<uint32>(kNumPopular * r * r * r);
+    }
+    TraceRecord record = { false, hash };
+    records->push_back(record);
+    record.create = true;
+    records->push_back(record);
+  }
+}
+
+// Replays |records| on a new cache of |cache_size| bytes, created with the
+// given |flags|, and returns the percentage of opens that found the entry.
+// Every entry stores |size| bytes from |buffer|, which are read back on hits.
+double ReplayTrace(const TraceRecords& records, int cache_size,
+                   bool new_eviction, uint32 flags, net::IOBuffer* buffer,
+                   int size, base::MessageLoopProxy* thread) {
+  scoped_refptr<net::IOBuffer> read_buffer(new net::IOBuffer(size));
+  ScopedTestCache test_cache;
+  disk_cache::BackendImpl* cache =
+      new disk_cache::BackendImpl(test_cache.path(), thread, NULL);
+  EXPECT_TRUE(cache->SetMaxSize(cache_size));
+  if (new_eviction)
+    cache->SetNewEviction();
+  cache->SetFlags(disk_cache::kNoRandom | disk_cache::kNoLoadProtection |
+                  flags);
+  TestCompletionCallback cb;
+  int rv = cache->Init(&cb);
+  EXPECT_EQ(net::OK, cb.GetResult(rv));
+
+  int hits = 0;
+  int opens = 0;
+  disk_cache::Entry* entry;
+  for (size_t i = 0; i < records.size(); i++) {
+    std::string key = base::StringPrintf("0x%x", records[i].hash);
+    if (!records[i].create) {
+      opens++;
+      rv = cache->OpenEntry(key, &entry, &cb);
+      if (cb.GetResult(rv) == net::OK) {
+        hits++;
+        rv = entry->ReadData(1, 0, read_buffer, size, &cb);
+        EXPECT_EQ(size, cb.GetResult(rv));
+        entry->Close();
+      }
+      continue;
+    }
+
+    rv = cache->CreateEntry(key, &entry, &cb);
+    if (cb.GetResult(rv) != net::OK)
+      continue;
+    rv = entry->WriteData(1, 0, buffer, size, &cb, false);
+    EXPECT_EQ(size, cb.GetResult(rv));
+    entry->Close();
+  }
+
+  MessageLoop::current()->RunAllPending();
+  delete cache;
+  return opens ? hits * 100.0 / opens : 0;
+}
+
 }  // namespace
 
 TEST_F(DiskCacheTest, Hash) {
@@ -255,3 +515,309 @@ TEST_F(DiskCacheTest, BlockFilesPerformance) {
   MessageLoop::current()->RunAllPending();
   delete[] address;
 }
+
+// Measures the number of IO operations (and bytes per operation) used to store
+// blocks on a write-heavy workload, with and without batching the writes.
+TEST_F(DiskCacheTest, BatchWritesPerformance) {
+  MessageLoopForIO message_loop;
+
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  const int kNumEntries = 5000;
+  const uint32 kFlags[] = { disk_cache::kNone, disk_cache::kBatchWrites };
+  const char* kNames[] = { "Block writes", "Block writes (batched)" };
+  for (size_t i = 0; i < arraysize(kFlags); i++) {
+    ScopedTestCache test_cache;
+    TestCompletionCallback cb;
+    disk_cache::Backend* cache;
+    int rv = disk_cache::BackendImpl::CreateBackend(
+                 test_cache.path(), false, 0, net::DISK_CACHE,
+                 disk_cache::kNoRandom | kFlags[i],
+                 cache_thread.message_loop_proxy(), NULL, &cache, &cb);
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+
+    PerfTimer timer;
+    WriteMix(static_cast<disk_cache::BackendImpl*>(cache), kNumEntries);
+    double seconds = timer.Elapsed().InSecondsF();
+
+    int64 num_writes = GetStat(cache, "Block writes");
+    int64 num_bytes = GetStat(cache, "Block bytes written");
+    ASSERT_GT(num_writes, 0);
+
+    std::string name(kNames[i]);
+    LogPerfResult((name + " count").c_str(),
+                  static_cast<double>(num_writes), "IOs");
+    LogPerfResult((name + " rate").c_str(), num_writes / seconds, "IOPS");
+    LogPerfResult((name + " size").c_str(),
+                  static_cast<double>(num_bytes) / num_writes, "bytes/IO");
+
+    MessageLoop::current()->RunAllPending();
+    delete cache;
+  }
+}
+
+// Measures the latency of asynchronous file reads, with a single read in
+// flight, and the throughput with many concurrent reads.
+TEST_F(DiskCacheTest, AsyncReadPerformance) {
+  MessageLoopForIO message_loop;
+
+  ScopedTestCache test_cache;
+  FilePath filename = test_cache.path().AppendASCII("a_test");
+  ASSERT_TRUE(CreateCacheTestFile(filename));
+  scoped_refptr<disk_cache::File> file(new disk_cache::File(false));
+  ASSERT_TRUE(file->Init(filename));
+  int file_len = static_cast<int>(file->GetLength());
+
+  const int kNumReads = 20000;
+  const int kConcurrency[] = { 1, 32 };
+  for (size_t i = 0; i < arraysize(kConcurrency); i++) {
+    int reads_left = kNumReads;
+    int chains_running = kConcurrency[i];
+    std::vector<ReadChain*> chains;
+    for (int j = 0; j < kConcurrency[i]; j++) {
+      chains.push_back(new ReadChain(file, file_len, &reads_left,
+                                     &chains_running));
+    }
+
+    PerfTimer timer;
+    for (int j = 0; j < kConcurrency[i]; j++)
+      chains[j]->Start();
+    MessageLoop::current()->Run();
+    double us = static_cast<double>(timer.Elapsed().InMicroseconds());
+
+    std::string name = base::StringPrintf("Async reads (%d in flight)",
+                                          kConcurrency[i]);
+    LogPerfResult((name + " latency").c_str(),
+                  us * kConcurrency[i] / kNumReads, "us");
+    LogPerfResult((name + " rate").c_str(), kNumReads * 1000000.0 / us,
+                  "reads/s");
+    STLDeleteElements(&chains);
+  }
+  disk_cache::File::WaitForPendingIO(NULL);
+}
+
+// Measures the cost of looking up entries that are not stored on the cache,
+// with and without resolving the misses on the calling thread.
+TEST_F(DiskCacheTest, IndexFilterPerformance) {
+  MessageLoopForIO message_loop;
+
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  ScopedTestCache test_cache;
+  int seed = static_cast<int>(Time::Now().ToInternalValue());
+  srand(seed);
+
+  TestEntries entries;
+  const int kNumEntries = 10000;
+  {
+    TestCompletionCallback cb;
+    disk_cache::Backend* cache;
+    int rv = disk_cache::CreateCacheBackend(
+                 net::DISK_CACHE, test_cache.path(), 0, false,
+                 cache_thread.message_loop_proxy(), NULL, &cache, &cb);
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+
+    for (int i = 0; i < kNumEntries; i++) {
+      TestEntry entry;
+      entry.key = GenerateKey(true);
+      entry.data_len = 0;
+      entries.push_back(entry);
+
+      disk_cache::Entry* cache_entry;
+      rv = cache->CreateEntry(entry.key, &cache_entry, &cb);
+      ASSERT_EQ(net::OK, cb.GetResult(rv));
+      cache_entry->Close();
+    }
+    MessageLoop::current()->RunAllPending();
+    delete cache;
+  }
+
+  const uint32 kFlags[] = { disk_cache::kNone, disk_cache::kIndexFilter };
+  const char* kMessages[] = { "Open entries (50% misses)",
+                              "Open entries (50% misses, index filter)" };
+  for (size_t i = 0; i < arraysize(kFlags); i++) {
+    TestCompletionCallback cb;
+    disk_cache::Backend* cache;
+    int rv = disk_cache::BackendImpl::CreateBackend(
+                 test_cache.path(), false, 0, net::DISK_CACHE, kFlags[i],
+                 cache_thread.message_loop_proxy(), NULL, &cache, &cb);
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+
+    EXPECT_EQ(kNumEntries / 2, TimeOpen(kNumEntries, cache, entries,
+                                        kMessages[i]));
+    MessageLoop::current()->RunAllPending();
+    delete cache;
+  }
+}
+
+// Replays a trace of cache requests with each eviction policy, and reports the
+// resulting hit ratios. The trace is read from the file passed with
+// --disk-cache-trace (a dump of disk_cache::Trace()), or generated if missing.
+TEST_F(DiskCacheTest, EvictionTraceReplay) {
+  MessageLoopForIO message_loop;
+
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  TraceRecords records;
+  FilePath trace_name =
+      CommandLine::ForCurrentProcess()->GetSwitchValuePath("disk-cache-trace");
+  if (trace_name.empty() || !LoadTrace(trace_name, &records))
+    GenerateTrace(&records);
+
+  const int kCacheSize = 4 * 1024 * 1024;
+  const int kSize = 4096;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer->data(), kSize, false);
+  for (int i = 0; i < 2; i++) {
+    bool new_eviction = (i == 1);
+    double base_ratio = ReplayTrace(records, kCacheSize, new_eviction,
+                                    disk_cache::kNone, buffer, kSize,
+                                    cache_thread.message_loop_proxy());
+    double tiny_lfu_ratio = ReplayTrace(records, kCacheSize, new_eviction,
+                                        disk_cache::kTinyLfu, buffer, kSize,
+                                        cache_thread.message_loop_proxy());
+
+    std::string name = base::StringPrintf("Trace hit ratio, %s",
+                                          new_eviction ? "new eviction" :
+                                                         "LRU");
+    LogPerfResult(name.c_str(), base_ratio, "%");
+    LogPerfResult((name + " + TinyLFU").c_str(), tiny_lfu_ratio, "%");
+    LogPerfResult((name + " delta").c_str(), tiny_lfu_ratio - base_ratio, "%");
+  }
+}
+
+// Replays a trace of requests for text resources on a cache that is too small
+// to hold them all, with and without compression, and reports the time spent
+// (which includes compressing and decompressing the data) and the hit ratios.
+TEST_F(DiskCacheTest, CompressionTraceReplay) {
+  MessageLoopForIO message_loop;
+
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+                  base::Thread::Options(MessageLoop::TYPE_IO, 0)));
+
+  TraceRecords records;
+  GenerateTrace(&records);
+
+  const int kCacheSize = 16 * 1024 * 1024;
+  const int kSize = 24 * 1024;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillTextBuffer(buffer->data(), kSize);
+
+  PerfTimer timer;
+  double base_ratio = ReplayTrace(records, kCacheSize, false, disk_cache::kNone,
+                                  buffer, kSize,
+                                  cache_thread.message_loop_proxy());
+  base::TimeDelta base_time = timer.Elapsed();
+
+  PerfTimer timer2;
+  double compressed_ratio = ReplayTrace(records, kCacheSize, false,
+                                        disk_cache::kCompression, buffer, kSize,
+                                        cache_thread.message_loop_proxy());
+  base::TimeDelta compressed_time = timer2.Elapsed();
+  EXPECT_GE(compressed_ratio, base_ratio);
+
+  LogPerfResult("Text trace hit ratio", base_ratio, "%");
+  LogPerfResult("Text trace hit ratio, compressed", compressed_ratio, "%");
+  LogPerfResult("Text trace time", base_time.InMillisecondsF(), "ms");
+  LogPerfResult("Text trace time, compressed",
+                compressed_time.InMillisecondsF(), "ms");
+}
+
+// Measures the memory used by the memory-only cache for each entry, beyond the
+// size of the key and the stored data.
+TEST_F(DiskCacheTest, MemoryCacheOverhead) {
+  const int kNumEntries = 20000;  // About 20 MB.
+  const int kSize0 = 300;
+  const int kSize1 = 500;
+  const int kSize2 = 200;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize1));
+  CacheTestFillBuffer(buffer->data(), kSize1, false);
+
+  scoped_ptr<base::ProcessMetrics> metrics(
+      base::ProcessMetrics::CreateProcessMetrics(
+          base::GetCurrentProcessHandle()));
+  scoped_ptr<disk_cache::Backend> cache(
+      disk_cache::MemBackendImpl::CreateBackend(100 * 1024 * 1024, NULL));
+  ASSERT_TRUE(cache.get());
+  size_t initial_memory = metrics->GetWorkingSetSize();
+
+  TestCompletionCallback cb;
+  int64 payload = 0;
+  PerfTimer timer;
+  for (int i = 0; i < kNumEntries; i++) {
+    std::string key = base::StringPrintf("http://www.google.com/some/path/%d",
+                                         i);
+    disk_cache::Entry* entry;
+    ASSERT_EQ(net::OK, cb.GetResult(cache->CreateEntry(key, &entry, &cb)));
+    // Metadata, plus data that arrives in two pieces.
+    EXPECT_EQ(kSize0, entry->WriteData(0, 0, buffer, kSize0, &cb, false));
+    EXPECT_EQ(kSize1, entry->WriteData(1, 0, buffer, kSize1, &cb, false));
+    EXPECT_EQ(kSize2, entry->WriteData(1, kSize1, buffer, kSize2, &cb, false));
+    entry->Close();
+    payload += key.size() + kSize0 + kSize1 + kSize2;
+  }
+  double seconds = timer.Elapsed().InSecondsF();
+  double used = static_cast<double>(metrics->GetWorkingSetSize()) -
+                static_cast<double>(initial_memory);
+
+  EXPECT_EQ(kNumEntries, cache->GetEntryCount());
+  LogPerfResult("Memory cache bytes per entry", used / kNumEntries, "bytes");
+  LogPerfResult("Memory cache overhead per entry",
+                (used - payload) / kNumEntries, "bytes");
+  LogPerfResult("Memory cache data bytes per entry",
+                static_cast<double>(GetStat(cache.get(), "Reserved bytes")) /
+                    kNumEntries, "bytes");
+  LogPerfResult("Memory cache inserts", kNumEntries / seconds, "entries/s");
+}
+
+// Measures lookups per second on a shared IndexFilter, as the number of
+// threads performing lookups grows.
+TEST_F(DiskCacheTest, IndexFilterThreads) {
+  const int kTableLen = 64 * 1024;
+  const int kNumLookups = 4 * 1000 * 1000;
+  scoped_array<disk_cache::CacheAddr> table(
+      new disk_cache::CacheAddr[kTableLen]);
+
+  // Simulate a load factor of 50%.
+  for (int i = 0; i < kTableLen; i++)
+    table[i] = (i & 1) ? 0x90000001 : 0;
+
+  disk_cache::IndexFilter filter;
+  filter.Init(table.get(), kTableLen);
+
+  for (int num_threads = 1; num_threads <= 16; num_threads *= 2) {
+    std::vector<FilterLookupDelegate*> delegates;
+    std::vector<base::DelegateSimpleThread*> threads;
+    for (int i = 0; i < num_threads; i++) {
+      delegates.push_back(new FilterLookupDelegate(&filter, kNumLookups));
+      threads.push_back(new base::DelegateSimpleThread(delegates[i],
+                                                       "FilterLookup"));
+    }
+
+    PerfTimer timer;
+    for (int i = 0; i < num_threads; i++)
+      threads[i]->Start();
+    for (int i = 0; i < num_threads; i++)
+      threads[i]->Join();
+    base::TimeDelta elapsed = timer.Elapsed();
+
+    double lookups = static_cast<double>(kNumLookups) * num_threads;
+    std::string name = base::StringPrintf("Index filter lookups, %d threads",
+                                          num_threads);
+    LogPerfResult(name.c_str(),
+                  lookups / std::max(elapsed.InSecondsF(), 1e-6), "lookups/s");
+
+    for (int i = 0; i < num_threads; i++) {
+      EXPECT_GT(delegates[i]->found(), 0);
+      delete threads[i];
+      delete delegates[i];
+    }
+  }
+}
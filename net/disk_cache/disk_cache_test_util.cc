@@ -4,10 +4,13 @@
 
 #include "net/disk_cache/disk_cache_test_util.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/file_util.h"
 #include "base/message_loop_proxy.h"
 #include "base/path_service.h"
+#include "base/stringprintf.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/backend_impl.h"
 #include "net/disk_cache/cache_util.h"
@@ -55,6 +58,26 @@ void CacheTestFillBuffer(char* buffer, size_t len, bool no_nulls) {
     buffer[0] = 'g';
 }
 
+void CacheTestFillTextBuffer(char* buffer, size_t len) {
+  static const char* const kWords[] = {
+    "{\"id\": ", "\"name\": ", "\"value\": ", "\"items\": [", "], ",
+    "true, ", "false, ", "null, ", "\"url\": \"http://www.google.com/\", ",
+    "}, ", "\n  ",
+  };
+  size_t i = 0;
+  while (i < len) {
+    std::string word;
+    int choice = rand() % (arraysize(kWords) + 1);
+    if (choice == arraysize(kWords))
+      word = base::StringPrintf("%d, ", rand() % 10000);
+    else
+      word = kWords[choice];
+    size_t copy = std::min(word.size(), len - i);
+    memcpy(buffer + i, word.data(), copy);
+    i += copy;
+  }
+}
+
 FilePath GetCacheFilePath() {
   return BuildCachePath("cache_test");
 }
@@ -29,6 +29,10 @@ FilePath GetCacheFilePath();
 // Fills buffer with random values (may contain nulls unless no_nulls is true).
 void CacheTestFillBuffer(char* buffer, size_t len, bool no_nulls);
 
+// Fills buffer with random JSON-like text, which compresses about as well as
+// typical web content.
+void CacheTestFillTextBuffer(char* buffer, size_t len);
+
 // Generates a random key of up to 200 bytes.
 std::string GenerateKey(bool same_length);
 
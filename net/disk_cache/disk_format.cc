@@ -12,6 +12,18 @@ IndexHeader::IndexHeader() {
   version = kCurrentVersion;
 }
 
+SketchHeader::SketchHeader() {
+  memset(this, 0, sizeof(*this));
+  magic = kSketchMagic;
+  version = kSketchVersion;
+}
+
+ContentHeader::ContentHeader() {
+  memset(this, 0, sizeof(*this));
+  magic = kContentMagic;
+  version = kContentVersion;
+}
+
 BlockFileHeader::BlockFileHeader() {
   memset(this, 0, sizeof(BlockFileHeader));
   magic = kBlockMagic;
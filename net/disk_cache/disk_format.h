@@ -104,6 +104,61 @@ struct Index {
                                        // by header.table_len.
 };
 
+const uint32 kSketchMagic = 0xC10BCAC3;
+const uint32 kSketchVersion = 0x10000;  // Version 1.0.
+
+// Header for the file that stores the access frequency of the entries (used by
+// the admission policy of the cache). The file lives next to the index file,
+// and the header is followed by |num_words| words of packed 4-bit counters.
+struct SketchHeader {
+  SketchHeader();
+
+  uint32      magic;
+  uint32      version;
+  int32       num_words;     // Size of the table of counters.
+  int32       samples;       // Number of increments since the last aging.
+  int32       sample_size;   // Number of increments that triggers aging.
+  int32       pad[11];
+};
+
+COMPILE_ASSERT(sizeof(SketchHeader) == 64, bad_SketchHeader);
+
+const uint32 kContentMagic = 0xC0DEDB0D;
+const uint32 kContentVersion = 0x10000;  // Version 1.0.
+
+// Header for the file that tracks the external files that store the data of
+// more than one entry (content deduplication). The file lives next to the index
+// file, and the header is followed by |table_len| ContentRecords.
+struct ContentHeader {
+  ContentHeader();
+
+  uint32      magic;
+  uint32      version;
+  int32       table_len;      // Number of records.
+  int32       num_records;    // Records in use.
+  int32       num_deleted;    // Records that were released.
+  int32       pad1;
+  int64       stored_bytes;   // Size of the files tracked by the table.
+  int64       saved_bytes;    // Size of all references but the first one.
+  int32       pad[6];
+};
+
+COMPILE_ASSERT(sizeof(ContentHeader) == 64, bad_ContentHeader);
+
+// Tracks an external file that may be shared by more than one entry. The
+// records are located by |hash| (open addressing), and a record that is no
+// longer used keeps a |refs| of -1 (and no |address|) so that searches go past
+// it.
+struct ContentRecord {
+  char        hash[32];       // SHA-256 of the data.
+  CacheAddr   address;        // External file with the data.
+  int32       refs;           // Number of entries that use the file.
+  int32       size;           // Length of the data.
+  int32       pad;
+};
+
+COMPILE_ASSERT(sizeof(ContentRecord) == 48, bad_ContentRecord);
+
 // Main structure for an entry on the backing storage. If the key is longer than
 // what can be stored on this structure, it will be extended on consecutive
 // blocks (adding 256 bytes each time), up to 4 blocks (1024 - 32 - 1 chars).
@@ -122,7 +177,10 @@ struct EntryStore {
   int32       data_size[4];       // We can store up to 4 data streams for each
   CacheAddr   data_addr[4];       // entry.
   uint32      flags;              // Any combination of EntryFlags.
-  int32       pad[5];
+  int32       content_record;     // ContentRecord for data_addr[1], if shared.
+  int32       codec;              // CodecType of data_addr[1], if compressed.
+  int32       compressed_size;    // Stored size of data_addr[1], if compressed.
+  int32       pad[2];
   char        key[256 - 24 * 4];  // null terminated
 };
 
@@ -140,7 +198,10 @@ enum EntryState {
 // Flags that can be applied to an entry.
 enum EntryFlags {
   PARENT_ENTRY = 1,         // This entry has children (sparse) entries.
-  CHILD_ENTRY = 1 << 1      // Child entry that stores sparse data.
+  CHILD_ENTRY = 1 << 1,     // Child entry that stores sparse data.
+  KEPT_ENTRY = 1 << 2,      // Skipped by eviction due to its access frequency.
+  SHARED_DATA = 1 << 3,     // The data stream is stored on a shared file.
+  COMPRESSED_DATA = 1 << 4  // The data stream is stored compressed.
 };
 
 #pragma pack(push, 4)
@@ -6,12 +6,17 @@
 
 #include "base/message_loop.h"
 #include "base/metrics/histogram.h"
+#include "base/file_util.h"
 #include "base/string_util.h"
+#include "crypto/secure_hash.h"
+#include "crypto/sha2.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/backend_impl.h"
 #include "net/disk_cache/bitmap.h"
 #include "net/disk_cache/cache_util.h"
+#include "net/disk_cache/compression.h"
+#include "net/disk_cache/content_store.h"
 #include "net/disk_cache/hash.h"
 #include "net/disk_cache/histogram_macros.h"
 #include "net/disk_cache/net_log_parameters.h"
@@ -26,6 +31,22 @@ namespace {
 // Index for the file used to store the key, if any (files_[kKeyFileIndex]).
 const int kKeyFileIndex = 3;
 
+// The stream that may be shared with other entries, or compressed.
+const int kDataIndex = 1;
+
+// Size of the buffers used to compress and decompress data.
+const int kCodecBufferSize = 64 * 1024;
+
+// Compressed data is only kept if it saves at least 10% of the space.
+const int kMinCompressionSavings = 10;
+
+// Data is compressed on the cache thread when the entry is closed, so only
+// streams that can be processed quickly are compressed.
+const int kMaxCompressionSize = 512 * 1024;
+
+// Size of the chunks used to copy a shared data stream.
+const int kCopyBufferSize = 256 * 1024;
+
 // This class implements FileIOCallback to buffer the callback from a file IO
 // operation from the actual net class.
 class SyncCallback: public disk_cache::FileIOCallback {
@@ -79,6 +100,46 @@ void SyncCallback::Discard() {
 
 const int kMaxBufferSize = 1024 * 1024;  // 1 MB.
 
+// Runs the first |size| bytes of |source| through |codec|, storing the result
+// on |target|. Returns the number of bytes stored, or -1 if there is an error
+// or the result is bigger than |max_size|.
+int TransformFile(disk_cache::File* source, int size, disk_cache::File* target,
+                  disk_cache::Codec* codec, int max_size) {
+  scoped_array<char> input(new char[kCodecBufferSize]);
+  scoped_array<char> output(new char[kCodecBufferSize]);
+  int read = 0;
+  int written = 0;
+  int input_start = 0;
+  int input_end = 0;
+  while (!codec->done()) {
+    if (input_start == input_end && read < size) {
+      input_start = 0;
+      input_end = std::min(size - read, kCodecBufferSize);
+      if (!source->Read(input.get(), input_end, read))
+        return -1;
+      read += input_end;
+    }
+
+    bool finish = read == size;
+    int input_len = input_end - input_start;
+    int output_len = kCodecBufferSize;
+    if (!codec->Process(input.get() + input_start, &input_len, output.get(),
+                        &output_len, finish)) {
+      return -1;
+    }
+    if (finish && !input_len && !output_len && !codec->done())
+      return -1;
+
+    input_start += input_len;
+    if (written + output_len > max_size)
+      return -1;
+    if (output_len && !target->Write(output.get(), output_len, written))
+      return -1;
+    written += output_len;
+  }
+  return written;
+}
+
 }  // namespace
 
 namespace disk_cache {
@@ -291,9 +352,240 @@ bool EntryImpl::UserBuffer::GrowBuffer(int required, int limit) {
 
 // ------------------------------------------------------------------------
 
+// This class reads data from a compressed stream. Reads are expected to be
+// sequential, so the object keeps the state of the decompression between
+// reads. Going backwards requires restarting from the beginning, and going
+// forward requires decompressing (and discarding) the data on the gap.
+class EntryImpl::Decompressor {
+ public:
+  Decompressor(File* file, CodecType type, int compressed_size)
+      : file_(file), type_(type), compressed_size_(compressed_size),
+        input_(new char[kCodecBufferSize]), offset_(0), file_offset_(0),
+        input_start_(0), input_end_(0) {}
+  ~Decompressor() {}
+
+  // Reads |len| bytes of the uncompressed data at |offset|. Returns the number
+  // of bytes read, or a net error code.
+  int Read(int offset, char* buffer, int len);
+
+ private:
+  // Decompresses up to |len| bytes from the current position.
+  int Decompress(char* buffer, int len);
+
+  scoped_refptr<File> file_;
+  CodecType type_;
+  int compressed_size_;
+  scoped_ptr<Codec> codec_;
+  scoped_array<char> input_;
+  int offset_;  // Current position on the uncompressed data.
+  int file_offset_;  // Next byte to read from the file.
+  int input_start_;  // Data pending on input_.
+  int input_end_;
+
+  DISALLOW_COPY_AND_ASSIGN(Decompressor);
+};
+
+int EntryImpl::Decompressor::Read(int offset, char* buffer, int len) {
+  if (!codec_.get() || offset < offset_) {
+    codec_.reset(Codec::Create(type_, false));
+    if (!codec_.get())
+      return net::ERR_FAILED;
+    offset_ = 0;
+    file_offset_ = 0;
+    input_start_ = input_end_ = 0;
+  }
+
+  if (offset > offset_) {
+    scoped_array<char> scratch(new char[kCodecBufferSize]);
+    while (offset > offset_) {
+      int rv = Decompress(scratch.get(),
+                          std::min(offset - offset_, kCodecBufferSize));
+      if (rv <= 0)
+        return net::ERR_FAILED;
+    }
+  }
+
+  int total = 0;
+  while (total < len) {
+    int rv = Decompress(buffer + total, len - total);
+    if (rv < 0)
+      return rv;
+    if (!rv)
+      break;
+    total += rv;
+  }
+  return total;
+}
+
+int EntryImpl::Decompressor::Decompress(char* buffer, int len) {
+  int total = 0;
+  while (total < len && !codec_->done()) {
+    if (input_start_ == input_end_ && file_offset_ < compressed_size_) {
+      input_start_ = 0;
+      input_end_ = std::min(compressed_size_ - file_offset_, kCodecBufferSize);
+      if (!file_->Read(input_.get(), input_end_, file_offset_))
+        return net::ERR_FAILED;
+      file_offset_ += input_end_;
+    }
+
+    bool finish = file_offset_ == compressed_size_;
+    int input_len = input_end_ - input_start_;
+    int output_len = len - total;
+    if (!codec_->Process(input_.get() + input_start_, &input_len,
+                         buffer + total, &output_len, finish)) {
+      return net::ERR_FAILED;
+    }
+    if (finish && !input_len && !output_len && !codec_->done())
+      return net::ERR_FAILED;
+
+    input_start_ += input_len;
+    total += output_len;
+  }
+  offset_ += total;
+  return total;
+}
+
+// ------------------------------------------------------------------------
+
+// This class copies a shared data stream to a new file using asynchronous IO,
+// and then performs the write that required the copy.
+class EntryImpl::DataCopier : public FileIOCallback {
+ public:
+  DataCopier(EntryImpl* entry, File* source, File* target, Addr new_address,
+             int size, int offset, net::IOBuffer* buf, int buf_len,
+             CompletionCallback* callback, bool truncate)
+      : entry_(entry), source_(source), target_(target),
+        new_address_(new_address), size_(size), offset_(offset), buf_(buf),
+        buf_len_(buf_len), callback_(callback), truncate_(truncate),
+        buffer_(new char[kCopyBufferSize]), copied_(0), pending_(0),
+        writing_(false), starting_(false), finished_(false), result_(0) {
+    entry->AddRef();
+    entry->IncrementIoCount();
+  }
+  virtual ~DataCopier() {}
+
+  // Starts the copy. Returns the result of the write if everything completes
+  // synchronously, or ERR_IO_PENDING if the callback will be invoked. This
+  // object deletes itself when done.
+  int Start();
+
+  // FileIOCallback interface.
+  virtual void OnFileIOComplete(int bytes_copied);
+
+ private:
+  // Alternates reads and writes until the copy is done, or an operation has to
+  // complete asynchronously. |result| is the result of the last operation.
+  void DoLoop(int result);
+
+  // Switches the entry to the new file (if the copy succeeded), and performs
+  // the write.
+  void Finish(bool success);
+
+  EntryImpl* entry_;
+  scoped_refptr<File> source_;
+  scoped_refptr<File> target_;
+  Addr new_address_;
+  int size_;
+  int offset_;  // Arguments of the write.
+  scoped_refptr<net::IOBuffer> buf_;
+  int buf_len_;
+  CompletionCallback* callback_;
+  bool truncate_;
+  scoped_array<char> buffer_;
+  int copied_;  // Bytes already stored on the new file.
+  int pending_;  // Length of the current IO operation.
+  bool writing_;  // True if the current IO operation is a write.
+  bool starting_;  // True while inside Start().
+  bool finished_;
+  int result_;  // Result of the write, if finished_ is true.
+
+  DISALLOW_COPY_AND_ASSIGN(DataCopier);
+};
+
+int EntryImpl::DataCopier::Start() {
+  starting_ = true;
+  DoLoop(0);
+  starting_ = false;
+  if (!finished_)
+    return net::ERR_IO_PENDING;
+
+  int rv = result_;
+  delete this;
+  return rv;
+}
+
+void EntryImpl::DataCopier::OnFileIOComplete(int bytes_copied) {
+  DoLoop(bytes_copied);
+}
+
+void EntryImpl::DataCopier::DoLoop(int result) {
+  bool completed = true;
+  while (completed) {
+    if (result != pending_) {
+      Finish(false);
+      return;
+    }
+    if (writing_)
+      copied_ += pending_;
+
+    bool rv;
+    if (!writing_ && pending_) {
+      writing_ = true;
+      rv = target_->Write(buffer_.get(), pending_, copied_, this, &completed);
+    } else {
+      writing_ = false;
+      pending_ = std::min(size_ - copied_, kCopyBufferSize);
+      if (!pending_) {
+        Finish(true);
+        return;
+      }
+      rv = source_->Read(buffer_.get(), pending_, copied_, this, &completed);
+    }
+    if (!rv) {
+      Finish(false);
+      return;
+    }
+    result = pending_;
+  }
+}
+
+void EntryImpl::DataCopier::Finish(bool success) {
+  // The new file may be deleted by the entry.
+  source_ = NULL;
+  target_ = NULL;
+  int rv = net::ERR_FAILED;
+  if (entry_->FinishCopySharedData(new_address_, success)) {
+    rv = entry_->InternalWriteData(kDataIndex, offset_, buf_, buf_len_,
+                                   callback_, truncate_);
+  }
+  entry_->DecrementIoCount();
+
+  if (starting_) {
+    // Start() returns the result directly.
+    finished_ = true;
+    result_ = rv;
+    entry_->Release();
+    return;
+  }
+
+  if (rv != net::ERR_IO_PENDING) {
+    if (entry_->net_log().IsLoggingAllEvents()) {
+      entry_->net_log().EndEvent(
+          net::NetLog::TYPE_ENTRY_WRITE_DATA,
+          make_scoped_refptr(new ReadWriteCompleteParameters(rv)));
+    }
+    callback_->Run(rv);
+  }
+  entry_->Release();
+  delete this;
+}
+
+// ------------------------------------------------------------------------
+
 EntryImpl::EntryImpl(BackendImpl* backend, Addr address, bool read_only)
     : entry_(NULL, Addr(0)), node_(NULL, Addr(0)), backend_(backend),
-      doomed_(false), read_only_(read_only), dirty_(false) {
+      doomed_(false), read_only_(read_only), dirty_(false),
+      sequential_bytes_(-1), copying_data_(false) {
   entry_.LazyInit(backend->File(address), address);
   for (int i = 0; i < kNumStreams; i++) {
     unreported_size_[i] = 0;
@@ -384,6 +676,41 @@ int EntryImpl::GetAvailableRangeImpl(int64 offset, int len, int64* start) {
   return sparse_->GetAvailableRange(offset, len, start);
 }
 
+int EntryImpl::GetDataFileImpl(int index, base::PlatformFile* file,
+                               int64* offset) {
+  if (index < 0 || index >= kNumStreams)
+    return net::ERR_INVALID_ARGUMENT;
+
+  // Small streams are stored on block files.
+  int entry_size = entry_.Data()->data_size[index];
+  Addr address(entry_.Data()->data_addr[index]);
+  if (entry_size <= kMaxBlockSize ||
+      (address.is_initialized() && !address.is_separate_file())) {
+    return net::ERR_FAILED;
+  }
+
+  // The file doesn't store the actual data.
+  if (index == kDataIndex && (GetEntryFlags() & COMPRESSED_DATA))
+    return net::ERR_FAILED;
+
+  // Make sure that the file exists and has all the data.
+  if (user_buffers_[index].get() && !Flush(index, 0))
+    return net::ERR_FAILED;
+
+  address.set_value(entry_.Data()->data_addr[index]);
+  if (!address.is_initialized())
+    return net::ERR_FAILED;
+
+  *file = base::CreatePlatformFile(
+      backend_->GetFileName(address),
+      base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_READ, NULL, NULL);
+  if (*file == base::kInvalidPlatformFileValue)
+    return net::ERR_FAILED;
+
+  *offset = 0;
+  return entry_size;
+}
+
 void EntryImpl::CancelSparseIOImpl() {
   if (!sparse_.get())
     return;
@@ -478,6 +805,13 @@ void EntryImpl::DeleteEntryData(bool everything) {
     CACHE_UMA(COUNTS, "DeleteHeader", 0, GetDataSize(0));
   if (GetDataSize(1))
     CACHE_UMA(COUNTS, "DeleteData", 0, GetDataSize(1));
+
+  // Other entries may be using our data.
+  if (GetEntryFlags() & SHARED_DATA)
+    UnshareData(false);
+  if (GetEntryFlags() & COMPRESSED_DATA)
+    DecompressData(false);
+
   for (int index = 0; index < kNumStreams; index++) {
     Addr address(entry_.Data()->data_addr[index]);
     if (address.is_initialized()) {
@@ -828,6 +1162,19 @@ int EntryImpl::WriteData(int index, int offset, net::IOBuffer* buf, int buf_len,
   return net::ERR_IO_PENDING;
 }
 
+int EntryImpl::GetDataFile(int index, base::PlatformFile* file, int64* offset,
+                           CompletionCallback* callback) {
+  if (!callback)
+    return GetDataFileImpl(index, file, offset);
+
+  if (index < 0 || index >= kNumStreams)
+    return net::ERR_INVALID_ARGUMENT;
+
+  backend_->background_queue()->GetDataFile(this, index, file, offset,
+                                            callback);
+  return net::ERR_IO_PENDING;
+}
+
 int EntryImpl::ReadSparseData(int64 offset, net::IOBuffer* buf, int buf_len,
                               net::CompletionCallback* callback) {
   if (!callback)
@@ -915,9 +1262,15 @@ EntryImpl::~EntryImpl() {
       int current_id = backend_->GetCurrentEntryId();
       node_.Data()->dirty = current_id == 1 ? -1 : current_id - 1;
       node_.Store();
-    } else if (node_.HasData() && !dirty_) {
-      node_.Data()->dirty = 0;
-      node_.Store();
+    } else {
+      // Data that is compressed is not shared.
+      CompressData();
+      if (content_hash_.get())
+        ShareData();
+      if (node_.HasData() && !dirty_) {
+        node_.Data()->dirty = 0;
+        node_.Store();
+      }
     }
   }
 
@@ -952,6 +1305,13 @@ int EntryImpl::InternalReadData(int index, int offset, net::IOBuffer* buf,
   backend_->OnEvent(Stats::READ_DATA);
   backend_->OnRead(buf_len);
 
+  if (index == kDataIndex && (GetEntryFlags() & COMPRESSED_DATA)) {
+    // Decompress the data right away.
+    buf_len = ReadCompressedData(offset, buf, buf_len);
+    ReportIOTime(kRead, start);
+    return buf_len;
+  }
+
   Addr address(entry_.Data()->data_addr[index]);
   int eof = address.is_initialized() ? entry_size : 0;
   if (user_buffers_[index].get() &&
@@ -1023,10 +1383,32 @@ int EntryImpl::InternalWriteData(int index, int offset, net::IOBuffer* buf,
 
   TimeTicks start = TimeTicks::Now();
 
+  // Writing to a shared or compressed file is not an option.
+  bool replace = !offset && truncate;
+  if (index == kDataIndex && copying_data_)
+    return net::ERR_CACHE_OPERATION_NOT_SUPPORTED;
+  if (index == kDataIndex && (GetEntryFlags() & SHARED_DATA)) {
+    // Copying a big file takes a while, so it is done in the background when
+    // the caller can wait for it.
+    if (!replace && callback && IsDataInUse())
+      return CopySharedData(offset, buf, buf_len, callback, truncate);
+    if (!UnshareData(!replace))
+      return net::ERR_FAILED;
+  }
+  if (index == kDataIndex && (GetEntryFlags() & COMPRESSED_DATA) &&
+      !DecompressData(!replace)) {
+    return net::ERR_FAILED;
+  }
+
   // Read the size at this point (it may change inside prepare).
   int entry_size = entry_.Data()->data_size[index];
   bool extending = entry_size < offset + buf_len;
   truncate = truncate && entry_size > offset + buf_len;
+  if (index == kDataIndex &&
+      (backend_->content_store() || backend_->compression_policy())) {
+    UpdateContentHash(offset, buf, buf_len,
+                      replace || (!offset && entry_size <= buf_len));
+  }
   Trace("To PrepareTarget 0x%x", entry_.address().value());
   if (!PrepareTarget(index, offset, buf_len, truncate))
     return net::ERR_FAILED;
@@ -1412,6 +1794,313 @@ void EntryImpl::UpdateSize(int index, int old_size, int new_size) {
   entry_.set_modified();
 }
 
+void EntryImpl::UpdateContentHash(int offset, net::IOBuffer* buf, int buf_len,
+                                  bool replace) {
+  // Sparse data is not shared nor compressed.
+  if (GetEntryFlags() & (PARENT_ENTRY | CHILD_ENTRY))
+    return;
+
+  if (replace) {
+    if (backend_->content_store()) {
+      content_hash_.reset(
+          crypto::SecureHash::Create(crypto::SecureHash::SHA256));
+    }
+    sequential_bytes_ = 0;
+  }
+
+  // We only know the hash of data written sequentially, from the start.
+  if (sequential_bytes_ < 0)
+    return;
+  if (offset != sequential_bytes_) {
+    content_hash_.reset();
+    sequential_bytes_ = -1;
+    return;
+  }
+
+  if (buf_len && content_hash_.get())
+    content_hash_->Update(buf->data(), buf_len);
+  sequential_bytes_ += buf_len;
+}
+
+void EntryImpl::ShareData() {
+  scoped_ptr<crypto::SecureHash> hash(content_hash_.release());
+  ContentStore* store = backend_->content_store();
+  int size = entry_.Data()->data_size[kDataIndex];
+  Addr address(entry_.Data()->data_addr[kDataIndex]);
+
+  // Small streams are not worth the trouble.
+  if (!store || sequential_bytes_ != size || size <= kMaxBlockSize ||
+      !address.is_separate_file() ||
+      (GetEntryFlags() & (PARENT_ENTRY | CHILD_ENTRY | SHARED_DATA |
+                          COMPRESSED_DATA))) {
+    return;
+  }
+
+  COMPILE_ASSERT(ContentStore::kHashSize == crypto::SHA256_LENGTH,
+                 bad_content_hash_size);
+  char digest[crypto::SHA256_LENGTH];
+  hash->Finish(digest, sizeof(digest));
+
+  int record = store->Find(digest, size);
+  if (record < 0) {
+    // From now on, this file belongs to the store.
+    record = store->Insert(digest, address, size);
+    if (record < 0)
+      return;
+    backend_->OnEvent(Stats::DEDUP_MISS);
+  } else {
+    // Switch to the stored file, and get rid of ours. The size of the data is
+    // already accounted for by the first entry that stored it.
+    store->AddRef(record);
+    entry_.Data()->data_addr[kDataIndex] = store->GetAddress(record).value();
+    backend_->ModifyStorageSize(size, 0);
+    backend_->OnEvent(Stats::DEDUP_HIT);
+  }
+
+  entry_.Data()->content_record = record;
+  entry_.Data()->flags |= SHARED_DATA;
+  entry_.Store();
+
+  if (address.value() != entry_.Data()->data_addr[kDataIndex])
+    DeleteData(address, kDataIndex);
+  files_[kDataIndex] = NULL;
+}
+
+bool EntryImpl::UnshareData(bool copy_data) {
+  DCHECK(GetEntryFlags() & SHARED_DATA);
+  ContentStore* store = backend_->content_store();
+  int size = entry_.Data()->data_size[kDataIndex];
+  Addr address(entry_.Data()->data_addr[kDataIndex]);
+  int record = entry_.Data()->content_record;
+  DCHECK(!unreported_size_[kDataIndex]);
+
+  // If we don't know who else is using the file, it cannot be deleted.
+  bool valid = store && store->IsValid(record, address);
+  LOG_IF(ERROR, !valid) << "Unknown shared file " << address.value();
+  if (valid && store->Release(record)) {
+    // We are the only user of the file.
+    entry_.Data()->flags &= ~SHARED_DATA;
+    entry_.Data()->content_record = 0;
+    entry_.Store();
+    return true;
+  }
+
+  Addr new_address;
+  if (copy_data) {
+    if (!backend_->CreateExternalFile(&new_address))
+      return false;
+    if (!file_util::CopyFile(backend_->GetFileName(address),
+                             backend_->GetFileName(new_address))) {
+      DeleteData(new_address, kDataIndex);
+      return false;
+    }
+    backend_->ModifyStorageSize(0, size);
+  } else {
+    entry_.Data()->data_size[kDataIndex] = 0;
+  }
+
+  files_[kDataIndex] = NULL;
+  entry_.Data()->data_addr[kDataIndex] = new_address.value();
+  entry_.Data()->flags &= ~SHARED_DATA;
+  entry_.Data()->content_record = 0;
+  entry_.Store();
+  return true;
+}
+
+bool EntryImpl::IsDataInUse() {
+  ContentStore* store = backend_->content_store();
+  Addr address(entry_.Data()->data_addr[kDataIndex]);
+  int record = entry_.Data()->content_record;
+  return !store || !store->IsValid(record, address) ||
+         store->GetRefs(record) > 1;
+}
+
+int EntryImpl::CopySharedData(int offset, net::IOBuffer* buf, int buf_len,
+                              CompletionCallback* callback, bool truncate) {
+  DCHECK(!copying_data_);
+  Addr address(entry_.Data()->data_addr[kDataIndex]);
+  File* source = GetExternalFile(address, kDataIndex);
+  if (!source)
+    return net::ERR_FAILED;
+
+  Addr new_address;
+  if (!backend_->CreateExternalFile(&new_address))
+    return net::ERR_FAILED;
+
+  scoped_refptr<File> target(new File(false));
+  if (!target->Init(backend_->GetFileName(new_address))) {
+    DeleteData(new_address, kDataIndex);
+    return net::ERR_FAILED;
+  }
+
+  // We keep our reference to the shared file until the copy is done, so that
+  // nobody deletes it.
+  copying_data_ = true;
+  DataCopier* copier = new DataCopier(this, source, target, new_address,
+                                      entry_.Data()->data_size[kDataIndex],
+                                      offset, buf, buf_len, callback, truncate);
+  return copier->Start();
+}
+
+bool EntryImpl::FinishCopySharedData(Addr new_address, bool success) {
+  DCHECK(copying_data_);
+  DCHECK(GetEntryFlags() & SHARED_DATA);
+  copying_data_ = false;
+  if (!success) {
+    DeleteData(new_address, kDataIndex);
+    return false;
+  }
+
+  ContentStore* store = backend_->content_store();
+  int size = entry_.Data()->data_size[kDataIndex];
+  Addr address(entry_.Data()->data_addr[kDataIndex]);
+  int record = entry_.Data()->content_record;
+  bool last = store && store->IsValid(record, address) &&
+              store->Release(record);
+
+  files_[kDataIndex] = NULL;
+  entry_.Data()->data_addr[kDataIndex] = new_address.value();
+  entry_.Data()->flags &= ~SHARED_DATA;
+  entry_.Data()->content_record = 0;
+  entry_.Store();
+
+  // If the other entries went away during the copy, the shared file is ours
+  // (and its size is already accounted for).
+  if (last)
+    DeleteData(address, kDataIndex);
+  else
+    backend_->ModifyStorageSize(0, size);
+  return true;
+}
+
+void EntryImpl::CompressData() {
+  const CompressionPolicy* policy = backend_->compression_policy();
+  int size = entry_.Data()->data_size[kDataIndex];
+  Addr address(entry_.Data()->data_addr[kDataIndex]);
+
+  // Small streams are stored on block files.
+  if (!policy || sequential_bytes_ != size || size <= kMaxBlockSize ||
+      size > kMaxCompressionSize || !address.is_separate_file() ||
+      (GetEntryFlags() & (PARENT_ENTRY | CHILD_ENTRY | SHARED_DATA |
+                          COMPRESSED_DATA))) {
+    return;
+  }
+
+  File* file = GetExternalFile(address, kDataIndex);
+  if (!file)
+    return;
+
+  // Let the policy take a look at the first bytes of the data.
+  TimeTicks start = TimeTicks::Now();
+  char header[kMaxBlockSize];
+  if (!file->Read(header, sizeof(header), 0))
+    return;
+
+  CodecType type = policy->GetCodec(header, sizeof(header));
+  scoped_ptr<Codec> codec(Codec::Create(type, true));
+  if (!codec.get())
+    return;
+
+  Addr new_address;
+  if (!backend_->CreateExternalFile(&new_address))
+    return;
+
+  FilePath name = backend_->GetFileName(new_address);
+  scoped_refptr<File> new_file(new File(false));
+  int max_size = size - size / 100 * kMinCompressionSavings;
+  int compressed_size = -1;
+  if (new_file->Init(name)) {
+    compressed_size = TransformFile(file, size, new_file, codec.get(),
+                                    max_size);
+  }
+  new_file = NULL;
+  CACHE_UMA(AGE_MS, "CompressTime", 0, start);
+
+  if (compressed_size <= 0) {
+    // Not worth it (or we failed).
+    DeleteCacheFile(name);
+    return;
+  }
+
+  entry_.Data()->data_addr[kDataIndex] = new_address.value();
+  entry_.Data()->codec = type;
+  entry_.Data()->compressed_size = compressed_size;
+  entry_.Data()->flags |= COMPRESSED_DATA;
+  entry_.Store();
+  DeleteData(address, kDataIndex);
+
+  backend_->ModifyStorageSize(size, compressed_size);
+  backend_->OnCompression(size, compressed_size);
+  CACHE_UMA(PERCENTAGE, "CompressionSavings", 0,
+            static_cast<int>((size - compressed_size) * 100LL / size));
+}
+
+bool EntryImpl::DecompressData(bool copy_data) {
+  DCHECK(GetEntryFlags() & COMPRESSED_DATA);
+  int size = entry_.Data()->data_size[kDataIndex];
+  int compressed_size = entry_.Data()->compressed_size;
+  Addr address(entry_.Data()->data_addr[kDataIndex]);
+  decompressor_.reset();
+
+  Addr new_address;
+  if (copy_data) {
+    File* file = GetExternalFile(address, kDataIndex);
+    scoped_ptr<Codec> codec(
+        Codec::Create(static_cast<CodecType>(entry_.Data()->codec), false));
+    if (!file || !codec.get() || !backend_->CreateExternalFile(&new_address))
+      return false;
+
+    FilePath name = backend_->GetFileName(new_address);
+    scoped_refptr<File> new_file(new File(false));
+    int rv = -1;
+    if (new_file->Init(name))
+      rv = TransformFile(file, compressed_size, new_file, codec.get(), size);
+    new_file = NULL;
+    if (rv != size) {
+      DeleteCacheFile(name);
+      return false;
+    }
+    backend_->ModifyStorageSize(compressed_size, size);
+  } else {
+    backend_->ModifyStorageSize(compressed_size, 0);
+    entry_.Data()->data_size[kDataIndex] = 0;
+  }
+
+  entry_.Data()->data_addr[kDataIndex] = new_address.value();
+  entry_.Data()->flags &= ~COMPRESSED_DATA;
+  entry_.Data()->codec = CODEC_NONE;
+  entry_.Data()->compressed_size = 0;
+  entry_.Store();
+  DeleteData(address, kDataIndex);
+  return true;
+}
+
+int EntryImpl::ReadCompressedData(int offset, net::IOBuffer* buf,
+                                  int buf_len) {
+  if (!decompressor_.get()) {
+    Addr address(entry_.Data()->data_addr[kDataIndex]);
+    if (!address.is_separate_file())
+      return net::ERR_FAILED;
+
+    File* file = GetExternalFile(address, kDataIndex);
+    if (!file)
+      return net::ERR_FAILED;
+
+    decompressor_.reset(new Decompressor(
+        file, static_cast<CodecType>(entry_.Data()->codec),
+        entry_.Data()->compressed_size));
+  }
+
+  int rv = decompressor_->Read(offset, buf->data(), buf_len);
+  if (rv >= 0 && rv != buf_len) {
+    LOG(ERROR) << "Truncated compressed data";
+    rv = net::ERR_FAILED;
+  }
+  if (rv < 0)
+    decompressor_.reset();
+  return rv;
+}
+
 int EntryImpl::InitSparseData() {
   if (sparse_.get())
     return net::OK;
@@ -12,6 +12,10 @@
 #include "net/disk_cache/storage_block.h"
 #include "net/disk_cache/storage_block-inl.h"
 
+namespace crypto {
+class SecureHash;
+}
+
 namespace disk_cache {
 
 class BackendImpl;
@@ -44,6 +48,7 @@ class EntryImpl : public Entry, public base::RefCounted<EntryImpl> {
   int WriteSparseDataImpl(int64 offset, net::IOBuffer* buf, int buf_len,
                           CompletionCallback* callback);
   int GetAvailableRangeImpl(int64 offset, int len, int64* start);
+  int GetDataFileImpl(int index, base::PlatformFile* file, int64* offset);
   void CancelSparseIOImpl();
   int ReadyForSparseIOImpl(CompletionCallback* callback);
 
@@ -147,6 +152,8 @@ class EntryImpl : public Entry, public base::RefCounted<EntryImpl> {
   virtual int WriteData(int index, int offset, net::IOBuffer* buf, int buf_len,
                         net::CompletionCallback* completion_callback,
                         bool truncate);
+  virtual int GetDataFile(int index, base::PlatformFile* file, int64* offset,
+                          net::CompletionCallback* completion_callback);
   virtual int ReadSparseData(int64 offset, net::IOBuffer* buf, int buf_len,
                              net::CompletionCallback* completion_callback);
   virtual int WriteSparseData(int64 offset, net::IOBuffer* buf, int buf_len,
@@ -162,6 +169,8 @@ class EntryImpl : public Entry, public base::RefCounted<EntryImpl> {
      kNumStreams = 3
   };
   class UserBuffer;
+  class Decompressor;
+  class DataCopier;
 
   ~EntryImpl();
 
@@ -221,6 +230,49 @@ class EntryImpl : public Entry, public base::RefCounted<EntryImpl> {
   // Updates the size of a given data stream.
   void UpdateSize(int index, int old_size, int new_size);
 
+  // Keeps track of the hash of the data stream (and whether it was written
+  // sequentially), for a write of |buf_len| bytes from |buf| at |offset| that
+  // replaces all the data if |replace| is true.
+  void UpdateContentHash(int offset, net::IOBuffer* buf, int buf_len,
+                         bool replace);
+
+  // Makes the data stream use a file that was already stored by another entry,
+  // or makes the current file available to other entries.
+  void ShareData();
+
+  // Stops sharing the file of the data stream with other entries, making a copy
+  // of the file if |copy_data| is true. Otherwise the stream is left empty.
+  // Returns false on failure.
+  bool UnshareData(bool copy_data);
+
+  // Returns true if other entries may be using the shared file of the data
+  // stream.
+  bool IsDataInUse();
+
+  // Starts copying the shared data stream to a file of its own, without
+  // blocking the cache thread, and performs the write of |buf_len| bytes from
+  // |buf| at |offset| when the copy completes. Returns a net error code.
+  int CopySharedData(int offset, net::IOBuffer* buf, int buf_len,
+                     CompletionCallback* callback, bool truncate);
+
+  // Switches the data stream to the copy stored at |new_address| once
+  // CopySharedData() is done. Returns false (and deletes the copy) if |success|
+  // is false.
+  bool FinishCopySharedData(Addr new_address, bool success);
+
+  // Replaces the file of the data stream with a compressed version, if the
+  // compression policy says so and the data was written sequentially.
+  void CompressData();
+
+  // Replaces the compressed file of the data stream with the original data if
+  // |copy_data| is true. Otherwise the stream is left empty. Returns false on
+  // failure.
+  bool DecompressData(bool copy_data);
+
+  // Reads |buf_len| bytes at |offset| from the compressed data stream. Returns
+  // the number of bytes read, or a net error code.
+  int ReadCompressedData(int offset, net::IOBuffer* buf, int buf_len);
+
   // Initializes the sparse control object. Returns a net error code.
   int InitSparseData();
 
@@ -255,6 +307,10 @@ class EntryImpl : public Entry, public base::RefCounted<EntryImpl> {
   bool read_only_;            // True if not yet writing.
   bool dirty_;                // True if we detected that this is a dirty entry.
   scoped_ptr<SparseControl> sparse_;  // Support for sparse entries.
+  scoped_ptr<crypto::SecureHash> content_hash_;  // Hash of the data stream.
+  int sequential_bytes_;      // Length of the data written sequentially, or -1.
+  scoped_ptr<Decompressor> decompressor_;  // Reads compressed data.
+  bool copying_data_;         // True while the shared data is being copied.
 
   net::BoundNetLog net_log_;
 
@@ -32,6 +32,7 @@ class DiskCacheEntryTest : public DiskCacheTestWithCache {
   void InternalAsyncIO();
   void ExternalSyncIO();
   void ExternalAsyncIO();
+  void GetDataFile();
   void StreamAccess();
   void GetKey();
   void GetTimes();
@@ -476,6 +477,60 @@ TEST_F(DiskCacheEntryTest, MemoryOnlyExternalAsyncIO) {
   ExternalAsyncIO();
 }
 
+void DiskCacheEntryTest::GetDataFile() {
+  disk_cache::Entry* entry;
+  ASSERT_EQ(net::OK, CreateEntry("the first key", &entry));
+
+  const int kSize1 = 200;
+  const int kSize2 = 40000;
+  scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kSize1));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kSize2));
+  CacheTestFillBuffer(buffer1->data(), kSize1, false);
+  CacheTestFillBuffer(buffer2->data(), kSize2, false);
+  EXPECT_EQ(kSize1, WriteData(entry, 0, 0, buffer1, kSize1, false));
+  EXPECT_EQ(kSize2, WriteData(entry, 1, 0, buffer2, kSize2, false));
+
+  // Small streams live on a block file.
+  TestCompletionCallback cb;
+  base::PlatformFile file;
+  int64 offset;
+  int rv = entry->GetDataFile(0, &file, &offset, &cb);
+  EXPECT_EQ(net::ERR_FAILED, cb.GetResult(rv));
+  rv = entry->GetDataFile(2, &file, &offset, &cb);
+  EXPECT_EQ(net::ERR_FAILED, cb.GetResult(rv));
+
+  rv = entry->GetDataFile(1, &file, &offset, &cb);
+  if (memory_only_) {
+    EXPECT_EQ(net::ERR_FAILED, cb.GetResult(rv));
+  } else {
+    ASSERT_EQ(kSize2, cb.GetResult(rv));
+    scoped_refptr<net::IOBuffer> buffer3(new net::IOBuffer(kSize2));
+    EXPECT_EQ(kSize2,
+              base::ReadPlatformFile(file, offset, buffer3->data(), kSize2));
+    EXPECT_EQ(0, memcmp(buffer2->data(), buffer3->data(), kSize2));
+    base::ClosePlatformFile(file);
+  }
+  entry->Close();
+}
+
+TEST_F(DiskCacheEntryTest, GetDataFile) {
+  InitCache();
+  GetDataFile();
+}
+
+TEST_F(DiskCacheEntryTest, GetDataFileNoBuffer) {
+  SetDirectMode();
+  InitCache();
+  cache_impl_->SetFlags(disk_cache::kNoBuffering);
+  GetDataFile();
+}
+
+TEST_F(DiskCacheEntryTest, MemoryOnlyGetDataFile) {
+  SetMemoryOnlyMode();
+  InitCache();
+  GetDataFile();
+}
+
 void DiskCacheEntryTest::StreamAccess() {
   disk_cache::Entry* entry = NULL;
   ASSERT_EQ(net::OK, CreateEntry("the first key", &entry));
@@ -1389,6 +1444,47 @@ TEST_F(DiskCacheEntryTest, MemoryOnlyHugeSparseIO) {
   HugeSparseIO();
 }
 
+// Tests sparse operations that span more children than we process at once.
+TEST_F(DiskCacheEntryTest, ManyChildrenSparseIO) {
+  SetMaxSize(50 * 1024 * 1024);
+  InitCache();
+  std::string key("the first key");
+  disk_cache::Entry* entry;
+  ASSERT_EQ(net::OK, CreateEntry(key, &entry));
+
+  // 20 children, starting in the middle of the first one.
+  const int kSize = 19 * 1024 * 1024 + 100 * 1024;
+  const int64 kOffset = 0x10000;
+  scoped_refptr<net::IOBuffer> buf_1(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buf_2(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buf_1->data(), kSize, false);
+  VerifySparseIO(entry, kOffset, buf_1, kSize, buf_2);
+  entry->Close();
+
+  ASSERT_EQ(net::OK, OpenEntry(key, &entry));
+  VerifyContentSparseIO(entry, kOffset, buf_1->data(), kSize);
+
+  // Reads stop at the end of the data.
+  TestCompletionCallback cb;
+  int rv = entry->ReadSparseData(kOffset + 5000, buf_2, kSize, &cb);
+  EXPECT_EQ(kSize - 5000, cb.GetResult(rv));
+  EXPECT_EQ(0, memcmp(buf_1->data() + 5000, buf_2->data(), kSize - 5000));
+
+  // And at the first hole.
+  const int kHoleOffset = 9 * 1024 * 1024;
+  rv = entry->WriteSparseData(kOffset + kSize + 1024 * 1024, buf_1, 1024,
+                              &cb);
+  EXPECT_EQ(1024, cb.GetResult(rv));
+  rv = entry->ReadSparseData(kHoleOffset, buf_2, kSize, &cb);
+  EXPECT_EQ(kOffset + kSize - kHoleOffset, cb.GetResult(rv));
+
+  int64 start;
+  rv = entry->GetAvailableRange(kOffset + kSize, kSize, &start, &cb);
+  EXPECT_EQ(1024, cb.GetResult(rv));
+  EXPECT_EQ(kOffset + kSize + 1024 * 1024, start);
+  entry->Close();
+}
+
 void DiskCacheEntryTest::GetAvailableRange() {
   std::string key("the first key");
   disk_cache::Entry* entry;
@@ -26,6 +26,16 @@
 // size so that we have a chance to see an element again and move it to another
 // list.
 
+// Optionally (kTinyLfu), any of the two policies can be combined with an
+// admission filter based on the access frequency of the entries: we keep a
+// sketch with the approximate number of recent uses of each entry (including
+// entries that are no longer stored) and, when an entry that is used more
+// often than the entries being created reaches the end of the list, it gets a
+// second chance instead of being evicted. The entry is flagged, so if it is not
+// used again before reaching the end of the list one more time, it will be
+// evicted. This prevents large scans of entries that are never reused from
+// flushing the popular entries out of the cache.
+
 #include "net/disk_cache/eviction.h"
 
 #include "base/compiler_specific.h"
@@ -36,6 +46,7 @@
 #include "net/disk_cache/backend_impl.h"
 #include "net/disk_cache/entry_impl.h"
 #include "net/disk_cache/experiments.h"
+#include "net/disk_cache/frequency_sketch.h"
 #include "net/disk_cache/histogram_macros.h"
 #include "net/disk_cache/trace.h"
 
@@ -49,6 +60,9 @@ const int kHighUse = 10;  // Reuse count to be on the HIGH_USE list.
 const int kTargetTime = 24 * 7;  // Time to be evicted (hours since last use).
 const int kMaxDelayedTrims = 60;
 
+// Number of created entries used to track the admission threshold.
+const int kCreatedWindow = 1000;
+
 int LowWaterAdjust(int high_water) {
   if (high_water < kCleanUpMargin)
     return 0;
@@ -62,6 +76,7 @@ namespace disk_cache {
 
 Eviction::Eviction()
     : backend_(NULL),
+      sketch_(NULL),
       init_(false),
       ALLOW_THIS_IN_INITIALIZER_LIST(factory_(this)) {
 }
@@ -75,6 +90,9 @@ void Eviction::Init(BackendImpl* backend) {
   backend_ = backend;
   rankings_ = &backend->rankings_;
   header_ = &backend_->data_->header;
+  sketch_ = backend->sketch_.get();
+  created_frequency_ = 0;
+  created_count_ = 0;
   max_size_ = LowWaterAdjust(backend_->max_size_);
   new_eviction_ = backend->new_eviction_;
   first_trim_ = true;
@@ -162,11 +180,17 @@ void Eviction::UpdateRank(EntryImpl* entry, bool modified) {
 }
 
 void Eviction::OnOpenEntry(EntryImpl* entry) {
+  if (sketch_)
+    RecordAccess(entry, false);
+
   if (new_eviction_)
     return OnOpenEntryV2(entry);
 }
 
 void Eviction::OnCreateEntry(EntryImpl* entry) {
+  if (sketch_)
+    RecordAccess(entry, true);
+
   if (new_eviction_)
     return OnCreateEntryV2(entry);
 
@@ -264,6 +288,12 @@ bool Eviction::EvictEntry(CacheRankingsBlock* node, bool empty,
     return false;
   }
 
+  if (!empty && !test_mode_ && ShouldKeepEntry(entry)) {
+    KeepEntry(entry, list);
+    entry->Release();
+    return false;
+  }
+
   ReportTrimTimes(entry);
   if (empty || !new_eviction_) {
     entry->DoomImpl();
@@ -283,6 +313,49 @@ bool Eviction::EvictEntry(CacheRankingsBlock* node, bool empty,
   return true;
 }
 
+void Eviction::RecordAccess(EntryImpl* entry, bool created) {
+  uint32 hash = entry->GetHash();
+  sketch_->Increment(hash);
+  if (created) {
+    // Keep a moving average of the frequency of the new entries.
+    created_frequency_ += sketch_->Estimate(hash);
+    if (++created_count_ >= kCreatedWindow) {
+      created_frequency_ /= 2;
+      created_count_ /= 2;
+    }
+    return;
+  }
+
+  EntryStore* info = entry->entry()->Data();
+  if (info->flags & KEPT_ENTRY) {
+    info->flags &= ~KEPT_ENTRY;
+    entry->entry()->set_modified();
+    backend_->OnEvent(Stats::KEPT_HIT);
+  }
+}
+
+bool Eviction::ShouldKeepEntry(EntryImpl* entry) {
+  if (!sketch_)
+    return false;
+
+  // This entry already had its second chance.
+  if (entry->entry()->Data()->flags & KEPT_ENTRY)
+    return false;
+
+  // Entries that were used only once are not worth keeping, and nothing is
+  // kept unless there are new entries to compare with.
+  int frequency = sketch_->Estimate(entry->GetHash());
+  return frequency > 1 && frequency * created_count_ > created_frequency_;
+}
+
+void Eviction::KeepEntry(EntryImpl* entry, Rankings::List list) {
+  EntryStore* info = entry->entry()->Data();
+  info->flags |= KEPT_ENTRY;
+  entry->entry()->Store();
+  rankings_->UpdateRank(entry->rankings(), false, list);
+  backend_->OnEvent(Stats::TRIM_KEPT);
+}
+
 // -----------------------------------------------------------------------
 
 void Eviction::TrimCacheV2(bool empty) {
@@ -15,6 +15,7 @@ namespace disk_cache {
 
 class BackendImpl;
 class EntryImpl;
+class FrequencySketch;
 
 // This class implements the eviction algorithm for the cache and it is tightly
 // integrated with BackendImpl.
@@ -52,6 +53,13 @@ class Eviction {
   Rankings::List GetListForEntry(EntryImpl* entry);
   bool EvictEntry(CacheRankingsBlock* node, bool empty, Rankings::List list);
 
+  // Admission policy (TinyLFU). An entry that is about to be evicted is kept
+  // (once) if it is used more often than the entries that are being added to
+  // the cache.
+  void RecordAccess(EntryImpl* entry, bool created);
+  bool ShouldKeepEntry(EntryImpl* entry);
+  void KeepEntry(EntryImpl* entry, Rankings::List list);
+
   // We'll just keep for a while a separate set of methods that implement the
   // new eviction algorithm. This code will replace the original methods when
   // finished.
@@ -72,6 +80,9 @@ class Eviction {
   BackendImpl* backend_;
   Rankings* rankings_;
   IndexHeader* header_;
+  FrequencySketch* sketch_;
+  int64 created_frequency_;  // Total frequency of recently created entries.
+  int created_count_;  // Number of recently created entries.
   int max_size_;
   int trim_delays_;
   bool new_eviction_;
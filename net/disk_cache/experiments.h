@@ -17,7 +17,9 @@ enum {
   EXPERIMENT_OLD_FILE2 = 4,
   EXPERIMENT_DELETED_LIST_OUT = 11,
   EXPERIMENT_DELETED_LIST_CONTROL = 12,
-  EXPERIMENT_DELETED_LIST_IN = 13
+  EXPERIMENT_DELETED_LIST_IN = 13,
+  EXPERIMENT_TINY_LFU_CONTROL = 14,
+  EXPERIMENT_TINY_LFU_IN = 15
 };
 
 }  // namespace disk_cache
@@ -52,6 +52,14 @@ class File : public base::RefCounted<File> {
   bool Read(void* buffer, size_t buffer_len, size_t offset);
   bool Write(const void* buffer, size_t buffer_len, size_t offset);
 
+  // Writes |num_buffers| buffers to consecutive locations of the file, starting
+  // at |offset|, with a single (synchronous) IO operation when possible.
+  bool WriteGather(const void* const* buffers, const size_t* lengths,
+                   int num_buffers, size_t offset);
+
+  // Forces the data written so far to reach the disk.
+  bool SyncData();
+
   // Performs asynchronous IO. callback will be called when the IO completes,
   // as an APC on the thread that queued the operation.
   bool Read(void* buffer, size_t buffer_len, size_t offset,
@@ -4,19 +4,60 @@
 
 #include "net/disk_cache/file.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
+#include "base/eintr_wrapper.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/threading/worker_pool.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/in_flight_io.h"
 
+#if defined(USE_IO_URING)
+#include "net/disk_cache/io_uring_linux.h"
+#endif
+
 namespace {
 
+#if defined(USE_IO_URING)
+// The number of operations that can be queued on the io_uring at once. Any
+// operation in excess goes to the WorkerPool.
+const int kIoUringEntries = 256;
+
+// Owns the io_uring used for all asynchronous IO.
+class IoUringHolder {
+ public:
+  IoUringHolder() : ring_(disk_cache::IoUring::Create(kIoUringEntries)) {}
+
+  // Returns NULL if io_uring is not available.
+  disk_cache::IoUring* ring() { return ring_; }
+
+ private:
+  disk_cache::IoUring* ring_;
+
+  DISALLOW_COPY_AND_ASSIGN(IoUringHolder);
+};
+
+// The ring (and its thread) lives until the process goes away, just like the
+// threads of the WorkerPool.
+base::LazyInstance<IoUringHolder, base::LeakyLazyInstanceTraits<IoUringHolder> >
+    g_io_uring(base::LINKER_INITIALIZED);
+#endif  // defined(USE_IO_URING)
+
 // This class represents a single asynchronous IO operation while it is being
 // bounced between threads.
-class FileBackgroundIO : public disk_cache::BackgroundIO {
+class FileBackgroundIO : public disk_cache::BackgroundIO
+#if defined(USE_IO_URING)
+                       , public disk_cache::IoUring::Operation
+#endif
+                       {
  public:
   // Other than the actual parameters for the IO operation (including the
   // |callback| that must be notified at the end), we need the controller that
@@ -24,10 +65,11 @@ class FileBackgroundIO : public disk_cache::BackgroundIO {
   // (we do NOT invoke the callback), in the worker thead that completed the
   // operation.
   FileBackgroundIO(disk_cache::File* file, const void* buf, size_t buf_len,
-                   size_t offset, disk_cache::FileIOCallback* callback,
+                   size_t offset, bool read,
+                   disk_cache::FileIOCallback* callback,
                    disk_cache::InFlightIO* controller)
       : disk_cache::BackgroundIO(controller), callback_(callback), file_(file),
-        buf_(buf), buf_len_(buf_len), offset_(offset) {
+        buf_(buf), buf_len_(buf_len), offset_(offset), read_(read) {
   }
 
   disk_cache::FileIOCallback* callback() {
@@ -46,6 +88,15 @@ class FileBackgroundIO : public disk_cache::BackgroundIO {
   void Read();
   void Write();
 
+  // Starts the operation on the io_uring, if available. Returns false if the
+  // operation has to be performed by the WorkerPool instead.
+  bool PostToIoUring();
+
+#if defined(USE_IO_URING)
+  // IoUring::Operation implementation. Runs on the io_uring thread.
+  virtual void OnIoUringComplete(int result);
+#endif
+
  private:
   ~FileBackgroundIO() {}
 
@@ -55,6 +106,7 @@ class FileBackgroundIO : public disk_cache::BackgroundIO {
   const void* buf_;
   size_t buf_len_;
   size_t offset_;
+  bool read_;
 
   DISALLOW_COPY_AND_ASSIGN(FileBackgroundIO);
 };
@@ -106,16 +158,57 @@ void FileBackgroundIO::Write() {
   controller_->OnIOComplete(this);
 }
 
+bool FileBackgroundIO::PostToIoUring() {
+#if defined(USE_IO_URING)
+  disk_cache::IoUring* ring = g_io_uring.Get().ring();
+  if (!ring)
+    return false;
+
+  int fd = file_->platform_file();
+  if (read_)
+    return ring->PostRead(fd, const_cast<void*>(buf_), buf_len_, offset_, this);
+  return ring->PostWrite(fd, buf_, buf_len_, offset_, this);
+#else
+  return false;
+#endif
+}
+
+#if defined(USE_IO_URING)
+// Runs on the io_uring thread.
+void FileBackgroundIO::OnIoUringComplete(int result) {
+  // Short (or failed) transfers are completed with regular IO.
+  size_t done = result > 0 ? static_cast<size_t>(result) : 0;
+  bool rv = true;
+  if (done < buf_len_) {
+    char* buf = const_cast<char*>(static_cast<const char*>(buf_)) + done;
+    if (read_)
+      rv = file_->Read(buf, buf_len_ - done, offset_ + done);
+    else
+      rv = file_->Write(buf, buf_len_ - done, offset_ + done);
+  }
+
+  if (rv) {
+    result_ = static_cast<int>(buf_len_);
+  } else {
+    result_ = read_ ? net::ERR_CACHE_READ_FAILURE :
+                      net::ERR_CACHE_WRITE_FAILURE;
+  }
+  controller_->OnIOComplete(this);
+}
+#endif  // defined(USE_IO_URING)
+
 // ---------------------------------------------------------------------------
 
 void FileInFlightIO::PostRead(disk_cache::File *file, void* buf, size_t buf_len,
                           size_t offset, disk_cache::FileIOCallback *callback) {
   scoped_refptr<FileBackgroundIO> operation(
-      new FileBackgroundIO(file, buf, buf_len, offset, callback, this));
+      new FileBackgroundIO(file, buf, buf_len, offset, true, callback, this));
   file->AddRef();  // Balanced on OnOperationComplete()
 
-  base::WorkerPool::PostTask(FROM_HERE,
-      NewRunnableMethod(operation.get(), &FileBackgroundIO::Read), true);
+  if (!operation->PostToIoUring()) {
+    base::WorkerPool::PostTask(FROM_HERE,
+        NewRunnableMethod(operation.get(), &FileBackgroundIO::Read), true);
+  }
   OnOperationPosted(operation);
 }
 
@@ -123,11 +216,13 @@ void FileInFlightIO::PostWrite(disk_cache::File* file, const void* buf,
                            size_t buf_len, size_t offset,
                            disk_cache::FileIOCallback* callback) {
   scoped_refptr<FileBackgroundIO> operation(
-      new FileBackgroundIO(file, buf, buf_len, offset, callback, this));
+      new FileBackgroundIO(file, buf, buf_len, offset, false, callback, this));
   file->AddRef();  // Balanced on OnOperationComplete()
 
-  base::WorkerPool::PostTask(FROM_HERE,
-      NewRunnableMethod(operation.get(), &FileBackgroundIO::Write), true);
+  if (!operation->PostToIoUring()) {
+    base::WorkerPool::PostTask(FROM_HERE,
+        NewRunnableMethod(operation.get(), &FileBackgroundIO::Write), true);
+  }
   OnOperationPosted(operation);
 }
 
@@ -218,6 +313,55 @@ bool File::Write(const void* buffer, size_t buffer_len, size_t offset) {
   return (static_cast<size_t>(ret) == buffer_len);
 }
 
+bool File::WriteGather(const void* const* buffers, const size_t* lengths,
+                       int num_buffers, size_t offset) {
+  DCHECK(init_);
+#if defined(OS_LINUX) && !defined(ANDROID)
+  while (num_buffers) {
+    int count = std::min(num_buffers, IOV_MAX);
+    struct iovec vectors[IOV_MAX];
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+      vectors[i].iov_base = const_cast<void*>(buffers[i]);
+      vectors[i].iov_len = lengths[i];
+      total += lengths[i];
+    }
+    // pwritev() reports the result as an ssize_t, and takes an off_t.
+    if (total > static_cast<size_t>(INT_MAX) ||
+        static_cast<uint64>(offset) + total >
+            static_cast<uint64>(std::numeric_limits<off_t>::max()))
+      return false;
+
+    ssize_t ret = HANDLE_EINTR(pwritev(platform_file_, vectors, count, offset));
+    if (ret < 0 || static_cast<size_t>(ret) != total)
+      return false;
+
+    buffers += count;
+    lengths += count;
+    num_buffers -= count;
+    offset += total;
+  }
+  return true;
+#else
+  // No pwritev() available, so just issue the writes back to back.
+  for (int i = 0; i < num_buffers; i++) {
+    if (!Write(buffers[i], lengths[i], offset))
+      return false;
+    offset += lengths[i];
+  }
+  return true;
+#endif
+}
+
+bool File::SyncData() {
+  DCHECK(init_);
+#if defined(OS_LINUX)
+  return !HANDLE_EINTR(fdatasync(platform_file_));
+#else
+  return !HANDLE_EINTR(fsync(platform_file_));
+#endif
+}
+
 // We have to increase the ref counter of the file before performing the IO to
 // prevent the completion to happen with an invalid handle (if the file is
 // closed while the IO is in flight).
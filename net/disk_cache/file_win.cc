@@ -154,6 +154,24 @@ bool File::Write(const void* buffer, size_t buffer_len, size_t offset) {
   return actual == size;
 }
 
+bool File::WriteGather(const void* const* buffers, const size_t* lengths,
+                       int num_buffers, size_t offset) {
+  DCHECK(init_);
+  // Note that the file is not opened with FILE_FLAG_NO_BUFFERING, so we cannot
+  // use WriteFileGather() here.
+  for (int i = 0; i < num_buffers; i++) {
+    if (!Write(buffers[i], lengths[i], offset))
+      return false;
+    offset += lengths[i];
+  }
+  return true;
+}
+
+bool File::SyncData() {
+  DCHECK(init_);
+  return FlushFileBuffers(sync_platform_file_) != FALSE;
+}
+
 // We have to increase the ref counter of the file before performing the IO to
 // prevent the completion to happen with an invalid handle (if the file is
 // closed while the IO is in flight).
@@ -0,0 +1,146 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/frequency_sketch.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/file_path.h"
+#include "base/logging.h"
+#include "base/platform_file.h"
+#include "net/disk_cache/disk_format.h"
+#include "net/disk_cache/mapped_file.h"
+
+namespace {
+
+// Each word of the table stores 8 counters of 4 bits.
+const int kCountersPerWord = 8;
+const int kMinWords = 512;
+
+// Number of counters used for each key.
+const int kNumRows = 4;
+const uint32 kSeeds[kNumRows] = {
+  0x97CB3127, 0x2F4A7C15, 0x85EBCA6B, 0xC2B2AE35
+};
+
+// We want about four counters per entry, and to start aging the counters after
+// seeing about ten accesses per entry.
+const int kCountersPerSlot = 4;
+const int kSamplesPerSlot = 10;
+
+}  // namespace
+
+namespace disk_cache {
+
+FrequencySketch::FrequencySketch() : header_(NULL), table_(NULL), mask_(0) {
+}
+
+FrequencySketch::~FrequencySketch() {
+}
+
+bool FrequencySketch::Init(const FilePath& name, int table_len) {
+  DCHECK(!file_.get());
+  int num_words = kMinWords;
+  while (num_words * kCountersPerWord < table_len * kCountersPerSlot)
+    num_words *= 2;
+  size_t size = sizeof(SketchHeader) + num_words * sizeof(uint32);
+
+  int flags = base::PLATFORM_FILE_READ |
+              base::PLATFORM_FILE_WRITE |
+              base::PLATFORM_FILE_OPEN_ALWAYS |
+              base::PLATFORM_FILE_EXCLUSIVE_WRITE;
+  bool created = false;
+  scoped_refptr<File> file(new File(
+      base::CreatePlatformFile(name, flags, &created, NULL)));
+  if (!file->IsValid())
+    return false;
+
+  // If the size of the index changed, there is no point on keeping old data.
+  bool reset = created || file->GetLength() != size;
+  if (reset && !file->SetLength(size))
+    return false;
+  file = NULL;
+
+  file_ = new MappedFile();
+  header_ = reinterpret_cast<SketchHeader*>(file_->Init(name, size));
+  if (!header_) {
+    LOG(ERROR) << "Unable to map the frequency sketch";
+    file_ = NULL;
+    return false;
+  }
+  table_ = reinterpret_cast<uint32*>(header_ + 1);
+  mask_ = num_words * kCountersPerWord - 1;
+
+  if (reset || header_->magic != kSketchMagic ||
+      header_->version != kSketchVersion || header_->num_words != num_words ||
+      header_->sample_size <= 0) {
+    *header_ = SketchHeader();
+    header_->num_words = num_words;
+    header_->sample_size = std::max(table_len, 1) * kSamplesPerSlot;
+    Reset();
+  }
+  return true;
+}
+
+void FrequencySketch::Increment(uint32 hash) {
+  DCHECK(header_);
+  uint32 indexes[kNumRows];
+  int min_count = kMaxFrequency;
+  for (int i = 0; i < kNumRows; i++) {
+    indexes[i] = GetIndex(hash, i);
+    min_count = std::min(min_count, GetCounter(indexes[i]));
+  }
+
+  if (min_count == kMaxFrequency)
+    return;
+
+  // Note that if two rows share a counter, it will be incremented only once.
+  for (int i = 0; i < kNumRows; i++) {
+    uint32 index = indexes[i];
+    if (GetCounter(index) == min_count)
+      table_[index / kCountersPerWord] += 1 << ((index % kCountersPerWord) * 4);
+  }
+
+  if (++header_->samples >= header_->sample_size)
+    Age();
+}
+
+int FrequencySketch::Estimate(uint32 hash) const {
+  DCHECK(header_);
+  int min_count = kMaxFrequency;
+  for (int i = 0; i < kNumRows; i++)
+    min_count = std::min(min_count, GetCounter(GetIndex(hash, i)));
+  return min_count;
+}
+
+void FrequencySketch::Reset() {
+  DCHECK(header_);
+  header_->samples = 0;
+  memset(table_, 0, header_->num_words * sizeof(uint32));
+}
+
+uint32 FrequencySketch::GetIndex(uint32 hash, int row) const {
+  uint32 value = hash * kSeeds[row];
+  value ^= value >> 16;
+  value *= 0x85EBCA6B;
+  value ^= value >> 13;
+  return value & mask_;
+}
+
+int FrequencySketch::GetCounter(uint32 index) const {
+  uint32 word = table_[index / kCountersPerWord];
+  return (word >> ((index % kCountersPerWord) * 4)) & kMaxFrequency;
+}
+
+void FrequencySketch::Age() {
+  // Shifting the whole word moves the low bit of each counter to the high bit
+  // of the previous one, so it has to be masked away.
+  for (int i = 0; i < header_->num_words; i++)
+    table_[i] = (table_[i] >> 1) & 0x77777777;
+  header_->samples /= 2;
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,76 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface of the cache.
+
+#ifndef NET_DISK_CACHE_FREQUENCY_SKETCH_H_
+#define NET_DISK_CACHE_FREQUENCY_SKETCH_H_
+#pragma once
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+
+class FilePath;
+
+namespace disk_cache {
+
+class MappedFile;
+struct SketchHeader;
+
+// This class keeps an approximate count of how often each entry of the cache
+// is used (including entries that are no longer stored), so that the eviction
+// code can tell apart entries that are popular from entries that are used only
+// once (TinyLFU).
+//
+// The counts are stored as a count-min sketch: four small (4-bit) counters are
+// selected by the hash of the key, and the estimated frequency is the minimum
+// of the four values. Only the smallest counters are incremented (conservative
+// update), and all counters are halved after a number of increments that is
+// proportional to the size of the table, so that the sketch follows changes on
+// the popularity of the entries.
+//
+// The sketch is stored on a memory mapped file (next to the index file), so it
+// survives browser restarts. All methods must be called from the cache thread.
+class FrequencySketch {
+ public:
+  // The maximum value of a single counter.
+  static const int kMaxFrequency = 15;
+
+  FrequencySketch();
+  ~FrequencySketch();
+
+  // Maps the sketch stored on the file |name|, creating (or resetting) it if
+  // needed. |table_len| is the number of slots of the index table, and controls
+  // the number of counters to use.
+  bool Init(const FilePath& name, int table_len);
+
+  // Records an access to the entry with the given |hash|.
+  void Increment(uint32 hash);
+
+  // Returns the estimated number of recent accesses for |hash|, between 0 and
+  // kMaxFrequency.
+  int Estimate(uint32 hash) const;
+
+  // Sets all the counters to zero.
+  void Reset();
+
+ private:
+  // Returns the position of the counter for |hash| on the given |row|.
+  uint32 GetIndex(uint32 hash, int row) const;
+  int GetCounter(uint32 index) const;
+
+  // Halves the value of every counter.
+  void Age();
+
+  scoped_refptr<MappedFile> file_;
+  SketchHeader* header_;
+  uint32* table_;
+  uint32 mask_;  // Selects a counter from the table.
+
+  DISALLOW_COPY_AND_ASSIGN(FrequencySketch);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_FREQUENCY_SKETCH_H_
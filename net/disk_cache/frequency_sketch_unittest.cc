@@ -0,0 +1,100 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/file_path.h"
+#include "base/file_util.h"
+#include "base/memory/scoped_ptr.h"
+#include "net/disk_cache/disk_cache_test_base.h"
+#include "net/disk_cache/disk_cache_test_util.h"
+#include "net/disk_cache/frequency_sketch.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+TEST_F(DiskCacheTest, FrequencySketch_Basics) {
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  ASSERT_TRUE(file_util::CreateDirectory(path));
+
+  FrequencySketch sketch;
+  ASSERT_TRUE(sketch.Init(path.AppendASCII("index_lfu"), 1024));
+
+  EXPECT_EQ(0, sketch.Estimate(0x1234));
+  sketch.Increment(0x1234);
+  EXPECT_EQ(1, sketch.Estimate(0x1234));
+
+  for (int i = 0; i < 5; i++)
+    sketch.Increment(0x5678);
+  EXPECT_EQ(5, sketch.Estimate(0x5678));
+  EXPECT_EQ(1, sketch.Estimate(0x1234));
+
+  // Counters saturate.
+  const int kMaxFrequency = FrequencySketch::kMaxFrequency;
+  for (int i = 0; i < 50; i++)
+    sketch.Increment(0x5678);
+  EXPECT_EQ(kMaxFrequency, sketch.Estimate(0x5678));
+
+  sketch.Reset();
+  EXPECT_EQ(0, sketch.Estimate(0x1234));
+  EXPECT_EQ(0, sketch.Estimate(0x5678));
+}
+
+// Tests that the counters are halved from time to time.
+TEST_F(DiskCacheTest, FrequencySketch_Aging) {
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  ASSERT_TRUE(file_util::CreateDirectory(path));
+
+  FrequencySketch sketch;
+  ASSERT_TRUE(sketch.Init(path.AppendASCII("index_lfu"), 1024));
+
+  for (int i = 0; i < 10; i++)
+    sketch.Increment(0x1234);
+  EXPECT_EQ(10, sketch.Estimate(0x1234));
+
+  // Aging takes place after 10 increments per slot.
+  for (uint32 hash = 1; hash <= 10 * 1024; hash++)
+    sketch.Increment(hash * 0x9E3779B1);
+  int frequency = sketch.Estimate(0x1234);
+  EXPECT_GE(frequency, 5);
+  EXPECT_LT(frequency, 10);
+}
+
+// Tests that the data is preserved across instances.
+TEST_F(DiskCacheTest, FrequencySketch_Persistence) {
+  FilePath path = GetCacheFilePath();
+  ASSERT_TRUE(DeleteCache(path));
+  ASSERT_TRUE(file_util::CreateDirectory(path));
+  FilePath name = path.AppendASCII("index_lfu");
+
+  {
+    FrequencySketch sketch;
+    ASSERT_TRUE(sketch.Init(name, 1024));
+    for (int i = 0; i < 3; i++)
+      sketch.Increment(0x1234);
+  }
+
+  {
+    FrequencySketch sketch;
+    ASSERT_TRUE(sketch.Init(name, 1024));
+    EXPECT_EQ(3, sketch.Estimate(0x1234));
+  }
+
+  // A different index size discards the old data.
+  {
+    FrequencySketch sketch;
+    ASSERT_TRUE(sketch.Init(name, 64 * 1024));
+    EXPECT_EQ(0, sketch.Estimate(0x1234));
+  }
+
+  // And so does a corrupt file.
+  ASSERT_EQ(8, file_util::WriteFile(name, "garbage!", 8));
+  {
+    FrequencySketch sketch;
+    ASSERT_TRUE(sketch.Init(name, 64 * 1024));
+    EXPECT_EQ(0, sketch.Estimate(0x1234));
+  }
+}
+
+}  // namespace disk_cache
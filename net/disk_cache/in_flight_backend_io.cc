@@ -145,6 +145,15 @@ void BackendIO::WriteData(EntryImpl* entry, int index, int offset,
   truncate_ = truncate;
 }
 
+void BackendIO::GetDataFile(EntryImpl* entry, int index,
+                            base::PlatformFile* file, int64* offset) {
+  operation_ = OP_GET_FILE;
+  entry_ = entry;
+  index_ = index;
+  file_ptr_ = file;
+  start_ = offset;
+}
+
 void BackendIO::ReadSparseData(EntryImpl* entry, int64 offset,
                                net::IOBuffer* buf, int buf_len) {
   operation_ = OP_READ_SPARSE;
@@ -253,6 +262,9 @@ void BackendIO::ExecuteEntryOperation() {
       result_ = entry_->WriteDataImpl(index_, offset_, buf_, buf_len_,
                                       &my_callback_, truncate_);
       break;
+    case OP_GET_FILE:
+      result_ = entry_->GetDataFileImpl(index_, file_ptr_, start_);
+      break;
     case OP_READ_SPARSE:
       result_ = entry_->ReadSparseDataImpl(offset64_, buf_, buf_len_,
                                            &my_callback_);
@@ -399,6 +411,14 @@ void InFlightBackendIO::WriteData(EntryImpl* entry, int index, int offset,
   PostOperation(operation);
 }
 
+void InFlightBackendIO::GetDataFile(EntryImpl* entry, int index,
+                                    base::PlatformFile* file, int64* offset,
+                                    CompletionCallback* callback) {
+  scoped_refptr<BackendIO> operation(new BackendIO(this, backend_, callback));
+  operation->GetDataFile(entry, index, file, offset);
+  PostOperation(operation);
+}
+
 void InFlightBackendIO::ReadSparseData(EntryImpl* entry, int64 offset,
                                        net::IOBuffer* buf, int buf_len,
                                        CompletionCallback* callback) {
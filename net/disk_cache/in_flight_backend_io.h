@@ -10,6 +10,7 @@
 #include <string>
 
 #include "base/message_loop_proxy.h"
+#include "base/platform_file.h"
 #include "base/time.h"
 #include "net/base/completion_callback.h"
 #include "net/base/io_buffer.h"
@@ -65,6 +66,8 @@ class BackendIO : public BackgroundIO {
                 int buf_len);
   void WriteData(EntryImpl* entry, int index, int offset, net::IOBuffer* buf,
                  int buf_len, bool truncate);
+  void GetDataFile(EntryImpl* entry, int index, base::PlatformFile* file,
+                   int64* offset);
   void ReadSparseData(EntryImpl* entry, int64 offset, net::IOBuffer* buf,
                       int buf_len);
   void WriteSparseData(EntryImpl* entry, int64 offset, net::IOBuffer* buf,
@@ -98,6 +101,7 @@ class BackendIO : public BackgroundIO {
     OP_MAX_BACKEND,
     OP_READ,
     OP_WRITE,
+    OP_GET_FILE,
     OP_READ_SPARSE,
     OP_WRITE_SPARSE,
     OP_GET_RANGE,
@@ -130,6 +134,7 @@ class BackendIO : public BackgroundIO {
   bool truncate_;
   int64 offset64_;
   int64* start_;
+  base::PlatformFile* file_ptr_;
   base::TimeTicks start_time_;
   Task* task_;
 
@@ -169,6 +174,8 @@ class InFlightBackendIO : public InFlightIO {
                 int buf_len, net::CompletionCallback* callback);
   void WriteData(EntryImpl* entry, int index, int offset, net::IOBuffer* buf,
                  int buf_len, bool truncate, net::CompletionCallback* callback);
+  void GetDataFile(EntryImpl* entry, int index, base::PlatformFile* file,
+                   int64* offset, net::CompletionCallback* callback);
   void ReadSparseData(EntryImpl* entry, int64 offset, net::IOBuffer* buf,
                       int buf_len, net::CompletionCallback* callback);
   void WriteSparseData(EntryImpl* entry, int64 offset, net::IOBuffer* buf,
@@ -0,0 +1,267 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/index_checker.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/message_loop_proxy.h"
+#include "base/platform_file.h"
+#include "base/stringprintf.h"
+#include "base/task.h"
+#include "base/threading/worker_pool.h"
+#include "net/disk_cache/addr.h"
+
+namespace {
+
+// Same as BlockFiles::Name().
+const char* kBlockName = "data_";
+
+// Number of buckets to check between looks at the stop flag.
+const int kStopCheckInterval = 256;
+
+// An entry chain longer than this is most likely a loop.
+const int kMaxChainLength = 1024;
+
+}  // namespace
+
+namespace disk_cache {
+
+// Provides access to the block files for a single worker task.
+class IndexChecker::Worker {
+ public:
+  explicit Worker(const FilePath& path);
+  ~Worker();
+
+  // Returns true if the blocks pointed to by |address| are in use.
+  bool IsUsed(Addr address);
+
+  // Reads |size| bytes from the first block pointed to by |address|.
+  bool Read(Addr address, void* buffer, int size);
+
+ private:
+  // Returns the header of a given block file, or NULL.
+  BlockFileHeader* GetHeader(int index);
+
+  FilePath path_;
+  base::PlatformFile files_[kMaxBlockFile + 1];
+  scoped_ptr<BlockFileHeader> headers_[kMaxBlockFile + 1];
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+IndexChecker::Worker::Worker(const FilePath& path) : path_(path) {
+  for (int i = 0; i <= kMaxBlockFile; i++)
+    files_[i] = base::kInvalidPlatformFileValue;
+}
+
+IndexChecker::Worker::~Worker() {
+  for (int i = 0; i <= kMaxBlockFile; i++) {
+    if (files_[i] != base::kInvalidPlatformFileValue)
+      base::ClosePlatformFile(files_[i]);
+  }
+}
+
+bool IndexChecker::Worker::IsUsed(Addr address) {
+  if (!address.is_initialized() || !address.is_block_file() ||
+      !address.SanityCheck()) {
+    return false;
+  }
+
+  BlockFileHeader* header = GetHeader(address.FileNumber());
+  if (!header || header->entry_size != address.BlockSize())
+    return false;
+
+  int start = address.start_block();
+  int size = address.num_blocks();
+  if (start + size > header->max_entries || start % 4 + size > 4)
+    return false;
+
+  // Same as UsedMapBlock() on block_files.cc.
+  const uint8* byte_map = reinterpret_cast<uint8*>(header->allocation_map);
+  uint8 used = ((1 << size) - 1) << (start % 8);
+  return (byte_map[start / 8] & used) == used;
+}
+
+bool IndexChecker::Worker::Read(Addr address, void* buffer, int size) {
+  DCHECK_LE(size, address.BlockSize() * address.num_blocks());
+  if (!GetHeader(address.FileNumber()))
+    return false;
+
+  int64 offset = static_cast<int64>(address.start_block()) *
+                 address.BlockSize() + kBlockHeaderSize;
+  return base::ReadPlatformFile(files_[address.FileNumber()], offset,
+                                static_cast<char*>(buffer), size) == size;
+}
+
+BlockFileHeader* IndexChecker::Worker::GetHeader(int index) {
+  if (headers_[index].get())
+    return headers_[index].get();
+
+  if (files_[index] == base::kInvalidPlatformFileValue) {
+    std::string name = base::StringPrintf("%s%d", kBlockName, index);
+    files_[index] = base::CreatePlatformFile(
+        path_.AppendASCII(name),
+        base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_READ, NULL, NULL);
+    if (files_[index] == base::kInvalidPlatformFileValue)
+      return NULL;
+  }
+
+  scoped_ptr<BlockFileHeader> header(new BlockFileHeader);
+  if (base::ReadPlatformFile(files_[index], 0, reinterpret_cast<char*>(
+          header.get()), sizeof(*header)) != sizeof(*header) ||
+      header->magic != kBlockMagic) {
+    return NULL;
+  }
+  headers_[index].swap(header);
+  return headers_[index].get();
+}
+
+// ------------------------------------------------------------------------
+
+IndexChecker::IndexChecker(const FilePath& path, const CacheAddr* table,
+                           int table_len, int32 current_id)
+    : path_(path),
+      table_(table, table + table_len),
+      states_(table_len, BUCKET_PENDING),
+      mask_(table_len - 1),
+      current_id_(current_id),
+      done_event_(true, false),
+      stop_(0),
+      pending_workers_(0),
+      num_checked_(0),
+      num_entries_(0),
+      num_damaged_(0) {
+  DCHECK(table_len && !(table_len & mask_));
+}
+
+IndexChecker::~IndexChecker() {
+}
+
+void IndexChecker::Start(int num_workers, base::MessageLoopProxy* thread,
+                         Task* done_task) {
+  DCHECK(!thread_);
+  DCHECK_GT(num_workers, 0);
+  thread_ = thread;
+  done_task_.reset(done_task);
+
+  int table_len = static_cast<int>(table_.size());
+  num_workers = std::min(num_workers, table_len);
+  base::subtle::NoBarrier_Store(&pending_workers_, num_workers);
+
+  int range = (table_len + num_workers - 1) / num_workers;
+  for (int i = 0; i < num_workers; i++) {
+    int begin = i * range;
+    int end = std::min(begin + range, table_len);
+    base::WorkerPool::PostTask(
+        FROM_HERE, NewRunnableMethod(this, &IndexChecker::CheckRange, begin,
+                                     end), true);
+  }
+}
+
+void IndexChecker::Stop() {
+  base::subtle::NoBarrier_Store(&stop_, 1);
+}
+
+void IndexChecker::WaitForCompletion() {
+  done_event_.Wait();
+}
+
+bool IndexChecker::done() const {
+  return thread_ && !base::subtle::Acquire_Load(&pending_workers_);
+}
+
+int IndexChecker::num_checked() const {
+  return base::subtle::NoBarrier_Load(&num_checked_);
+}
+
+IndexChecker::BucketState IndexChecker::GetBucketState(int bucket) const {
+  DCHECK(done());
+  return static_cast<BucketState>(states_[bucket]);
+}
+
+int IndexChecker::num_entries() const {
+  DCHECK(done());
+  return base::subtle::NoBarrier_Load(&num_entries_);
+}
+
+int IndexChecker::num_damaged() const {
+  DCHECK(done());
+  return base::subtle::NoBarrier_Load(&num_damaged_);
+}
+
+void IndexChecker::CheckRange(int begin, int end) {
+  Worker worker(path_);
+  int num_entries = 0;
+  int num_damaged = 0;
+  int num_checked = 0;
+  for (int bucket = begin; bucket < end; bucket++) {
+    if (num_checked == kStopCheckInterval) {
+      base::subtle::NoBarrier_AtomicIncrement(&num_checked_, num_checked);
+      num_checked = 0;
+      if (base::subtle::NoBarrier_Load(&stop_))
+        break;
+    }
+
+    bool damaged = !CheckBucket(&worker, bucket, &num_entries);
+    if (damaged)
+      num_damaged++;
+    states_[bucket] = damaged ? BUCKET_DAMAGED : BUCKET_CLEAN;
+    num_checked++;
+  }
+
+  base::subtle::NoBarrier_AtomicIncrement(&num_checked_, num_checked);
+  OnWorkerDone(num_entries, num_damaged);
+}
+
+bool IndexChecker::CheckBucket(Worker* worker, int bucket, int* num_entries) {
+  Addr address(table_[bucket]);
+  for (int i = 0; address.is_initialized(); i++) {
+    if (i == kMaxChainLength || address.file_type() != BLOCK_256 ||
+        !worker->IsUsed(address)) {
+      return false;
+    }
+
+    EntryStore entry;
+    if (!worker->Read(address, &entry, sizeof(entry)) ||
+        (entry.hash & mask_) != static_cast<uint32>(bucket)) {
+      return false;
+    }
+
+    for (size_t j = 0; j < arraysize(entry.data_addr); j++) {
+      Addr data_address(entry.data_addr[j]);
+      if (data_address.is_block_file() && !worker->IsUsed(data_address))
+        return false;
+    }
+
+    // The rankings node tells us if the entry was properly closed.
+    Addr node_address(entry.rankings_node);
+    RankingsNode node;
+    if (node_address.file_type() != RANKINGS ||
+        !worker->IsUsed(node_address) ||
+        !worker->Read(node_address, &node, sizeof(node)) ||
+        node.contents != address.value() || node.dummy ||
+        (node.dirty && node.dirty != current_id_)) {
+      return false;
+    }
+
+    (*num_entries)++;
+    address.set_value(entry.next);
+  }
+  return true;
+}
+
+void IndexChecker::OnWorkerDone(int num_entries, int num_damaged) {
+  base::subtle::NoBarrier_AtomicIncrement(&num_entries_, num_entries);
+  base::subtle::NoBarrier_AtomicIncrement(&num_damaged_, num_damaged);
+  if (base::subtle::Barrier_AtomicIncrement(&pending_workers_, -1))
+    return;
+
+  // This is the last worker.
+  done_event_.Signal();
+  thread_->PostTask(FROM_HERE, done_task_.release());
+}
+
+}  // namespace disk_cache
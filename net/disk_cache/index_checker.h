@@ -0,0 +1,124 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface of the cache.
+
+#ifndef NET_DISK_CACHE_INDEX_CHECKER_H_
+#define NET_DISK_CACHE_INDEX_CHECKER_H_
+#pragma once
+
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/waitable_event.h"
+#include "net/disk_cache/disk_format.h"
+
+class Task;
+
+namespace base {
+class MessageLoopProxy;
+}
+
+namespace disk_cache {
+
+// This class validates the entries of the cache after an unclean shutdown,
+// without blocking the cache thread. The index table is split in ranges of
+// buckets that are checked in parallel by tasks running on the worker pool.
+// Each task reads the entries (and rankings nodes) directly from the block
+// files, using its own file handles, and verifies that the blocks are in use,
+// that every entry belongs to its bucket and points to a matching rankings node,
+// and that the entry was not left dirty by a previous instance of the cache.
+//
+// The checker works on a snapshot of the index, and the cache thread may
+// modify the files while the check is running, so the result is only a hint:
+// the cache thread has to go through the damaged buckets (with the regular
+// code) to actually fix them. Lookups are not blocked while the check runs;
+// they keep performing their own checks, as usual.
+class IndexChecker : public base::RefCountedThreadSafe<IndexChecker> {
+ public:
+  enum BucketState {
+    BUCKET_PENDING = 0,  // Not checked yet.
+    BUCKET_CLEAN,        // All the entries look fine.
+    BUCKET_DAMAGED       // At least one entry is dirty or invalid.
+  };
+
+  // |path| is the directory of the cache, |table| is the index table, with
+  // |table_len| slots, and |current_id| is the id used by this instance of the
+  // cache to mark entries in use.
+  IndexChecker(const FilePath& path, const CacheAddr* table, int table_len,
+               int32 current_id);
+
+  // Starts the check with |num_workers| tasks. |done_task| will be posted to
+  // |thread| when all the tasks are done.
+  void Start(int num_workers, base::MessageLoopProxy* thread, Task* done_task);
+
+  // Makes the workers finish as soon as possible. |done_task| is still posted.
+  void Stop();
+
+  // Blocks the current thread until all the workers are done.
+  void WaitForCompletion();
+
+  // Returns true when all the workers are done. Can be called from any thread.
+  bool done() const;
+
+  // Returns the number of buckets already checked. Can be called from any
+  // thread.
+  int num_checked() const;
+
+  int table_len() const {
+    return static_cast<int>(table_.size());
+  }
+
+  // The following methods can be called only after done() returns true.
+
+  // Returns the state of the given index bucket.
+  BucketState GetBucketState(int bucket) const;
+
+  // Returns the number of entries that looked fine, and the number of damaged
+  // buckets found by the workers.
+  int num_entries() const;
+  int num_damaged() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<IndexChecker>;
+  class Worker;
+
+  ~IndexChecker();
+
+  // Checks the buckets from |begin| to |end - 1|, on a worker thread.
+  void CheckRange(int begin, int end);
+
+  // Returns false if there is a problem with any entry of |bucket|. Entries
+  // that look fine are added to |num_entries|.
+  bool CheckBucket(Worker* worker, int bucket, int* num_entries);
+
+  // Called by each worker when it is done.
+  void OnWorkerDone(int num_entries, int num_damaged);
+
+  FilePath path_;
+  std::vector<CacheAddr> table_;  // Snapshot of the index table.
+  std::vector<char> states_;      // BucketState for each bucket.
+  uint32 mask_;
+  int32 current_id_;
+
+  scoped_refptr<base::MessageLoopProxy> thread_;
+  scoped_ptr<Task> done_task_;
+  base::WaitableEvent done_event_;
+
+  base::subtle::Atomic32 stop_;
+  base::subtle::Atomic32 pending_workers_;
+  base::subtle::Atomic32 num_checked_;
+  base::subtle::Atomic32 num_entries_;
+  base::subtle::Atomic32 num_damaged_;
+
+  DISALLOW_COPY_AND_ASSIGN(IndexChecker);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_INDEX_CHECKER_H_
@@ -0,0 +1,94 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/index_filter.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+
+using base::subtle::Atomic32;
+
+namespace disk_cache {
+
+IndexFilter::IndexFilter() : mask_(0), enabled_(0), fast_misses_(0) {
+  memset(const_cast<Atomic32*>(buckets_), 0, sizeof(buckets_));
+  memset(const_cast<Atomic32*>(pending_), 0, sizeof(pending_));
+}
+
+IndexFilter::~IndexFilter() {
+}
+
+void IndexFilter::Init(const CacheAddr* table, int table_len) {
+  DCHECK(table);
+  Disable();
+
+  // Note that pending_ is not reset: there may be operations in flight that
+  // were posted before the index was re-created.
+  for (int i = 0; i < kNumBuckets; i++)
+    base::subtle::NoBarrier_Store(&buckets_[i], 0);
+
+  // table_len is a power of two, and so is kNumBuckets, so the slot number
+  // has the same low bits as the hash of any entry stored on that slot. If
+  // the table is smaller than the filter, we just use fewer buckets.
+  int num_buckets = table_len < kNumBuckets ? table_len : kNumBuckets;
+  uint32 mask = static_cast<uint32>(num_buckets - 1);
+  base::subtle::NoBarrier_Store(&mask_, mask);
+  for (int i = 0; i < table_len; i++) {
+    if (table[i])
+      base::subtle::NoBarrier_AtomicIncrement(&buckets_[i & mask], 1);
+  }
+
+  base::subtle::Release_Store(&enabled_, 1);
+}
+
+void IndexFilter::Disable() {
+  base::subtle::Release_Store(&enabled_, 0);
+}
+
+bool IndexFilter::MayContain(uint32 hash) const {
+  if (!base::subtle::Acquire_Load(&enabled_))
+    return true;
+
+  // Pending creations are checked first: the cache thread increases the bucket
+  // count before releasing the pending count.
+  if (base::subtle::Acquire_Load(&pending_[hash & (kNumPendingBuckets - 1)]))
+    return true;
+
+  uint32 mask = base::subtle::NoBarrier_Load(&mask_);
+  return base::subtle::Acquire_Load(&buckets_[hash & mask]) > 0;
+}
+
+void IndexFilter::UpdateSlot(uint32 hash, CacheAddr old_value,
+                             CacheAddr new_value) {
+  if (!old_value == !new_value)
+    return;
+
+  uint32 mask = base::subtle::NoBarrier_Load(&mask_);
+  Atomic32 delta = new_value ? 1 : -1;
+  Atomic32 count = base::subtle::Barrier_AtomicIncrement(&buckets_[hash & mask],
+                                                         delta);
+  DCHECK_GE(count, 0);
+}
+
+void IndexFilter::AddPending(uint32 hash) {
+  base::subtle::Barrier_AtomicIncrement(
+      &pending_[hash & (kNumPendingBuckets - 1)], 1);
+}
+
+void IndexFilter::RemovePending(uint32 hash) {
+  Atomic32 count = base::subtle::Barrier_AtomicIncrement(
+                       &pending_[hash & (kNumPendingBuckets - 1)], -1);
+  DCHECK_GE(count, 0);
+}
+
+void IndexFilter::OnFastMiss() {
+  base::subtle::NoBarrier_AtomicIncrement(&fast_misses_, 1);
+}
+
+int IndexFilter::GetAndResetFastMisses() {
+  return base::subtle::NoBarrier_AtomicExchange(&fast_misses_, 0);
+}
+
+}  // namespace disk_cache
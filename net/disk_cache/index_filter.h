@@ -0,0 +1,85 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface of the cache.
+
+#ifndef NET_DISK_CACHE_INDEX_FILTER_H_
+#define NET_DISK_CACHE_INDEX_FILTER_H_
+#pragma once
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "net/disk_cache/disk_format.h"
+
+namespace disk_cache {
+
+// This class keeps a lock-free summary of the cache index that can be queried
+// from any thread, so that lookups for keys that are known to be missing from
+// the cache don't have to be bounced to the cache thread at all.
+//
+// The summary is a fixed number of independent buckets, selected by the low
+// bits of the hash of the key. Each bucket counts the number of non-empty
+// slots of the real index table that map to it, plus the number of entries
+// that are being created (but are not yet linked to the index table). As long
+// as every modification to the index table is reported through UpdateSlot(),
+// a bucket with a count of zero means that there is no entry with a matching
+// hash on the cache. In other words, MayContain() can return false positives
+// but never false negatives.
+//
+// All the methods that modify the table (except for the pending create counts)
+// must be called from the cache thread.
+class IndexFilter {
+ public:
+  IndexFilter();
+  ~IndexFilter();
+
+  // Rebuilds the filter from the provided index |table|, that has |table_len|
+  // slots. After this call, the filter is enabled.
+  void Init(const CacheAddr* table, int table_len);
+
+  // Disables the filter (MayContain() will return true for every hash), for
+  // instance because the index is being re-created.
+  void Disable();
+
+  // Returns true if there may be an entry on the cache for the given |hash|.
+  // This method can be called from any thread.
+  bool MayContain(uint32 hash) const;
+
+  // Updates the filter to reflect that the index slot for |hash| is changing
+  // from |old_value| to |new_value|.
+  void UpdateSlot(uint32 hash, CacheAddr old_value, CacheAddr new_value);
+
+  // Keeps track of entries that are being created. AddPending() can be called
+  // from any thread, before posting the operation to the cache thread, and
+  // RemovePending() must be called once the entry is linked to the index (or
+  // the operation failed).
+  void AddPending(uint32 hash);
+  void RemovePending(uint32 hash);
+
+  // Records that a lookup was resolved by MayContain() without going to the
+  // cache thread, and returns (and resets) the number of such lookups.
+  void OnFastMiss();
+  int GetAndResetFastMisses();
+
+ private:
+  static const int kNumBuckets = 64 * 1024;
+  static const int kNumPendingBuckets = 1024;
+
+  // The number of non-empty index slots that map to each bucket.
+  base::subtle::Atomic32 buckets_[kNumBuckets];
+
+  // The number of in-flight creations for a given bucket.
+  base::subtle::Atomic32 pending_[kNumPendingBuckets];
+
+  // Selects the bucket for a given hash; it depends on the size of the index.
+  base::subtle::Atomic32 mask_;
+  base::subtle::Atomic32 enabled_;
+  base::subtle::Atomic32 fast_misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(IndexFilter);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_INDEX_FILTER_H_
@@ -0,0 +1,72 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/scoped_ptr.h"
+#include "net/disk_cache/index_filter.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+TEST(DiskCacheIndexFilter, Disabled) {
+  scoped_ptr<disk_cache::IndexFilter> filter(new disk_cache::IndexFilter());
+  // Until the filter is initialized, everything may be on the cache.
+  EXPECT_TRUE(filter->MayContain(0x1234));
+
+  disk_cache::CacheAddr table[16] = {0};
+  filter->Init(table, 16);
+  EXPECT_FALSE(filter->MayContain(0x1234));
+
+  filter->Disable();
+  EXPECT_TRUE(filter->MayContain(0x1234));
+}
+
+TEST(DiskCacheIndexFilter, Basics) {
+  scoped_ptr<disk_cache::IndexFilter> filter(new disk_cache::IndexFilter());
+  disk_cache::CacheAddr table[16] = {0};
+  table[3] = 0x90000001;
+  filter->Init(table, 16);
+
+  // Only the low bits of the hash select the slot.
+  EXPECT_TRUE(filter->MayContain(0x3));
+  EXPECT_TRUE(filter->MayContain(0x12345673));
+  EXPECT_FALSE(filter->MayContain(0x4));
+
+  filter->UpdateSlot(0x4, 0, 0x90000002);
+  EXPECT_TRUE(filter->MayContain(0x4));
+
+  // Replacing the head of a list doesn't empty the slot.
+  filter->UpdateSlot(0x4, 0x90000002, 0x90000003);
+  EXPECT_TRUE(filter->MayContain(0x4));
+
+  filter->UpdateSlot(0x4, 0x90000003, 0);
+  EXPECT_FALSE(filter->MayContain(0x4));
+  filter->UpdateSlot(0x3, 0x90000001, 0);
+  EXPECT_FALSE(filter->MayContain(0x3));
+}
+
+TEST(DiskCacheIndexFilter, Pending) {
+  scoped_ptr<disk_cache::IndexFilter> filter(new disk_cache::IndexFilter());
+  disk_cache::CacheAddr table[16] = {0};
+  filter->Init(table, 16);
+
+  filter->AddPending(0x7);
+  filter->AddPending(0x7);
+  EXPECT_TRUE(filter->MayContain(0x7));
+
+  // Pending creations survive a rebuild of the index.
+  filter->Init(table, 16);
+  EXPECT_TRUE(filter->MayContain(0x7));
+
+  filter->RemovePending(0x7);
+  EXPECT_TRUE(filter->MayContain(0x7));
+  filter->RemovePending(0x7);
+  EXPECT_FALSE(filter->MayContain(0x7));
+}
+
+TEST(DiskCacheIndexFilter, FastMisses) {
+  disk_cache::IndexFilter filter;
+  EXPECT_EQ(0, filter.GetAndResetFastMisses());
+  filter.OnFastMiss();
+  filter.OnFastMiss();
+  EXPECT_EQ(2, filter.GetAndResetFastMisses());
+  EXPECT_EQ(0, filter.GetAndResetFastMisses());
+}
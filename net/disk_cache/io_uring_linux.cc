@@ -0,0 +1,266 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/io_uring_linux.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+
+namespace {
+
+// The user data of the operation used to stop the completion thread.
+const uint64 kShutdownData = 0;
+
+int SysIoUringSetup(uint32 entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int SysIoUringEnter(int fd, uint32 to_submit, uint32 min_complete,
+                    uint32 flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, NULL, 0));
+}
+
+base::subtle::Atomic32 LoadAcquire(const uint32* value) {
+  return base::subtle::Acquire_Load(
+      reinterpret_cast<const volatile base::subtle::Atomic32*>(value));
+}
+
+void StoreRelease(uint32* value, uint32 new_value) {
+  base::subtle::Release_Store(
+      reinterpret_cast<volatile base::subtle::Atomic32*>(value), new_value);
+}
+
+}  // namespace
+
+namespace disk_cache {
+
+IoUring::IoUring()
+    : ring_fd_(-1), sq_ring_(MAP_FAILED), sq_ring_size_(0), sq_head_(NULL),
+      sq_tail_(NULL), sq_mask_(0), sq_array_(NULL), sqes_(MAP_FAILED),
+      sqes_size_(0), cq_ring_(MAP_FAILED), cq_ring_size_(0), cq_head_(NULL),
+      cq_tail_(NULL), cq_mask_(0), cqes_(NULL), failed_(false), thread_(0) {
+}
+
+IoUring::~IoUring() {
+  if (thread_) {
+    // The completion thread exits when it sees this operation, or by itself
+    // if the ring failed.
+    while (!Post(IORING_OP_NOP, -1, NULL, 0, 0, kShutdownData) && !failed())
+      base::PlatformThread::YieldCurrentThread();
+    base::PlatformThread::Join(thread_);
+  }
+
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != MAP_FAILED)
+    munmap(sq_ring_, sq_ring_size_);
+  if (sqes_ != MAP_FAILED)
+    munmap(sqes_, sqes_size_);
+  if (ring_fd_ >= 0)
+    close(ring_fd_);
+}
+
+// Static.
+IoUring* IoUring::Create(int num_entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = SysIoUringSetup(num_entries, &params);
+  if (fd < 0)
+    return NULL;
+
+  IoUring* ring = new IoUring;
+  ring->ring_fd_ = fd;
+
+  // IORING_OP_READ and IORING_OP_WRITE were added on the same release as
+  // IORING_FEAT_RW_CUR_POS. Also, make sure that completions are never dropped.
+  const uint32 kRequiredFeatures = IORING_FEAT_RW_CUR_POS | IORING_FEAT_NODROP;
+  if ((params.features & kRequiredFeatures) != kRequiredFeatures ||
+      !ring->MapRings(&params) ||
+      !base::PlatformThread::Create(0, ring, &ring->thread_)) {
+    delete ring;
+    return NULL;
+  }
+  return ring;
+}
+
+bool IoUring::PostRead(int fd, void* buf, size_t len, size_t offset,
+                       Operation* operation) {
+  return Post(IORING_OP_READ, fd, buf, len, offset,
+              reinterpret_cast<uintptr_t>(operation));
+}
+
+bool IoUring::PostWrite(int fd, const void* buf, size_t len, size_t offset,
+                        Operation* operation) {
+  return Post(IORING_OP_WRITE, fd, buf, len, offset,
+              reinterpret_cast<uintptr_t>(operation));
+}
+
+void IoUring::ThreadMain() {
+  base::PlatformThread::SetName("Cache IO completion");
+  for (;;) {
+    int rv = SysIoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+    if (rv < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      // Waiting again would fail the same way (a bad descriptor or memory),
+      // so give up on the ring. The owner of every operation falls back to
+      // regular IO when it gets the error.
+      int error = errno;
+      PLOG(ERROR) << "io_uring_enter";
+      if (ProcessCompletions())
+        FailPendingOperations(-error);
+      return;
+    }
+    if (!ProcessCompletions())
+      return;
+  }
+}
+
+bool IoUring::MapRings(const void* raw_params) {
+  const io_uring_params* params =
+      static_cast<const io_uring_params*>(raw_params);
+
+  sq_ring_size_ = params->sq_off.array + params->sq_entries * sizeof(uint32);
+  cq_ring_size_ = params->cq_off.cqes +
+                  params->cq_entries * sizeof(io_uring_cqe);
+  bool single_map = (params->features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_map)
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+  sq_ring_ = mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED)
+    return false;
+
+  if (single_map) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED)
+      return false;
+  }
+
+  sqes_size_ = params->sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED)
+    return false;
+
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<uint32*>(sq + params->sq_off.head);
+  sq_tail_ = reinterpret_cast<uint32*>(sq + params->sq_off.tail);
+  sq_mask_ = *reinterpret_cast<uint32*>(sq + params->sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<uint32*>(sq + params->sq_off.array);
+
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<uint32*>(cq + params->cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32*>(cq + params->cq_off.tail);
+  cq_mask_ = *reinterpret_cast<uint32*>(cq + params->cq_off.ring_mask);
+  cqes_ = cq + params->cq_off.cqes;
+  return true;
+}
+
+bool IoUring::Post(int opcode, int fd, const void* buf, size_t len,
+                   size_t offset, uint64 user_data) {
+  base::AutoLock lock(lock_);
+  if (failed_)
+    return false;
+
+  // We are the only producer, so only the head can move behind our back.
+  uint32 tail = *sq_tail_;
+  uint32 head = LoadAcquire(sq_head_);
+  if (tail - head > sq_mask_)
+    return false;
+
+  uint32 index = tail & sq_mask_;
+  io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = static_cast<uint8>(opcode);
+  sqe->fd = fd;
+  sqe->off = offset;
+  sqe->addr = reinterpret_cast<uintptr_t>(buf);
+  sqe->len = static_cast<uint32>(len);
+  sqe->user_data = user_data;
+  sq_array_[index] = index;
+  StoreRelease(sq_tail_, tail + 1);
+
+  // The completion can only be delivered after we release the lock.
+  Operation* operation =
+      reinterpret_cast<Operation*>(static_cast<uintptr_t>(user_data));
+  if (user_data != kShutdownData)
+    pending_.insert(operation);
+
+  int rv;
+  do {
+    rv = SysIoUringEnter(ring_fd_, 1, 0, 0);
+  } while (rv < 0 && errno == EINTR);
+
+  if (rv != 1) {
+    // The kernel didn't take the entry (most likely because there are too many
+    // completions waiting to be processed), so take it back.
+    StoreRelease(sq_tail_, tail);
+    pending_.erase(operation);
+    return false;
+  }
+  return true;
+}
+
+bool IoUring::ProcessCompletions() {
+  bool keep_running = true;
+  uint32 head = *cq_head_;
+  for (;;) {
+    uint32 tail = LoadAcquire(cq_tail_);
+    if (head == tail)
+      break;
+
+    for (; head != tail; head++) {
+      io_uring_cqe* cqe =
+          static_cast<io_uring_cqe*>(cqes_) + (head & cq_mask_);
+      if (cqe->user_data == kShutdownData) {
+        keep_running = false;
+        continue;
+      }
+      Operation* operation = reinterpret_cast<Operation*>(
+          static_cast<uintptr_t>(cqe->user_data));
+      {
+        base::AutoLock lock(lock_);
+        pending_.erase(operation);
+      }
+      operation->OnIoUringComplete(cqe->res);
+    }
+    StoreRelease(cq_head_, head);
+  }
+  return keep_running;
+}
+
+void IoUring::FailPendingOperations(int error) {
+  std::set<Operation*> operations;
+  {
+    base::AutoLock lock(lock_);
+    failed_ = true;
+    operations.swap(pending_);
+  }
+
+  for (std::set<Operation*>::iterator it = operations.begin();
+       it != operations.end(); ++it) {
+    (*it)->OnIoUringComplete(error);
+  }
+}
+
+bool IoUring::failed() {
+  base::AutoLock lock(lock_);
+  return failed_;
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,105 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface of the cache.
+
+#ifndef NET_DISK_CACHE_IO_URING_LINUX_H_
+#define NET_DISK_CACHE_IO_URING_LINUX_H_
+#pragma once
+
+#include <set>
+
+#include "base/basictypes.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+
+namespace disk_cache {
+
+// This class is a minimal wrapper around a Linux io_uring instance, used to
+// perform the asynchronous file IO of the cache without a pool of worker
+// threads: operations are queued directly from the thread that starts them,
+// the kernel performs the IO, and a single thread (owned by this object)
+// receives all the completions.
+class IoUring : public base::PlatformThread::Delegate {
+ public:
+  // The interface to receive the result of an operation.
+  class Operation {
+   public:
+    // Called on the completion thread of the IoUring, with the result of the
+    // system call (the number of bytes transferred, or -errno).
+    virtual void OnIoUringComplete(int result) = 0;
+
+   protected:
+    virtual ~Operation() {}
+  };
+
+  virtual ~IoUring();
+
+  // Returns a new ring with room for |num_entries| concurrent submissions, or
+  // NULL if io_uring is not supported by the running kernel (or is disabled).
+  static IoUring* Create(int num_entries);
+
+  // Starts reading (or writing) |len| bytes at |offset| of the file |fd|, and
+  // notifies |operation| when done. Returns false if the operation could not
+  // be queued, in which case |operation| will not be called.
+  bool PostRead(int fd, void* buf, size_t len, size_t offset,
+                Operation* operation);
+  bool PostWrite(int fd, const void* buf, size_t len, size_t offset,
+                 Operation* operation);
+
+  // base::PlatformThread::Delegate implementation.
+  virtual void ThreadMain();
+
+ private:
+  IoUring();
+
+  // Maps the rings of |ring_fd_|, described by |params|.
+  bool MapRings(const void* params);
+
+  // Queues a new operation (and submits it to the kernel).
+  bool Post(int opcode, int fd, const void* buf, size_t len, size_t offset,
+            uint64 user_data);
+
+  // Delivers all the available completions. Returns false when the ring is
+  // being shut down.
+  bool ProcessCompletions();
+
+  // Stops accepting operations after an unrecoverable error, and completes
+  // every operation still in flight with |error|.
+  void FailPendingOperations(int error);
+
+  // Returns true if the ring stopped working.
+  bool failed();
+
+  int ring_fd_;
+
+  // Submission queue.
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  uint32* sq_head_;
+  uint32* sq_tail_;
+  uint32 sq_mask_;
+  uint32* sq_array_;
+  void* sqes_;
+  size_t sqes_size_;
+
+  // Completion queue.
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  uint32* cq_head_;
+  uint32* cq_tail_;
+  uint32 cq_mask_;
+  void* cqes_;
+
+  base::Lock lock_;  // Protects the submission queue, |pending_| and |failed_|.
+  std::set<Operation*> pending_;  // Operations handed to the kernel.
+  bool failed_;
+  base::PlatformThreadHandle thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(IoUring);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_IO_URING_LINUX_H_
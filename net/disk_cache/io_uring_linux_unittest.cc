@@ -0,0 +1,106 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/string_util.h"
+#include "base/synchronization/waitable_event.h"
+#include "net/disk_cache/disk_cache_test_base.h"
+#include "net/disk_cache/disk_cache_test_util.h"
+#include "net/disk_cache/file.h"
+#include "net/disk_cache/io_uring_linux.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+// Waits for the result of a single operation.
+class TestOperation : public disk_cache::IoUring::Operation {
+ public:
+  TestOperation() : result_(0), done_(false, false) {}
+  virtual ~TestOperation() {}
+
+  virtual void OnIoUringComplete(int result) {
+    result_ = result;
+    done_.Signal();
+  }
+
+  int WaitForResult() {
+    done_.Wait();
+    return result_;
+  }
+
+ private:
+  int result_;
+  base::WaitableEvent done_;
+};
+
+}  // namespace
+
+TEST_F(DiskCacheTest, IoUring_ReadWrite) {
+  scoped_ptr<disk_cache::IoUring> ring(disk_cache::IoUring::Create(8));
+  if (!ring.get()) {
+    LOG(WARNING) << "io_uring not available";
+    return;
+  }
+
+  FilePath filename = GetCacheFilePath().AppendASCII("a_test");
+  scoped_refptr<disk_cache::File> file(new disk_cache::File(true));
+  ASSERT_TRUE(CreateCacheTestFile(filename));
+  ASSERT_TRUE(file->Init(filename));
+
+  char buffer1[20];
+  char buffer2[20];
+  CacheTestFillBuffer(buffer1, sizeof(buffer1), false);
+  base::strlcpy(buffer1, "the data", arraysize(buffer1));
+
+  TestOperation write;
+  ASSERT_TRUE(ring->PostWrite(file->platform_file(), buffer1, sizeof(buffer1),
+                              8192, &write));
+  EXPECT_EQ(static_cast<int>(sizeof(buffer1)), write.WaitForResult());
+
+  TestOperation read;
+  ASSERT_TRUE(ring->PostRead(file->platform_file(), buffer2, sizeof(buffer2),
+                             8192, &read));
+  EXPECT_EQ(static_cast<int>(sizeof(buffer2)), read.WaitForResult());
+  EXPECT_STREQ(buffer1, buffer2);
+
+  // Reading past the end of the file is not an error for the ring itself.
+  TestOperation short_read;
+  size_t offset = file->GetLength() - 10;
+  ASSERT_TRUE(ring->PostRead(file->platform_file(), buffer2, sizeof(buffer2),
+                             offset, &short_read));
+  EXPECT_EQ(10, short_read.WaitForResult());
+}
+
+// Tests that many concurrent operations are all delivered.
+TEST_F(DiskCacheTest, IoUring_ManyOperations) {
+  scoped_ptr<disk_cache::IoUring> ring(disk_cache::IoUring::Create(8));
+  if (!ring.get())
+    return;
+
+  FilePath filename = GetCacheFilePath().AppendASCII("a_test");
+  scoped_refptr<disk_cache::File> file(new disk_cache::File(true));
+  ASSERT_TRUE(CreateCacheTestFile(filename));
+  ASSERT_TRUE(file->Init(filename));
+
+  const int kNumOperations = 8;
+  char buffer[kNumOperations][100];
+  TestOperation operations[kNumOperations];
+  for (int i = 0; i < kNumOperations; i++) {
+    CacheTestFillBuffer(buffer[i], sizeof(buffer[i]), false);
+    ASSERT_TRUE(ring->PostWrite(file->platform_file(), buffer[i],
+                                sizeof(buffer[i]), i * sizeof(buffer[i]),
+                                &operations[i]));
+  }
+  for (int i = 0; i < kNumOperations; i++)
+    EXPECT_EQ(100, operations[i].WaitForResult());
+
+  char read_buffer[100];
+  for (int i = 0; i < kNumOperations; i++) {
+    ASSERT_TRUE(file->Read(read_buffer, sizeof(read_buffer),
+                           i * sizeof(read_buffer)));
+    EXPECT_EQ(0, memcmp(buffer[i], read_buffer, sizeof(read_buffer)));
+  }
+}
@@ -0,0 +1,178 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/mapped_file.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "base/message_loop.h"
+#include "base/task.h"
+
+namespace {
+
+// The maximum amount of data to keep in memory before writing to disk.
+const size_t kMaxPendingBytes = 64 * 1024;
+
+// How long to wait before writing buffered data to disk.
+const int kFlushDelayMs = 20;
+
+}  // namespace
+
+namespace disk_cache {
+
+MappedFile::MappedFile()
+    : File(true), init_(false), batch_writes_(false), sync_writes_(false),
+      flush_posted_(false), pending_bytes_(0), num_block_writes_(0),
+      block_bytes_written_(0) {
+}
+
+void MappedFile::SetBatchWrites(bool batch, bool sync) {
+  if (!batch)
+    Flush();
+  batch_writes_ = batch;
+  sync_writes_ = sync;
+}
+
+bool MappedFile::Flush() {
+  if (pending_.empty())
+    return true;
+
+  // The map is sorted by offset, so we only have to find the runs of blocks
+  // that are next to each other.
+  bool rv = true;
+  PendingWrites::iterator begin = pending_.begin();
+  while (begin != pending_.end()) {
+    PendingWrites::iterator end = begin;
+    size_t next_offset = begin->first;
+    for (; end != pending_.end() && end->first == next_offset; ++end)
+      next_offset += end->second.size();
+
+    if (!WriteRun(begin, end))
+      rv = false;
+    begin = end;
+  }
+
+  pending_.clear();
+  pending_bytes_ = 0;
+
+  if (sync_writes_ && !SyncData())
+    rv = false;
+
+  return rv;
+}
+
+void MappedFile::DropPendingWrites(size_t offset, size_t len) {
+  PendingWrites::iterator it = pending_.lower_bound(offset);
+  while (it != pending_.end() && it->first < offset + len) {
+    DCHECK_LE(it->first + it->second.size(), offset + len);
+    pending_bytes_ -= it->second.size();
+    pending_.erase(it++);
+  }
+}
+
+bool MappedFile::StorePending(const void* buffer, size_t len, size_t offset) {
+  // Blocks are always stored using the same offset and size, so we don't
+  // expect partially overlapping data.
+  PendingWrites::iterator it = pending_.find(offset);
+  if (it != pending_.end() && it->second.size() == len) {
+    memcpy(&it->second[0], buffer, len);
+    return true;
+  }
+
+  if (it != pending_.end()) {
+    NOTREACHED();
+    if (!Flush())
+      return false;
+  }
+
+  const char* data = static_cast<const char*>(buffer);
+  pending_[offset].assign(data, data + len);
+  pending_bytes_ += len;
+
+  if (pending_bytes_ >= kMaxPendingBytes)
+    return Flush();
+
+  if (!flush_posted_ && MessageLoop::current()) {
+    flush_posted_ = true;
+    MessageLoop::current()->PostDelayedTask(FROM_HERE,
+        NewRunnableMethod(this, &MappedFile::OnFlushTask), kFlushDelayMs);
+  }
+  return true;
+}
+
+bool MappedFile::LoadPending(void* buffer, size_t len, size_t offset) {
+  if (pending_.empty())
+    return false;
+
+  PendingWrites::iterator it = pending_.find(offset);
+  if (it != pending_.end() && it->second.size() == len) {
+    memcpy(buffer, &it->second[0], len);
+    return true;
+  }
+
+  // Make sure that we don't read stale data from disk.
+  it = pending_.lower_bound(offset);
+  if (it != pending_.begin())
+    --it;
+  for (; it != pending_.end() && it->first < offset + len; ++it) {
+    if (it->first + it->second.size() > offset) {
+      Flush();
+      break;
+    }
+  }
+  return false;
+}
+
+bool MappedFile::WriteRun(PendingWrites::iterator begin,
+                          PendingWrites::iterator end) {
+  std::vector<const void*> buffers;
+  std::vector<size_t> lengths;
+  size_t total = 0;
+  for (PendingWrites::iterator it = begin; it != end; ++it) {
+    buffers.push_back(&it->second[0]);
+    lengths.push_back(it->second.size());
+    total += it->second.size();
+  }
+
+  num_block_writes_++;
+  block_bytes_written_ += total;
+  return WriteGather(&buffers[0], &lengths[0], static_cast<int>(buffers.size()),
+                     begin->first);
+}
+
+void MappedFile::OnFlushTask() {
+  flush_posted_ = false;
+  Flush();
+}
+
+bool MappedFile::Load(const FileBlock* block) {
+  size_t offset = block->offset() + view_size_;
+  if (LoadPending(block->buffer(), block->size(), offset))
+    return true;
+  return Read(block->buffer(), block->size(), offset);
+}
+
+bool MappedFile::Store(const FileBlock* block) {
+  size_t offset = block->offset() + view_size_;
+  if (batch_writes_)
+    return StorePending(block->buffer(), block->size(), offset);
+
+  num_block_writes_++;
+  block_bytes_written_ += block->size();
+  return Write(block->buffer(), block->size(), offset);
+}
+
+bool MappedFile::StoreNow(const FileBlock* block) {
+  size_t offset = block->offset() + view_size_;
+  DropPendingWrites(offset, block->size());
+
+  num_block_writes_++;
+  block_bytes_written_ += block->size();
+  if (!Write(block->buffer(), block->size(), offset))
+    return false;
+  return !batch_writes_ || !sync_writes_ || SyncData();
+}
+
+}  // namespace disk_cache
@@ -8,6 +8,9 @@
 #define NET_DISK_CACHE_MAPPED_FILE_H_
 #pragma once
 
+#include <map>
+#include <vector>
+
 #include "net/disk_cache/disk_format.h"
 #include "net/disk_cache/file.h"
 #include "net/disk_cache/file_block.h"
@@ -20,9 +23,13 @@ namespace disk_cache {
 // idea is that the header and bitmap will be memory mapped all the time, and
 // the actual data for the blocks will be access asynchronously (most of the
 // time).
+//
+// Stores can also be buffered in memory (see SetBatchWrites()), so that all
+// the blocks modified during a short period of time are written to disk at the
+// same time, in file order, and merging adjacent blocks on a single IO.
 class MappedFile : public File {
  public:
-  MappedFile() : File(true), init_(false) {}
+  MappedFile();
 
   // Performs object initialization. name is the file to use, and size is the
   // ammount of data to memory map from th efile. If size is 0, the whole file
@@ -37,10 +44,58 @@ class MappedFile : public File {
   bool Load(const FileBlock* block);
   bool Store(const FileBlock* block);
 
+  // Enables or disables the buffering of stores. While enabled, the blocks
+  // passed to Store() are kept in memory until Flush() is called, which
+  // happens automatically shortly after the first buffered store (or when
+  // there is too much data buffered). If |sync| is true, every Flush() will
+  // also force the data to reach the disk.
+  void SetBatchWrites(bool batch, bool sync);
+
+  // Writes |block| to disk right away, replacing any buffered store of it.
+  // This is used for blocks that are about to be referenced from data that is
+  // not buffered (the index table or the rankings list), so that a crash never
+  // leaves such a reference pointing to a block that was not written.
+  bool StoreNow(const FileBlock* block);
+
+  // Writes all the buffered blocks to the backing file. Returns false if any
+  // of the writes failed.
+  bool Flush();
+
+  // Discards any buffered data for the range of |len| bytes that starts at
+  // |offset| (measured from the start of the file).
+  void DropPendingWrites(size_t offset, size_t len);
+
+  // Returns the number of IO operations and bytes used to store blocks.
+  int64 num_block_writes() const { return num_block_writes_; }
+  int64 block_bytes_written() const { return block_bytes_written_; }
+
  private:
+  // Buffered stores, indexed by offset.
+  typedef std::map<size_t, std::vector<char> > PendingWrites;
+
   virtual ~MappedFile();
 
+  // Buffers a store. Returns false if the data had to be written to disk and
+  // the write failed.
+  bool StorePending(const void* buffer, size_t len, size_t offset);
+
+  // Returns true if a load was satisfied from the buffered stores.
+  bool LoadPending(void* buffer, size_t len, size_t offset);
+
+  // Writes the given run of consecutive blocks with a single IO operation.
+  bool WriteRun(PendingWrites::iterator begin, PendingWrites::iterator end);
+
+  // Task that flushes the buffered stores.
+  void OnFlushTask();
+
   bool init_;
+  bool batch_writes_;
+  bool sync_writes_;
+  bool flush_posted_;
+  PendingWrites pending_;
+  size_t pending_bytes_;
+  int64 num_block_writes_;
+  int64 block_bytes_written_;
 #if defined(OS_WIN)
   HANDLE section_;
 #endif
@@ -32,17 +32,8 @@ void* MappedFile::Init(const FilePath& name, size_t size) {
   return buffer_;
 }
 
-bool MappedFile::Load(const FileBlock* block) {
-  size_t offset = block->offset() + view_size_;
-  return Read(block->buffer(), block->size(), offset);
-}
-
-bool MappedFile::Store(const FileBlock* block) {
-  size_t offset = block->offset() + view_size_;
-  return Write(block->buffer(), block->size(), offset);
-}
-
 MappedFile::~MappedFile() {
+  Flush();
   if (!init_)
     return;
 
@@ -30,6 +30,7 @@ void* MappedFile::Init(const FilePath& name, size_t size) {
 }
 
 MappedFile::~MappedFile() {
+  Flush();
   if (!init_)
     return;
 
@@ -42,14 +43,4 @@ MappedFile::~MappedFile() {
     CloseHandle(section_);
 }
 
-bool MappedFile::Load(const FileBlock* block) {
-  size_t offset = block->offset() + view_size_;
-  return Read(block->buffer(), block->size(), offset);
-}
-
-bool MappedFile::Store(const FileBlock* block) {
-  size_t offset = block->offset() + view_size_;
-  return Write(block->buffer(), block->size(), offset);
-}
-
 }  // namespace disk_cache
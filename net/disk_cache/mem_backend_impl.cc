@@ -5,6 +5,7 @@
 #include "net/disk_cache/mem_backend_impl.h"
 
 #include "base/logging.h"
+#include "base/string_number_conversions.h"
 #include "base/sys_info.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/cache_util.h"
@@ -191,6 +192,31 @@ void MemBackendImpl::EndEnumeration(void** iter) {
   *iter = NULL;
 }
 
+void MemBackendImpl::GetStats(
+    std::vector<std::pair<std::string, std::string> >* stats) {
+  std::pair<std::string, std::string> item;
+
+  item.first = "Entries";
+  item.second = base::IntToString(GetEntryCount());
+  stats->push_back(item);
+
+  item.first = "Max size";
+  item.second = base::IntToString(max_size_);
+  stats->push_back(item);
+
+  item.first = "Current size";
+  item.second = base::IntToString(current_size_);
+  stats->push_back(item);
+
+  item.first = "Allocated bytes";
+  item.second = base::Int64ToString(allocator_.allocated_bytes());
+  stats->push_back(item);
+
+  item.first = "Reserved bytes";
+  item.second = base::Int64ToString(allocator_.reserved_bytes());
+  stats->push_back(item);
+}
+
 bool MemBackendImpl::OpenEntry(const std::string& key, Entry** entry) {
   EntryMap::iterator it = entries_.find(key);
   if (it == entries_.end())
@@ -12,6 +12,7 @@
 
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/mem_rankings.h"
+#include "net/disk_cache/mem_slab_allocator.h"
 
 namespace net {
 class NetLog;
@@ -53,6 +54,11 @@ class MemBackendImpl : public Backend {
   // Returns the maximum size for a file to reside on the cache.
   int MaxFileSize() const;
 
+  // Returns the allocator to use for the data of the entries.
+  MemSlabAllocator* allocator() {
+    return &allocator_;
+  }
+
   // Insert an MemEntryImpl into the ranking list. This method is only called
   // from MemEntryImpl to insert child entries. The reference can be removed
   // by calling RemoveFromRankingList(|entry|).
@@ -79,7 +85,7 @@ class MemBackendImpl : public Backend {
                             CompletionCallback* callback);
   virtual void EndEnumeration(void** iter);
   virtual void GetStats(
-      std::vector<std::pair<std::string, std::string> >* stats) {}
+      std::vector<std::pair<std::string, std::string> >* stats);
 
  private:
   typedef base::hash_map<std::string, MemEntryImpl*> EntryMap;
@@ -103,6 +109,7 @@ class MemBackendImpl : public Backend {
   void AddStorageSize(int32 bytes);
   void SubstractStorageSize(int32 bytes);
 
+  MemSlabAllocator allocator_;  // Must outlive all the entries.
   EntryMap entries_;
   MemRankings rankings_;  // Rankings to be able to trim the cache.
   int32 max_size_;        // Maximum data size for this instance.
@@ -54,8 +54,11 @@ MemEntryImpl::MemEntryImpl(MemBackendImpl* backend) {
   child_first_pos_ = 0;
   next_ = NULL;
   prev_ = NULL;
-  for (int i = 0; i < NUM_STREAMS; i++)
+  for (int i = 0; i < NUM_STREAMS; i++) {
+    data_[i] = NULL;
+    data_capacity_[i] = 0;
     data_size_[i] = 0;
+  }
 }
 
 // ------------------------------------------------------------------------
@@ -204,6 +207,13 @@ int MemEntryImpl::WriteData(int index, int offset, net::IOBuffer* buf,
   return result;
 }
 
+int MemEntryImpl::GetDataFile(int index, base::PlatformFile* file,
+                              int64* offset,
+                              net::CompletionCallback* completion_callback) {
+  // The data is not stored on a file.
+  return net::ERR_FAILED;
+}
+
 int MemEntryImpl::ReadSparseData(int64 offset, net::IOBuffer* buf, int buf_len,
                                  net::CompletionCallback* completion_callback) {
   if (net_log_.IsLoggingAllEvents()) {
@@ -262,8 +272,11 @@ int MemEntryImpl::ReadyForSparseIO(
 // ------------------------------------------------------------------------
 
 MemEntryImpl::~MemEntryImpl() {
-  for (int i = 0; i < NUM_STREAMS; i++)
+  for (int i = 0; i < NUM_STREAMS; i++) {
+    if (data_[i])
+      backend_->allocator()->Free(data_[i], data_capacity_[i]);
     backend_->ModifyStorageSize(data_size_[i], 0);
+  }
   backend_->ModifyStorageSize(static_cast<int32>(key_.size()), 0);
   net_log_.EndEvent(net::NetLog::TYPE_DISK_CACHE_MEM_ENTRY_IMPL, NULL);
 }
@@ -287,7 +300,7 @@ int MemEntryImpl::InternalReadData(int index, int offset, net::IOBuffer* buf,
 
   UpdateRank(false);
 
-  memcpy(buf->data(), &(data_[index])[offset], buf_len);
+  memcpy(buf->data(), data_[index] + offset, buf_len);
   return buf_len;
 }
 
@@ -321,6 +334,7 @@ int MemEntryImpl::InternalWriteData(int index, int offset, net::IOBuffer* buf,
     if (entry_size > offset + buf_len) {
       backend_->ModifyStorageSize(entry_size, offset + buf_len);
       data_size_[index] = offset + buf_len;
+      ShrinkTarget(index, offset + buf_len);
     }
   }
 
@@ -329,7 +343,7 @@ int MemEntryImpl::InternalWriteData(int index, int offset, net::IOBuffer* buf,
   if (!buf_len)
     return 0;
 
-  memcpy(&(data_[index])[offset], buf->data(), buf_len);
+  memcpy(data_[index] + offset, buf->data(), buf_len);
   return buf_len;
 }
 
@@ -508,15 +522,22 @@ void MemEntryImpl::PrepareTarget(int index, int offset, int buf_len) {
   if (entry_size >= offset + buf_len)
     return;  // Not growing the stored data.
 
-  if (static_cast<int>(data_[index].size()) < offset + buf_len)
-    data_[index].resize(offset + buf_len);
+  if (data_capacity_[index] < offset + buf_len) {
+    data_[index] = backend_->allocator()->Resize(
+        data_[index], &data_capacity_[index], entry_size, offset + buf_len);
+  }
 
   if (offset <= entry_size)
     return;  // There is no "hole" on the stored data.
 
   // Cleanup the hole not written by the user. The point is to avoid returning
   // random stuff later on.
-  memset(&(data_[index])[entry_size], 0, offset - entry_size);
+  memset(data_[index] + entry_size, 0, offset - entry_size);
+}
+
+void MemEntryImpl::ShrinkTarget(int index, int new_size) {
+  data_[index] = backend_->allocator()->Resize(
+      data_[index], &data_capacity_[index], new_size, new_size);
 }
 
 void MemEntryImpl::UpdateRank(bool modified) {
@@ -103,6 +103,8 @@ class MemEntryImpl : public Entry {
   virtual int WriteData(int index, int offset, net::IOBuffer* buf, int buf_len,
                         net::CompletionCallback* completion_callback,
                         bool truncate);
+  virtual int GetDataFile(int index, base::PlatformFile* file, int64* offset,
+                          net::CompletionCallback* completion_callback);
   virtual int ReadSparseData(int64 offset, net::IOBuffer* buf, int buf_len,
                              net::CompletionCallback* completion_callback);
   virtual int WriteSparseData(int64 offset, net::IOBuffer* buf, int buf_len,
@@ -136,6 +138,10 @@ class MemEntryImpl : public Entry {
   // Grows and cleans up the data buffer.
   void PrepareTarget(int index, int offset, int buf_len);
 
+  // Releases the memory not needed to store |new_size| bytes of a stream that
+  // is being truncated.
+  void ShrinkTarget(int index, int new_size);
+
   // Updates ranking information.
   void UpdateRank(bool modified);
 
@@ -163,7 +169,8 @@ class MemEntryImpl : public Entry {
   void DetachChild(int child_id);
 
   std::string key_;
-  std::vector<char> data_[NUM_STREAMS];  // User data.
+  char* data_[NUM_STREAMS];  // User data (from the backend's allocator).
+  int32 data_capacity_[NUM_STREAMS];
   int32 data_size_[NUM_STREAMS];
   int ref_count_;
 
@@ -0,0 +1,241 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/mem_slab_allocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace {
+
+const int kSlabSize = 64 * 1024;
+
+// Buffers bigger than this are not stored on slabs.
+const int kMaxSlabBuffer = 16 * 1024;
+
+// Sizes up to this value use size classes of kMinBufferSize bytes; after that
+// there are four classes for every power of two.
+const int kMinBufferSize = 16;
+const int kLinearLimit = 128;
+const int kLinearClasses = kLinearLimit / kMinBufferSize;
+
+// Large buffers are allocated in multiples of this size.
+const int kPageSize = 4096;
+
+// Returns the "floor" of log base 2 of |value|.
+int LogBase2(int value) {
+  int result = 0;
+  while (value >>= 1)
+    result++;
+  return result;
+}
+
+}  // namespace
+
+namespace disk_cache {
+
+struct MemSlabAllocator::FreeBlock {
+  FreeBlock* next;
+};
+
+struct MemSlabAllocator::Slab {
+  char* memory;
+  int size_class;
+  int buffer_size;
+  int num_used;          // Number of buffers in use.
+  int unused_offset;     // Start of the space that was never used.
+  bool linked;           // True if the slab is on the list of partial slabs.
+  FreeBlock* free_list;  // Buffers that were released.
+  Slab* prev;
+  Slab* next;
+};
+
+MemSlabAllocator::MemSlabAllocator()
+    : allocated_bytes_(0), reserved_bytes_(0) {
+  memset(partial_slabs_, 0, sizeof(partial_slabs_));
+}
+
+MemSlabAllocator::~MemSlabAllocator() {
+  DCHECK(!allocated_bytes_);
+  for (SlabMap::iterator it = slabs_.begin(); it != slabs_.end(); ++it) {
+    delete[] it->second->memory;
+    delete it->second;
+  }
+}
+
+char* MemSlabAllocator::Alloc(int size, int* capacity) {
+  DCHECK_GT(size, 0);
+  if (size > kMaxSlabBuffer) {
+    *capacity = (size + kPageSize - 1) & ~(kPageSize - 1);
+    allocated_bytes_ += *capacity;
+    reserved_bytes_ += *capacity;
+    return static_cast<char*>(malloc(*capacity));
+  }
+
+  int size_class = GetSizeClass(size);
+  Slab* slab = partial_slabs_[size_class];
+  if (!slab)
+    slab = NewSlab(size_class);
+
+  char* buffer;
+  if (slab->free_list) {
+    buffer = reinterpret_cast<char*>(slab->free_list);
+    slab->free_list = slab->free_list->next;
+  } else {
+    buffer = slab->memory + slab->unused_offset;
+    slab->unused_offset += slab->buffer_size;
+  }
+  slab->num_used++;
+
+  if (!slab->free_list &&
+      slab->unused_offset + slab->buffer_size > kSlabSize) {
+    UnlinkSlab(slab);
+  }
+
+  *capacity = slab->buffer_size;
+  allocated_bytes_ += *capacity;
+  return buffer;
+}
+
+void MemSlabAllocator::Free(char* buffer, int capacity) {
+  DCHECK(buffer);
+  allocated_bytes_ -= capacity;
+  DCHECK_GE(allocated_bytes_, 0);
+  if (capacity > kMaxSlabBuffer) {
+    reserved_bytes_ -= capacity;
+    free(buffer);
+    return;
+  }
+
+  SlabMap::iterator it = slabs_.upper_bound(buffer);
+  DCHECK(it != slabs_.begin());
+  --it;
+  Slab* slab = it->second;
+  DCHECK(buffer >= slab->memory && buffer < slab->memory + kSlabSize);
+  DCHECK_EQ(slab->buffer_size, capacity);
+
+  FreeBlock* block = reinterpret_cast<FreeBlock*>(buffer);
+  block->next = slab->free_list;
+  slab->free_list = block;
+  slab->num_used--;
+
+  if (!slab->linked)
+    LinkSlab(slab);
+
+  // Keep one slab around for each class, to avoid creating and deleting slabs
+  // all the time.
+  if (!slab->num_used &&
+      (partial_slabs_[slab->size_class] != slab || slab->next)) {
+    UnlinkSlab(slab);
+    slabs_.erase(it);
+    reserved_bytes_ -= kSlabSize;
+    delete[] slab->memory;
+    delete slab;
+  }
+}
+
+char* MemSlabAllocator::Resize(char* buffer, int* capacity, int used,
+                               int new_size) {
+  DCHECK_LE(used, *capacity);
+  if (!new_size) {
+    if (buffer)
+      Free(buffer, *capacity);
+    *capacity = 0;
+    return NULL;
+  }
+
+  if (buffer && new_size <= *capacity &&
+      (new_size > *capacity / 2 || *capacity == kMinBufferSize)) {
+    return buffer;
+  }
+
+  // Large buffers grow geometrically, to avoid copying the data too often.
+  int request = new_size;
+  if (new_size > *capacity && new_size > kMaxSlabBuffer)
+    request = std::max(new_size, *capacity + *capacity / 2);
+
+  int new_capacity;
+  char* new_buffer = Alloc(request, &new_capacity);
+  if (buffer) {
+    memcpy(new_buffer, buffer, std::min(used, new_size));
+    Free(buffer, *capacity);
+  }
+  *capacity = new_capacity;
+  return new_buffer;
+}
+
+// Static.
+int MemSlabAllocator::GetSizeClass(int size) {
+  DCHECK(size > 0 && size <= kMaxSlabBuffer);
+  if (size <= kLinearLimit)
+    return (size - 1) / kMinBufferSize;
+
+  // |step| is a fourth of the power of two immediately below |size|.
+  int log = LogBase2(size - 1);
+  int step_log = log - 2;
+  return kLinearClasses + (log - LogBase2(kLinearLimit)) * 4 +
+         ((size - 1) >> step_log) - 4;
+}
+
+// Static.
+int MemSlabAllocator::GetClassSize(int size_class) {
+  DCHECK(size_class >= 0 && size_class < kNumClasses);
+  if (size_class < kLinearClasses)
+    return (size_class + 1) * kMinBufferSize;
+
+  size_class -= kLinearClasses;
+  int log = LogBase2(kLinearLimit) + size_class / 4;
+  int step = 1 << (log - 2);
+  return (1 << log) + (size_class % 4 + 1) * step;
+}
+
+MemSlabAllocator::Slab* MemSlabAllocator::NewSlab(int size_class) {
+  Slab* slab = new Slab;
+  slab->memory = new char[kSlabSize];
+  slab->size_class = size_class;
+  slab->buffer_size = GetClassSize(size_class);
+  slab->num_used = 0;
+  slab->unused_offset = 0;
+  slab->linked = false;
+  slab->free_list = NULL;
+  slab->prev = NULL;
+  slab->next = NULL;
+
+  slabs_[slab->memory] = slab;
+  reserved_bytes_ += kSlabSize;
+  LinkSlab(slab);
+  return slab;
+}
+
+void MemSlabAllocator::LinkSlab(Slab* slab) {
+  DCHECK(!slab->linked);
+  Slab*& head = partial_slabs_[slab->size_class];
+  slab->prev = NULL;
+  slab->next = head;
+  if (head)
+    head->prev = slab;
+  head = slab;
+  slab->linked = true;
+}
+
+void MemSlabAllocator::UnlinkSlab(Slab* slab) {
+  DCHECK(slab->linked);
+  if (slab->prev)
+    slab->prev->next = slab->next;
+  else
+    partial_slabs_[slab->size_class] = slab->next;
+
+  if (slab->next)
+    slab->next->prev = slab->prev;
+
+  slab->prev = NULL;
+  slab->next = NULL;
+  slab->linked = false;
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,88 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface of the cache.
+
+#ifndef NET_DISK_CACHE_MEM_SLAB_ALLOCATOR_H_
+#define NET_DISK_CACHE_MEM_SLAB_ALLOCATOR_H_
+#pragma once
+
+#include <map>
+
+#include "base/basictypes.h"
+
+namespace disk_cache {
+
+// This class provides the memory used to store the data of the entries of the
+// memory-only cache. Instead of a separate heap allocation (with its own
+// header and growth policy) for each stream of each entry, small buffers are
+// carved out of 64 KB slabs, using a set of size classes (four per power of
+// two, so that no more than 25% of a buffer is wasted), and large buffers are
+// allocated directly, with room to grow.
+//
+// Buffers don't have any header: the caller must provide the capacity of the
+// buffer (as returned by Alloc()) when releasing it. A slab is released as soon
+// as it is not in use, unless it is the only slab with free space for its size
+// class, so the memory used by this object tracks the amount of data stored
+// on the cache.
+class MemSlabAllocator {
+ public:
+  MemSlabAllocator();
+  ~MemSlabAllocator();
+
+  // Returns a new buffer of at least |size| bytes, and the actual size of the
+  // buffer on |capacity|.
+  char* Alloc(int size, int* capacity);
+
+  // Releases a |buffer| of the given |capacity|.
+  void Free(char* buffer, int capacity);
+
+  // Returns a buffer able to store |new_size| bytes that contains the first
+  // |used| bytes of |buffer|, releasing |buffer| if needed. |capacity| is the
+  // size of |buffer|, and it is updated with the size of the returned buffer.
+  // |buffer| can be NULL (with |capacity| and |used| of zero), and the returned
+  // buffer is NULL when |new_size| is zero. A buffer that would be mostly
+  // empty is replaced by a smaller one.
+  char* Resize(char* buffer, int* capacity, int used, int new_size);
+
+  // Returns the number of bytes given out by this object.
+  int64 allocated_bytes() const {
+    return allocated_bytes_;
+  }
+
+  // Returns the number of bytes obtained from the system.
+  int64 reserved_bytes() const {
+    return reserved_bytes_;
+  }
+
+ private:
+  struct FreeBlock;
+  struct Slab;
+  typedef std::map<char*, Slab*> SlabMap;
+
+  // Returns the size class to use for a buffer of |size| bytes, and the size of
+  // the buffers of a given class.
+  static int GetSizeClass(int size);
+  static int GetClassSize(int size_class);
+
+  // Creates a new slab for buffers of the given class.
+  Slab* NewSlab(int size_class);
+
+  // Adds or removes |slab| from the list of slabs with free buffers.
+  void LinkSlab(Slab* slab);
+  void UnlinkSlab(Slab* slab);
+
+  static const int kNumClasses = 36;
+
+  Slab* partial_slabs_[kNumClasses];  // Slabs with free buffers.
+  SlabMap slabs_;  // All slabs, by address.
+  int64 allocated_bytes_;
+  int64 reserved_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemSlabAllocator);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_MEM_SLAB_ALLOCATOR_H_
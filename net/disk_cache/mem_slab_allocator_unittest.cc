@@ -0,0 +1,125 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "net/disk_cache/mem_slab_allocator.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+TEST(DiskCacheMemSlabAllocator, SizeClasses) {
+  MemSlabAllocator allocator;
+  int capacity;
+
+  char* buffer1 = allocator.Alloc(1, &capacity);
+  EXPECT_EQ(16, capacity);
+  allocator.Free(buffer1, capacity);
+
+  buffer1 = allocator.Alloc(128, &capacity);
+  EXPECT_EQ(128, capacity);
+  allocator.Free(buffer1, capacity);
+
+  buffer1 = allocator.Alloc(129, &capacity);
+  EXPECT_EQ(160, capacity);
+  allocator.Free(buffer1, capacity);
+
+  buffer1 = allocator.Alloc(5000, &capacity);
+  EXPECT_EQ(5120, capacity);
+  allocator.Free(buffer1, capacity);
+
+  buffer1 = allocator.Alloc(16 * 1024, &capacity);
+  EXPECT_EQ(16 * 1024, capacity);
+  allocator.Free(buffer1, capacity);
+
+  // Large buffers are rounded to a page.
+  buffer1 = allocator.Alloc(20000, &capacity);
+  EXPECT_EQ(20480, capacity);
+  EXPECT_EQ(20480, allocator.allocated_bytes());
+  allocator.Free(buffer1, capacity);
+
+  EXPECT_EQ(0, allocator.allocated_bytes());
+}
+
+TEST(DiskCacheMemSlabAllocator, Resize) {
+  MemSlabAllocator allocator;
+  int capacity = 0;
+
+  char* buffer = allocator.Resize(NULL, &capacity, 0, 100);
+  ASSERT_TRUE(buffer != NULL);
+  EXPECT_EQ(112, capacity);
+  memset(buffer, 'a', 100);
+
+  // There is room for a few more bytes.
+  EXPECT_EQ(buffer, allocator.Resize(buffer, &capacity, 100, 110));
+  EXPECT_EQ(112, capacity);
+
+  // Growing preserves the data.
+  buffer = allocator.Resize(buffer, &capacity, 100, 3000);
+  EXPECT_EQ(3072, capacity);
+  for (int i = 0; i < 100; i++)
+    ASSERT_EQ('a', buffer[i]);
+  memset(buffer + 100, 'b', 2900);
+
+  // And so does shrinking.
+  buffer = allocator.Resize(buffer, &capacity, 3000, 200);
+  EXPECT_EQ(224, capacity);
+  EXPECT_EQ(0, memcmp(buffer, std::string(100, 'a').data(), 100));
+  EXPECT_EQ(0, memcmp(buffer + 100, std::string(100, 'b').data(), 100));
+
+  // Large buffers grow with extra room.
+  buffer = allocator.Resize(buffer, &capacity, 200, 40000);
+  EXPECT_EQ(40960, capacity);
+  buffer = allocator.Resize(buffer, &capacity, 40000, 41000);
+  EXPECT_LE(60000, capacity);
+  EXPECT_EQ(0, memcmp(buffer, std::string(100, 'a').data(), 100));
+
+  buffer = allocator.Resize(buffer, &capacity, 41000, 0);
+  EXPECT_TRUE(buffer == NULL);
+  EXPECT_EQ(0, capacity);
+  EXPECT_EQ(0, allocator.allocated_bytes());
+}
+
+// Tests that slabs are released when they are not used.
+TEST(DiskCacheMemSlabAllocator, ReleaseSlabs) {
+  MemSlabAllocator allocator;
+  const int kNumBuffers = 10000;
+  std::vector<char*> buffers;
+  int capacity;
+
+  for (int i = 0; i < kNumBuffers; i++) {
+    buffers.push_back(allocator.Alloc(300, &capacity));
+    memset(buffers.back(), i, capacity);
+  }
+  EXPECT_EQ(320, capacity);
+  EXPECT_EQ(kNumBuffers * capacity, allocator.allocated_bytes());
+
+  // No more than one slab should be partially used (besides the space at the
+  // end of each slab that is too small for another buffer).
+  int64 num_slabs = allocator.reserved_bytes() / (64 * 1024);
+  EXPECT_GT(allocator.allocated_bytes() + num_slabs * capacity + 64 * 1024,
+            allocator.reserved_bytes());
+
+  // The buffers don't overlap.
+  for (int i = 0; i < kNumBuffers; i++)
+    ASSERT_EQ(static_cast<char>(i), buffers[i][capacity - 1]);
+
+  // Free every other buffer, and then allocate them again.
+  int64 reserved = allocator.reserved_bytes();
+  for (int i = 0; i < kNumBuffers; i += 2)
+    allocator.Free(buffers[i], capacity);
+  for (int i = 0; i < kNumBuffers; i += 2)
+    buffers[i] = allocator.Alloc(300, &capacity);
+  EXPECT_EQ(reserved, allocator.reserved_bytes());
+
+  for (int i = 0; i < kNumBuffers; i++)
+    allocator.Free(buffers[i], capacity);
+  EXPECT_EQ(0, allocator.allocated_bytes());
+  EXPECT_GE(64 * 1024, allocator.reserved_bytes());
+}
+
+}  // namespace disk_cache
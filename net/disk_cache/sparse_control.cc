@@ -4,9 +4,12 @@
 
 #include "net/disk_cache/sparse_control.h"
 
+#include <algorithm>
+
 #include "base/format_macros.h"
 #include "base/logging.h"
 #include "base/message_loop.h"
+#include "base/stl_util-inl.h"
 #include "base/string_util.h"
 #include "base/stringprintf.h"
 #include "base/time.h"
@@ -36,6 +39,13 @@ const int kMaxEntrySize = 0x100000;
 // The size of each data block (tracked by the child allocation bitmap).
 const int kBlockSize = 1024;
 
+// The maximum number of children with IO in flight for a given operation.
+const int kMaxChildIO = 8;
+
+// The number of children that we keep open. This has to be at least as big as
+// kMaxChildIO.
+const int kMaxOpenChildren = 16;
+
 // Returns the name of a child entry given the base_name and signature of the
 // parent and the child_id.
 // If the entry is called entry_name, child entries will be named something
@@ -183,20 +193,64 @@ void LogChildOperationEnd(const net::BoundNetLog& net_log,
 
 namespace disk_cache {
 
+// An open child entry, with its allocation bitmap.
+struct SparseControl::Child {
+  Child(int64 id, EntryImpl* entry)
+      : id(id), entry(entry),
+        map(data.bitmap, kNumSparseBits, kNumSparseBits / 32) {}
+
+  int64 id;  // The child number (offset >> 20).
+  EntryImpl* entry;  // We hold a reference to this entry.
+  SparseData data;  // Parent and allocation map of the entry.
+  Bitmap map;  // The allocation map as a bitmap.
+};
+
+// A single read or write for a child, issued as part of a larger operation.
+class SparseControl::ChildIO {
+ public:
+  ChildIO(SparseControl* owner, Child* child, int offset, int len)
+      : owner_(owner), child_(child), offset_(offset), len_(len), result_(0),
+        ALLOW_THIS_IN_INITIALIZER_LIST(
+            callback_(this, &ChildIO::OnIOComplete)) {}
+
+  Child* child() const { return child_; }
+  int offset() const { return offset_; }
+  int len() const { return len_; }
+  int result() const { return result_; }
+  void set_result(int result) { result_ = result; }
+  net::CompletionCallback* callback() { return &callback_; }
+
+ private:
+  void OnIOComplete(int result) {
+    DCHECK_NE(net::ERR_IO_PENDING, result);
+    result_ = result;
+    owner_->OnChildIOCompleted();
+  }
+
+  SparseControl* owner_;
+  Child* child_;
+  int offset_;  // Offset within the child.
+  int len_;
+  int result_;
+  net::CompletionCallbackImpl<ChildIO> callback_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChildIO);
+};
+
 SparseControl::SparseControl(EntryImpl* entry)
     : entry_(entry),
       child_(NULL),
+      pending_io_(0),
       operation_(kNoOperation),
       init_(false),
-      child_map_(child_data_.bitmap, kNumSparseBits, kNumSparseBits / 32),
-      ALLOW_THIS_IN_INITIALIZER_LIST(
-          child_callback_(this, &SparseControl::OnChildIOCompleted)),
       user_callback_(NULL) {
 }
 
 SparseControl::~SparseControl() {
-  if (child_)
-    CloseChild();
+  DCHECK(child_io_.empty());
+  // Close the children in the order they were used.
+  while (!open_children_.empty())
+    CloseChild(open_children_.front());
   if (init_)
     WriteSparseData();
 }
@@ -428,60 +482,102 @@ int SparseControl::OpenSparseEntry(int data_len) {
 bool SparseControl::OpenChild() {
   DCHECK_GE(result_, 0);
 
-  std::string key = GenerateChildKey();
-  if (child_) {
-    // Keep using the same child or open another one?.
-    if (key == child_->GetKey())
-      return true;
-    CloseChild();
-  }
+  // Keep using the same child or find another one?.
+  int64 child_id = offset_ >> 20;
+  if (child_ && child_->id == child_id)
+    return true;
+  child_ = FindChild(child_id);
+  if (child_)
+    return true;
 
   // See if we are tracking this child.
+  std::string key = GenerateChildKey();
   if (!ChildPresent())
     return ContinueWithoutChild(key);
 
-  child_ = entry_->backend_->OpenEntryImpl(key);
-  if (!child_)
+  EntryImpl* child = entry_->backend_->OpenEntryImpl(key);
+  if (!child)
     return ContinueWithoutChild(key);
 
-  EntryImpl* child = static_cast<EntryImpl*>(child_);
+  AddChild(child_id, child);
+  SparseData& child_data = child_->data;
   if (!(CHILD_ENTRY & child->GetEntryFlags()) ||
       child->GetDataSize(kSparseIndex) <
-          static_cast<int>(sizeof(child_data_)))
+          static_cast<int>(sizeof(child_data)))
     return KillChildAndContinue(key, false);
 
   scoped_refptr<net::WrappedIOBuffer> buf(
-      new net::WrappedIOBuffer(reinterpret_cast<char*>(&child_data_)));
+      new net::WrappedIOBuffer(reinterpret_cast<char*>(&child_data)));
 
   // Read signature.
-  int rv = child_->ReadData(kSparseIndex, 0, buf, sizeof(child_data_), NULL);
-  if (rv != sizeof(child_data_))
+  int rv = child->ReadData(kSparseIndex, 0, buf, sizeof(child_data), NULL);
+  if (rv != sizeof(child_data))
     return KillChildAndContinue(key, true);  // This is a fatal failure.
 
-  if (child_data_.header.signature != sparse_header_.signature ||
-      child_data_.header.magic != kIndexMagic)
+  if (child_data.header.signature != sparse_header_.signature ||
+      child_data.header.magic != kIndexMagic)
     return KillChildAndContinue(key, false);
 
-  if (child_data_.header.last_block_len < 0 ||
-      child_data_.header.last_block_len > kBlockSize) {
+  if (child_data.header.last_block_len < 0 ||
+      child_data.header.last_block_len > kBlockSize) {
     // Make sure these values are always within range.
-    child_data_.header.last_block_len = 0;
-    child_data_.header.last_block = -1;
+    child_data.header.last_block_len = 0;
+    child_data.header.last_block = -1;
   }
 
   return true;
 }
 
-void SparseControl::CloseChild() {
+void SparseControl::CloseChild(Child* child) {
   scoped_refptr<net::WrappedIOBuffer> buf(
-      new net::WrappedIOBuffer(reinterpret_cast<char*>(&child_data_)));
+      new net::WrappedIOBuffer(reinterpret_cast<char*>(&child->data)));
 
   // Save the allocation bitmap before closing the child entry.
-  int rv = child_->WriteData(kSparseIndex, 0, buf, sizeof(child_data_),
-                             NULL, false);
-  if (rv != sizeof(child_data_))
+  int rv = child->entry->WriteData(kSparseIndex, 0, buf, sizeof(child->data),
+                                   NULL, false);
+  if (rv != sizeof(child->data))
     DLOG(ERROR) << "Failed to save child data";
-  child_->Release();
+
+  std::vector<Child*>::iterator it =
+      std::find(open_children_.begin(), open_children_.end(), child);
+  DCHECK(it != open_children_.end());
+  open_children_.erase(it);
+  if (child_ == child)
+    child_ = NULL;
+  child->entry->Release();
+  delete child;
+}
+
+SparseControl::Child* SparseControl::FindChild(int64 child_id) {
+  for (size_t i = 0; i < open_children_.size(); i++) {
+    Child* child = open_children_[i];
+    if (child->id != child_id)
+      continue;
+
+    // Move it to the end of the list.
+    open_children_.erase(open_children_.begin() + i);
+    open_children_.push_back(child);
+    return child;
+  }
+  return NULL;
+}
+
+void SparseControl::AddChild(int64 child_id, EntryImpl* entry) {
+  if (open_children_.size() >= static_cast<size_t>(kMaxOpenChildren)) {
+    // The children of the current batch are the most recently used ones.
+    COMPILE_ASSERT(kMaxOpenChildren >= kMaxChildIO, not_enough_open_children);
+    CloseChild(open_children_.front());
+  }
+  child_ = new Child(child_id, entry);
+  open_children_.push_back(child_);
+}
+
+void SparseControl::RemoveChild() {
+  DCHECK(child_);
+  DCHECK(open_children_.back() == child_);
+  open_children_.pop_back();
+  child_->entry->Release();
+  delete child_;
   child_ = NULL;
 }
 
@@ -493,9 +589,8 @@ std::string SparseControl::GenerateChildKey() {
 // We are deleting the child because something went wrong.
 bool SparseControl::KillChildAndContinue(const std::string& key, bool fatal) {
   SetChildBit(false);
-  child_->DoomImpl();
-  child_->Release();
-  child_ = NULL;
+  child_->entry->DoomImpl();
+  RemoveChild();
   if (fatal) {
     result_ = net::ERR_CACHE_READ_FAILURE;
     return false;
@@ -510,12 +605,13 @@ bool SparseControl::ContinueWithoutChild(const std::string& key) {
   if (kGetRangeOperation == operation_)
     return true;
 
-  child_ = entry_->backend_->CreateEntryImpl(key);
-  if (!child_) {
-    child_ = NULL;
+  EntryImpl* child = entry_->backend_->CreateEntryImpl(key);
+  if (!child) {
     result_ = net::ERR_CACHE_READ_FAILURE;
     return false;
   }
+  AddChild(offset_ >> 20, child);
+
   // Write signature.
   InitChildData();
   return true;
@@ -564,10 +660,10 @@ bool SparseControl::VerifyRange() {
   // Check that there are no holes in this range.
   int last_bit = (child_offset_ + child_len_ + 1023) >> 10;
   int start = child_offset_ >> 10;
-  if (child_map_.FindNextBit(&start, last_bit, false)) {
+  if (child_->map.FindNextBit(&start, last_bit, false)) {
     // Something is not here.
-    DCHECK_GE(child_data_.header.last_block_len, 0);
-    DCHECK_LT(child_data_.header.last_block_len, kMaxEntrySize);
+    DCHECK_GE(child_->data.header.last_block_len, 0);
+    DCHECK_LT(child_->data.header.last_block_len, kMaxEntrySize);
     int partial_block_len = PartialBlockLength(start);
     if (start == child_offset_ >> 10) {
       // It looks like we don't have anything.
@@ -587,24 +683,25 @@ bool SparseControl::VerifyRange() {
   return true;
 }
 
-void SparseControl::UpdateRange(int result) {
+void SparseControl::UpdateRange(Child* child, int child_offset, int result) {
   if (result <= 0 || operation_ != kWriteOperation)
     return;
 
-  DCHECK_GE(child_data_.header.last_block_len, 0);
-  DCHECK_LT(child_data_.header.last_block_len, kMaxEntrySize);
+  SparseData& child_data = child->data;
+  DCHECK_GE(child_data.header.last_block_len, 0);
+  DCHECK_LT(child_data.header.last_block_len, kMaxEntrySize);
 
   // Write the bitmap.
-  int first_bit = child_offset_ >> 10;
-  int block_offset = child_offset_ & (kBlockSize - 1);
-  if (block_offset && (child_data_.header.last_block != first_bit ||
-                       child_data_.header.last_block_len < block_offset)) {
+  int first_bit = child_offset >> 10;
+  int block_offset = child_offset & (kBlockSize - 1);
+  if (block_offset && (child_data.header.last_block != first_bit ||
+                       child_data.header.last_block_len < block_offset)) {
     // The first block is not completely filled; ignore it.
     first_bit++;
   }
 
-  int last_bit = (child_offset_ + result) >> 10;
-  block_offset = (child_offset_ + result) & (kBlockSize - 1);
+  int last_bit = (child_offset + result) >> 10;
+  block_offset = (child_offset + result) & (kBlockSize - 1);
 
   // This condition will hit with the following criteria:
   // 1. The first byte doesn't follow the last write.
@@ -613,23 +710,23 @@ void SparseControl::UpdateRange(int result) {
   if (first_bit > last_bit)
     return;
 
-  if (block_offset && !child_map_.Get(last_bit)) {
+  if (block_offset && !child->map.Get(last_bit)) {
     // The last block is not completely filled; save it for later.
-    child_data_.header.last_block = last_bit;
-    child_data_.header.last_block_len = block_offset;
+    child_data.header.last_block = last_bit;
+    child_data.header.last_block_len = block_offset;
   } else {
-    child_data_.header.last_block = -1;
+    child_data.header.last_block = -1;
   }
 
-  child_map_.SetRange(first_bit, last_bit, true);
+  child->map.SetRange(first_bit, last_bit, true);
 }
 
 int SparseControl::PartialBlockLength(int block_index) const {
-  if (block_index == child_data_.header.last_block)
-    return child_data_.header.last_block_len;
+  if (block_index == child_->data.header.last_block)
+    return child_->data.header.last_block_len;
 
   // This may be the last stored index.
-  int entry_len = child_->GetDataSize(kSparseData);
+  int entry_len = child_->entry->GetDataSize(kSparseData);
   if (block_index == entry_len >> 10)
     return entry_len & (kBlockSize - 1);
 
@@ -638,25 +735,34 @@ int SparseControl::PartialBlockLength(int block_index) const {
 }
 
 void SparseControl::InitChildData() {
-  // We know the real type of child_.
-  EntryImpl* child = static_cast<EntryImpl*>(child_);
+  EntryImpl* child = child_->entry;
   child->SetEntryFlags(CHILD_ENTRY);
 
-  memset(&child_data_, 0, sizeof(child_data_));
-  child_data_.header = sparse_header_;
+  SparseData& child_data = child_->data;
+  memset(&child_data, 0, sizeof(child_data));
+  child_data.header = sparse_header_;
 
   scoped_refptr<net::WrappedIOBuffer> buf(
-      new net::WrappedIOBuffer(reinterpret_cast<char*>(&child_data_)));
+      new net::WrappedIOBuffer(reinterpret_cast<char*>(&child_data)));
 
-  int rv = child_->WriteData(kSparseIndex, 0, buf, sizeof(child_data_),
-                             NULL, false);
-  if (rv != sizeof(child_data_))
+  int rv = child->WriteData(kSparseIndex, 0, buf, sizeof(child_data),
+                            NULL, false);
+  if (rv != sizeof(child_data))
     DLOG(ERROR) << "Failed to save child data";
   SetChildBit(true);
 }
 
 void SparseControl::DoChildrenIO() {
-  while (DoChildIO()) continue;
+  for (;;) {
+    while (DoChildIO()) continue;
+
+    // Wait until the whole batch is done.
+    if (pending_io_)
+      return;
+    GatherChildIO();
+    if (finished_)
+      break;
+  }
 
   // Range operations are finished synchronously, often without setting
   // |finished_| to true.
@@ -667,14 +773,12 @@ void SparseControl::DoChildrenIO() {
         make_scoped_refptr(
             new GetAvailableRangeResultParameters(offset_, result_)));
   }
-  if (finished_) {
-    if (kGetRangeOperation != operation_ &&
-        entry_->net_log().IsLoggingAllEvents()) {
-      entry_->net_log().EndEvent(GetSparseEventType(operation_), NULL);
-    }
-    if (pending_)
-      DoUserCallback();
+  if (kGetRangeOperation != operation_ &&
+      entry_->net_log().IsLoggingAllEvents()) {
+    entry_->net_log().EndEvent(GetSparseEventType(operation_), NULL);
   }
+  if (pending_)
+    DoUserCallback();
 }
 
 bool SparseControl::DoChildIO() {
@@ -690,8 +794,28 @@ bool SparseControl::DoChildIO() {
 
   // We have more work to do. Let's not trigger a callback to the caller.
   finished_ = false;
-  net::CompletionCallback* callback = user_callback_ ? &child_callback_ : NULL;
 
+  if (kGetRangeOperation == operation_) {
+    int rv = DoGetAvailableRange();
+    if (!rv)
+      return false;
+    DoChildIOCompleted(rv);
+    return true;
+  }
+
+  // Each child gets its own view of the user buffer, and we move on to the
+  // next child right away.
+  ChildIO* io = new ChildIO(this, child_, child_offset_, child_len_);
+  child_io_.push_back(io);
+  scoped_refptr<net::IOBuffer> buf(
+      new net::DrainableIOBuffer(user_buf_, user_buf_->BytesRemaining()));
+  offset_ += child_len_;
+  buf_len_ -= child_len_;
+  if (buf_len_)
+    user_buf_->DidConsume(child_len_);
+
+  net::CompletionCallback* callback = user_callback_ ? io->callback() : NULL;
+  EntryImpl* child = child_->entry;
   int rv = 0;
   switch (operation_) {
     case kReadOperation:
@@ -699,31 +823,29 @@ bool SparseControl::DoChildIO() {
         entry_->net_log().BeginEvent(
             net::NetLog::TYPE_SPARSE_READ_CHILD_DATA,
             make_scoped_refptr(new SparseReadWriteParameters(
-                child_->net_log().source(),
-                child_len_)));
+                child->net_log().source(),
+                io->len())));
       }
-      rv = child_->ReadDataImpl(kSparseData, child_offset_, user_buf_,
-                                child_len_, callback);
+      rv = child->ReadDataImpl(kSparseData, io->offset(), buf, io->len(),
+                               callback);
       break;
     case kWriteOperation:
       if (entry_->net_log().IsLoggingAllEvents()) {
         entry_->net_log().BeginEvent(
             net::NetLog::TYPE_SPARSE_WRITE_CHILD_DATA,
             make_scoped_refptr(new SparseReadWriteParameters(
-                child_->net_log().source(),
-                child_len_)));
+                child->net_log().source(),
+                io->len())));
       }
-      rv = child_->WriteDataImpl(kSparseData, child_offset_, user_buf_,
-                                 child_len_, callback, false);
-      break;
-    case kGetRangeOperation:
-      rv = DoGetAvailableRange();
+      rv = child->WriteDataImpl(kSparseData, io->offset(), buf, io->len(),
+                                callback, false);
       break;
     default:
       NOTREACHED();
   }
 
   if (rv == net::ERR_IO_PENDING) {
+    pending_io_++;
     if (!pending_) {
       pending_ = true;
       // The child will protect himself against closing the entry while IO is in
@@ -732,13 +854,43 @@ bool SparseControl::DoChildIO() {
       // finished doing sparse stuff.
       entry_->AddRef();  // Balanced in DoUserCallback.
     }
-    return false;
+  } else {
+    io->set_result(rv);
+    if (rv != io->len())
+      return false;  // There is no point in issuing more IO.
   }
-  if (!rv)
-    return false;
 
-  DoChildIOCompleted(rv);
-  return true;
+  return child_io_.size() < static_cast<size_t>(kMaxChildIO);
+}
+
+void SparseControl::GatherChildIO() {
+  bool done = false;
+  for (size_t i = 0; i < child_io_.size(); i++) {
+    ChildIO* io = child_io_[i];
+    int result = io->result();
+    LogChildOperationEnd(entry_->net_log(), operation_, result);
+
+    // Whatever was written is there, even if the operation failed later on.
+    UpdateRange(io->child(), io->offset(), result);
+    if (done)
+      continue;
+
+    // We fail the whole operation if we encounter an error, and we stop at the
+    // first child that doesn't have all the data.
+    if (result < 0) {
+      result_ = result;
+      done = true;
+    } else {
+      result_ += result;
+      done = result < io->len();
+    }
+  }
+  STLDeleteElements(&child_io_);
+
+  if (done) {
+    buf_len_ = 0;
+    finished_ = true;
+  }
 }
 
 int SparseControl::DoGetAvailableRange() {
@@ -750,7 +902,7 @@ int SparseControl::DoGetAvailableRange() {
   int start = child_offset_ >> 10;
   int partial_start_bytes = PartialBlockLength(start);
   int found = start;
-  int bits_found = child_map_.FindBits(&found, last_bit, true);
+  int bits_found = child_->map.FindBits(&found, last_bit, true);
 
   // We don't care if there is a partial block in the middle of the range.
   int block_offset = child_offset_ & (kBlockSize - 1);
@@ -789,28 +941,18 @@ int SparseControl::DoGetAvailableRange() {
 }
 
 void SparseControl::DoChildIOCompleted(int result) {
-  LogChildOperationEnd(entry_->net_log(), operation_, result);
-  if (result < 0) {
-    // We fail the whole operation if we encounter an error.
-    result_ = result;
-    return;
-  }
-
-  UpdateRange(result);
-
+  DCHECK_EQ(kGetRangeOperation, operation_);
   result_ += result;
   offset_ += result;
   buf_len_ -= result;
-
-  // We'll be reusing the user provided buffer for the next chunk.
-  if (buf_len_ && user_buf_)
-    user_buf_->DidConsume(result);
 }
 
-void SparseControl::OnChildIOCompleted(int result) {
-  DCHECK_NE(net::ERR_IO_PENDING, result);
-  DoChildIOCompleted(result);
+void SparseControl::OnChildIOCompleted() {
+  DCHECK_GT(pending_io_, 0);
+  if (--pending_io_)
+    return;
 
+  GatherChildIO();
   if (abort_) {
     // We'll return the current result of the operation, which may be less than
     // the bytes to read or write, but the user cancelled the operation.
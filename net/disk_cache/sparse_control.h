@@ -30,6 +30,10 @@ class EntryImpl;
 // the operation into multiple small pieces, sending each one to the
 // appropriate entry. An instance of this class is asociated with each entry
 // used directly for sparse operations (the entry passed in to the constructor).
+//
+// The IO for the children of a single operation is issued in batches, so that
+// a large request doesn't have to wait for each child in turn, and the most
+// recently used children are kept open between operations.
 class SparseControl {
  public:
   // The operation to perform.
@@ -76,6 +80,9 @@ class SparseControl {
   static void DeleteChildren(EntryImpl* entry);
 
  private:
+  class ChildIO;
+  struct Child;
+
   // Creates a new sparse entry or opens an aready created entry from disk.
   // These methods just read / write the required info from disk for the current
   // entry, and verify that everything is correct. The return value is a net
@@ -85,11 +92,22 @@ class SparseControl {
 
   // Opens and closes a child entry. A child entry is a regular EntryImpl object
   // with a key derived from the key of the resource to store and the range
-  // stored by that child.
+  // stored by that child. Closed children stay open for a while, for the
+  // benefit of future operations.
   bool OpenChild();
-  void CloseChild();
+  void CloseChild(Child* child);
   std::string GenerateChildKey();
 
+  // Returns the open child for |child_id|, or NULL.
+  Child* FindChild(int64 child_id);
+
+  // Starts tracking |entry| as the current (open) child, closing the least
+  // recently used child if there are too many of them.
+  void AddChild(int64 child_id, EntryImpl* entry);
+
+  // Stops tracking the current child, without saving its data.
+  void RemoveChild();
+
   // Deletes the current child and continues the current operation (open).
   bool KillChildAndContinue(const std::string& key, bool fatal);
 
@@ -113,9 +131,9 @@ class SparseControl {
   // the child).
   bool VerifyRange();
 
-  // Updates the contents bitmap for the current range, based on the result of
-  // the current operation.
-  void UpdateRange(int result);
+  // Updates the contents bitmap of |child| for the range that starts at
+  // |child_offset|, based on the |result| of the operation.
+  void UpdateRange(Child* child, int child_offset, int result);
 
   // Returns the number of bytes stored at |block_index|, if its allocation-bit
   // is off (because it is not completely filled).
@@ -129,24 +147,31 @@ class SparseControl {
 
   // Performs a single operation with the current child. Returns true when we
   // should move on to the next child and false when we should interrupt our
-  // work.
+  // work, either because we are done, or because we have to wait for the
+  // current batch of operations.
   bool DoChildIO();
 
+  // Collects the results of the operations issued to the children.
+  void GatherChildIO();
+
   // Performs the required work for GetAvailableRange for one child.
   int DoGetAvailableRange();
 
-  // Performs the required work after a single IO operations finishes.
+  // Performs the required work after a single GetAvailableRange step.
   void DoChildIOCompleted(int result);
 
-  // Invoked by the callback of asynchronous operations.
-  void OnChildIOCompleted(int result);
+  // Invoked when an asynchronous operation of a child finishes.
+  void OnChildIOCompleted();
 
   // Reports to the user that we are done.
   void DoUserCallback();
   void DoAbortCallbacks();
 
   EntryImpl* entry_;  // The sparse entry.
-  EntryImpl* child_;  // The current child entry.
+  Child* child_;  // The current child entry.
+  std::vector<Child*> open_children_;  // Least recently used first.
+  std::vector<ChildIO*> child_io_;  // The current batch, in offset order.
+  int pending_io_;  // Operations from child_io_ not completed yet.
   SparseOperation operation_;
   bool pending_;  // True if any child IO operation returned pending.
   bool finished_;
@@ -156,10 +181,7 @@ class SparseControl {
 
   SparseHeader sparse_header_;  // Data about the children of entry_.
   Bitmap children_map_;  // The actual bitmap of children.
-  SparseData child_data_;  // Parent and allocation map of child_.
-  Bitmap child_map_;  // The allocation map as a bitmap.
 
-  net::CompletionCallbackImpl<SparseControl> child_callback_;
   net::CompletionCallback* user_callback_;
   std::vector<net::CompletionCallback*> abort_callbacks_;
   int64 offset_;  // Current sparse offset.
@@ -60,7 +60,13 @@ static const char* kCounterNames[] = {
   "Fatal error",
   "Last report",
   "Last report timer",
-  "Doom recent entries"
+  "Doom recent entries",
+  "Trim kept entry",
+  "Kept entry hit",
+  "Dedup hit",
+  "Dedup miss",
+  "Compress input bytes",
+  "Compress output bytes"
 };
 COMPILE_ASSERT(arraysize(kCounterNames) == disk_cache::Stats::MAX_COUNTER,
                update_the_names);
@@ -212,9 +218,37 @@ int Stats::GetResurrectRatio() const {
   return GetRatio(RESURRECT_HIT, CREATE_HIT);
 }
 
+int Stats::GetKeptHitRatio() const {
+  // KEPT_HIT is a subset of OPEN_HIT.
+  int64 ratio = GetCounter(KEPT_HIT) * 100;
+  if (!ratio)
+    return 0;
+
+  ratio /= (GetCounter(OPEN_HIT) + GetCounter(OPEN_MISS));
+  return static_cast<int>(ratio);
+}
+
+int Stats::GetDedupRatio() const {
+  return GetRatio(DEDUP_HIT, DEDUP_MISS);
+}
+
+int Stats::GetCompressionRatio() const {
+  int64 input = GetCounter(COMPRESS_INPUT);
+  if (!input)
+    return 0;
+
+  int64 saved = input - GetCounter(COMPRESS_OUTPUT);
+  return static_cast<int>(saved * 100 / input);
+}
+
 void Stats::ResetRatios() {
   SetCounter(OPEN_HIT, 0);
   SetCounter(OPEN_MISS, 0);
+  SetCounter(KEPT_HIT, 0);
+  SetCounter(DEDUP_HIT, 0);
+  SetCounter(DEDUP_MISS, 0);
+  SetCounter(COMPRESS_INPUT, 0);
+  SetCounter(COMPRESS_OUTPUT, 0);
   SetCounter(RESURRECT_HIT, 0);
   SetCounter(CREATE_HIT, 0);
 }
@@ -46,6 +46,12 @@ class Stats {
     LAST_REPORT,  // Time of the last time we sent a report.
     LAST_REPORT_TIMER,  // Timer count of the last time we sent a report.
     DOOM_RECENT,  // The cache was partially cleared.
+    TRIM_KEPT,  // An entry was not evicted due to its access frequency.
+    KEPT_HIT,  // Open hit for an entry that was not evicted (see TRIM_KEPT).
+    DEDUP_HIT,  // The data of an entry was already stored by another entry.
+    DEDUP_MISS,  // The data of an entry can be shared from now on.
+    COMPRESS_INPUT,  // Bytes given to the compressor.
+    COMPRESS_OUTPUT,  // Bytes stored by compressed streams.
     MAX_COUNTER
   };
 
@@ -65,6 +71,16 @@ class Stats {
   void GetItems(StatsItems* items);
   int GetHitRatio() const;
   int GetResurrectRatio() const;
+
+  // Returns the percentage of lookups served by entries that would have been
+  // evicted without the admission policy.
+  int GetKeptHitRatio() const;
+
+  // Returns the percentage of stored bodies that were already on the cache.
+  int GetDedupRatio() const;
+
+  // Returns the percentage of space saved by compressing data streams.
+  int GetCompressionRatio() const;
   void ResetRatios();
 
   // Returns the lower bound of the space used by entries bigger than 512 KB.
@@ -159,6 +159,11 @@ class MockDiskEntry : public disk_cache::Entry,
     return net::ERR_IO_PENDING;
   }
 
+  virtual int GetDataFile(int index, base::PlatformFile* file, int64* offset,
+                          net::CompletionCallback* callback) {
+    return net::ERR_FAILED;
+  }
+
   virtual int ReadSparseData(int64 offset, net::IOBuffer* buf, int buf_len,
                              net::CompletionCallback* callback) {
     DCHECK(callback);
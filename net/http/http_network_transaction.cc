@@ -1206,6 +1206,9 @@ int HttpNetworkTransaction::HandleIOError(int error) {
        }
        break;
     case ERR_SPDY_PING_FAILED:
+    // Only idempotent requests are pipelined, so an evicted request can
+    // always be resent.
+    case ERR_PIPELINE_EVICTION:
       ResetConnectionAndRequestForResend();
       error = OK;
       break;
@@ -421,6 +421,41 @@ TEST_F(HttpNetworkTransactionTest, StatusLineJunk4Bytes_Slow) {
   EXPECT_EQ("DATA", out.response_data);
 }
 
+// The end-of-headers marker is split across several reads.
+TEST_F(HttpNetworkTransactionTest, EndOfHeadersSplitAcrossReads) {
+  MockRead data_reads[] = {
+    MockRead("HTTP/1.0 404 Not Found\r\nServer: blah\r"),
+    MockRead("\n"),
+    MockRead("\r"),
+    MockRead("\nDATA"),
+    MockRead(false, OK),
+  };
+  SimpleGetHelperResult out = SimpleGetHelper(data_reads,
+                                              arraysize(data_reads));
+  EXPECT_EQ(OK, out.rv);
+  EXPECT_EQ("HTTP/1.0 404 Not Found", out.status_line);
+  EXPECT_EQ("DATA", out.response_data);
+}
+
+// A 1xx response followed by headers that don't fit in the initial read
+// buffer, so that the buffer has to be compacted and grown.
+TEST_F(HttpNetworkTransactionTest, Ignores1xxThenLargeHeaders) {
+  std::string large_headers_string;
+  FillLargeHeadersString(&large_headers_string, 20 * 1024);
+
+  MockRead data_reads[] = {
+    MockRead("HTTP/1.1 100 Continue\r\n\r\nHTTP/1.0 200 OK\r\n"),
+    MockRead(true, large_headers_string.data(), large_headers_string.size()),
+    MockRead("\r\nDATA"),
+    MockRead(false, OK),
+  };
+  SimpleGetHelperResult out = SimpleGetHelper(data_reads,
+                                              arraysize(data_reads));
+  EXPECT_EQ(OK, out.rv);
+  EXPECT_EQ("HTTP/1.0 200 OK", out.status_line);
+  EXPECT_EQ("DATA", out.response_data);
+}
+
 // Close the connection before enough bytes to have a status line.
 TEST_F(HttpNetworkTransactionTest, StatusLinePartial) {
   MockRead data_reads[] = {
@@ -4981,6 +5016,91 @@ TEST_F(HttpNetworkTransactionTest, BuildRequest_PostContentLengthZero) {
   EXPECT_EQ(OK, rv);
 }
 
+// The headers and the body of a small POST go out in a single write.
+TEST_F(HttpNetworkTransactionTest, BuildRequest_PostHeadersAndBodyTogether) {
+  HttpRequestInfo request;
+  request.method = "POST";
+  request.url = GURL("http://www.google.com/");
+  request.upload_data = new UploadData;
+  request.upload_data->AppendBytes("foo=bar", 7);
+
+  SessionDependencies session_deps;
+  scoped_ptr<HttpTransaction> trans(
+      new HttpNetworkTransaction(CreateSession(&session_deps)));
+
+  MockWrite data_writes[] = {
+    MockWrite("POST / HTTP/1.1\r\n"
+              "Host: www.google.com\r\n"
+              "Connection: keep-alive\r\n"
+              "Content-Length: 7\r\n\r\n"
+              "foo=bar"),
+  };
+
+  MockRead data_reads[] = {
+    MockRead("HTTP/1.0 200 OK\r\n\r\n"),
+    MockRead(false, OK),
+  };
+
+  StaticSocketDataProvider data(data_reads, arraysize(data_reads),
+                                data_writes, arraysize(data_writes));
+  session_deps.socket_factory.AddSocketDataProvider(&data);
+
+  TestCompletionCallback callback;
+
+  int rv = trans->Start(&request, &callback, BoundNetLog());
+  EXPECT_EQ(ERR_IO_PENDING, rv);
+
+  rv = callback.WaitForResult();
+  EXPECT_EQ(OK, rv);
+  EXPECT_TRUE(data.at_write_eof());
+}
+
+// A chunked upload whose chunk is written a few bytes at a time, so that
+// each write has to resume partway through the chunk.
+TEST_F(HttpNetworkTransactionTest, BuildRequest_ChunkedPostPartialWrites) {
+  HttpRequestInfo request;
+  request.method = "POST";
+  request.url = GURL("http://www.google.com/");
+  request.upload_data = new UploadData;
+  request.upload_data->set_is_chunked(true);
+  request.upload_data->AppendChunk("foo", 3, false);
+  request.upload_data->AppendChunk("hello", 5, true);
+
+  SessionDependencies session_deps;
+  scoped_ptr<HttpTransaction> trans(
+      new HttpNetworkTransaction(CreateSession(&session_deps)));
+
+  MockWrite data_writes[] = {
+    MockWrite("POST / HTTP/1.1\r\n"
+              "Host: www.google.com\r\n"
+              "Connection: keep-alive\r\n"
+              "Transfer-Encoding: chunked\r\n\r\n"),
+    MockWrite("8\r"),
+    MockWrite("\nfoo"),
+    MockWrite("hello\r"),
+    MockWrite("\n"),
+    MockWrite("0\r\n\r\n"),
+  };
+
+  MockRead data_reads[] = {
+    MockRead("HTTP/1.0 200 OK\r\n\r\n"),
+    MockRead(false, OK),
+  };
+
+  StaticSocketDataProvider data(data_reads, arraysize(data_reads),
+                                data_writes, arraysize(data_writes));
+  session_deps.socket_factory.AddSocketDataProvider(&data);
+
+  TestCompletionCallback callback;
+
+  int rv = trans->Start(&request, &callback, BoundNetLog());
+  EXPECT_EQ(ERR_IO_PENDING, rv);
+
+  rv = callback.WaitForResult();
+  EXPECT_EQ(OK, rv);
+  EXPECT_TRUE(data.at_write_eof());
+}
+
 TEST_F(HttpNetworkTransactionTest, BuildRequest_PutContentLengthZero) {
   HttpRequestInfo request;
   request.method = "PUT";
@@ -0,0 +1,577 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_pipelined_connection.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/message_loop.h"
+#include "base/stl_util-inl.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/http/http_pipelined_stream.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_response_info.h"
+#include "net/http/http_stream_parser.h"
+#include "net/http/http_version.h"
+#include "net/socket/client_socket_handle.h"
+
+namespace net {
+
+namespace {
+
+// Responses longer than this keep the requests behind them waiting for too
+// long to put more requests on the pipeline.
+const int64 kHeadOfLineBlockingBodySize = 64 * 1024;
+
+}  // namespace
+
+HttpPipelinedConnection::StreamInfo::StreamInfo()
+    : parser(NULL),
+      state(STREAM_CREATED),
+      callback(NULL),
+      was_pipelined(false) {
+}
+
+HttpPipelinedConnection::StreamInfo::~StreamInfo() {}
+
+HttpPipelinedConnection::PendingSendRequest::PendingSendRequest()
+    : pipeline_id(0),
+      response(NULL) {
+}
+
+HttpPipelinedConnection::PendingSendRequest::~PendingSendRequest() {}
+
+HttpPipelinedConnection::HttpPipelinedConnection(
+    ClientSocketHandle* connection,
+    const HostPortPair& origin,
+    Delegate* delegate,
+    const SSLConfig& used_ssl_config,
+    const ProxyInfo& used_proxy_info,
+    const BoundNetLog& net_log,
+    bool was_npn_negotiated)
+    : delegate_(delegate),
+      connection_(connection),
+      read_buf_(new GrowableIOBuffer()),
+      origin_(origin),
+      used_ssl_config_(used_ssl_config),
+      used_proxy_info_(used_proxy_info),
+      net_log_(net_log),
+      was_npn_negotiated_(was_npn_negotiated),
+      next_pipeline_id_(1),
+      depth_(0),
+      usable_(true),
+      capacity_notification_pending_(false),
+      send_in_progress_(false),
+      read_in_progress_(false),
+      ALLOW_THIS_IN_INITIALIZER_LIST(
+          send_callback_(this, &HttpPipelinedConnection::OnSendComplete)),
+      ALLOW_THIS_IN_INITIALIZER_LIST(
+          read_callback_(this, &HttpPipelinedConnection::OnReadComplete)),
+      ALLOW_THIS_IN_INITIALIZER_LIST(method_factory_(this)) {
+  PostNotifyHasCapacity();
+}
+
+HttpPipelinedConnection::~HttpPipelinedConnection() {
+  DCHECK(stream_info_map_.empty());
+  STLDeleteElements(&pending_send_queue_);
+  // A broken pipeline may have unread responses on the wire.
+  if (connection_->socket() && (!usable_ || read_buf_->offset() > 0))
+    connection_->socket()->Disconnect();
+  connection_->Reset();
+  connection_.reset();
+  STLDeleteElements(&orphaned_parsers_);
+}
+
+HttpPipelinedStream* HttpPipelinedConnection::CreateNewStream() {
+  DCHECK(usable_);
+  int pipeline_id = next_pipeline_id_++;
+  stream_info_map_[pipeline_id] = StreamInfo();
+  ++depth_;
+  return new HttpPipelinedStream(this, pipeline_id);
+}
+
+bool HttpPipelinedConnection::IsHeadOfLineBlocked() const {
+  if (request_order_.empty())
+    return false;
+  StreamInfoMap::const_iterator it =
+      stream_info_map_.find(request_order_.front());
+  if (it == stream_info_map_.end() || it->second.state != STREAM_ACTIVE)
+    return false;
+  const HttpResponseHeaders* headers =
+      it->second.parser->GetResponseInfo()->headers;
+  if (!headers)
+    return false;
+  // Chunked responses, and responses that end when the connection closes,
+  // have no Content-Length.
+  int64 content_length = headers->GetContentLength();
+  return content_length < 0 || content_length > kHeadOfLineBlockingBodySize;
+}
+
+void HttpPipelinedConnection::OnStreamDeleted(int pipeline_id) {
+  StreamInfoMap::iterator it = stream_info_map_.find(pipeline_id);
+  CHECK(it != stream_info_map_.end());
+  Close(pipeline_id, true);
+
+  // The socket may still call back into a parser that is reading or writing,
+  // so such a parser lives until the socket is gone.
+  bool sending = send_in_progress_ &&
+      pending_send_queue_.front()->pipeline_id == pipeline_id;
+  bool reading = read_in_progress_ && !request_order_.empty() &&
+      request_order_.front() == pipeline_id;
+  if (sending || reading)
+    orphaned_parsers_.push_back(it->second.parser);
+  else
+    delete it->second.parser;
+  stream_info_map_.erase(it);
+
+  if (stream_info_map_.empty())
+    delegate_->OnPipelineEmpty(this);  // May delete |this|.
+}
+
+void HttpPipelinedConnection::InitializeParser(int pipeline_id,
+                                               const HttpRequestInfo* request,
+                                               const BoundNetLog& net_log) {
+  CHECK(ContainsKey(stream_info_map_, pipeline_id));
+  StreamInfo& info = stream_info_map_[pipeline_id];
+  DCHECK(!info.parser);
+  info.parser = new HttpStreamParser(connection_.get(), request,
+                                     read_buf_.get(), net_log);
+  if (info.state == STREAM_CREATED)
+    info.state = STREAM_BOUND;
+}
+
+int HttpPipelinedConnection::SendRequest(int pipeline_id,
+                                         const std::string& request_line,
+                                         const HttpRequestHeaders& headers,
+                                         UploadDataStream* request_body,
+                                         HttpResponseInfo* response,
+                                         CompletionCallback* callback) {
+  CHECK(ContainsKey(stream_info_map_, pipeline_id));
+  StreamInfo& info = stream_info_map_[pipeline_id];
+  if (info.state == STREAM_EVICTED) {
+    delete request_body;
+    return ERR_PIPELINE_EVICTION;
+  }
+  DCHECK_EQ(STREAM_BOUND, info.state);
+
+  PendingSendRequest* send = new PendingSendRequest;
+  send->pipeline_id = pipeline_id;
+  send->request_line = request_line;
+  send->headers.CopyFrom(headers);
+  send->request_body.reset(request_body);
+  send->response = response;
+  pending_send_queue_.push_back(send);
+  info.state = STREAM_SENDING;
+
+  // Another send is running, or the next one is about to start.
+  if (send_in_progress_ || pending_send_queue_.size() > 1) {
+    info.callback = callback;
+    return ERR_IO_PENDING;
+  }
+
+  int rv = DoSendNext();
+  if (rv == ERR_IO_PENDING) {
+    info.callback = callback;
+    return rv;
+  }
+  return FinishSend(pipeline_id, rv);
+}
+
+int HttpPipelinedConnection::DoSendNext() {
+  DCHECK(!send_in_progress_);
+  PendingSendRequest* send = pending_send_queue_.front();
+  StreamInfo& info = stream_info_map_[send->pipeline_id];
+  info.was_pipelined = !request_order_.empty();
+  request_order_.push_back(send->pipeline_id);
+  send_in_progress_ = true;
+  return info.parser->SendRequest(send->request_line, send->headers,
+                                  send->request_body.release(),
+                                  send->response, &send_callback_);
+}
+
+void HttpPipelinedConnection::OnSendComplete(int result) {
+  DCHECK(send_in_progress_);
+  int pipeline_id = pending_send_queue_.front()->pipeline_id;
+  result = FinishSend(pipeline_id, result);
+  DoCallback(pipeline_id, result);
+}
+
+int HttpPipelinedConnection::FinishSend(int pipeline_id, int result) {
+  DCHECK(send_in_progress_);
+  send_in_progress_ = false;
+  delete pending_send_queue_.front();
+  pending_send_queue_.pop_front();
+  if (!pending_send_queue_.empty()) {
+    MessageLoop::current()->PostTask(
+        FROM_HERE,
+        method_factory_.NewRunnableMethod(
+            &HttpPipelinedConnection::StartNextSend));
+  }
+
+  StreamInfoMap::iterator it = stream_info_map_.find(pipeline_id);
+  if (it == stream_info_map_.end())
+    return result;
+  StreamInfo& info = it->second;
+  if (info.state == STREAM_EVICTED)
+    return ERR_PIPELINE_EVICTION;
+  if (info.state != STREAM_SENDING)
+    return result;
+  if (result < 0) {
+    // Part of the request may have been sent.
+    Break(pipeline_id);
+    SetStreamState(&info, STREAM_CLOSED);
+    return result;
+  }
+  info.state = STREAM_SENT;
+  return OK;
+}
+
+void HttpPipelinedConnection::StartNextSend() {
+  if (send_in_progress_ || pending_send_queue_.empty())
+    return;
+  int pipeline_id = pending_send_queue_.front()->pipeline_id;
+  int rv = DoSendNext();
+  if (rv == ERR_IO_PENDING)
+    return;
+  rv = FinishSend(pipeline_id, rv);
+  DoCallback(pipeline_id, rv);
+}
+
+int HttpPipelinedConnection::ReadResponseHeaders(int pipeline_id,
+                                                 CompletionCallback* callback) {
+  CHECK(ContainsKey(stream_info_map_, pipeline_id));
+  StreamInfo& info = stream_info_map_[pipeline_id];
+  if (info.state == STREAM_EVICTED)
+    return ERR_PIPELINE_EVICTION;
+  DCHECK_EQ(STREAM_SENT, info.state);
+  info.state = STREAM_READ_PENDING;
+
+  // Wait for the responses to the earlier requests to be read.
+  if (read_in_progress_ || request_order_.front() != pipeline_id) {
+    info.callback = callback;
+    return ERR_IO_PENDING;
+  }
+
+  int rv = DoReadHeaders(pipeline_id);
+  if (rv == ERR_IO_PENDING)
+    info.callback = callback;
+  return rv;
+}
+
+void HttpPipelinedConnection::StartNextRead() {
+  if (read_in_progress_ || request_order_.empty())
+    return;
+  int pipeline_id = request_order_.front();
+  StreamInfoMap::iterator it = stream_info_map_.find(pipeline_id);
+  if (it == stream_info_map_.end() ||
+      it->second.state != STREAM_READ_PENDING) {
+    return;
+  }
+  int rv = DoReadHeaders(pipeline_id);
+  if (rv != ERR_IO_PENDING)
+    DoCallback(pipeline_id, rv);
+}
+
+int HttpPipelinedConnection::DoReadHeaders(int pipeline_id) {
+  StreamInfo& info = stream_info_map_[pipeline_id];
+  info.state = STREAM_READING_HEADERS;
+  read_in_progress_ = true;
+  int rv = info.parser->ReadResponseHeaders(&read_callback_);
+  if (rv == ERR_IO_PENDING)
+    return rv;
+  read_in_progress_ = false;
+  return CheckResponseHeaders(pipeline_id, rv);
+}
+
+int HttpPipelinedConnection::ReadResponseBody(int pipeline_id,
+                                              IOBuffer* buf,
+                                              int buf_len,
+                                              CompletionCallback* callback) {
+  CHECK(ContainsKey(stream_info_map_, pipeline_id));
+  StreamInfo& info = stream_info_map_[pipeline_id];
+  if (info.state == STREAM_EVICTED)
+    return ERR_PIPELINE_EVICTION;
+  if (info.state == STREAM_DONE)
+    return info.parser->ReadResponseBody(buf, buf_len, callback);
+  DCHECK_EQ(STREAM_ACTIVE, info.state);
+  DCHECK(!read_in_progress_);
+
+  read_in_progress_ = true;
+  int rv = info.parser->ReadResponseBody(buf, buf_len, &read_callback_);
+  if (rv == ERR_IO_PENDING) {
+    info.callback = callback;
+    return rv;
+  }
+  read_in_progress_ = false;
+  CheckResponseBody(pipeline_id, rv);
+  return rv;
+}
+
+void HttpPipelinedConnection::OnReadComplete(int result) {
+  DCHECK(read_in_progress_);
+  DCHECK(!request_order_.empty());
+  read_in_progress_ = false;
+  int pipeline_id = request_order_.front();
+  StreamInfoMap::iterator it = stream_info_map_.find(pipeline_id);
+  // The stream was closed while reading, which broke the pipeline.
+  if (it == stream_info_map_.end() || it->second.state == STREAM_CLOSED)
+    return;
+
+  if (it->second.state == STREAM_READING_HEADERS)
+    result = CheckResponseHeaders(pipeline_id, result);
+  else
+    CheckResponseBody(pipeline_id, result);
+  DoCallback(pipeline_id, result);
+}
+
+int HttpPipelinedConnection::CheckResponseHeaders(int pipeline_id,
+                                                  int result) {
+  StreamInfo& info = stream_info_map_[pipeline_id];
+  info.state = STREAM_ACTIVE;
+  if (result < 0) {
+    if (info.was_pipelined)
+      delegate_->OnPipelineFeedback(this, PIPELINE_INCAPABLE);
+    Break(pipeline_id);
+    return result;
+  }
+
+  const HttpResponseInfo* response = info.parser->GetResponseInfo();
+  const HttpResponseHeaders* headers = response->headers;
+  int response_code = headers->response_code();
+  if (headers->GetParsedHttpVersion() < HttpVersion(1, 1) ||
+      !info.parser->CanFindEndOfResponse() ||
+      response_code == 401 || response_code == 407) {
+    // Connection-based authentication schemes need the connection to
+    // themselves.
+    delegate_->OnPipelineFeedback(this, PIPELINE_INCAPABLE);
+    Break(pipeline_id);
+  } else if (!headers->IsKeepAlive()) {
+    // Says nothing about the origin; the server is just done with us.
+    Break(pipeline_id);
+  } else {
+    delegate_->OnPipelineFeedback(this, PIPELINE_CAPABLE);
+    PostNotifyHasCapacity();
+  }
+
+  if (info.parser->IsResponseBodyComplete())
+    FinishActiveRead(pipeline_id);
+  return OK;
+}
+
+void HttpPipelinedConnection::CheckResponseBody(int pipeline_id, int result) {
+  StreamInfo& info = stream_info_map_[pipeline_id];
+  if (result < 0) {
+    if (info.was_pipelined)
+      delegate_->OnPipelineFeedback(this, PIPELINE_INCAPABLE);
+    Break(pipeline_id);
+    return;
+  }
+  if (info.parser->IsResponseBodyComplete())
+    FinishActiveRead(pipeline_id);
+}
+
+void HttpPipelinedConnection::FinishActiveRead(int pipeline_id) {
+  DCHECK_EQ(pipeline_id, request_order_.front());
+  SetStreamState(&stream_info_map_[pipeline_id], STREAM_DONE);
+  request_order_.pop_front();
+  if (!request_order_.empty()) {
+    MessageLoop::current()->PostTask(
+        FROM_HERE,
+        method_factory_.NewRunnableMethod(
+            &HttpPipelinedConnection::StartNextRead));
+  }
+}
+
+void HttpPipelinedConnection::Close(int pipeline_id, bool not_reusable) {
+  CHECK(ContainsKey(stream_info_map_, pipeline_id));
+  StreamInfo& info = stream_info_map_[pipeline_id];
+  info.callback = NULL;
+  switch (info.state) {
+    case STREAM_CREATED:
+    case STREAM_BOUND:
+    case STREAM_DONE:
+      break;
+
+    case STREAM_SENDING:
+      if (send_in_progress_ &&
+          pending_send_queue_.front()->pipeline_id == pipeline_id) {
+        // Part of the request may be on the wire already.
+        Break(pipeline_id);
+      } else {
+        for (std::deque<PendingSendRequest*>::iterator it =
+                 pending_send_queue_.begin();
+             it != pending_send_queue_.end(); ++it) {
+          if ((*it)->pipeline_id == pipeline_id) {
+            delete *it;
+            pending_send_queue_.erase(it);
+            break;
+          }
+        }
+      }
+      break;
+
+    case STREAM_SENT:
+    case STREAM_READ_PENDING:
+    case STREAM_READING_HEADERS:
+    case STREAM_ACTIVE:
+      // Nobody would read the rest of this response, so the responses
+      // behind it cannot be found.
+      Break(pipeline_id);
+      break;
+
+    case STREAM_CLOSED:
+    case STREAM_EVICTED:
+      return;
+  }
+  SetStreamState(&info, STREAM_CLOSED);
+}
+
+uint64 HttpPipelinedConnection::GetUploadProgress(int pipeline_id) const {
+  StreamInfoMap::const_iterator it = stream_info_map_.find(pipeline_id);
+  CHECK(it != stream_info_map_.end());
+  return it->second.parser->GetUploadProgress();
+}
+
+HttpResponseInfo* HttpPipelinedConnection::GetResponseInfo(int pipeline_id) {
+  CHECK(ContainsKey(stream_info_map_, pipeline_id));
+  return stream_info_map_[pipeline_id].parser->GetResponseInfo();
+}
+
+bool HttpPipelinedConnection::IsResponseBodyComplete(int pipeline_id) const {
+  StreamInfoMap::const_iterator it = stream_info_map_.find(pipeline_id);
+  CHECK(it != stream_info_map_.end());
+  return it->second.parser->IsResponseBodyComplete();
+}
+
+bool HttpPipelinedConnection::CanFindEndOfResponse(int pipeline_id) const {
+  StreamInfoMap::const_iterator it = stream_info_map_.find(pipeline_id);
+  CHECK(it != stream_info_map_.end());
+  return it->second.parser->CanFindEndOfResponse();
+}
+
+bool HttpPipelinedConnection::IsMoreDataBuffered(int pipeline_id) const {
+  StreamInfoMap::const_iterator it = stream_info_map_.find(pipeline_id);
+  CHECK(it != stream_info_map_.end());
+  return it->second.parser->IsMoreDataBuffered();
+}
+
+bool HttpPipelinedConnection::IsConnectionReused(int pipeline_id) const {
+  StreamInfoMap::const_iterator it = stream_info_map_.find(pipeline_id);
+  CHECK(it != stream_info_map_.end());
+  if (pipeline_id > 1)
+    return true;
+  return it->second.parser->IsConnectionReused();
+}
+
+void HttpPipelinedConnection::SetConnectionReused(int pipeline_id) {
+  CHECK(ContainsKey(stream_info_map_, pipeline_id));
+  stream_info_map_[pipeline_id].parser->SetConnectionReused();
+}
+
+void HttpPipelinedConnection::GetSSLInfo(int pipeline_id, SSLInfo* ssl_info) {
+  CHECK(ContainsKey(stream_info_map_, pipeline_id));
+  stream_info_map_[pipeline_id].parser->GetSSLInfo(ssl_info);
+}
+
+void HttpPipelinedConnection::GetSSLCertRequestInfo(
+    int pipeline_id,
+    SSLCertRequestInfo* cert_request_info) {
+  CHECK(ContainsKey(stream_info_map_, pipeline_id));
+  stream_info_map_[pipeline_id].parser->GetSSLCertRequestInfo(
+      cert_request_info);
+}
+
+void HttpPipelinedConnection::Break(int pipeline_id) {
+  usable_ = false;
+
+  // The streams whose requests went out after |pipeline_id|'s.
+  std::deque<int>::iterator order_it =
+      std::find(request_order_.begin(), request_order_.end(), pipeline_id);
+  DCHECK(order_it != request_order_.end());
+  if (order_it != request_order_.end())
+    ++order_it;
+  std::vector<int> evicted(order_it, request_order_.end());
+  request_order_.erase(order_it, request_order_.end());
+
+  // The streams whose requests have not gone out yet.
+  std::deque<PendingSendRequest*>::iterator send_it =
+      pending_send_queue_.begin();
+  if (send_in_progress_)
+    ++send_it;
+  for (std::deque<PendingSendRequest*>::iterator it = send_it;
+       it != pending_send_queue_.end(); ++it) {
+    evicted.push_back((*it)->pipeline_id);
+    delete *it;
+  }
+  pending_send_queue_.erase(send_it, pending_send_queue_.end());
+
+  for (StreamInfoMap::iterator it = stream_info_map_.begin();
+       it != stream_info_map_.end(); ++it) {
+    if (it->second.state == STREAM_CREATED ||
+        it->second.state == STREAM_BOUND) {
+      evicted.push_back(it->first);
+    }
+  }
+
+  for (std::vector<int>::const_iterator it = evicted.begin();
+       it != evicted.end(); ++it) {
+    EvictStream(*it);
+  }
+}
+
+void HttpPipelinedConnection::EvictStream(int pipeline_id) {
+  StreamInfo& info = stream_info_map_[pipeline_id];
+  SetStreamState(&info, STREAM_EVICTED);
+  // A send in flight reports the eviction when it completes.
+  bool sending = send_in_progress_ &&
+      pending_send_queue_.front()->pipeline_id == pipeline_id;
+  if (info.callback && !sending) {
+    MessageLoop::current()->PostTask(
+        FROM_HERE,
+        method_factory_.NewRunnableMethod(
+            &HttpPipelinedConnection::DoCallback, pipeline_id,
+            static_cast<int>(ERR_PIPELINE_EVICTION)));
+  }
+}
+
+void HttpPipelinedConnection::SetStreamState(StreamInfo* info,
+                                             StreamState state) {
+  DCHECK_GE(state, info->state);
+  bool was_unfinished = info->state < STREAM_DONE;
+  info->state = state;
+  if (was_unfinished && state >= STREAM_DONE) {
+    --depth_;
+    PostNotifyHasCapacity();
+  }
+}
+
+void HttpPipelinedConnection::DoCallback(int pipeline_id, int result) {
+  StreamInfoMap::iterator it = stream_info_map_.find(pipeline_id);
+  if (it == stream_info_map_.end())
+    return;
+  CompletionCallback* callback = it->second.callback;
+  it->second.callback = NULL;
+  if (callback)
+    callback->Run(result);  // May delete |this|.
+}
+
+void HttpPipelinedConnection::PostNotifyHasCapacity() {
+  if (!usable_ || capacity_notification_pending_)
+    return;
+  capacity_notification_pending_ = true;
+  MessageLoop::current()->PostTask(
+      FROM_HERE,
+      method_factory_.NewRunnableMethod(
+          &HttpPipelinedConnection::NotifyHasCapacity));
+}
+
+void HttpPipelinedConnection::NotifyHasCapacity() {
+  capacity_notification_pending_ = false;
+  if (usable_)
+    delegate_->OnPipelineHasCapacity(this);
+}
+
+}  // namespace net
@@ -0,0 +1,261 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// HttpPipelinedConnection sends the requests of several HttpPipelinedStreams
+// over one HTTP/1.1 connection without waiting for the earlier responses, and
+// hands each stream its response in the order the requests were sent.  Each
+// stream has its own HttpStreamParser; they share the connection and the read
+// buffer, which carries the bytes of the next response over from one parser
+// to the next.
+//
+// If the pipeline breaks (a read or write error, a response that cannot be
+// delimited, a stream closed before its response was read), the streams that
+// were queued behind the failure are evicted: their operations fail with
+// ERR_PIPELINE_EVICTION, and the transaction resends them elsewhere.  Only
+// idempotent requests are pipelined, so resending is always safe.
+
+#ifndef NET_HTTP_HTTP_PIPELINED_CONNECTION_H_
+#define NET_HTTP_HTTP_PIPELINED_CONNECTION_H_
+#pragma once
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/task.h"
+#include "net/base/completion_callback.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/net_log.h"
+#include "net/base/ssl_config_service.h"
+#include "net/http/http_request_headers.h"
+#include "net/proxy/proxy_info.h"
+
+namespace net {
+
+class ClientSocketHandle;
+class GrowableIOBuffer;
+class HttpPipelinedStream;
+struct HttpRequestInfo;
+class HttpResponseInfo;
+class HttpStreamParser;
+class IOBuffer;
+class SSLCertRequestInfo;
+class SSLInfo;
+class UploadDataStream;
+
+class HttpPipelinedConnection {
+ public:
+  // What a response taught us about the origin's support for pipelining.
+  enum Feedback {
+    // A keep-alive HTTP/1.1 response that can be delimited.
+    PIPELINE_CAPABLE,
+    // A response or error that rules out pipelining to the origin.
+    PIPELINE_INCAPABLE,
+  };
+
+  class Delegate {
+   public:
+    // Called when |pipeline| can take another stream.
+    virtual void OnPipelineHasCapacity(HttpPipelinedConnection* pipeline) = 0;
+
+    // Called when |pipeline| has learned something about its origin.
+    virtual void OnPipelineFeedback(HttpPipelinedConnection* pipeline,
+                                    Feedback feedback) = 0;
+
+    // Called when the last stream of |pipeline| has been deleted.  The
+    // delegate should delete |pipeline|.
+    virtual void OnPipelineEmpty(HttpPipelinedConnection* pipeline) = 0;
+
+   protected:
+    virtual ~Delegate() {}
+  };
+
+  // Takes ownership of |connection|, an idle connection to |origin|.
+  HttpPipelinedConnection(ClientSocketHandle* connection,
+                          const HostPortPair& origin,
+                          Delegate* delegate,
+                          const SSLConfig& used_ssl_config,
+                          const ProxyInfo& used_proxy_info,
+                          const BoundNetLog& net_log,
+                          bool was_npn_negotiated);
+  ~HttpPipelinedConnection();
+
+  // Returns a new stream on this pipeline, owned by the caller.
+  HttpPipelinedStream* CreateNewStream();
+
+  // The number of streams whose responses have not been read yet.
+  int depth() const { return depth_; }
+
+  // Returns whether new streams may be added to the pipeline.
+  bool usable() const { return usable_; }
+
+  // Returns whether the response being read is large or of unknown length,
+  // so that a request added now would wait a long time for its turn.
+  bool IsHeadOfLineBlocked() const;
+
+  const HostPortPair& origin() const { return origin_; }
+  const SSLConfig& used_ssl_config() const { return used_ssl_config_; }
+  const ProxyInfo& used_proxy_info() const { return used_proxy_info_; }
+  const NetLog::Source& source() const { return net_log_.source(); }
+  bool was_npn_negotiated() const { return was_npn_negotiated_; }
+
+  // The following are called by HttpPipelinedStream, and implement the
+  // HttpStream methods of the stream |pipeline_id|.
+
+  void OnStreamDeleted(int pipeline_id);
+
+  void InitializeParser(int pipeline_id,
+                        const HttpRequestInfo* request,
+                        const BoundNetLog& net_log);
+
+  int SendRequest(int pipeline_id,
+                  const std::string& request_line,
+                  const HttpRequestHeaders& headers,
+                  UploadDataStream* request_body,
+                  HttpResponseInfo* response,
+                  CompletionCallback* callback);
+
+  int ReadResponseHeaders(int pipeline_id, CompletionCallback* callback);
+
+  int ReadResponseBody(int pipeline_id, IOBuffer* buf, int buf_len,
+                       CompletionCallback* callback);
+
+  void Close(int pipeline_id, bool not_reusable);
+
+  uint64 GetUploadProgress(int pipeline_id) const;
+
+  HttpResponseInfo* GetResponseInfo(int pipeline_id);
+
+  bool IsResponseBodyComplete(int pipeline_id) const;
+
+  bool CanFindEndOfResponse(int pipeline_id) const;
+
+  bool IsMoreDataBuffered(int pipeline_id) const;
+
+  bool IsConnectionReused(int pipeline_id) const;
+
+  void SetConnectionReused(int pipeline_id);
+
+  void GetSSLInfo(int pipeline_id, SSLInfo* ssl_info);
+
+  void GetSSLCertRequestInfo(int pipeline_id,
+                             SSLCertRequestInfo* cert_request_info);
+
+ private:
+  // The states are in order; a stream never moves to an earlier one.
+  enum StreamState {
+    STREAM_CREATED,
+    STREAM_BOUND,
+    // Queued for sending, or being sent.
+    STREAM_SENDING,
+    STREAM_SENT,
+    // Waiting for the earlier responses to be read.
+    STREAM_READ_PENDING,
+    STREAM_READING_HEADERS,
+    // Reading the response body.
+    STREAM_ACTIVE,
+    // The whole response has been read.
+    STREAM_DONE,
+    STREAM_CLOSED,
+    STREAM_EVICTED,
+  };
+
+  struct StreamInfo {
+    StreamInfo();
+    ~StreamInfo();
+
+    HttpStreamParser* parser;
+    StreamState state;
+    // The callback of the pending operation, if any.
+    CompletionCallback* callback;
+    // Whether the request was sent while an earlier response was unread.
+    bool was_pipelined;
+  };
+
+  struct PendingSendRequest {
+    PendingSendRequest();
+    ~PendingSendRequest();
+
+    int pipeline_id;
+    std::string request_line;
+    HttpRequestHeaders headers;
+    scoped_ptr<UploadDataStream> request_body;
+    HttpResponseInfo* response;
+  };
+
+  typedef std::map<int, StreamInfo> StreamInfoMap;
+
+  // Starts sending the request at the front of |pending_send_queue_|.
+  // Returns the result of the send, or ERR_IO_PENDING.
+  int DoSendNext();
+  void OnSendComplete(int result);
+  // Records the end of the current send, and returns the result to report to
+  // its stream.
+  int FinishSend(int pipeline_id, int result);
+  void StartNextSend();
+
+  // Makes the stream whose response comes next read it, if it asked to.
+  void StartNextRead();
+  int DoReadHeaders(int pipeline_id);
+  void OnReadComplete(int result);
+  // Look at the active stream once its headers, or part of its body, are read.
+  // CheckResponseHeaders() returns the result to hand to the stream.
+  int CheckResponseHeaders(int pipeline_id, int result);
+  void CheckResponseBody(int pipeline_id, int result);
+
+  // Called when the active stream has read all of its response.
+  void FinishActiveRead(int pipeline_id);
+
+  // Stops the pipeline: no more streams are added, and every stream that was
+  // not sent before |pipeline_id| is evicted.
+  void Break(int pipeline_id);
+
+  void EvictStream(int pipeline_id);
+  void SetStreamState(StreamInfo* info, StreamState state);
+  void DoCallback(int pipeline_id, int result);
+  void PostNotifyHasCapacity();
+  void NotifyHasCapacity();
+
+  Delegate* const delegate_;
+  scoped_ptr<ClientSocketHandle> connection_;
+  scoped_refptr<GrowableIOBuffer> read_buf_;
+  const HostPortPair origin_;
+  const SSLConfig used_ssl_config_;
+  const ProxyInfo used_proxy_info_;
+  const BoundNetLog net_log_;
+  const bool was_npn_negotiated_;
+
+  StreamInfoMap stream_info_map_;
+  int next_pipeline_id_;
+  int depth_;
+  bool usable_;
+  bool capacity_notification_pending_;
+
+  // The requests waiting to be sent, the one being sent first.
+  std::deque<PendingSendRequest*> pending_send_queue_;
+  bool send_in_progress_;
+
+  // The streams whose requests have been sent, in order, and whose responses
+  // have not been read yet.  The front one is, or will be, the active one.
+  std::deque<int> request_order_;
+  bool read_in_progress_;
+
+  // Parsers of deleted streams that still had a read or write in flight.
+  // They are deleted after the socket.
+  std::vector<HttpStreamParser*> orphaned_parsers_;
+
+  CompletionCallbackImpl<HttpPipelinedConnection> send_callback_;
+  CompletionCallbackImpl<HttpPipelinedConnection> read_callback_;
+  ScopedRunnableMethodFactory<HttpPipelinedConnection> method_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpPipelinedConnection);
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_PIPELINED_CONNECTION_H_
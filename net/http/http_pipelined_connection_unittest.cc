@@ -0,0 +1,377 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_pipelined_connection.h"
+
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/base/net_log.h"
+#include "net/base/test_completion_callback.h"
+#include "net/http/http_pipelined_stream.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_request_info.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_response_info.h"
+#include "net/proxy/proxy_info.h"
+#include "net/socket/client_socket_handle.h"
+#include "net/socket/socket_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const char kRequest1[] = "GET /ok.html HTTP/1.1\r\n\r\n";
+const char kRequest2[] = "GET /ko.html HTTP/1.1\r\n\r\n";
+const char kResponse1[] =
+    "HTTP/1.1 200 OK\r\nContent-Length: 7\r\n\r\nok.html";
+const char kResponse2[] =
+    "HTTP/1.1 200 OK\r\nContent-Length: 7\r\n\r\nko.html";
+
+class TestPipelineDelegate : public HttpPipelinedConnection::Delegate {
+ public:
+  TestPipelineDelegate()
+      : capable_feedback_count_(0),
+        incapable_feedback_count_(0),
+        empty_(false) {
+  }
+
+  virtual void OnPipelineHasCapacity(HttpPipelinedConnection* pipeline) {}
+
+  virtual void OnPipelineFeedback(HttpPipelinedConnection* pipeline,
+                                  HttpPipelinedConnection::Feedback feedback) {
+    if (feedback == HttpPipelinedConnection::PIPELINE_CAPABLE)
+      ++capable_feedback_count_;
+    else
+      ++incapable_feedback_count_;
+  }
+
+  virtual void OnPipelineEmpty(HttpPipelinedConnection* pipeline) {
+    empty_ = true;
+    delete pipeline;
+  }
+
+  int capable_feedback_count() const { return capable_feedback_count_; }
+  int incapable_feedback_count() const { return incapable_feedback_count_; }
+  bool empty() const { return empty_; }
+
+ private:
+  int capable_feedback_count_;
+  int incapable_feedback_count_;
+  bool empty_;
+};
+
+class HttpPipelinedConnectionTest : public testing::Test {
+ protected:
+  HttpPipelinedConnectionTest() : pipeline_(NULL) {}
+
+  void Initialize(MockRead* reads, size_t reads_count,
+                  MockWrite* writes, size_t writes_count) {
+    data_.reset(new StaticSocketDataProvider(reads, reads_count,
+                                             writes, writes_count));
+    data_->set_connect_data(MockConnect(false, OK));
+    MockTCPClientSocket* socket =
+        new MockTCPClientSocket(AddressList(), NULL, data_.get());
+    TestCompletionCallback callback;
+    EXPECT_EQ(OK, socket->Connect(&callback));
+    ClientSocketHandle* connection = new ClientSocketHandle;
+    connection->set_socket(socket);
+    pipeline_ = new HttpPipelinedConnection(
+        connection, HostPortPair("localhost", 80), &delegate_, SSLConfig(),
+        ProxyInfo(), BoundNetLog(), false);
+  }
+
+  // Returns a stream for a GET of |path| that is ready to send its request.
+  HttpPipelinedStream* NewTestStream(const std::string& path) {
+    HttpPipelinedStream* stream = pipeline_->CreateNewStream();
+    HttpRequestInfo* request_info = new HttpRequestInfo;
+    request_info->url = GURL("http://localhost/" + path);
+    request_info->method = "GET";
+    request_infos_.push_back(request_info);
+    EXPECT_EQ(OK, stream->InitializeStream(request_info, BoundNetLog(), NULL));
+    return stream;
+  }
+
+  // Reads the body of |stream| and checks that it is |expected|.
+  void ExpectResponseBody(HttpPipelinedStream* stream,
+                          const std::string& expected) {
+    scoped_refptr<IOBuffer> buf(new IOBuffer(expected.size()));
+    EXPECT_EQ(static_cast<int>(expected.size()),
+              stream->ReadResponseBody(buf, expected.size(), NULL));
+    EXPECT_EQ(expected, std::string(buf->data(), expected.size()));
+    EXPECT_TRUE(stream->IsResponseBodyComplete());
+  }
+
+  TestPipelineDelegate delegate_;
+  scoped_ptr<StaticSocketDataProvider> data_;
+  ScopedVector<HttpRequestInfo> request_infos_;
+  HttpPipelinedConnection* pipeline_;
+  HttpRequestHeaders headers_;
+  HttpResponseInfo response1_;
+  HttpResponseInfo response2_;
+};
+
+TEST_F(HttpPipelinedConnectionTest, ResponsesReadInOrder) {
+  MockWrite writes[] = {
+    MockWrite(false, kRequest1),
+    MockWrite(false, kRequest2),
+  };
+  MockRead reads[] = {
+    MockRead(false, kResponse1),
+    MockRead(false, kResponse2),
+  };
+  Initialize(reads, arraysize(reads), writes, arraysize(writes));
+
+  scoped_ptr<HttpPipelinedStream> stream1(NewTestStream("ok.html"));
+  scoped_ptr<HttpPipelinedStream> stream2(NewTestStream("ko.html"));
+  EXPECT_EQ(2, pipeline_->depth());
+
+  EXPECT_EQ(OK, stream1->SendRequest(headers_, NULL, &response1_, NULL));
+  EXPECT_EQ(OK, stream2->SendRequest(headers_, NULL, &response2_, NULL));
+
+  EXPECT_EQ(OK, stream1->ReadResponseHeaders(NULL));
+  EXPECT_EQ(1, delegate_.capable_feedback_count());
+  ExpectResponseBody(stream1.get(), "ok.html");
+  EXPECT_EQ(1, pipeline_->depth());
+
+  EXPECT_EQ(OK, stream2->ReadResponseHeaders(NULL));
+  ExpectResponseBody(stream2.get(), "ko.html");
+  EXPECT_TRUE(stream2->IsConnectionReused());
+
+  stream1->Close(false);
+  stream2->Close(false);
+  EXPECT_EQ(0, pipeline_->depth());
+  EXPECT_TRUE(pipeline_->usable());
+
+  stream1.reset();
+  stream2.reset();
+  EXPECT_TRUE(delegate_.empty());
+}
+
+TEST_F(HttpPipelinedConnectionTest, ResponsesShareReadBuffer) {
+  MockWrite writes[] = {
+    MockWrite(false, kRequest1),
+    MockWrite(false, kRequest2),
+  };
+  std::string responses = std::string(kResponse1) + kResponse2;
+  MockRead reads[] = {
+    MockRead(false, responses.data(), responses.size()),
+  };
+  Initialize(reads, arraysize(reads), writes, arraysize(writes));
+
+  scoped_ptr<HttpPipelinedStream> stream1(NewTestStream("ok.html"));
+  scoped_ptr<HttpPipelinedStream> stream2(NewTestStream("ko.html"));
+  EXPECT_EQ(OK, stream1->SendRequest(headers_, NULL, &response1_, NULL));
+  EXPECT_EQ(OK, stream2->SendRequest(headers_, NULL, &response2_, NULL));
+
+  EXPECT_EQ(OK, stream1->ReadResponseHeaders(NULL));
+  ExpectResponseBody(stream1.get(), "ok.html");
+  EXPECT_TRUE(stream1->IsMoreDataBuffered());
+
+  // The second response is already in the read buffer.
+  EXPECT_EQ(OK, stream2->ReadResponseHeaders(NULL));
+  ExpectResponseBody(stream2.get(), "ko.html");
+  EXPECT_EQ(1U, data_->read_index());
+}
+
+// A stream may join the pipeline as soon as the headers of the response
+// before it are read, while the rest of that response is still buffered.
+TEST_F(HttpPipelinedConnectionTest, StreamInitializedWhileBodyBuffered) {
+  MockWrite writes[] = {
+    MockWrite(false, kRequest1),
+    MockWrite(false, kRequest2),
+  };
+  std::string responses = std::string(kResponse1) + kResponse2;
+  MockRead reads[] = {
+    MockRead(false, responses.data(), responses.size()),
+  };
+  Initialize(reads, arraysize(reads), writes, arraysize(writes));
+
+  scoped_ptr<HttpPipelinedStream> stream1(NewTestStream("ok.html"));
+  EXPECT_EQ(OK, stream1->SendRequest(headers_, NULL, &response1_, NULL));
+  EXPECT_EQ(OK, stream1->ReadResponseHeaders(NULL));
+  EXPECT_TRUE(stream1->IsMoreDataBuffered());
+
+  scoped_ptr<HttpPipelinedStream> stream2(NewTestStream("ko.html"));
+  EXPECT_EQ(OK, stream2->SendRequest(headers_, NULL, &response2_, NULL));
+
+  ExpectResponseBody(stream1.get(), "ok.html");
+  EXPECT_EQ(OK, stream2->ReadResponseHeaders(NULL));
+  ExpectResponseBody(stream2.get(), "ko.html");
+  EXPECT_EQ(1U, data_->read_index());
+}
+
+TEST_F(HttpPipelinedConnectionTest, LaterReadWaitsForEarlierResponse) {
+  MockWrite writes[] = {
+    MockWrite(false, kRequest1),
+    MockWrite(false, kRequest2),
+  };
+  MockRead reads[] = {
+    MockRead(false, kResponse1),
+    MockRead(false, kResponse2),
+  };
+  Initialize(reads, arraysize(reads), writes, arraysize(writes));
+
+  scoped_ptr<HttpPipelinedStream> stream1(NewTestStream("ok.html"));
+  scoped_ptr<HttpPipelinedStream> stream2(NewTestStream("ko.html"));
+  EXPECT_EQ(OK, stream1->SendRequest(headers_, NULL, &response1_, NULL));
+  EXPECT_EQ(OK, stream2->SendRequest(headers_, NULL, &response2_, NULL));
+
+  TestCompletionCallback callback2;
+  EXPECT_EQ(ERR_IO_PENDING, stream2->ReadResponseHeaders(&callback2));
+  EXPECT_EQ(OK, stream1->ReadResponseHeaders(NULL));
+  MessageLoop::current()->RunAllPending();
+  EXPECT_FALSE(callback2.have_result());
+
+  ExpectResponseBody(stream1.get(), "ok.html");
+  EXPECT_EQ(OK, callback2.WaitForResult());
+  ASSERT_TRUE(response2_.headers);
+  EXPECT_EQ(200, response2_.headers->response_code());
+  ExpectResponseBody(stream2.get(), "ko.html");
+}
+
+TEST_F(HttpPipelinedConnectionTest, CloseBeforeReadEvictsLaterStreams) {
+  MockWrite writes[] = {
+    MockWrite(false, kRequest1),
+    MockWrite(false, kRequest2),
+  };
+  MockRead reads[] = {
+    MockRead(false, kResponse1),
+  };
+  Initialize(reads, arraysize(reads), writes, arraysize(writes));
+
+  scoped_ptr<HttpPipelinedStream> stream1(NewTestStream("ok.html"));
+  scoped_ptr<HttpPipelinedStream> stream2(NewTestStream("ko.html"));
+  scoped_ptr<HttpPipelinedStream> stream3(NewTestStream("ok.html"));
+  EXPECT_EQ(OK, stream1->SendRequest(headers_, NULL, &response1_, NULL));
+  EXPECT_EQ(OK, stream2->SendRequest(headers_, NULL, &response2_, NULL));
+
+  TestCompletionCallback callback2;
+  EXPECT_EQ(ERR_IO_PENDING, stream2->ReadResponseHeaders(&callback2));
+
+  // Nobody will read the first response, so the second cannot be found.
+  stream1->Close(false);
+  EXPECT_FALSE(pipeline_->usable());
+  EXPECT_EQ(ERR_PIPELINE_EVICTION, callback2.WaitForResult());
+
+  HttpResponseInfo response3;
+  EXPECT_EQ(ERR_PIPELINE_EVICTION,
+            stream3->SendRequest(headers_, NULL, &response3, NULL));
+  EXPECT_EQ(0, pipeline_->depth());
+  EXPECT_EQ(0, delegate_.incapable_feedback_count());
+}
+
+TEST_F(HttpPipelinedConnectionTest, Http10ResponseIsIncapable) {
+  MockWrite writes[] = {
+    MockWrite(false, kRequest1),
+    MockWrite(false, kRequest2),
+  };
+  MockRead reads[] = {
+    MockRead(false, "HTTP/1.0 200 OK\r\nContent-Length: 7\r\n\r\nok.html"),
+  };
+  Initialize(reads, arraysize(reads), writes, arraysize(writes));
+
+  scoped_ptr<HttpPipelinedStream> stream1(NewTestStream("ok.html"));
+  scoped_ptr<HttpPipelinedStream> stream2(NewTestStream("ko.html"));
+  EXPECT_EQ(OK, stream1->SendRequest(headers_, NULL, &response1_, NULL));
+  EXPECT_EQ(OK, stream2->SendRequest(headers_, NULL, &response2_, NULL));
+
+  // The first response is still delivered.
+  EXPECT_EQ(OK, stream1->ReadResponseHeaders(NULL));
+  EXPECT_EQ(1, delegate_.incapable_feedback_count());
+  EXPECT_EQ(0, delegate_.capable_feedback_count());
+  EXPECT_FALSE(pipeline_->usable());
+  ExpectResponseBody(stream1.get(), "ok.html");
+
+  EXPECT_EQ(ERR_PIPELINE_EVICTION, stream2->ReadResponseHeaders(NULL));
+}
+
+TEST_F(HttpPipelinedConnectionTest, ConnectionCloseEvictsWithoutFeedback) {
+  MockWrite writes[] = {
+    MockWrite(false, kRequest1),
+  };
+  MockRead reads[] = {
+    MockRead(false, "HTTP/1.1 200 OK\r\nContent-Length: 7\r\n"
+                    "Connection: close\r\n\r\nok.html"),
+  };
+  Initialize(reads, arraysize(reads), writes, arraysize(writes));
+
+  scoped_ptr<HttpPipelinedStream> stream1(NewTestStream("ok.html"));
+  scoped_ptr<HttpPipelinedStream> stream2(NewTestStream("ko.html"));
+  EXPECT_EQ(OK, stream1->SendRequest(headers_, NULL, &response1_, NULL));
+
+  EXPECT_EQ(OK, stream1->ReadResponseHeaders(NULL));
+  EXPECT_EQ(0, delegate_.capable_feedback_count());
+  EXPECT_EQ(0, delegate_.incapable_feedback_count());
+  ExpectResponseBody(stream1.get(), "ok.html");
+
+  // |stream2| had not sent its request yet.
+  EXPECT_EQ(ERR_PIPELINE_EVICTION,
+            stream2->SendRequest(headers_, NULL, &response2_, NULL));
+}
+
+TEST_F(HttpPipelinedConnectionTest, ReadErrorOnPipelinedStreamIsIncapable) {
+  MockWrite writes[] = {
+    MockWrite(false, kRequest1),
+    MockWrite(false, kRequest2),
+  };
+  MockRead reads[] = {
+    MockRead(false, kResponse1),
+    MockRead(false, ERR_CONNECTION_RESET),
+  };
+  Initialize(reads, arraysize(reads), writes, arraysize(writes));
+
+  scoped_ptr<HttpPipelinedStream> stream1(NewTestStream("ok.html"));
+  scoped_ptr<HttpPipelinedStream> stream2(NewTestStream("ko.html"));
+  EXPECT_EQ(OK, stream1->SendRequest(headers_, NULL, &response1_, NULL));
+  EXPECT_EQ(OK, stream2->SendRequest(headers_, NULL, &response2_, NULL));
+
+  EXPECT_EQ(OK, stream1->ReadResponseHeaders(NULL));
+  ExpectResponseBody(stream1.get(), "ok.html");
+
+  EXPECT_EQ(ERR_CONNECTION_RESET, stream2->ReadResponseHeaders(NULL));
+  EXPECT_EQ(1, delegate_.incapable_feedback_count());
+  EXPECT_FALSE(pipeline_->usable());
+}
+
+TEST_F(HttpPipelinedConnectionTest, AsyncSendsAreSerialized) {
+  MockWrite writes[] = {
+    MockWrite(true, kRequest1),
+    MockWrite(true, kRequest2),
+  };
+  MockRead reads[] = {
+    MockRead(true, kResponse1),
+    MockRead(true, kResponse2),
+  };
+  Initialize(reads, arraysize(reads), writes, arraysize(writes));
+
+  scoped_ptr<HttpPipelinedStream> stream1(NewTestStream("ok.html"));
+  scoped_ptr<HttpPipelinedStream> stream2(NewTestStream("ko.html"));
+
+  TestCompletionCallback callback1;
+  TestCompletionCallback callback2;
+  EXPECT_EQ(ERR_IO_PENDING,
+            stream1->SendRequest(headers_, NULL, &response1_, &callback1));
+  EXPECT_EQ(ERR_IO_PENDING,
+            stream2->SendRequest(headers_, NULL, &response2_, &callback2));
+  EXPECT_EQ(OK, callback1.WaitForResult());
+  EXPECT_EQ(OK, callback2.WaitForResult());
+  EXPECT_EQ(2U, data_->write_index());
+
+  EXPECT_EQ(ERR_IO_PENDING, stream1->ReadResponseHeaders(&callback1));
+  EXPECT_EQ(ERR_IO_PENDING, stream2->ReadResponseHeaders(&callback2));
+  EXPECT_EQ(OK, callback1.WaitForResult());
+  ExpectResponseBody(stream1.get(), "ok.html");
+  EXPECT_EQ(OK, callback2.WaitForResult());
+  ExpectResponseBody(stream2.get(), "ko.html");
+}
+
+}  // namespace
+
+}  // namespace net
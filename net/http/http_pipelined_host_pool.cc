@@ -0,0 +1,135 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_pipelined_host_pool.h"
+
+#include "base/logging.h"
+#include "base/stl_util-inl.h"
+#include "net/http/http_pipelined_stream.h"
+
+namespace net {
+
+namespace {
+
+// The most streams a pipeline to an origin known to support pipelining
+// carries at once.
+const int kMaxPipelineDepth = 3;
+
+}  // namespace
+
+HttpPipelinedHostPool::HttpPipelinedHostPool(Delegate* delegate)
+    : delegate_(delegate) {
+}
+
+HttpPipelinedHostPool::~HttpPipelinedHostPool() {
+  DCHECK(pipelines_.empty());
+}
+
+bool HttpPipelinedHostPool::IsHostEligibleForPipelining(
+    const HostPortPair& origin) const {
+  return GetCapability(origin) != CAPABILITY_INCAPABLE;
+}
+
+HttpPipelinedStream* HttpPipelinedHostPool::CreateStreamOnNewPipeline(
+    const HostPortPair& origin,
+    ClientSocketHandle* connection,
+    const SSLConfig& used_ssl_config,
+    const ProxyInfo& used_proxy_info,
+    const BoundNetLog& net_log,
+    bool was_npn_negotiated) {
+  HttpPipelinedConnection* pipeline = new HttpPipelinedConnection(
+      connection, origin, this, used_ssl_config, used_proxy_info, net_log,
+      was_npn_negotiated);
+  pipelines_[origin].insert(pipeline);
+  return pipeline->CreateNewStream();
+}
+
+HttpPipelinedStream* HttpPipelinedHostPool::CreateStreamOnExistingPipeline(
+    const HostPortPair& origin) {
+  HttpPipelinedConnection* pipeline = FindAvailablePipeline(origin);
+  if (!pipeline)
+    return NULL;
+  return pipeline->CreateNewStream();
+}
+
+bool HttpPipelinedHostPool::IsExistingPipelineAvailableForOrigin(
+    const HostPortPair& origin) const {
+  return FindAvailablePipeline(origin) != NULL;
+}
+
+void HttpPipelinedHostPool::OnPipelineHasCapacity(
+    HttpPipelinedConnection* pipeline) {
+  if (CanPipelineAcceptStream(pipeline))
+    delegate_->OnHttpPipelinedHostHasAdditionalCapacity(pipeline->origin());
+}
+
+void HttpPipelinedHostPool::OnPipelineFeedback(
+    HttpPipelinedConnection* pipeline,
+    HttpPipelinedConnection::Feedback feedback) {
+  Capability& capability = capabilities_[pipeline->origin()];
+  switch (feedback) {
+    case HttpPipelinedConnection::PIPELINE_CAPABLE:
+      // One bad response is enough to stop pipelining to an origin.
+      if (capability == CAPABILITY_UNKNOWN)
+        capability = CAPABILITY_CAPABLE;
+      break;
+    case HttpPipelinedConnection::PIPELINE_INCAPABLE:
+      capability = CAPABILITY_INCAPABLE;
+      break;
+  }
+}
+
+void HttpPipelinedHostPool::OnPipelineEmpty(
+    HttpPipelinedConnection* pipeline) {
+  PipelineMap::iterator it = pipelines_.find(pipeline->origin());
+  DCHECK(it != pipelines_.end());
+  DCHECK(ContainsKey(it->second, pipeline));
+  it->second.erase(pipeline);
+  if (it->second.empty())
+    pipelines_.erase(it);
+  delete pipeline;
+}
+
+HttpPipelinedHostPool::Capability HttpPipelinedHostPool::GetCapability(
+    const HostPortPair& origin) const {
+  CapabilityMap::const_iterator it = capabilities_.find(origin);
+  if (it == capabilities_.end())
+    return CAPABILITY_UNKNOWN;
+  return it->second;
+}
+
+bool HttpPipelinedHostPool::CanPipelineAcceptStream(
+    HttpPipelinedConnection* pipeline) const {
+  if (!pipeline->usable() || pipeline->IsHeadOfLineBlocked())
+    return false;
+  switch (GetCapability(pipeline->origin())) {
+    case CAPABILITY_CAPABLE:
+      return pipeline->depth() < kMaxPipelineDepth;
+    case CAPABILITY_UNKNOWN:
+      // Wait for a response to tell whether the origin can be pipelined to.
+      return pipeline->depth() < 1;
+    case CAPABILITY_INCAPABLE:
+      return false;
+  }
+  NOTREACHED();
+  return false;
+}
+
+HttpPipelinedConnection* HttpPipelinedHostPool::FindAvailablePipeline(
+    const HostPortPair& origin) const {
+  PipelineMap::const_iterator map_it = pipelines_.find(origin);
+  if (map_it == pipelines_.end())
+    return NULL;
+  HttpPipelinedConnection* best = NULL;
+  for (PipelineSet::const_iterator it = map_it->second.begin();
+       it != map_it->second.end(); ++it) {
+    if (CanPipelineAcceptStream(*it) &&
+        (!best || (*it)->depth() < best->depth())) {
+      best = *it;
+    }
+  }
+  return best;
+}
+
+}  // namespace net
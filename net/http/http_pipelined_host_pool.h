@@ -0,0 +1,103 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// HttpPipelinedHostPool owns the HttpPipelinedConnections of a session, and
+// remembers which origins have shown that they can, or cannot, be pipelined
+// to.  An origin gets one request per pipeline until a response has shown that
+// it supports pipelining.
+
+#ifndef NET_HTTP_HTTP_PIPELINED_HOST_POOL_H_
+#define NET_HTTP_HTTP_PIPELINED_HOST_POOL_H_
+#pragma once
+
+#include <map>
+#include <set>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "net/base/host_port_pair.h"
+#include "net/http/http_pipelined_connection.h"
+
+namespace net {
+
+class BoundNetLog;
+class ClientSocketHandle;
+class HttpPipelinedStream;
+class ProxyInfo;
+struct SSLConfig;
+
+class HttpPipelinedHostPool : public HttpPipelinedConnection::Delegate {
+ public:
+  class Delegate {
+   public:
+    // Called when a pipeline to |origin| can take another stream.
+    virtual void OnHttpPipelinedHostHasAdditionalCapacity(
+        const HostPortPair& origin) = 0;
+
+   protected:
+    virtual ~Delegate() {}
+  };
+
+  explicit HttpPipelinedHostPool(Delegate* delegate);
+  virtual ~HttpPipelinedHostPool();
+
+  // Returns false if |origin| is known not to support pipelining.
+  bool IsHostEligibleForPipelining(const HostPortPair& origin) const;
+
+  // Starts a new pipeline to |origin| on |connection|, which it takes
+  // ownership of, and returns the pipeline's first stream.
+  HttpPipelinedStream* CreateStreamOnNewPipeline(
+      const HostPortPair& origin,
+      ClientSocketHandle* connection,
+      const SSLConfig& used_ssl_config,
+      const ProxyInfo& used_proxy_info,
+      const BoundNetLog& net_log,
+      bool was_npn_negotiated);
+
+  // Returns a new stream on the least loaded pipeline to |origin| that can
+  // take one, or NULL if there is none.
+  HttpPipelinedStream* CreateStreamOnExistingPipeline(
+      const HostPortPair& origin);
+
+  bool IsExistingPipelineAvailableForOrigin(const HostPortPair& origin) const;
+
+  // HttpPipelinedConnection::Delegate methods:
+  virtual void OnPipelineHasCapacity(
+      HttpPipelinedConnection* pipeline) OVERRIDE;
+  virtual void OnPipelineFeedback(
+      HttpPipelinedConnection* pipeline,
+      HttpPipelinedConnection::Feedback feedback) OVERRIDE;
+  virtual void OnPipelineEmpty(HttpPipelinedConnection* pipeline) OVERRIDE;
+
+ private:
+  enum Capability {
+    CAPABILITY_UNKNOWN,
+    CAPABILITY_CAPABLE,
+    CAPABILITY_INCAPABLE,
+  };
+
+  typedef std::set<HttpPipelinedConnection*> PipelineSet;
+  typedef std::map<HostPortPair, PipelineSet> PipelineMap;
+  typedef std::map<HostPortPair, Capability> CapabilityMap;
+
+  Capability GetCapability(const HostPortPair& origin) const;
+
+  // Returns whether |pipeline| may be given another stream.
+  bool CanPipelineAcceptStream(HttpPipelinedConnection* pipeline) const;
+
+  HttpPipelinedConnection* FindAvailablePipeline(
+      const HostPortPair& origin) const;
+
+  Delegate* const delegate_;
+
+  PipelineMap pipelines_;
+
+  CapabilityMap capabilities_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpPipelinedHostPool);
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_PIPELINED_HOST_POOL_H_
@@ -0,0 +1,137 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_pipelined_host_pool.h"
+
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/base/net_log.h"
+#include "net/base/ssl_config_service.h"
+#include "net/base/test_completion_callback.h"
+#include "net/http/http_pipelined_stream.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_request_info.h"
+#include "net/http/http_response_info.h"
+#include "net/proxy/proxy_info.h"
+#include "net/socket/client_socket_handle.h"
+#include "net/socket/socket_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const char kRequest[] = "GET / HTTP/1.1\r\n\r\n";
+
+class TestPoolDelegate : public HttpPipelinedHostPool::Delegate {
+ public:
+  TestPoolDelegate() : capacity_count_(0) {}
+
+  virtual void OnHttpPipelinedHostHasAdditionalCapacity(
+      const HostPortPair& origin) {
+    ++capacity_count_;
+  }
+
+  int capacity_count() const { return capacity_count_; }
+
+ private:
+  int capacity_count_;
+};
+
+class HttpPipelinedHostPoolTest : public testing::Test {
+ protected:
+  HttpPipelinedHostPoolTest()
+      : origin_("localhost", 80),
+        pool_(&delegate_) {
+    request_info_.url = GURL("http://localhost/");
+    request_info_.method = "GET";
+  }
+
+  // Starts a pipeline whose first request gets |response| back, and reads the
+  // response headers of that request.
+  HttpPipelinedStream* StartPipelineAndReadHeaders(const char* response) {
+    MockWrite writes[] = { MockWrite(false, kRequest) };
+    MockRead reads[] = { MockRead(false, response) };
+    data_.reset(new StaticSocketDataProvider(reads, arraysize(reads),
+                                             writes, arraysize(writes)));
+    data_->set_connect_data(MockConnect(false, OK));
+    MockTCPClientSocket* socket =
+        new MockTCPClientSocket(AddressList(), NULL, data_.get());
+    TestCompletionCallback callback;
+    EXPECT_EQ(OK, socket->Connect(&callback));
+    ClientSocketHandle* connection = new ClientSocketHandle;
+    connection->set_socket(socket);
+
+    HttpPipelinedStream* stream = pool_.CreateStreamOnNewPipeline(
+        origin_, connection, SSLConfig(), ProxyInfo(), BoundNetLog(), false);
+    EXPECT_EQ(OK, stream->InitializeStream(&request_info_, BoundNetLog(),
+                                           NULL));
+    EXPECT_EQ(OK, stream->SendRequest(HttpRequestHeaders(), NULL, &response_,
+                                      NULL));
+    EXPECT_EQ(OK, stream->ReadResponseHeaders(NULL));
+    return stream;
+  }
+
+  const HostPortPair origin_;
+  TestPoolDelegate delegate_;
+  HttpPipelinedHostPool pool_;
+  scoped_ptr<StaticSocketDataProvider> data_;
+  HttpRequestInfo request_info_;
+  HttpResponseInfo response_;
+};
+
+TEST_F(HttpPipelinedHostPoolTest, UnknownHostGetsOneStreamPerPipeline) {
+  EXPECT_TRUE(pool_.IsHostEligibleForPipelining(origin_));
+
+  data_.reset(new StaticSocketDataProvider());
+  MockTCPClientSocket* socket =
+      new MockTCPClientSocket(AddressList(), NULL, data_.get());
+  ClientSocketHandle* connection = new ClientSocketHandle;
+  connection->set_socket(socket);
+  scoped_ptr<HttpPipelinedStream> stream(pool_.CreateStreamOnNewPipeline(
+      origin_, connection, SSLConfig(), ProxyInfo(), BoundNetLog(), false));
+  EXPECT_FALSE(pool_.IsExistingPipelineAvailableForOrigin(origin_));
+  EXPECT_EQ(NULL, pool_.CreateStreamOnExistingPipeline(origin_));
+
+  MessageLoop::current()->RunAllPending();
+  EXPECT_EQ(0, delegate_.capacity_count());
+}
+
+TEST_F(HttpPipelinedHostPoolTest, CapableHostGetsMoreStreams) {
+  scoped_ptr<HttpPipelinedStream> stream1(StartPipelineAndReadHeaders(
+      "HTTP/1.1 200 OK\r\nContent-Length: 7\r\n\r\nok.html"));
+  EXPECT_TRUE(pool_.IsExistingPipelineAvailableForOrigin(origin_));
+  MessageLoop::current()->RunAllPending();
+  EXPECT_EQ(1, delegate_.capacity_count());
+
+  scoped_ptr<HttpPipelinedStream> stream2(
+      pool_.CreateStreamOnExistingPipeline(origin_));
+  ASSERT_TRUE(stream2.get());
+  scoped_ptr<HttpPipelinedStream> stream3(
+      pool_.CreateStreamOnExistingPipeline(origin_));
+  ASSERT_TRUE(stream3.get());
+  EXPECT_FALSE(pool_.IsExistingPipelineAvailableForOrigin(origin_));
+}
+
+TEST_F(HttpPipelinedHostPoolTest, LongResponseBlocksPipeline) {
+  scoped_ptr<HttpPipelinedStream> stream1(StartPipelineAndReadHeaders(
+      "HTTP/1.1 200 OK\r\nContent-Length: 1000000\r\n\r\n"));
+  EXPECT_TRUE(pool_.IsHostEligibleForPipelining(origin_));
+  EXPECT_FALSE(pool_.IsExistingPipelineAvailableForOrigin(origin_));
+}
+
+TEST_F(HttpPipelinedHostPoolTest, Http10HostIsIneligible) {
+  scoped_ptr<HttpPipelinedStream> stream1(StartPipelineAndReadHeaders(
+      "HTTP/1.0 200 OK\r\nContent-Length: 7\r\n\r\nok.html"));
+  EXPECT_FALSE(pool_.IsHostEligibleForPipelining(origin_));
+  EXPECT_FALSE(pool_.IsExistingPipelineAvailableForOrigin(origin_));
+  MessageLoop::current()->RunAllPending();
+  EXPECT_EQ(0, delegate_.capacity_count());
+}
+
+}  // namespace
+
+}  // namespace net
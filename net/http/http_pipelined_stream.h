@@ -0,0 +1,94 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// HttpPipelinedStream is an HttpStream that shares its connection with the
+// other streams of an HttpPipelinedConnection, which does the actual work.
+
+#ifndef NET_HTTP_HTTP_PIPELINED_STREAM_H_
+#define NET_HTTP_HTTP_PIPELINED_STREAM_H_
+#pragma once
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "net/base/net_log.h"
+#include "net/http/http_stream.h"
+
+namespace net {
+
+class HttpPipelinedConnection;
+struct HttpRequestInfo;
+class ProxyInfo;
+struct SSLConfig;
+
+class HttpPipelinedStream : public HttpStream {
+ public:
+  HttpPipelinedStream(HttpPipelinedConnection* pipeline, int pipeline_id);
+  virtual ~HttpPipelinedStream();
+
+  // HttpStream methods:
+  virtual int InitializeStream(const HttpRequestInfo* request_info,
+                               const BoundNetLog& net_log,
+                               CompletionCallback* callback) OVERRIDE;
+
+  virtual int SendRequest(const HttpRequestHeaders& headers,
+                          UploadDataStream* request_body,
+                          HttpResponseInfo* response,
+                          CompletionCallback* callback) OVERRIDE;
+
+  virtual uint64 GetUploadProgress() const OVERRIDE;
+
+  virtual int ReadResponseHeaders(CompletionCallback* callback) OVERRIDE;
+
+  virtual const HttpResponseInfo* GetResponseInfo() const OVERRIDE;
+
+  virtual int ReadResponseBody(IOBuffer* buf, int buf_len,
+                               CompletionCallback* callback) OVERRIDE;
+
+  virtual void Close(bool not_reusable) OVERRIDE;
+
+  // Returns NULL: the connection cannot be handed to a single stream.
+  virtual HttpStream* RenewStreamForAuth() OVERRIDE;
+
+  virtual bool IsResponseBodyComplete() const OVERRIDE;
+
+  virtual bool CanFindEndOfResponse() const OVERRIDE;
+
+  virtual bool IsMoreDataBuffered() const OVERRIDE;
+
+  virtual bool IsConnectionReused() const OVERRIDE;
+
+  virtual void SetConnectionReused() OVERRIDE;
+
+  virtual bool IsConnectionReusable() const OVERRIDE;
+
+  virtual void GetSSLInfo(SSLInfo* ssl_info) OVERRIDE;
+
+  virtual void GetSSLCertRequestInfo(
+      SSLCertRequestInfo* cert_request_info) OVERRIDE;
+
+  virtual bool IsSpdyHttpStream() const OVERRIDE;
+
+  // The details of the pipeline's connection, for HttpStreamRequest.
+  const SSLConfig& used_ssl_config() const;
+  const ProxyInfo& used_proxy_info() const;
+  const NetLog::Source& source() const;
+  bool was_npn_negotiated() const;
+
+ private:
+  HttpPipelinedConnection* pipeline_;
+
+  const int pipeline_id_;
+
+  const HttpRequestInfo* request_info_;
+
+  std::string request_line_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpPipelinedStream);
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_PIPELINED_STREAM_H_
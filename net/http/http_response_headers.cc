@@ -11,6 +11,7 @@
 
 #include <algorithm>
 
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/metrics/histogram.h"
 #include "base/pickle.h"
@@ -20,6 +21,7 @@
 #include "net/base/escape.h"
 #include "net/http/http_util.h"
 
+using base::StringPiece;
 using base::Time;
 using base::TimeDelta;
 
@@ -114,6 +116,106 @@ int MapHttpResponseCode(int code) {
   return 0;
 }
 
+// Headers that callers look up by name.  Each parsed header records which of
+// these it is, if any, so that looking one of these up compares integers
+// rather than strings.
+const char* const kWellKnownHeaders[] = {
+  "accept-ranges",
+  "age",
+  "cache-control",
+  "connection",
+  "content-disposition",
+  "content-encoding",
+  "content-language",
+  "content-length",
+  "content-location",
+  "content-md5",
+  "content-range",
+  "content-type",
+  "date",
+  "etag",
+  "expires",
+  "keep-alive",
+  "last-modified",
+  "location",
+  "pragma",
+  "proxy-authenticate",
+  "proxy-connection",
+  "refresh",
+  "server",
+  "set-cookie",
+  "set-cookie2",
+  "strict-transport-security",
+  "trailer",
+  "transfer-encoding",
+  "upgrade",
+  "vary",
+  "via",
+  "www-authenticate",
+};
+
+// The name id of the headers that are not in kWellKnownHeaders.
+const int kUnknownHeader = -1;
+
+const size_t kWellKnownHeaderSlots = 64;
+
+// Hashes a header name, ignoring case.  The multipliers were picked so that
+// every name in kWellKnownHeaders gets a slot of its own; adding a name may
+// require picking new ones (WellKnownHeaderTable checks it in debug builds).
+size_t HashHeaderName(const char* name, size_t length) {
+  if (!length)
+    return 0;
+  size_t first = static_cast<unsigned char>(base::ToLowerASCII(name[0]));
+  size_t middle =
+      static_cast<unsigned char>(base::ToLowerASCII(name[length / 2]));
+  size_t last =
+      static_cast<unsigned char>(base::ToLowerASCII(name[length - 1]));
+  return (length + 3 * first + 35 * last + 58 * middle) %
+      kWellKnownHeaderSlots;
+}
+
+// A perfect hash table from header names to indices in kWellKnownHeaders.
+class WellKnownHeaderTable {
+ public:
+  WellKnownHeaderTable() {
+    std::fill(slots_, slots_ + kWellKnownHeaderSlots, kUnknownHeader);
+    for (size_t i = 0; i < arraysize(kWellKnownHeaders); ++i) {
+      size_t slot =
+          HashHeaderName(kWellKnownHeaders[i], strlen(kWellKnownHeaders[i]));
+      DCHECK_EQ(kUnknownHeader, slots_[slot]) << kWellKnownHeaders[i];
+      slots_[slot] = static_cast<int>(i);
+    }
+  }
+
+  // Returns the index of |name| in kWellKnownHeaders, or kUnknownHeader.
+  int Lookup(const char* name, size_t length) const {
+    int id = slots_[HashHeaderName(name, length)];
+    if (id == kUnknownHeader ||
+        !LowerCaseEqualsASCII(name, name + length, kWellKnownHeaders[id]))
+      return kUnknownHeader;
+    return id;
+  }
+
+ private:
+  int slots_[kWellKnownHeaderSlots];
+
+  DISALLOW_COPY_AND_ASSIGN(WellKnownHeaderTable);
+};
+
+base::LazyInstance<WellKnownHeaderTable> g_well_known_headers(
+    base::LINKER_INITIALIZED);
+
+int GetHeaderNameId(const StringPiece& name) {
+  return g_well_known_headers.Get().Lookup(name.data(), name.size());
+}
+
+StringPiece MakeStringPiece(std::string::const_iterator begin,
+                            std::string::const_iterator end) {
+  if (begin == end)
+    return StringPiece();
+  return StringPiece(&*begin, end - begin);
+}
+
 }  // namespace
 
 struct HttpResponseHeaders::ParsedHeader {
@@ -125,6 +227,9 @@ struct HttpResponseHeaders::ParsedHeader {
   std::string::const_iterator name_end;
   std::string::const_iterator value_begin;
   std::string::const_iterator value_end;
+
+  // The index of the name in kWellKnownHeaders, or kUnknownHeader.
+  int name_id;
 };
 
 //-----------------------------------------------------------------------------
@@ -416,10 +521,10 @@ void HttpResponseHeaders::GetNormalizedHeaders(std::string* output) const {
   output->push_back('\n');
 }
 
-bool HttpResponseHeaders::GetNormalizedHeader(const std::string& name,
+bool HttpResponseHeaders::GetNormalizedHeader(const StringPiece& name,
                                               std::string* value) const {
   // If you hit this assertion, please use EnumerateHeader instead!
-  DCHECK(!HttpUtil::IsNonCoalescingHeader(name));
+  DCHECK(!HttpUtil::IsNonCoalescingHeader(name.as_string()));
 
   value->clear();
 
@@ -464,27 +569,48 @@ std::string HttpResponseHeaders::GetStatusText() const {
 bool HttpResponseHeaders::EnumerateHeaderLines(void** iter,
                                                std::string* name,
                                                std::string* value) const {
+  StringPiece name_piece;
+  StringPiece value_piece;
+  if (!EnumerateHeaderLines(iter, &name_piece, &value_piece))
+    return false;
+  name_piece.CopyToString(name);
+  value_piece.CopyToString(value);
+  return true;
+}
+
+bool HttpResponseHeaders::EnumerateHeaderLines(void** iter,
+                                               StringPiece* name,
+                                               StringPiece* value) const {
   size_t i = reinterpret_cast<size_t>(*iter);
   if (i == parsed_.size())
     return false;
 
   DCHECK(!parsed_[i].is_continuation());
 
-  name->assign(parsed_[i].name_begin, parsed_[i].name_end);
+  *name = MakeStringPiece(parsed_[i].name_begin, parsed_[i].name_end);
 
+  // The values of the continuations follow in raw_headers_.
   std::string::const_iterator value_begin = parsed_[i].value_begin;
   std::string::const_iterator value_end = parsed_[i].value_end;
   while (++i < parsed_.size() && parsed_[i].is_continuation())
     value_end = parsed_[i].value_end;
 
-  value->assign(value_begin, value_end);
+  *value = MakeStringPiece(value_begin, value_end);
 
   *iter = reinterpret_cast<void*>(i);
   return true;
 }
 
-bool HttpResponseHeaders::EnumerateHeader(void** iter, const std::string& name,
+bool HttpResponseHeaders::EnumerateHeader(void** iter, const StringPiece& name,
                                           std::string* value) const {
+  StringPiece value_piece;
+  bool found = EnumerateHeader(iter, name, &value_piece);
+  value_piece.CopyToString(value);
+  return found;
+}
+
+bool HttpResponseHeaders::EnumerateHeader(void** iter, const StringPiece& name,
+                                          StringPiece* value) const {
   size_t i;
   if (!iter || !*iter) {
     i = FindHeader(0, name);
@@ -504,16 +630,16 @@ bool HttpResponseHeaders::EnumerateHeader(void** iter, const std::string& name,
 
   if (iter)
     *iter = reinterpret_cast<void*>(i + 1);
-  value->assign(parsed_[i].value_begin, parsed_[i].value_end);
+  *value = MakeStringPiece(parsed_[i].value_begin, parsed_[i].value_end);
   return true;
 }
 
-bool HttpResponseHeaders::HasHeaderValue(const std::string& name,
-                                         const std::string& value) const {
+bool HttpResponseHeaders::HasHeaderValue(const StringPiece& name,
+                                         const StringPiece& value) const {
   // The value has to be an exact match.  This is important since
   // 'cache-control: no-cache' != 'cache-control: no-cache="foo"'
   void* iter = NULL;
-  std::string temp;
+  StringPiece temp;
   while (EnumerateHeader(&iter, name, &temp)) {
     if (value.size() == temp.size() &&
         std::equal(temp.begin(), temp.end(), value.begin(),
@@ -523,7 +649,7 @@ bool HttpResponseHeaders::HasHeaderValue(const std::string& name,
   return false;
 }
 
-bool HttpResponseHeaders::HasHeader(const std::string& name) const {
+bool HttpResponseHeaders::HasHeader(const StringPiece& name) const {
   return FindHeader(0, name) != std::string::npos;
 }
 
@@ -654,10 +780,16 @@ void HttpResponseHeaders::ParseStatusLine(
 }
 
 size_t HttpResponseHeaders::FindHeader(size_t from,
-                                       const std::string& search) const {
+                                       const StringPiece& search) const {
+  // Names that are equal ignoring case have the same id.  So a well-known
+  // name only needs its id compared, and other names only need comparing
+  // with the other unknown names.
+  int search_id = GetHeaderNameId(search);
   for (size_t i = from; i < parsed_.size(); ++i) {
-    if (parsed_[i].is_continuation())
+    if (parsed_[i].is_continuation() || parsed_[i].name_id != search_id)
       continue;
+    if (search_id != kUnknownHeader)
+      return i;
     const std::string::const_iterator& name_begin = parsed_[i].name_begin;
     const std::string::const_iterator& name_end = parsed_[i].name_end;
     if (static_cast<size_t>(name_end - name_begin) == search.size() &&
@@ -696,6 +828,9 @@ void HttpResponseHeaders::AddToParsed(std::string::const_iterator name_begin,
   header.name_end = name_end;
   header.value_begin = value_begin;
   header.value_end = value_end;
+  header.name_id = kUnknownHeader;
+  if (!header.is_continuation())
+    header.name_id = GetHeaderNameId(MakeStringPiece(name_begin, name_end));
   parsed_.push_back(header);
 }
 
@@ -993,14 +1128,13 @@ TimeDelta HttpResponseHeaders::GetCurrentAge(const Time& request_time,
 }
 
 bool HttpResponseHeaders::GetMaxAgeValue(TimeDelta* result) const {
-  std::string name = "cache-control";
-  std::string value;
+  StringPiece value;
 
   const char kMaxAgePrefix[] = "max-age=";
   const size_t kMaxAgePrefixLen = arraysize(kMaxAgePrefix) - 1;
 
   void* iter = NULL;
-  while (EnumerateHeader(&iter, name, &value)) {
+  while (EnumerateHeader(&iter, "cache-control", &value)) {
     if (value.size() > kMaxAgePrefixLen) {
       if (LowerCaseEqualsASCII(value.begin(),
                                value.begin() + kMaxAgePrefixLen,
@@ -1019,12 +1153,12 @@ bool HttpResponseHeaders::GetMaxAgeValue(TimeDelta* result) const {
 }
 
 bool HttpResponseHeaders::GetAgeValue(TimeDelta* result) const {
-  std::string value;
+  StringPiece value;
   if (!EnumerateHeader(NULL, "Age", &value))
     return false;
 
   int64 seconds;
-  base::StringToInt64(value, &seconds);
+  base::StringToInt64(value.begin(), value.end(), &seconds);
   *result = TimeDelta::FromSeconds(seconds);
   return true;
 }
@@ -1041,9 +1175,9 @@ bool HttpResponseHeaders::GetExpiresValue(Time* result) const {
   return GetTimeValuedHeader("Expires", result);
 }
 
-bool HttpResponseHeaders::GetTimeValuedHeader(const std::string& name,
+bool HttpResponseHeaders::GetTimeValuedHeader(const StringPiece& name,
                                               Time* result) const {
-  std::string value;
+  StringPiece value;
   if (!EnumerateHeader(NULL, name, &value))
     return false;
 
@@ -1058,7 +1192,7 @@ bool HttpResponseHeaders::IsKeepAlive() const {
   // NOTE: It is perhaps risky to assume that a Proxy-Connection header is
   // meaningful when we don't know that this response was from a proxy, but
   // Mozilla also does this, so we'll do the same.
-  std::string connection_val;
+  StringPiece connection_val;
   if (!EnumerateHeader(NULL, "connection", &connection_val))
     EnumerateHeader(NULL, "proxy-connection", &connection_val);
 
@@ -1066,10 +1200,12 @@ bool HttpResponseHeaders::IsKeepAlive() const {
 
   if (http_version_ == HttpVersion(1, 0)) {
     // HTTP/1.0 responses default to NOT keep-alive
-    keep_alive = LowerCaseEqualsASCII(connection_val, "keep-alive");
+    keep_alive = LowerCaseEqualsASCII(connection_val.begin(),
+                                      connection_val.end(), "keep-alive");
   } else {
     // HTTP/1.1 responses default to keep-alive
-    keep_alive = !LowerCaseEqualsASCII(connection_val, "close");
+    keep_alive = !LowerCaseEqualsASCII(connection_val.begin(),
+                                       connection_val.end(), "close");
   }
 
   return keep_alive;
@@ -1105,7 +1241,7 @@ bool HttpResponseHeaders::HasStrongValidators() const {
 // Content-Length = "Content-Length" ":" 1*DIGIT
 int64 HttpResponseHeaders::GetContentLength() const {
   void* iter = NULL;
-  std::string content_length_val;
+  StringPiece content_length_val;
   if (!EnumerateHeader(&iter, "content-length", &content_length_val))
     return -1;
 
@@ -1116,7 +1252,8 @@ int64 HttpResponseHeaders::GetContentLength() const {
     return -1;
 
   int64 result;
-  bool ok = base::StringToInt64(content_length_val, &result);
+  bool ok = base::StringToInt64(content_length_val.begin(),
+                                content_length_val.end(), &result);
   if (!ok || result < 0)
     return -1;
 
@@ -12,6 +12,7 @@
 #include "base/basictypes.h"
 #include "base/hash_tables.h"
 #include "base/memory/ref_counted.h"
+#include "base/string_piece.h"
 #include "net/base/net_export.h"
 #include "net/http/http_version.h"
 
@@ -111,7 +112,8 @@ class NET_EXPORT HttpResponseHeaders
   //
   // TODO(darin): remove this method
   //
-  bool GetNormalizedHeader(const std::string& name, std::string* value) const;
+  bool GetNormalizedHeader(const base::StringPiece& name,
+                           std::string* value) const;
 
   // Returns the normalized status line.  For HTTP/0.9 responses (i.e.,
   // responses that lack a status line), this is the manufactured string
@@ -144,6 +146,12 @@ class NET_EXPORT HttpResponseHeaders
                             std::string* name,
                             std::string* value) const;
 
+  // Same as above, but |name| and |value| point into raw_headers() instead of
+  // being copied.  They are valid until this object is modified or destroyed.
+  bool EnumerateHeaderLines(void** iter,
+                            base::StringPiece* name,
+                            base::StringPiece* value) const;
+
   // Enumerate the values of the specified header.   If you are only interested
   // in the first header, then you can pass NULL for the 'iter' parameter.
   // Otherwise, to iterate across all values for the specified header,
@@ -151,16 +159,23 @@ class NET_EXPORT HttpResponseHeaders
   // EnumerateHeader. Note that a header might have an empty value. Call
   // EnumerateHeader repeatedly until it returns false.
   bool EnumerateHeader(void** iter,
-                       const std::string& name,
+                       const base::StringPiece& name,
                        std::string* value) const;
 
+  // Same as above, but |value| points into raw_headers() instead of being
+  // copied.  It is valid until this object is modified or destroyed.
+  bool EnumerateHeader(void** iter,
+                       const base::StringPiece& name,
+                       base::StringPiece* value) const;
+
   // Returns true if the response contains the specified header-value pair.
   // Both name and value are compared case insensitively.
-  bool HasHeaderValue(const std::string& name, const std::string& value) const;
+  bool HasHeaderValue(const base::StringPiece& name,
+                      const base::StringPiece& value) const;
 
   // Returns true if the response contains the specified header.
   // The name is compared case insensitively.
-  bool HasHeader(const std::string& name) const;
+  bool HasHeader(const base::StringPiece& name) const;
 
   // Get the mime type and charset values in lower case form from the headers.
   // Empty strings are returned if the values are not present.
@@ -214,7 +229,8 @@ class NET_EXPORT HttpResponseHeaders
 
   // Extracts the time value of a particular header.  This method looks for the
   // first matching header value and parses its value as a HTTP-date.
-  bool GetTimeValuedHeader(const std::string& name, base::Time* result) const;
+  bool GetTimeValuedHeader(const base::StringPiece& name,
+                           base::Time* result) const;
 
   // Determines if this response indicates a keep-alive connection.
   bool IsKeepAlive() const;
@@ -281,7 +297,7 @@ class NET_EXPORT HttpResponseHeaders
 
   // Find the header in our list (case-insensitive) starting with parsed_ at
   // index |from|.  Returns string::npos if not found.
-  size_t FindHeader(size_t from, const std::string& name) const;
+  size_t FindHeader(size_t from, const base::StringPiece& name) const;
 
   // Add a header->value pair to our list.  If we already have header in our
   // list, append the value to it.
@@ -322,7 +338,8 @@ class NET_EXPORT HttpResponseHeaders
   static void AddHopContentRangeHeaders(HeaderSet* header_names);
 
   // We keep a list of ParsedHeader objects.  These tell us where to locate the
-  // header-value pairs within raw_headers_.
+  // header-value pairs within raw_headers_, and which well-known header each
+  // one is, so that lookups by name rarely need to compare strings.
   HeaderList parsed_;
 
   // The raw_headers_ consists of the normalized status line (terminated with a
@@ -0,0 +1,87 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/memory/ref_counted.h"
+#include "base/perftimer.h"
+#include "base/time.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumResponses = 100000;
+
+// The headers of a typical cacheable response.
+const char kHeaders[] =
+    "HTTP/1.1 200 OK\n"
+    "Date: Mon, 10 Oct 2011 18:30:00 GMT\n"
+    "Server: Apache\n"
+    "Last-Modified: Fri, 07 Oct 2011 12:00:00 GMT\n"
+    "ETag: \"3e86-410-3596fbbc\"\n"
+    "Accept-Ranges: bytes\n"
+    "Cache-Control: public, max-age=3600\n"
+    "Expires: Mon, 10 Oct 2011 19:30:00 GMT\n"
+    "Vary: Accept-Encoding\n"
+    "Content-Encoding: gzip\n"
+    "Content-Length: 1040\n"
+    "Keep-Alive: timeout=15, max=100\n"
+    "Connection: Keep-Alive\n"
+    "Content-Type: text/html; charset=UTF-8\n"
+    "X-Frame-Options: SAMEORIGIN\n"
+    "\n";
+
+std::string RawHeaders() {
+  return HttpUtil::AssembleRawHeaders(
+      kHeaders, static_cast<int>(arraysize(kHeaders) - 1));
+}
+
+// Reads the headers the way the cache, the job and the filters do for each
+// response, as if it had been received at |response_time|.
+void InspectHeaders(const HttpResponseHeaders& headers,
+                    const base::Time& response_time) {
+  EXPECT_FALSE(headers.RequiresValidation(response_time, response_time,
+                                          response_time));
+  EXPECT_TRUE(headers.IsKeepAlive());
+  EXPECT_TRUE(headers.HasStrongValidators());
+  EXPECT_EQ(1040, headers.GetContentLength());
+  EXPECT_FALSE(headers.IsRedirect(NULL));
+  EXPECT_FALSE(headers.HasHeader("Content-Disposition"));
+  EXPECT_FALSE(headers.HasHeaderValue("cache-control", "no-store"));
+
+  std::string value;
+  void* iter = NULL;
+  while (headers.EnumerateHeader(&iter, "Content-Encoding", &value)) {}
+  EXPECT_TRUE(headers.GetMimeType(&value));
+}
+
+}  // namespace
+
+TEST(HttpResponseHeadersPerfTest, Parse) {
+  std::string raw_headers = RawHeaders();
+  PerfTimeLogger timer("HttpResponseHeaders_parse");
+  for (int i = 0; i < kNumResponses; ++i) {
+    scoped_refptr<HttpResponseHeaders> headers(
+        new HttpResponseHeaders(raw_headers));
+    EXPECT_EQ(200, headers->response_code());
+  }
+  timer.Done();
+}
+
+TEST(HttpResponseHeadersPerfTest, Inspect) {
+  scoped_refptr<HttpResponseHeaders> headers(
+      new HttpResponseHeaders(RawHeaders()));
+  base::Time response_time;
+  ASSERT_TRUE(headers->GetDateValue(&response_time));
+  PerfTimeLogger timer("HttpResponseHeaders_inspect");
+  for (int i = 0; i < kNumResponses; ++i)
+    InspectHeaders(*headers, response_time);
+  timer.Done();
+}
+
+}  // namespace net
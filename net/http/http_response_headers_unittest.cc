@@ -520,6 +520,60 @@ TEST(HttpResponseHeadersTest, EnumerateHeader_DateValued) {
   EXPECT_EQ("Wed, 01 Aug 2007 23:23:45 GMT", value);
 }
 
+TEST(HttpResponseHeadersTest, EnumerateHeader_StringPiece) {
+  std::string headers =
+      "HTTP/1.1 200 OK\n"
+      "Cache-control: private, max-age=3600\n"
+      "X-Custom: a, b\n"
+      "ETag:\n"
+      "cache-CONTROL: no-store\n";
+  HeadersToRaw(&headers);
+  scoped_refptr<net::HttpResponseHeaders> parsed(
+      new net::HttpResponseHeaders(headers));
+
+  // The values point into the raw headers.
+  void* iter = NULL;
+  base::StringPiece value;
+  EXPECT_TRUE(parsed->EnumerateHeader(&iter, "CACHE-CONTROL", &value));
+  EXPECT_EQ("private", value.as_string());
+  EXPECT_GE(value.data(), parsed->raw_headers().data());
+  EXPECT_LT(value.data(),
+            parsed->raw_headers().data() + parsed->raw_headers().size());
+  EXPECT_TRUE(parsed->EnumerateHeader(&iter, "CACHE-CONTROL", &value));
+  EXPECT_EQ("max-age=3600", value.as_string());
+  EXPECT_TRUE(parsed->EnumerateHeader(&iter, "CACHE-CONTROL", &value));
+  EXPECT_EQ("no-store", value.as_string());
+  EXPECT_FALSE(parsed->EnumerateHeader(&iter, "CACHE-CONTROL", &value));
+  EXPECT_TRUE(value.empty());
+
+  iter = NULL;
+  EXPECT_TRUE(parsed->EnumerateHeader(&iter, "x-custom", &value));
+  EXPECT_EQ("a", value.as_string());
+  EXPECT_TRUE(parsed->EnumerateHeader(&iter, "x-custom", &value));
+  EXPECT_EQ("b", value.as_string());
+  EXPECT_FALSE(parsed->EnumerateHeader(&iter, "x-custom", &value));
+
+  EXPECT_TRUE(parsed->EnumerateHeader(NULL, "etag", &value));
+  EXPECT_TRUE(value.empty());
+
+  // Names that are not well-known, or that are close to one, are not
+  // mistaken for each other.
+  EXPECT_FALSE(parsed->HasHeader("x-custo"));
+  EXPECT_FALSE(parsed->HasHeader("cache-contrl"));
+  EXPECT_FALSE(parsed->HasHeader("cache-controls"));
+  EXPECT_FALSE(parsed->HasHeader("date"));
+  EXPECT_FALSE(parsed->HasHeader(""));
+  EXPECT_TRUE(parsed->HasHeaderValue("X-CUSTOM", "B"));
+  EXPECT_TRUE(parsed->HasHeaderValue("Cache-Control", "No-Store"));
+  EXPECT_FALSE(parsed->HasHeaderValue("Cache-Control", "no-cache"));
+
+  iter = NULL;
+  base::StringPiece name;
+  EXPECT_TRUE(parsed->EnumerateHeaderLines(&iter, &name, &value));
+  EXPECT_EQ("Cache-control", name.as_string());
+  EXPECT_EQ("private, max-age=3600", value.as_string());
+}
+
 TEST(HttpResponseHeadersTest, GetMimeType) {
   const ContentTypeTestData tests[] = {
     { "HTTP/1.1 200 OK\n"
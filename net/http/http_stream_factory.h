@@ -202,6 +202,12 @@ class HttpStreamFactory {
   }
   static bool force_spdy_always() { return force_spdy_always_; }
 
+  // Controls whether or not HTTP/1.1 requests may be pipelined.
+  static void set_http_pipelining_enabled(bool value) {
+    http_pipelining_enabled_ = value;
+  }
+  static bool http_pipelining_enabled() { return http_pipelining_enabled_; }
+
   // Add a URL to exclude from forced SPDY.
   static void add_forced_spdy_exclusion(const std::string& value);
   // Check if a HostPortPair is excluded from using spdy.
@@ -239,6 +245,7 @@ class HttpStreamFactory {
   static bool force_spdy_always_;
   static std::list<HostPortPair>* forced_spdy_exclusions_;
   static bool ignore_certificate_errors_;
+  static bool http_pipelining_enabled_;
 
   DISALLOW_COPY_AND_ASSIGN(HttpStreamFactory);
 };
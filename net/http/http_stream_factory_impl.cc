@@ -10,6 +10,7 @@
 #include "net/base/net_log.h"
 #include "net/base/net_util.h"
 #include "net/http/http_network_session.h"
+#include "net/http/http_pipelined_stream.h"
 #include "net/http/http_stream_factory_impl_job.h"
 #include "net/http/http_stream_factory_impl_request.h"
 #include "net/spdy/spdy_http_stream.h"
@@ -32,11 +33,13 @@ GURL UpgradeUrlToHttps(const GURL& original_url) {
 }  // namespace
 
 HttpStreamFactoryImpl::HttpStreamFactoryImpl(HttpNetworkSession* session)
-    : session_(session) {}
+    : session_(session),
+      ALLOW_THIS_IN_INITIALIZER_LIST(http_pipelined_host_pool_(this)) {}
 
 HttpStreamFactoryImpl::~HttpStreamFactoryImpl() {
   DCHECK(request_map_.empty());
   DCHECK(spdy_session_request_map_.empty());
+  DCHECK(http_pipelining_request_map_.empty());
 
   std::set<const Job*> tmp_job_set;
   tmp_job_set.swap(orphaned_job_set_);
@@ -194,6 +197,26 @@ void HttpStreamFactoryImpl::OnSpdySessionReady(
   // TODO(mbelshe): Alert other valid requests.
 }
 
+void HttpStreamFactoryImpl::OnHttpPipelinedHostHasAdditionalCapacity(
+    const HostPortPair& origin) {
+  while (ContainsKey(http_pipelining_request_map_, origin)) {
+    HttpPipelinedStream* stream =
+        http_pipelined_host_pool_.CreateStreamOnExistingPipeline(origin);
+    if (!stream)
+      return;
+
+    Request* request = *http_pipelining_request_map_[origin].begin();
+    request->RemoveRequestFromHttpPipeliningRequestMap();
+    request->Complete(stream->was_npn_negotiated(),
+                      false,  // not using_spdy
+                      stream->source());
+    request->OnStreamReady(NULL,
+                           stream->used_ssl_config(),
+                           stream->used_proxy_info(),
+                           stream);
+  }
+}
+
 void HttpStreamFactoryImpl::OnOrphanedJobComplete(const Job* job) {
   orphaned_job_set_.erase(job);
   delete job;
@@ -10,6 +10,7 @@
 
 #include "base/memory/ref_counted.h"
 #include "net/base/host_port_pair.h"
+#include "net/http/http_pipelined_host_pool.h"
 #include "net/http/http_stream_factory.h"
 #include "net/base/net_log.h"
 #include "net/proxy/proxy_server.h"
@@ -19,7 +20,8 @@ namespace net {
 class HttpNetworkSession;
 class SpdySession;
 
-class HttpStreamFactoryImpl : public HttpStreamFactory {
+class HttpStreamFactoryImpl : public HttpStreamFactory,
+                              public HttpPipelinedHostPool::Delegate {
  public:
   explicit HttpStreamFactoryImpl(HttpNetworkSession* session);
   virtual ~HttpStreamFactoryImpl();
@@ -38,12 +40,17 @@ class HttpStreamFactoryImpl : public HttpStreamFactory {
   virtual void AddTLSIntolerantServer(const HostPortPair& server);
   virtual bool IsTLSIntolerantServer(const HostPortPair& server) const;
 
+  // HttpPipelinedHostPool::Delegate interface
+  virtual void OnHttpPipelinedHostHasAdditionalCapacity(
+      const HostPortPair& origin) OVERRIDE;
+
  private:
   class Request;
   class Job;
 
   typedef std::set<Request*> RequestSet;
   typedef std::map<HostPortProxyPair, RequestSet> SpdySessionRequestMap;
+  typedef std::map<HostPortPair, RequestSet> HttpPipeliningRequestMap;
 
   bool GetAlternateProtocolRequestFor(const GURL& original_url,
                                       GURL* alternate_url) const;
@@ -87,6 +94,12 @@ class HttpStreamFactoryImpl : public HttpStreamFactory {
 
   SpdySessionRequestMap spdy_session_request_map_;
 
+  HttpPipelinedHostPool http_pipelined_host_pool_;
+
+  // Requests whose Job is connecting to an origin that may be pipelined to.
+  // They are handed a stream on an existing pipeline if one has room first.
+  HttpPipeliningRequestMap http_pipelining_request_map_;
+
   // These jobs correspond to jobs orphaned by Requests and now owned by
   // HttpStreamFactoryImpl. Since they are no longer tied to Requests, they will
   // not be canceled when Requests are canceled. Therefore, in
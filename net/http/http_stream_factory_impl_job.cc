@@ -15,6 +15,7 @@
 #include "net/base/ssl_cert_request_info.h"
 #include "net/http/http_basic_stream.h"
 #include "net/http/http_network_session.h"
+#include "net/http/http_pipelined_stream.h"
 #include "net/http/http_proxy_client_socket.h"
 #include "net/http/http_proxy_client_socket_pool.h"
 #include "net/http/http_request_info.h"
@@ -61,6 +62,7 @@ HttpStreamFactoryImpl::Job::Job(HttpStreamFactoryImpl* stream_factory,
       was_npn_negotiated_(false),
       num_streams_(0),
       spdy_session_direct_(false),
+      existing_available_pipeline_(false),
       ALLOW_THIS_IN_INITIALIZER_LIST(method_factory_(this)) {
   DCHECK(stream_factory);
   DCHECK(session);
@@ -507,6 +509,25 @@ bool HttpStreamFactoryImpl::Job::ShouldForceSpdyWithoutSSL() const {
   return rv && !HttpStreamFactory::HasSpdyExclusion(origin_);
 }
 
+bool HttpStreamFactoryImpl::Job::IsRequestEligibleForPipelining() const {
+  if (!HttpStreamFactory::http_pipelining_enabled())
+    return false;
+  if (IsPreconnecting() || original_url_.get())
+    return false;
+  if (using_spdy_ || force_spdy_always_)
+    return false;
+  // Requests behind a proxy may end up on connections to different servers.
+  if (!proxy_info_.is_direct())
+    return false;
+  // Evicted requests are resent, so only idempotent ones are pipelined.
+  if (request_info_.upload_data ||
+      (request_info_.method != "GET" && request_info_.method != "HEAD")) {
+    return false;
+  }
+  return stream_factory_->http_pipelined_host_pool_.IsHostEligibleForPipelining(
+      origin_);
+}
+
 int HttpStreamFactoryImpl::Job::DoWaitForJob() {
   DCHECK(blocking_job_);
   next_state_ = STATE_WAIT_FOR_JOB_COMPLETE;
@@ -552,6 +573,20 @@ int HttpStreamFactoryImpl::Job::DoInitConnection() {
     request_->SetSpdySessionKey(spdy_session_key);
   }
 
+  // Likewise, a request that can be pipelined may join an existing pipeline
+  // instead of waiting for a connection of its own.
+  if (IsRequestEligibleForPipelining()) {
+    HttpPipelinedHostPool& pipelined_host_pool =
+        stream_factory_->http_pipelined_host_pool_;
+    if (pipelined_host_pool.IsExistingPipelineAvailableForOrigin(origin_)) {
+      existing_available_pipeline_ = true;
+      next_state_ = STATE_CREATE_STREAM;
+      return OK;
+    }
+    if (request_)
+      request_->SetHttpPipeliningKey(origin_);
+  }
+
   // OK, there's no available SPDY session. Let |dependent_job_| resume if it's
   // paused.
 
@@ -601,6 +636,10 @@ int HttpStreamFactoryImpl::Job::DoInitConnection() {
 }
 
 int HttpStreamFactoryImpl::Job::DoInitConnectionComplete(int result) {
+  // This Job will create the stream itself.
+  if (request_)
+    request_->RemoveRequestFromHttpPipeliningRequestMap();
+
   if (IsPreconnecting()) {
     DCHECK_EQ(OK, result);
     return OK;
@@ -728,10 +767,22 @@ int HttpStreamFactoryImpl::Job::DoCreateStream() {
   const ProxyServer& proxy_server = proxy_info_.proxy_server();
 
   if (!using_spdy_) {
-    bool using_proxy = (proxy_info_.is_http() || proxy_info_.is_https()) &&
-        request_info_.url.SchemeIs("http");
-    stream_.reset(new HttpBasicStream(connection_.release(), NULL,
-                                      using_proxy));
+    HttpPipelinedHostPool& pipelined_host_pool =
+        stream_factory_->http_pipelined_host_pool_;
+    if (existing_available_pipeline_) {
+      stream_.reset(
+          pipelined_host_pool.CreateStreamOnExistingPipeline(origin_));
+      DCHECK(stream_.get());
+    } else if (IsRequestEligibleForPipelining()) {
+      stream_.reset(pipelined_host_pool.CreateStreamOnNewPipeline(
+          origin_, connection_.release(), ssl_config_, proxy_info_, net_log_,
+          was_npn_negotiated_));
+    } else {
+      bool using_proxy = (proxy_info_.is_http() || proxy_info_.is_https()) &&
+          request_info_.url.SchemeIs("http");
+      stream_.reset(new HttpBasicStream(connection_.release(), NULL,
+                                        using_proxy));
+    }
     return OK;
   }
 
@@ -196,6 +196,10 @@ class HttpStreamFactoryImpl::Job {
   // Should we force SPDY to run without SSL for this stream request.
   bool ShouldForceSpdyWithoutSSL() const;
 
+  // Whether the request may share a connection with other requests through
+  // HTTP pipelining.
+  bool IsRequestEligibleForPipelining() const;
+
   // Record histograms of latency until Connect() completes.
   static void LogHttpConnectedMetrics(const ClientSocketHandle& handle);
 
@@ -265,6 +269,9 @@ class HttpStreamFactoryImpl::Job {
   // Only used if |new_spdy_session_| is non-NULL.
   bool spdy_session_direct_;
 
+  // True if an existing pipeline can handle this job's request.
+  bool existing_available_pipeline_;
+
   ScopedRunnableMethodFactory<Job> method_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(Job);
@@ -30,6 +30,11 @@ class HttpStreamFactoryImpl::Request : public HttpStreamRequest {
   // before knowing if SPDY is available.
   void SetSpdySessionKey(const HostPortProxyPair& spdy_session_key);
 
+  // Called when the Job connecting for the Request finds that |origin| may be
+  // pipelined to.  The Request may then be handed a stream on an existing
+  // pipeline before its Job finishes.
+  void SetHttpPipeliningKey(const HostPortPair& origin);
+
   // Attaches |job| to this request. Does not mean that Request will use |job|,
   // but Request will own |job|.
   void AttachJob(HttpStreamFactoryImpl::Job* job);
@@ -45,6 +50,10 @@ class HttpStreamFactoryImpl::Request : public HttpStreamRequest {
   // SpdySessionRequestMap.
   void RemoveRequestFromSpdySessionRequestMap();
 
+  // If this Request has an http_pipelining_key, remove it from the
+  // HttpPipeliningRequestMap.
+  void RemoveRequestFromHttpPipeliningRequestMap();
+
   // Called by an attached Job if it sets up a SpdySession.
   void OnSpdySessionReady(Job* job,
                           scoped_refptr<SpdySession> spdy_session,
@@ -102,6 +111,7 @@ class HttpStreamFactoryImpl::Request : public HttpStreamRequest {
   scoped_ptr<Job> bound_job_;
   std::set<HttpStreamFactoryImpl::Job*> jobs_;
   scoped_ptr<const HostPortProxyPair> spdy_session_key_;
+  scoped_ptr<const HostPortPair> http_pipelining_key_;
 
   bool completed_;
   bool was_npn_negotiated_;
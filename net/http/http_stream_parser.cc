@@ -32,6 +32,7 @@ HttpStreamParser::HttpStreamParser(ClientSocketHandle* connection,
       read_buf_(read_buffer),
       read_buf_unused_offset_(0),
       response_header_start_offset_(-1),
+      response_header_scan_offset_(0),
       response_body_length_(-1),
       response_body_read_(0),
       chunked_decoder_(NULL),
@@ -42,10 +43,11 @@ HttpStreamParser::HttpStreamParser(ClientSocketHandle* connection,
       net_log_(net_log),
       ALLOW_THIS_IN_INITIALIZER_LIST(
           io_callback_(this, &HttpStreamParser::OnIOComplete)),
+      chunk_header_length_(0),
       chunk_length_(0),
       chunk_length_without_encoding_(0),
+      chunk_bytes_sent_(0),
       sent_last_chunk_(false) {
-  DCHECK_EQ(0, read_buffer->offset());
 }
 
 HttpStreamParser::~HttpStreamParser() {
@@ -85,9 +87,10 @@ int HttpStreamParser::SendRequest(const std::string& request_line,
   request_body_.reset(request_body);
   if (request_body_ != NULL && request_body_->is_chunked()) {
     request_body_->set_chunk_callback(this);
-    const int kChunkHeaderFooterSize = 12;  // 2 CRLFs + max of 8 hex chars.
-    chunk_buf_ = new IOBuffer(request_body_->GetMaxBufferSize() +
-                              kChunkHeaderFooterSize);
+    chunk_buf_ = new IOBuffer(kMaxChunkHeaderSize);
+  } else if (request_body_ != NULL) {
+    // Read any files to upload on a worker thread, ahead of the socket.
+    request_body_->EnableAsyncFileReads(this);
   }
 
   io_state_ = STATE_SENDING_HEADERS;
@@ -168,8 +171,8 @@ void HttpStreamParser::OnIOComplete(int result) {
 void HttpStreamParser::OnChunkAvailable() {
   // This method may get called while sending the headers or body, so check
   // before processing the new data. If we were still initializing or sending
-  // headers, we will automatically start reading the chunks once we get into
-  // STATE_SENDING_BODY so nothing to do here.
+  // headers, we will automatically start reading the chunks (or the file data
+  // read so far) once we get into STATE_SENDING_BODY so nothing to do here.
   DCHECK(io_state_ == STATE_SENDING_HEADERS || io_state_ == STATE_SENDING_BODY);
   if (io_state_ == STATE_SENDING_BODY)
     OnIOComplete(0);
@@ -230,7 +233,11 @@ int HttpStreamParser::DoLoop(int result) {
 }
 
 int HttpStreamParser::DoSendHeaders(int result) {
-  request_headers_->DidConsume(result);
+  // If the headers were sent together with the start of the body, |result|
+  // may also count some bytes of the body.
+  int header_bytes = std::min(result, request_headers_->BytesRemaining());
+  request_headers_->DidConsume(header_bytes);
+  result -= header_bytes;
   int bytes_remaining = request_headers_->BytesRemaining();
   if (bytes_remaining > 0) {
     // Record our best estimate of the 'request time' as the time when we send
@@ -270,13 +277,24 @@ int HttpStreamParser::DoSendHeaders(int result) {
       UMA_HISTOGRAM_ENUMERATION("Net.CoalescePotential", coalesce,
                                 COALESCE_POTENTIAL_MAX);
     }
-    result = connection_->socket()->Write(request_headers_,
-                                          bytes_remaining,
-                                          &io_callback_);
+    if (request_body_ != NULL && !request_body_->is_chunked() &&
+        request_body_->buf_len()) {
+      // Send the headers and the first part of the body with one write,
+      // straight from their own buffers.
+      IOBuffer* bufs[] = { request_headers_, request_body_->buf() };
+      int buf_lens[] = { bytes_remaining,
+                         static_cast<int>(request_body_->buf_len()) };
+      result = connection_->socket()->Writev(bufs, buf_lens, arraysize(bufs),
+                                             &io_callback_);
+    } else {
+      result = connection_->socket()->Write(request_headers_,
+                                            bytes_remaining,
+                                            &io_callback_);
+    }
   } else if (request_body_ != NULL &&
              (request_body_->is_chunked() || request_body_->size())) {
+    // Pass on the number of body bytes that were sent with the headers.
     io_state_ = STATE_SENDING_BODY;
-    result = OK;
   } else {
     io_state_ = STATE_REQUEST_SENT;
   }
@@ -285,12 +303,9 @@ int HttpStreamParser::DoSendHeaders(int result) {
 
 int HttpStreamParser::DoSendBody(int result) {
   if (request_body_->is_chunked()) {
-    chunk_length_ -= result;
-    if (chunk_length_) {
-      memmove(chunk_buf_->data(), chunk_buf_->data() + result, chunk_length_);
-      return connection_->socket()->Write(chunk_buf_, chunk_length_,
-                                          &io_callback_);
-    }
+    chunk_bytes_sent_ += result;
+    if (chunk_bytes_sent_ < chunk_length_)
+      return WriteChunk();
 
     if (sent_last_chunk_) {
       io_state_ = STATE_REQUEST_SENT;
@@ -298,33 +313,32 @@ int HttpStreamParser::DoSendBody(int result) {
     }
 
     request_body_->MarkConsumedAndFillBuffer(chunk_length_without_encoding_);
+    chunk_header_length_ = 0;
     chunk_length_without_encoding_ = 0;
     chunk_length_ = 0;
+    chunk_bytes_sent_ = 0;
 
     int buf_len = static_cast<int>(request_body_->buf_len());
     if (request_body_->eof()) {
       static const char kLastChunk[] = "0\r\n\r\n";
-      chunk_length_ = strlen(kLastChunk);
-      memcpy(chunk_buf_->data(), kLastChunk, chunk_length_);
+      chunk_header_length_ = strlen(kLastChunk);
+      memcpy(chunk_buf_->data(), kLastChunk, chunk_header_length_);
+      chunk_length_ = chunk_header_length_;
       sent_last_chunk_ = true;
     } else if (buf_len) {
-      // Encode and send the buffer as 1 chunk.
+      // Send the buffer as 1 chunk.  Only its header is built here; the data
+      // is written from |request_body_|'s buffer.
       std::string chunk_header = StringPrintf("%X\r\n", buf_len);
-      char* chunk_ptr = chunk_buf_->data();
-      memcpy(chunk_ptr, chunk_header.data(), chunk_header.length());
-      chunk_ptr += chunk_header.length();
-      memcpy(chunk_ptr, request_body_->buf()->data(), buf_len);
-      chunk_ptr += buf_len;
-      memcpy(chunk_ptr, "\r\n", 2);
+      memcpy(chunk_buf_->data(), chunk_header.data(), chunk_header.length());
+      chunk_header_length_ = chunk_header.length();
       chunk_length_without_encoding_ = buf_len;
-      chunk_length_ = chunk_header.length() + buf_len + 2;
+      chunk_length_ = chunk_header_length_ + buf_len + 2;
     }
 
     if (!chunk_length_)  // More POST data is yet to come?
       return ERR_IO_PENDING;
 
-    return connection_->socket()->Write(chunk_buf_, chunk_length_,
-                                        &io_callback_);
+    return WriteChunk();
   }
 
   // Non-chunked request body.
@@ -332,6 +346,8 @@ int HttpStreamParser::DoSendBody(int result) {
 
   if (!request_body_->eof()) {
     int buf_len = static_cast<int>(request_body_->buf_len());
+    if (!buf_len)  // Waiting for file data to be read?
+      return ERR_IO_PENDING;
     result = connection_->socket()->Write(request_body_->buf(), buf_len,
                                           &io_callback_);
   } else {
@@ -340,12 +356,72 @@ int HttpStreamParser::DoSendBody(int result) {
   return result;
 }
 
+int HttpStreamParser::WriteChunk() {
+  static const char kChunkTrailer[] = "\r\n";
+  scoped_refptr<IOBuffer> parts[] = {
+    chunk_buf_,
+    request_body_->buf(),
+    new WrappedIOBuffer(kChunkTrailer),
+  };
+  int part_lens[] = {
+    static_cast<int>(chunk_header_length_),
+    static_cast<int>(chunk_length_without_encoding_),
+    sent_last_chunk_ ? 0 : 2,
+  };
+
+  // Skip whatever an earlier partial write already sent.
+  IOBuffer* bufs[arraysize(parts)];
+  int buf_lens[arraysize(parts)];
+  int buf_count = 0;
+  int skip = static_cast<int>(chunk_bytes_sent_);
+  for (size_t i = 0; i < arraysize(parts); ++i) {
+    if (skip >= part_lens[i]) {
+      skip -= part_lens[i];
+      continue;
+    }
+    if (skip) {
+      // |parts[i]| itself is kept alive by this object.
+      parts[i] = new WrappedIOBuffer(parts[i]->data() + skip);
+      part_lens[i] -= skip;
+      skip = 0;
+    }
+    bufs[buf_count] = parts[i];
+    buf_lens[buf_count] = part_lens[i];
+    ++buf_count;
+  }
+  DCHECK_GT(buf_count, 0);
+  return connection_->socket()->Writev(bufs, buf_lens, buf_count,
+                                       &io_callback_);
+}
+
 int HttpStreamParser::DoReadHeaders() {
   io_state_ = STATE_READ_HEADERS_COMPLETE;
 
-  // Grow the read buffer if necessary.
-  if (read_buf_->RemainingCapacity() == 0)
-    read_buf_->SetCapacity(read_buf_->capacity() + kHeaderBufInitialSize);
+  // If the read buffer is full, first drop the bytes of any 1xx responses
+  // that have already been parsed, then grow it if that wasn't enough.  The
+  // buffer is never emptied entirely, since an empty buffer means that
+  // nothing has been received yet.
+  int unparsed_bytes = read_buf_->offset() - read_buf_unused_offset_;
+  if (read_buf_->RemainingCapacity() == 0 && read_buf_unused_offset_ > 0 &&
+      unparsed_bytes > 0) {
+    memmove(read_buf_->StartOfBuffer(),
+            read_buf_->StartOfBuffer() + read_buf_unused_offset_,
+            unparsed_bytes);
+    read_buf_->set_offset(unparsed_bytes);
+    read_buf_unused_offset_ = 0;
+  }
+  if (read_buf_->RemainingCapacity() == 0) {
+    // Double the capacity rather than adding a fixed amount, so that large
+    // headers don't cost a reallocation and copy every few kilobytes.
+    // There is no point in growing past |kMaxHeaderBufSize|.
+    int min_capacity = read_buf_->capacity() + kHeaderBufInitialSize;
+    int new_capacity = std::max(min_capacity, 2 * read_buf_->capacity());
+    if (new_capacity > kMaxHeaderBufSize) {
+      new_capacity = std::max(min_capacity,
+                              static_cast<int>(kMaxHeaderBufSize));
+    }
+    read_buf_->SetCapacity(new_capacity);
+  }
 
   // http://crbug.com/16371: We're seeing |user_buf_->data()| return NULL.
   // See if the user is passing in an IOBuffer with a NULL |data_|.
@@ -430,6 +506,7 @@ int HttpStreamParser::DoReadHeadersComplete(int result) {
       // tunnel.
       io_state_ = STATE_REQUEST_SENT;
       response_header_start_offset_ = -1;
+      response_header_scan_offset_ = 0;
     } else {
       io_state_ = STATE_BODY_PENDING;
       CalculateResponseBodySize();
@@ -567,10 +644,17 @@ int HttpStreamParser::ParseResponseHeaders() {
   }
 
   if (response_header_start_offset_ >= 0) {
+    // Resume the search where the previous read left off, backing up over
+    // the first two bytes of an end-of-headers marker that might straddle
+    // the two reads.
+    int search_offset = std::max(response_header_start_offset_,
+                                 response_header_scan_offset_ - 2);
+    int buf_len = read_buf_->offset() - read_buf_unused_offset_;
     end_offset = HttpUtil::LocateEndOfHeaders(
-        read_buf_->StartOfBuffer() + read_buf_unused_offset_,
-        read_buf_->offset() - read_buf_unused_offset_,
-        response_header_start_offset_);
+        read_buf_->StartOfBuffer() + read_buf_unused_offset_, buf_len,
+        search_offset);
+    if (end_offset == -1)
+      response_header_scan_offset_ = buf_len;
   } else if (read_buf_->offset() - read_buf_unused_offset_ >= 8) {
     // Enough data to decide that this is an HTTP/0.9 response.
     // 8 bytes = (4 bytes of junk) + "http".length()
@@ -32,7 +32,9 @@ class HttpStreamParser  : public ChunkCallback {
   // and any data left over after parsing the stream will be put into
   // |read_buffer|.  The left over data will start at offset 0 and the
   // buffer's offset will be set to the first free byte. |read_buffer| may
-  // have its capacity changed.
+  // have its capacity changed.  Parsers that share |connection| may share
+  // |read_buffer| as well, so it may still hold a response that another
+  // parser is reading when this one is created.
   HttpStreamParser(ClientSocketHandle* connection,
                    const HttpRequestInfo* request,
                    GrowableIOBuffer* read_buffer,
@@ -92,8 +94,8 @@ class HttpStreamParser  : public ChunkCallback {
     STATE_DONE
   };
 
-  // The number of bytes by which the header buffer is grown when it reaches
-  // capacity.
+  // The minimum number of bytes by which the header buffer is grown when it
+  // reaches capacity.  Beyond that, its capacity is doubled.
   enum { kHeaderBufInitialSize = 4096 };
 
   // |kMaxHeaderBufSize| is the number of bytes that the response headers can
@@ -105,6 +107,9 @@ class HttpStreamParser  : public ChunkCallback {
   // The maximum sane buffer size.
   enum { kMaxBufSize = 2 * 1024 * 1024 };  // 2 megabytes.
 
+  // The largest chunk header: 8 hex digits and a CRLF.
+  enum { kMaxChunkHeaderSize = 10 };
+
   // Handle callbacks.
   void OnIOComplete(int result);
 
@@ -129,6 +134,9 @@ class HttpStreamParser  : public ChunkCallback {
   // failure.
   int DoParseResponseHeaders(int end_of_header_offset);
 
+  // Writes whatever is left of the current chunk of a chunked upload.
+  int WriteChunk();
+
   // Examine the parsed headers to try to determine the response body size.
   void CalculateResponseBodySize();
 
@@ -155,6 +163,10 @@ class HttpStreamParser  : public ChunkCallback {
   // -1 if not found yet.
   int response_header_start_offset_;
 
+  // The amount beyond |read_buf_unused_offset_| that has already been searched
+  // for the end of the headers, so that each read only scans the new data.
+  int response_header_scan_offset_;
+
   // The parsed response headers.  Owned by the caller.
   HttpResponseInfo* response_;
 
@@ -191,11 +203,15 @@ class HttpStreamParser  : public ChunkCallback {
   // Callback to be used when doing IO.
   CompletionCallbackImpl<HttpStreamParser> io_callback_;
 
-  // Stores an encoded chunk for chunked uploads.
-  // Note: This should perhaps be improved to not create copies of the data.
+  // Stores the header of the current chunk for chunked uploads.  The chunk's
+  // data is sent from |request_body_|'s buffer, followed by a CRLF.
   scoped_refptr<IOBuffer> chunk_buf_;
+  size_t chunk_header_length_;
+  // The length of the whole chunk, with and without its header and CRLF.
   size_t chunk_length_;
   size_t chunk_length_without_encoding_;
+  // The number of bytes of the current chunk that have been written.
+  size_t chunk_bytes_sent_;
   bool sent_last_chunk_;
 
   DISALLOW_COPY_AND_ASSIGN(HttpStreamParser);
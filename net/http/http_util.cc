@@ -7,6 +7,8 @@
 
 #include "net/http/http_util.h"
 
+#include <string.h>
+
 #include <algorithm>
 
 #include "base/basictypes.h"
@@ -14,6 +16,12 @@
 #include "base/string_number_conversions.h"
 #include "base/string_piece.h"
 #include "base/string_util.h"
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY) && defined(__SSE2__)
+#include <emmintrin.h>
+#define HTTP_UTIL_USE_SSE2
+#endif
 
 using std::string;
 
@@ -450,19 +458,76 @@ int HttpUtil::LocateStartOfStatusLine(const char* buf, int buf_len) {
   return -1;  // Not found
 }
 
+#if defined(HTTP_UTIL_USE_SSE2)
+
+// Returns the index of the lowest set bit of the non-zero |mask|.
+static inline int LowestSetBit(int mask) {
+  return __builtin_ctz(mask);
+}
+
+// Returns the first LF in [begin, end), or NULL.  Compares 16 bytes at a
+// time, and never reads past |end|.
+static const char* FindLineFeed(const char* begin, const char* end) {
+  const __m128i lf = _mm_set1_epi8('\n');
+  for (; end - begin >= 16; begin += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, lf));
+    if (mask)
+      return begin + LowestSetBit(mask);
+  }
+  return static_cast<const char*>(memchr(begin, '\n', end - begin));
+}
+
+// Returns the first CR or LF in [begin, end), or |end|.  Used by
+// AssembleRawHeaders to find the end of each line.
+static const char* FindLineBreak(const char* begin, const char* end) {
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  for (; end - begin >= 16; begin += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, cr),
+                                              _mm_cmpeq_epi8(chunk, lf)));
+    if (mask)
+      return begin + LowestSetBit(mask);
+  }
+  for (; begin != end; ++begin) {
+    if (*begin == '\r' || *begin == '\n')
+      break;
+  }
+  return begin;
+}
+
+#else  // !defined(HTTP_UTIL_USE_SSE2)
+
+static const char* FindLineFeed(const char* begin, const char* end) {
+  return static_cast<const char*>(memchr(begin, '\n', end - begin));
+}
+
+static const char* FindLineBreak(const char* begin, const char* end) {
+  for (; begin != end; ++begin) {
+    if (*begin == '\r' || *begin == '\n')
+      break;
+  }
+  return begin;
+}
+
+#endif  // defined(HTTP_UTIL_USE_SSE2)
+
 int HttpUtil::LocateEndOfHeaders(const char* buf, int buf_len, int i) {
-  bool was_lf = false;
-  char last_c = '\0';
-  for (; i < buf_len; ++i) {
-    char c = buf[i];
-    if (c == '\n') {
-      if (was_lf)
-        return i + 1;
-      was_lf = true;
-    } else if (c != '\r' || last_c != '\n') {
-      was_lf = false;
-    }
-    last_c = c;
+  if (i >= buf_len)
+    return -1;
+
+  // Only LFs can end the headers, so jump from one to the next and look
+  // behind each for the LF or LF CR that would complete the marker.  The
+  // marker must lie entirely at or after |i|.
+  const char* start = buf + i;
+  const char* end = buf + buf_len;
+  for (const char* lf = FindLineFeed(start, end); lf;
+       lf = FindLineFeed(lf + 1, end)) {
+    if (lf - start >= 1 && lf[-1] == '\n')
+      return lf - buf + 1;
+    if (lf - start >= 2 && lf[-1] == '\r' && lf[-2] == '\n')
+      return lf - buf + 1;
   }
   return -1;
 }
@@ -492,14 +557,6 @@ static bool IsLineSegmentContinuable(const char* begin, const char* end) {
   return true;
 }
 
-// Helper used by AssembleRawHeaders, to find the end of the status line.
-static const char* FindStatusLineEnd(const char* begin, const char* end) {
-  size_t i = base::StringPiece(begin, end - begin).find_first_of("\r\n");
-  if (i == base::StringPiece::npos)
-    return end;
-  return begin + i;
-}
-
 // Helper used by AssembleRawHeaders, to skip past leading LWS.
 static const char* FindFirstNonLWS(const char* begin, const char* end) {
   for (const char* cur = begin; cur != end; ++cur) {
@@ -523,22 +580,27 @@ std::string HttpUtil::AssembleRawHeaders(const char* input_begin,
     input_begin += status_begin_offset;
 
   // Copy the status line.
-  const char* status_line_end = FindStatusLineEnd(input_begin, input_end);
+  const char* status_line_end = FindLineBreak(input_begin, input_end);
   raw_headers.append(input_begin, status_line_end);
 
   // After the status line, every subsequent line is a header line segment.
   // Should a segment start with LWS, it is a continuation of the previous
   // line's field-value.
 
-  // TODO(ericroman): is this too permissive? (delimits on [\r\n]+)
-  CStringTokenizer lines(status_line_end, input_end, "\r\n");
-
   // This variable is true when the previous line was continuable.
   bool prev_line_continuable = false;
 
-  while (lines.GetNext()) {
-    const char* line_begin = lines.token_begin();
-    const char* line_end = lines.token_end();
+  const char* line_end = status_line_end;
+  for (;;) {
+    // TODO(ericroman): is this too permissive? (delimits on [\r\n]+)
+    // Skip the run of line terminators, including empty lines.
+    const char* line_begin = line_end;
+    while (line_begin != input_end &&
+           (*line_begin == '\r' || *line_begin == '\n'))
+      ++line_begin;
+    if (line_begin == input_end)
+      break;
+    line_end = FindLineBreak(line_begin, input_end);
 
     if (prev_line_continuable && IsLWS(*line_begin)) {
       // Join continuation; reduce the leading LWS to a single SP.
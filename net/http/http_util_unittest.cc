@@ -185,6 +185,11 @@ TEST(HttpUtilTest, LocateEndOfHeaders) {
     { "foo\nbar\n\njunk", 9 },
     { "foo\nbar\n\r\njunk", 10 },
     { "foo\nbar\r\n\njunk", 10 },
+    { "foo\r\nbar\r\n", -1 },
+    { "foo\n\r\rbar\n", -1 },
+    { "", -1 },
+    { "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n\r\n", 44 },
+    { "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nX: y\r\n", -1 },
   };
   for (size_t i = 0; i < ARRAYSIZE_UNSAFE(tests); ++i) {
     int input_len = static_cast<int>(strlen(tests[i].input));
@@ -193,6 +198,32 @@ TEST(HttpUtilTest, LocateEndOfHeaders) {
   }
 }
 
+// The end-of-headers marker must be found wherever it falls, and the search
+// must start at the given offset, as when resuming after a partial read.
+TEST(HttpUtilTest, LocateEndOfHeadersAtEveryOffset) {
+  const char* const kMarkers[] = { "\n\n", "\n\r\n", "\r\n\r\n" };
+  for (size_t i = 0; i < ARRAYSIZE_UNSAFE(kMarkers); ++i) {
+    for (int prefix_len = 0; prefix_len < 70; ++prefix_len) {
+      std::string input(prefix_len, 'x');
+      input.append(kMarkers[i]);
+      int marker_end = static_cast<int>(input.size());
+      input.append("body\n\n");
+      int input_len = static_cast<int>(input.size());
+      EXPECT_EQ(marker_end, HttpUtil::LocateEndOfHeaders(input.data(),
+                                                         input_len));
+      EXPECT_EQ(-1, HttpUtil::LocateEndOfHeaders(input.data(), marker_end - 1));
+
+      // Starting anywhere up to the first LF of the marker finds it; past
+      // that, only the LF LF at the end of the body is left.
+      int first_lf = static_cast<int>(input.find('\n'));
+      EXPECT_EQ(marker_end, HttpUtil::LocateEndOfHeaders(
+          input.data(), input_len, first_lf));
+      EXPECT_EQ(input_len, HttpUtil::LocateEndOfHeaders(
+          input.data(), input_len, first_lf + 1));
+    }
+  }
+}
+
 TEST(HttpUtilTest, AssembleRawHeaders) {
   struct {
     const char* input;
@@ -482,6 +513,21 @@ TEST(HttpUtilTest, AssembleRawHeaders) {
       "Bar: 2||",
     },
 
+    // Lines longer than a vector register, with mixed and repeated line
+    // terminators.
+    {
+      "HTTP/1.1 200 OK with a rather long reason phrase\r\n"
+      "Content-Type: text/html; charset=UTF-8\r\r\n"
+      "Cache-Control: private, max-age=0, must-revalidate\n"
+      "    and-a-continuation-longer-than-sixteen-bytes\n"
+      "Set-Cookie: PREF=ID=1234567890abcdef:FF=0:TM=1318270200\r\n\r\n",
+
+      "HTTP/1.1 200 OK with a rather long reason phrase|"
+      "Content-Type: text/html; charset=UTF-8|"
+      "Cache-Control: private, max-age=0, must-revalidate "
+      "and-a-continuation-longer-than-sixteen-bytes|"
+      "Set-Cookie: PREF=ID=1234567890abcdef:FF=0:TM=1318270200||",
+    },
   };
   for (size_t i = 0; i < ARRAYSIZE_UNSAFE(tests); ++i) {
     int input_len = static_cast<int>(strlen(tests[i].input));
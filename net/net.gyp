@@ -252,6 +252,13 @@
         },
       ],
       'conditions': [
+        [ 'use_io_uring==1 and OS=="linux"', {
+            'sources': [
+              'disk_cache/io_uring_linux.cc',
+              'disk_cache/io_uring_linux.h',
+            ],
+          },
+        ],
         [ 'OS == "linux" or OS == "freebsd" or OS == "openbsd"', {
             'dependencies': [
               '../build/linux/system.gyp:gconf',
@@ -381,6 +388,10 @@
         'disk_cache/cache_util.h',
         'disk_cache/cache_util_posix.cc',
         'disk_cache/cache_util_win.cc',
+        'disk_cache/compression.cc',
+        'disk_cache/compression.h',
+        'disk_cache/content_store.cc',
+        'disk_cache/content_store.h',
         'disk_cache/disk_cache.h',
         'disk_cache/disk_format.cc',
         'disk_cache/disk_format.h',
@@ -399,6 +410,8 @@
         'disk_cache/file_lock.h',
         'disk_cache/file_posix.cc',
         'disk_cache/file_win.cc',
+        'disk_cache/frequency_sketch.cc',
+        'disk_cache/frequency_sketch.h',
         'disk_cache/hash.cc',
         'disk_cache/hash.h',
         'disk_cache/histogram_macros.h',
@@ -406,6 +419,11 @@
         'disk_cache/in_flight_backend_io.h',
         'disk_cache/in_flight_io.cc',
         'disk_cache/in_flight_io.h',
+        'disk_cache/index_checker.cc',
+        'disk_cache/index_checker.h',
+        'disk_cache/index_filter.cc',
+        'disk_cache/index_filter.h',
+        'disk_cache/mapped_file.cc',
         'disk_cache/mapped_file.h',
         'disk_cache/mapped_file_posix.cc',
         'disk_cache/mapped_file_win.cc',
@@ -415,6 +433,8 @@
         'disk_cache/mem_entry_impl.h',
         'disk_cache/mem_rankings.cc',
         'disk_cache/mem_rankings.h',
+        'disk_cache/mem_slab_allocator.cc',
+        'disk_cache/mem_slab_allocator.h',
         'disk_cache/rankings.cc',
         'disk_cache/rankings.h',
         'disk_cache/sparse_control.cc',
@@ -510,6 +530,12 @@
         'http/http_network_session_peer.h',
         'http/http_network_transaction.cc',
         'http/http_network_transaction.h',
+        'http/http_pipelined_connection.cc',
+        'http/http_pipelined_connection.h',
+        'http/http_pipelined_host_pool.cc',
+        'http/http_pipelined_host_pool.h',
+        'http/http_pipelined_stream.cc',
+        'http/http_pipelined_stream.h',
         'http/http_request_headers.cc',
         'http/http_request_headers.h',
         'http/http_request_info.cc',
@@ -935,10 +961,15 @@
         'disk_cache/bitmap_unittest.cc',
         'disk_cache/block_files_unittest.cc',
         'disk_cache/cache_util_unittest.cc',
+        'disk_cache/compression_unittest.cc',
+        'disk_cache/content_store_unittest.cc',
         'disk_cache/disk_cache_test_base.cc',
         'disk_cache/disk_cache_test_base.h',
         'disk_cache/entry_unittest.cc',
+        'disk_cache/frequency_sketch_unittest.cc',
+        'disk_cache/index_filter_unittest.cc',
         'disk_cache/mapped_file_unittest.cc',
+        'disk_cache/mem_slab_allocator_unittest.cc',
         'disk_cache/storage_block_unittest.cc',
         'ftp/ftp_auth_cache_unittest.cc',
         'ftp/ftp_ctrl_response_buffer_unittest.cc',
@@ -969,6 +1000,8 @@
         'http/http_chunked_decoder_unittest.cc',
         'http/http_network_layer_unittest.cc',
         'http/http_network_transaction_unittest.cc',
+        'http/http_pipelined_connection_unittest.cc',
+        'http/http_pipelined_host_pool_unittest.cc',
         'http/http_proxy_client_socket_pool_unittest.cc',
         'http/http_request_headers_unittest.cc',
         'http/http_response_body_drainer_unittest.cc',
@@ -1047,6 +1080,11 @@
              'proxy/proxy_config_service_linux_unittest.cc',
           ],
         }],
+        ['use_io_uring==1 and OS=="linux"', {
+          'sources': [
+            'disk_cache/io_uring_linux_unittest.cc',
+          ],
+        }],
         [ 'OS == "linux" or OS == "freebsd" or OS == "openbsd"', {
             'dependencies': [
               '../build/linux/system.gyp:gtk',
@@ -1111,6 +1149,7 @@
       'sources': [
         'base/cookie_monster_perftest.cc',
         'disk_cache/disk_cache_perftest.cc',
+        'http/http_response_headers_perftest.cc',
         'proxy/proxy_resolver_perftest.cc',
       ],
       'conditions': [
@@ -8,6 +8,7 @@
 #include "base/metrics/histogram.h"
 #include "base/string_number_conversions.h"
 #include "base/values.h"
+#include "net/base/io_buffer.h"
 
 namespace net {
 
@@ -144,6 +145,34 @@ void ClientSocket::UseHistory::EmitPreconnectionHistograms() const {
   }
 }
 
+int ClientSocket::Writev(IOBuffer* const* bufs, const int* buf_lens,
+                         int buf_count, CompletionCallback* callback) {
+  int total_len = 0;
+  int last_non_empty = -1;
+  for (int i = 0; i < buf_count; ++i) {
+    DCHECK_GE(buf_lens[i], 0);
+    if (buf_lens[i]) {
+      total_len += buf_lens[i];
+      last_non_empty = i;
+    }
+  }
+  DCHECK_GT(total_len, 0);
+
+  // A single buffer can be written without copying it.
+  if (buf_lens[last_non_empty] == total_len)
+    return Write(bufs[last_non_empty], total_len, callback);
+
+  scoped_refptr<IOBuffer> buf(new IOBuffer(total_len));
+  char* dest = buf->data();
+  for (int i = 0; i < buf_count; ++i) {
+    if (!buf_lens[i])
+      continue;
+    memcpy(dest, bufs[i]->data(), buf_lens[i]);
+    dest += buf_lens[i];
+  }
+  return Write(buf, total_len, callback);
+}
+
 void ClientSocket::LogByteTransfer(const BoundNetLog& net_log,
                                    NetLog::EventType event_type,
                                    int byte_count,
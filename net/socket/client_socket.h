@@ -85,6 +85,18 @@ class ClientSocket : public Socket {
   // TCP FastOpen is an experiment with sending data in the TCP SYN packet.
   virtual bool UsingTCPFastOpen() const = 0;
 
+  // Writes the first |buf_lens[i]| bytes of each of the |buf_count| buffers in
+  // |bufs|, in order, as though they were one buffer passed to Write().  The
+  // return value and the rules for pending writes are the same as for Write();
+  // in particular, only part of the data may be written.  Empty buffers are
+  // allowed, but the total length must be positive.
+  //
+  // The default implementation copies the data into a single buffer and calls
+  // Write().  Sockets that can pass the buffers to the OS as they are, such as
+  // TCP sockets on POSIX, override it.
+  virtual int Writev(IOBuffer* const* bufs, const int* buf_lens, int buf_count,
+                     CompletionCallback* callback);
+
  protected:
   // The following class is only used to gather statistics about the history of
   // a socket.  It is only instantiated and used in basic sockets, such as
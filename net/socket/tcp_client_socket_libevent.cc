@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/tcp.h>
 #if defined(OS_POSIX)
 #include <netinet/in.h>
@@ -17,6 +18,7 @@
 #include "base/logging.h"
 #include "base/message_loop.h"
 #include "base/metrics/stats_counters.h"
+#include "base/stl_util-inl.h"
 #include "base/string_util.h"
 #include "net/base/address_list_net_log_param.h"
 #include "net/base/connection_type_histograms.h"
@@ -340,6 +342,10 @@ void TCPClientSocketLibevent::DoDisconnect() {
     PLOG(ERROR) << "close";
   socket_ = kInvalidSocket;
   previously_disconnected_ = true;
+
+  // Drop the buffers of any pending Writev().
+  write_bufs_.clear();
+  write_buf_lens_.clear();
 }
 
 bool TCPClientSocketLibevent::IsConnected() const {
@@ -453,6 +459,55 @@ int TCPClientSocketLibevent::Write(IOBuffer* buf,
   return ERR_IO_PENDING;
 }
 
+int TCPClientSocketLibevent::Writev(IOBuffer* const* bufs,
+                                    const int* buf_lens,
+                                    int buf_count,
+                                    CompletionCallback* callback) {
+  DCHECK(CalledOnValidThread());
+  DCHECK_NE(kInvalidSocket, socket_);
+  DCHECK(!waiting_connect());
+  DCHECK(!write_callback_);
+  // Synchronous operation not supported
+  DCHECK(callback);
+  DCHECK_GT(buf_count, 0);
+
+  // The first write of a TCP FastOpen connection goes out with sendto().
+  if (use_tcp_fastopen_ && !tcp_fastopen_connected_)
+    return ClientSocket::Writev(bufs, buf_lens, buf_count, callback);
+
+  write_bufs_.assign(bufs, bufs + buf_count);
+  write_buf_lens_.assign(buf_lens, buf_lens + buf_count);
+
+  int nwrite = InternalWritev();
+  if (nwrite >= 0) {
+    base::StatsCounter write_bytes("tcp.write_bytes");
+    write_bytes.Add(nwrite);
+    if (nwrite > 0)
+      use_history_.set_was_used_to_convey_data();
+    LogWritevTransfer(nwrite);
+    write_bufs_.clear();
+    write_buf_lens_.clear();
+    return nwrite;
+  }
+  if (errno != EAGAIN && errno != EWOULDBLOCK) {
+    write_bufs_.clear();
+    write_buf_lens_.clear();
+    return MapSystemError(errno);
+  }
+
+  if (!MessageLoopForIO::current()->WatchFileDescriptor(
+          socket_, true, MessageLoopForIO::WATCH_WRITE,
+          &write_socket_watcher_, &write_watcher_)) {
+    DVLOG(1) << "WatchFileDescriptor failed on write, errno " << errno;
+    write_bufs_.clear();
+    write_buf_lens_.clear();
+    return MapSystemError(errno);
+  }
+
+  write_callback_ = callback;
+  return ERR_IO_PENDING;
+}
+
 int TCPClientSocketLibevent::InternalWrite(IOBuffer* buf, int buf_len) {
   int nwrite;
   if (use_tcp_fastopen_ && !tcp_fastopen_connected_) {
@@ -485,6 +540,37 @@ int TCPClientSocketLibevent::InternalWrite(IOBuffer* buf, int buf_len) {
   return nwrite;
 }
 
+int TCPClientSocketLibevent::InternalWritev() {
+  // Any buffers beyond the first |kMaxIovecs| are left for the caller to
+  // write again, as with any partial write.
+  const size_t kMaxIovecs = 16;
+  struct iovec iov[kMaxIovecs];
+  size_t count = std::min(write_bufs_.size(), kMaxIovecs);
+  for (size_t i = 0; i < count; ++i) {
+    iov[i].iov_base = write_bufs_[i]->data();
+    iov[i].iov_len = write_buf_lens_[i];
+  }
+  return HANDLE_EINTR(writev(socket_, iov, count));
+}
+
+void TCPClientSocketLibevent::LogWritevTransfer(int byte_count) {
+  if (!net_log_.IsLoggingBytes()) {
+    LogByteTransfer(net_log_, NetLog::TYPE_SOCKET_BYTES_SENT, byte_count,
+                    NULL);
+    return;
+  }
+
+  std::string bytes;
+  bytes.reserve(byte_count);
+  for (size_t i = 0; i < write_bufs_.size(); ++i) {
+    int len = std::min(write_buf_lens_[i],
+                       byte_count - static_cast<int>(bytes.size()));
+    bytes.append(write_bufs_[i]->data(), len);
+  }
+  LogByteTransfer(net_log_, NetLog::TYPE_SOCKET_BYTES_SENT, byte_count,
+                  string_as_array(&bytes));
+}
+
 bool TCPClientSocketLibevent::SetReceiveBufferSize(int32 size) {
   DCHECK(CalledOnValidThread());
   int rv = setsockopt(socket_, SOL_SOCKET, SO_RCVBUF,
@@ -647,9 +733,14 @@ void TCPClientSocketLibevent::DidCompleteRead() {
 }
 
 void TCPClientSocketLibevent::DidCompleteWrite() {
+  bool is_writev = !write_bufs_.empty();
   int bytes_transferred;
-  bytes_transferred = HANDLE_EINTR(write(socket_, write_buf_->data(),
-                                         write_buf_len_));
+  if (is_writev) {
+    bytes_transferred = InternalWritev();
+  } else {
+    bytes_transferred = HANDLE_EINTR(write(socket_, write_buf_->data(),
+                                           write_buf_len_));
+  }
 
   int result;
   if (bytes_transferred >= 0) {
@@ -658,8 +749,12 @@ void TCPClientSocketLibevent::DidCompleteWrite() {
     write_bytes.Add(bytes_transferred);
     if (bytes_transferred > 0)
       use_history_.set_was_used_to_convey_data();
-    LogByteTransfer(net_log_, NetLog::TYPE_SOCKET_BYTES_SENT, result,
-                    write_buf_->data());
+    if (is_writev) {
+      LogWritevTransfer(result);
+    } else {
+      LogByteTransfer(net_log_, NetLog::TYPE_SOCKET_BYTES_SENT, result,
+                      write_buf_->data());
+    }
   } else {
     result = MapSystemError(errno);
   }
@@ -667,6 +762,8 @@ void TCPClientSocketLibevent::DidCompleteWrite() {
   if (result != ERR_IO_PENDING) {
     write_buf_ = NULL;
     write_buf_len_ = 0;
+    write_bufs_.clear();
+    write_buf_lens_.clear();
     write_socket_watcher_.StopWatchingFileDescriptor();
     DoWriteCallback(result);
   }
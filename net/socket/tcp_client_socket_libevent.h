@@ -6,6 +6,8 @@
 #define NET_SOCKET_TCP_CLIENT_SOCKET_LIBEVENT_H_
 #pragma once
 
+#include <vector>
+
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/message_loop.h"
@@ -64,6 +66,8 @@ class TCPClientSocketLibevent : public ClientSocket, base::NonThreadSafe {
   // Full duplex mode (reading and writing at the same time) is supported
   virtual int Read(IOBuffer* buf, int buf_len, CompletionCallback* callback);
   virtual int Write(IOBuffer* buf, int buf_len, CompletionCallback* callback);
+  virtual int Writev(IOBuffer* const* bufs, const int* buf_lens, int buf_count,
+                     CompletionCallback* callback);
   virtual bool SetReceiveBufferSize(int32 size);
   virtual bool SetSendBufferSize(int32 size);
 
@@ -148,6 +152,12 @@ class TCPClientSocketLibevent : public ClientSocket, base::NonThreadSafe {
   // Internal function to write to a socket.
   int InternalWrite(IOBuffer* buf, int buf_len);
 
+  // Internal function to write |write_bufs_| to a socket with writev().
+  int InternalWritev();
+
+  // Logs a SOCKET_BYTES_SENT event for |byte_count| bytes of |write_bufs_|.
+  void LogWritevTransfer(int byte_count);
+
   int socket_;
 
   // The list of addresses we should try in order to establish a connection.
@@ -172,6 +182,11 @@ class TCPClientSocketLibevent : public ClientSocket, base::NonThreadSafe {
   scoped_refptr<IOBuffer> write_buf_;
   int write_buf_len_;
 
+  // The buffers of the Writev request being written, if any, instead of
+  // |write_buf_|.
+  std::vector<scoped_refptr<IOBuffer> > write_bufs_;
+  std::vector<int> write_buf_lens_;
+
   // External callback; called when read is complete.
   CompletionCallback* read_callback_;
 
@@ -4,6 +4,8 @@
 
 #include "net/socket/tcp_client_socket.h"
 
+#include <algorithm>
+
 #include "base/basictypes.h"
 #include "net/base/address_list.h"
 #include "net/base/host_resolver.h"
@@ -281,6 +283,40 @@ TEST_P(TransportClientSocketTest, Read) {
   EXPECT_EQ(0, callback.WaitForResult());
 }
 
+TEST_P(TransportClientSocketTest, Writev) {
+  TestCompletionCallback callback;
+  int rv = sock_->Connect(&callback);
+  if (rv != OK) {
+    ASSERT_EQ(rv, ERR_IO_PENDING);
+
+    rv = callback.WaitForResult();
+    EXPECT_EQ(rv, OK);
+  }
+
+  // Send the request in three pieces, one of them empty.
+  const char* const kPieces[] = { "GET / HTTP/1.0\r\n", "", "\r\n" };
+  scoped_refptr<IOBuffer> piece_bufs[arraysize(kPieces)];
+  IOBuffer* bufs[arraysize(kPieces)];
+  int buf_lens[arraysize(kPieces)];
+  int total_len = 0;
+  for (size_t i = 0; i < arraysize(kPieces); ++i) {
+    buf_lens[i] = strlen(kPieces[i]);
+    piece_bufs[i] = new IOBuffer(std::max(buf_lens[i], 1));
+    memcpy(piece_bufs[i]->data(), kPieces[i], buf_lens[i]);
+    bufs[i] = piece_bufs[i];
+    total_len += buf_lens[i];
+  }
+  rv = sock_->Writev(bufs, buf_lens, arraysize(bufs), &callback);
+  if (rv == ERR_IO_PENDING)
+    rv = callback.WaitForResult();
+  EXPECT_EQ(total_len, rv);
+
+  scoped_refptr<IOBuffer> buf(new IOBuffer(4096));
+  uint32 bytes_read = DrainClientSocket(buf, 4096, arraysize(kServerReply) - 1,
+                                        &callback);
+  ASSERT_EQ(bytes_read, arraysize(kServerReply) - 1);
+}
+
 TEST_P(TransportClientSocketTest, Read_SmallChunks) {
   TestCompletionCallback callback;
   int rv = sock_->Connect(&callback);
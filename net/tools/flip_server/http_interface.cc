@@ -317,6 +317,31 @@ void HttpSM::SendDataFrameImpl(uint32 stream_id, const char* data, int64 len,
   EnqueueDataFrame(df);
 }
 
+void HttpSM::SendFileDataFrame(uint32 stream_id, int file, off_t offset,
+                               int64 len) {
+  char chunk_buf[128];
+  snprintf(chunk_buf, sizeof(chunk_buf), "%x\r\n", (unsigned int)len);
+  std::string chunk_description(chunk_buf);
+  DataFrame* df = new DataFrame;
+  df->size = chunk_description.size();
+  char* buffer = new char[df->size];
+  df->data = buffer;
+  df->delete_when_done = true;
+  memcpy(buffer, chunk_description.data(), chunk_description.size());
+  EnqueueDataFrame(df);
+
+  df = new DataFrame;
+  df->size = len;
+  df->file = file;
+  df->file_offset = offset;
+  EnqueueDataFrame(df);
+
+  df = new DataFrame;
+  df->data = "\r\n";
+  df->size = 2;
+  EnqueueDataFrame(df);
+}
+
 void HttpSM::EnqueueDataFrame(DataFrame* df) {
   VLOG(2) << ACCEPTOR_CLIENT_IDENT << "HttpSM: Enqueue data frame: stream "
           << stream_id_;
@@ -350,9 +375,16 @@ void HttpSM::GetOutput() {
   if (num_to_write > mci->max_segment_size)
     num_to_write = mci->max_segment_size;
 
-  SendDataFrame(mci->stream_id,
-                mci->file_data->body.data() + mci->body_bytes_consumed,
-                num_to_write, 0, true);
+  // Large bodies are sent straight from the cache file, if possible.
+  if (mci->file_data->body_file != -1 && connection_->can_send_from_file()) {
+    SendFileDataFrame(mci->stream_id, mci->file_data->body_file,
+                      mci->file_data->body_offset + mci->body_bytes_consumed,
+                      num_to_write);
+  } else {
+    SendDataFrame(mci->stream_id,
+                  mci->file_data->body.data() + mci->body_bytes_consumed,
+                  num_to_write, 0, true);
+  }
   VLOG(2) << ACCEPTOR_CLIENT_IDENT << "HttpSM: GetOutput SendDataFrame["
           << mci->stream_id << "]: " << num_to_write;
   mci->body_bytes_consumed += num_to_write;
@@ -111,6 +111,8 @@ class HttpSM : public BalsaVisitorInterface,
   size_t SendSynStreamImpl(uint32 stream_id, const BalsaHeaders& headers);
   void SendDataFrameImpl(uint32 stream_id, const char* data, int64 len,
                          uint32 flags, bool compress);
+  // Sends a chunk with |len| bytes of |file|, starting at |offset|.
+  void SendFileDataFrame(uint32 stream_id, int file, off_t offset, int64 len);
   void EnqueueDataFrame(DataFrame* df);
   virtual void GetOutput();
 
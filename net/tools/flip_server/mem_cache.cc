@@ -22,6 +22,14 @@
 // The directory where cache locates);
 std::string FLAGS_cache_base_dir = ".";
 
+namespace {
+
+// Bodies of at least this size that are stored verbatim on the cache files
+// are sent straight from the file.
+const size_t kMinBodyFileSize = 64 * 1024;
+
+}  // namespace
+
 namespace net {
 
 void StoreBodyAndHeadersVisitor::ProcessBodyData(const char *input,
@@ -46,10 +54,10 @@ void StoreBodyAndHeadersVisitor::HandleBodyError(BalsaFrame* framer) {
 }
 
 FileData::FileData(BalsaHeaders* h, const std::string& b)
-    : headers(h), body(b) {
+    : headers(h), body(b), body_file(-1), body_offset(0) {
 }
 
-FileData::FileData() {}
+FileData::FileData() : body_file(-1), body_offset(0) {}
 
 FileData::~FileData() {}
 
@@ -59,11 +67,16 @@ void FileData::CopyFrom(const FileData& file_data) {
     filename = file_data.filename;
     related_files = file_data.related_files;
     body = file_data.body;
+    body_file = file_data.body_file;
+    body_offset = file_data.body_offset;
   }
 
 MemoryCache::MemoryCache() {}
 
-MemoryCache::~MemoryCache() {}
+MemoryCache::~MemoryCache() {
+  for (size_t i = 0; i < body_files_.size(); ++i)
+    close(body_files_[i]);
+}
 
 void MemoryCache::CloneFrom(const MemoryCache& mc) {
   for (Files::const_iterator i = mc.files_.begin();
@@ -201,6 +214,18 @@ void MemoryCache::ReadAndStoreFileContents(const char* filename) {
   fd = FileData(headers, visitor.body);
   fd.filename = std::string(filename_stripped,
                             filename_stripped.find_first_of('/'));
+
+  size_t body_size = visitor.body.size();
+  if (body_size >= kMinBodyFileSize &&
+      filename_contents.compare(filename_contents.size() - body_size,
+                                body_size, visitor.body) == 0) {
+    int body_file = open(filename, O_RDONLY);
+    if (body_file != -1) {
+      body_files_.push_back(body_file);
+      fd.body_file = body_file;
+      fd.body_offset = filename_contents.size() - body_size;
+    }
+  }
 }
 
 FileData* MemoryCache::GetFileData(const std::string& filename) {
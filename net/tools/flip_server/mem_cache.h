@@ -5,6 +5,8 @@
 #ifndef NET_TOOLS_FLIP_SERVER_MEM_CACHE_H_
 #define NET_TOOLS_FLIP_SERVER_MEM_CACHE_H_
 
+#include <sys/types.h>
+
 #include <map>
 #include <string>
 #include <vector>
@@ -71,6 +73,11 @@ struct FileData {
   // priority, filename
   std::vector< std::pair<int, std::string> > related_files;
   std::string body;
+  // When the body is stored verbatim on the cache file, an open descriptor for
+  // that file and the offset of the body, so that the body can be sent without
+  // copying it to user space. Otherwise, |body_file| is -1.
+  int body_file;
+  off_t body_offset;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -126,6 +133,11 @@ class MemoryCache {
 
   Files files_;
   std::string cwd_;
+
+ private:
+  // Descriptors opened by this object (and not by the object we were cloned
+  // from).
+  std::vector<int> body_files_;
 };
 
 class NotifierInterface {
@@ -6,6 +6,7 @@
 
 #include <errno.h>
 #include <netinet/tcp.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 
 #include <list>
@@ -219,6 +220,17 @@ int SMConnection::Send(const char* data, int len, int flags) {
   return rv;
 }
 
+int SMConnection::SendFromFile(int file, off_t offset, int len, int flags) {
+  DCHECK(!ssl_);
+  // sendfile() doesn't take flags: the socket stays corked while there is more
+  // data to send.
+  CorkSocket();
+  int rv = sendfile(fd_, file, &offset, len);
+  if (!(flags & MSG_MORE))
+    UncorkSocket();
+  return rv;
+}
+
 void SMConnection::OnRegistration(EpollServer* eps, int fd, int event_mask) {
   registered_in_epoll_server_ = true;
 }
@@ -550,9 +562,7 @@ bool SMConnection::DoWrite() {
       sm_interface_->GetOutput();
     }
     DataFrame* data_frame = output_list_.front();
-    const char*  bytes = data_frame->data;
     int size = data_frame->size;
-    bytes += data_frame->index;
     size -= data_frame->index;
     DCHECK_GE(size, 0);
     if (size <= 0) {
@@ -570,7 +580,14 @@ bool SMConnection::DoWrite() {
       flags |= MSG_MORE;
     }
     VLOG(2) << log_prefix_ << "Attempting to send " << size << " bytes.";
-    ssize_t bytes_written = Send(bytes, size, flags);
+    ssize_t bytes_written;
+    if (data_frame->file != -1) {
+      bytes_written = SendFromFile(data_frame->file,
+                                   data_frame->file_offset + data_frame->index,
+                                   size, flags);
+    } else {
+      bytes_written = Send(data_frame->data + data_frame->index, size, flags);
+    }
     int stored_errno = errno;
     if (bytes_written == -1) {
       switch (stored_errno) {
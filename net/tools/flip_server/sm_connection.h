@@ -6,6 +6,7 @@
 #define NET_TOOLS_FLIP_SERVER_SM_CONNECTION_H_
 
 #include <arpa/inet.h>  // in_addr_t
+#include <sys/types.h>
 #include <time.h>
 
 #include <list>
@@ -24,14 +25,20 @@ class FlipAcceptor;
 class MemoryCache;
 struct SSLState;
 
-// A frame of data to be sent.
+// A frame of data to be sent. If |file| is not -1, the frame is sent straight
+// from |size| bytes of that file, starting at |file_offset|, instead of from
+// |data|.
 class DataFrame {
  public:
   const char* data;
   size_t size;
   bool delete_when_done;
   size_t index;
-  DataFrame() : data(NULL), size(0), delete_when_done(false), index(0) {}
+  int file;
+  off_t file_offset;
+  DataFrame()
+      : data(NULL), size(0), delete_when_done(false), index(0), file(-1),
+        file_offset(0) {}
   virtual ~DataFrame() {
     if (delete_when_done)
       delete[] data;
@@ -81,6 +88,11 @@ class SMConnection : public SMConnectionInterface,
 
   int Send(const char* data, int len, int flags);
 
+  // Sends |len| bytes of |file|, starting at |offset|, without copying them to
+  // user space. Only available when the connection doesn't use SSL.
+  int SendFromFile(int file, off_t offset, int len, int flags);
+  bool can_send_from_file() const { return ssl_ == NULL; }
+
   // EpollCallbackInterface interface.
   virtual void OnRegistration(EpollServer* eps, int fd, int event_mask);
   virtual void OnModification(int fd, int event_mask) {}